@@ -1,6 +1,10 @@
 #include "animated_model.h"
+#include "binary_cache.h"
+#include "thread_pool.h"
+#include "timer.h"
 
 #include <assimp/postprocess.h>
+#include <bit>
 #include <glm/gtc/matrix_transform.hpp>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -9,237 +13,481 @@
 
 namespace RGL
 {
+    /* Dual quaternion of the rigid transformation, real part in the first column, both in the (w, x, y, z) order. */
+    static glm::mat2x4 ToDualQuaternion(const glm::mat4& transform)
+    {
+        glm::quat      rotation(transform);
+        glm::fdualquat dq      (rotation, transform[3]);
+
+        return glm::mat2x4(glm::vec4(dq.real.w, dq.real.x, dq.real.y, dq.real.z), 
+                           glm::vec4(dq.dual.w, dq.dual.x, dq.dual.y, dq.dual.z));
+    }
+
+    /* Per thread buffers of UpdateInstances(), they only grow, so that the steady state updates don't allocate. */
+    struct AnimationScratchBuffers
+    {
+        Pose                         pose;
+        Pose                         layer_pose;
+        Pose                         fade_pose;
+        std::vector<AffineTransform> node_transforms;
+        std::vector<glm::mat4>       palette;
+    };
+
+    static AnimationScratchBuffers& GetScratchBuffers(uint32_t nodes_count, uint32_t bones_count)
+    {
+        thread_local AnimationScratchBuffers buffers;
+
+        /* The poses of all models are evaluated in the same buffers, the pose's size has to match the skeleton's. */
+        if (buffers.pose.GetNodesCount() != nodes_count)
+        {
+            buffers.pose      .Resize(nodes_count);
+            buffers.layer_pose.Resize(nodes_count);
+            buffers.fade_pose .Resize(nodes_count);
+        }
+
+        if (buffers.node_transforms.size() < nodes_count)
+        {
+            buffers.node_transforms.resize(nodes_count);
+        }
+
+        if (buffers.palette.size() < bones_count)
+        {
+            buffers.palette.resize(bones_count);
+        }
+
+        return buffers;
+    }
+
     void AnimatedModel::BoneTransform(float dt, std::vector<glm::mat4>& transforms)
     {
-        if (m_assimp_scene->mNumAnimations > 0)
+        if (!m_animation_clips.empty())
         {
-            /* Calc animation duration */
-            float ticks_per_second = (float)(m_assimp_scene->mAnimations[m_current_animation]->mTicksPerSecond != 0 ? m_assimp_scene->mAnimations[m_current_animation]->mTicksPerSecond : 25.0f);
-            float animation_duration = (float)m_assimp_scene->mAnimations[m_current_animation]->mDuration;
+            UpdateBones(dt);
 
-            m_current_animation_time += ticks_per_second * dt * m_animation_speed;
-            m_current_animation_time = fmod(m_current_animation_time, animation_duration);
+            transforms.assign(m_bone_palette.begin(), m_bone_palette.end());
+        }
+    }
 
-            ReadNodeHierarchy(m_current_animation_time, m_assimp_scene->mRootNode, glm::mat4(1.0f));
+    void AnimatedModel::BoneTransform(float dt, std::vector<glm::mat2x4>& transforms)
+    {
+        if (!m_animation_clips.empty())
+        {
+            UpdateBones(dt);
 
             transforms.resize(m_bones_count);
 
             for (uint32_t i = 0; i < m_bones_count; ++i)
             {
-                transforms[i] = m_bone_infos[i].m_final_transform;
+                transforms[i] = ToDualQuaternion(m_bone_palette[i]);
             }
         }
     }
 
-    void AnimatedModel::BoneTransform(float dt, std::vector<glm::mat2x4>& transforms)
+    AnimationUpdateStats AnimatedModel::UpdateInstances(float dt, std::span<AnimationState> instances, std::span<glm::mat4> palettes) const
     {
-        if (m_assimp_scene->mNumAnimations > 0)
+        return UpdateInstancesImpl(instances.size(), instances.size(), palettes, [&](size_t i, Pose& pose, Pose&, Pose& fade_pose)
         {
-            /* Calc animation duration */
-            float ticks_per_second = (float)(m_assimp_scene->mAnimations[m_current_animation]->mTicksPerSecond != 0 ? m_assimp_scene->mAnimations[m_current_animation]->mTicksPerSecond : 25.0f);
-            float animation_duration = (float)m_assimp_scene->mAnimations[m_current_animation]->mDuration;
+            AdvanceAnimation(dt, instances[i]);
+            SamplePose(instances[i], pose, fade_pose);
 
-            m_current_animation_time += ticks_per_second * dt * m_animation_speed;
-            m_current_animation_time = fmod(m_current_animation_time, animation_duration);
+            return InstanceEvaluation{ uint32_t(i), false };
+        });
+    }
 
-            ReadNodeHierarchy(m_current_animation_time, m_assimp_scene->mRootNode, glm::mat4(1.0f));
+    AnimationUpdateStats AnimatedModel::UpdateInstances(float dt, std::span<AnimationState> instances, std::span<glm::mat2x4> palettes) const
+    {
+        return UpdateInstancesImpl(instances.size(), instances.size(), palettes, [&](size_t i, Pose& pose, Pose&, Pose& fade_pose)
+        {
+            AdvanceAnimation(dt, instances[i]);
+            SamplePose(instances[i], pose, fade_pose);
 
-            transforms.resize(m_bones_count);
+            return InstanceEvaluation{ uint32_t(i), false };
+        });
+    }
 
-            for (uint32_t i = 0; i < m_bones_count; ++i)
+    AnimationUpdateStats AnimatedModel::UpdateInstances(float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat4> palettes) const
+    {
+        const size_t instances_count = layers_per_instance > 0 ? layers.size() / layers_per_instance : 0;
+
+        return UpdateInstancesImpl(instances_count, instances_count, palettes, [&](size_t i, Pose& pose, Pose& layer_pose, Pose& fade_pose)
+        {
+            auto instance_layers = layers.subspan(i * layers_per_instance, layers_per_instance);
+
+            for (auto& layer : instance_layers)
             {
-                 glm::quat rotation(m_bone_infos[i].m_final_transform);
-                 glm::fdualquat dq (rotation, m_bone_infos[i].m_final_transform[3]);
+                AdvanceAnimation(dt, layer.state);
+            }
+
+            EvaluateLayers(instance_layers, pose, layer_pose, fade_pose);
+
+            return InstanceEvaluation{ uint32_t(i), false };
+        });
+    }
+
+    AnimationUpdateStats AnimatedModel::UpdateInstances(float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat2x4> palettes) const
+    {
+        const size_t instances_count = layers_per_instance > 0 ? layers.size() / layers_per_instance : 0;
 
-                 glm::mat2x4 dq_mat(glm::vec4(dq.real.w, dq.real.x, dq.real.y, dq.real.z), 
-                                    glm::vec4(dq.dual.w, dq.dual.x, dq.dual.y, dq.dual.z));
+        return UpdateInstancesImpl(instances_count, instances_count, palettes, [&](size_t i, Pose& pose, Pose& layer_pose, Pose& fade_pose)
+        {
+            auto instance_layers = layers.subspan(i * layers_per_instance, layers_per_instance);
 
-                 transforms[i] = dq_mat;
+            for (auto& layer : instance_layers)
+            {
+                AdvanceAnimation(dt, layer.state);
             }
-        }
+
+            EvaluateLayers(instance_layers, pose, layer_pose, fade_pose);
+
+            return InstanceEvaluation{ uint32_t(i), false };
+        });
     }
 
-    void AnimatedModel::CalcInterpolatedScaling(aiVector3D& out, float animation_time, const aiNodeAnim* node_anim)
+    void AnimatedModel::AdvanceLayers(float dt, std::span<AnimationLayer> layers) const
     {
-        if (node_anim->mNumScalingKeys == 1)
+        if (m_animation_clips.empty())
         {
-            out = node_anim->mScalingKeys[0].mValue;
             return;
         }
 
-        uint32_t scaling_index      = FindScaling(animation_time, node_anim);
-        uint32_t next_scaling_index = (scaling_index + 1);
+        for (auto& layer : layers)
+        {
+            AdvanceAnimation(dt, layer.state);
+        }
+    }
+
+    AnimationUpdateStats AnimatedModel::EvaluateInstances(std::span<const AnimationLayer> layers, uint32_t layers_per_instance, std::span<const InstanceEvaluation> evaluations, std::span<glm::mat4> palettes) const
+    {
+        const size_t instances_count = layers_per_instance > 0 ? layers.size() / layers_per_instance : 0;
+
+        return UpdateInstancesImpl(instances_count, evaluations.size(), palettes, [&](size_t i, Pose& pose, Pose& layer_pose, Pose& fade_pose)
+        {
+            const auto& evaluation = evaluations[i];
+            const auto  node_mask  = evaluation.reduced ? m_skeleton.GetReducedNodesMask() : std::span<const uint8_t>();
+
+            EvaluateLayers(layers.subspan(evaluation.instance_index * layers_per_instance, layers_per_instance), pose, layer_pose, fade_pose, node_mask);
 
-        assert(next_scaling_index < node_anim->mNumScalingKeys);
+            return evaluation;
+        });
+    }
 
-        float delta_time = (float)(node_anim->mScalingKeys[next_scaling_index].mTime - node_anim->mScalingKeys[scaling_index].mTime);
-        float factor     = (animation_time - (float)node_anim->mScalingKeys[scaling_index].mTime) / delta_time;
+    AnimationUpdateStats AnimatedModel::EvaluateInstances(std::span<const AnimationLayer> layers, uint32_t layers_per_instance, std::span<const InstanceEvaluation> evaluations, std::span<glm::mat2x4> palettes) const
+    {
+        const size_t instances_count = layers_per_instance > 0 ? layers.size() / layers_per_instance : 0;
 
-        assert(factor >= 0.0f && factor <= 1.0f);
+        return UpdateInstancesImpl(instances_count, evaluations.size(), palettes, [&](size_t i, Pose& pose, Pose& layer_pose, Pose& fade_pose)
+        {
+            const auto& evaluation = evaluations[i];
+            const auto  node_mask  = evaluation.reduced ? m_skeleton.GetReducedNodesMask() : std::span<const uint8_t>();
 
-        const aiVector3D& start = node_anim->mScalingKeys[scaling_index].mValue;
-        const aiVector3D& end   = node_anim->mScalingKeys[next_scaling_index].mValue;
+            EvaluateLayers(layers.subspan(evaluation.instance_index * layers_per_instance, layers_per_instance), pose, layer_pose, fade_pose, node_mask);
 
-        aiVector3D delta = end - start;
-        out = start + factor * delta;
+            return evaluation;
+        });
     }
 
-    void AnimatedModel::CalcInterpolatedRotation(aiQuaternion& out, float animation_time, const aiNodeAnim* node_anim)
+    template<typename T, typename Evaluate>
+    AnimationUpdateStats AnimatedModel::UpdateInstancesImpl(size_t instances_count, size_t items_count, std::span<T> palettes, const Evaluate& evaluate) const
     {
-        // we need at least two values to interpolate...
-        if (node_anim->mNumRotationKeys == 1)
+        AnimationUpdateStats stats;
+
+        if (m_animation_clips.empty() || items_count == 0)
         {
-            out = node_anim->mRotationKeys[0].mValue;
-            return;
+            return stats;
+        }
+
+        if (palettes.size() < instances_count * m_bones_count)
+        {
+            fprintf(stderr, "AnimatedModel::UpdateInstances: the palettes buffer is too small for %zu instances.\n", instances_count);
+            return stats;
         }
 
-        uint32_t rotation_index      = FindRotation(animation_time, node_anim);
-        uint32_t next_rotation_index = (rotation_index + 1);
+        const double start_time  = Timer::getTime();
+        const size_t tasks_count = (items_count + INSTANCES_PER_TASK - 1) / INSTANCES_PER_TASK;
+
+        auto process_task = [&](size_t task_index)
+        {
+            auto& buffers = GetScratchBuffers(m_skeleton.GetNodesCount(), m_bones_count);
+
+            const size_t first = task_index * INSTANCES_PER_TASK;
+            const size_t last  = std::min(first + INSTANCES_PER_TASK, items_count);
 
-        assert(next_rotation_index < node_anim->mNumRotationKeys);
+            for (size_t i = first; i < last; ++i)
+            {
+                const InstanceEvaluation evaluation = evaluate(i, buffers.pose, buffers.layer_pose, buffers.fade_pose);
+
+                auto palette = palettes.subspan(size_t(evaluation.instance_index) * m_bones_count, m_bones_count);
 
-        float delta_time = (float)(node_anim->mRotationKeys[next_rotation_index].mTime - node_anim->mRotationKeys[rotation_index].mTime);
-        float factor     = (animation_time - (float)node_anim->mRotationKeys[rotation_index].mTime) / delta_time;
+                if constexpr (std::is_same_v<T, glm::mat4>)
+                {
+                    m_skeleton.ComputeBoneTransforms(buffers.pose, buffers.node_transforms, palette, evaluation.reduced);
+                }
+                else
+                {
+                    m_skeleton.ComputeBoneTransforms(buffers.pose, buffers.node_transforms, buffers.palette, evaluation.reduced);
 
-        assert(factor >= 0.0f && factor <= 1.0f);
+                    for (uint32_t b = 0; b < m_bones_count; ++b)
+                    {
+                        palette[b] = ToDualQuaternion(buffers.palette[b]);
+                    }
+                }
+            }
+        };
 
-        const aiQuaternion& start_rotation_quat = node_anim->mRotationKeys[rotation_index].mValue;
-        const aiQuaternion& end_rotation_quat   = node_anim->mRotationKeys[next_rotation_index].mValue;
+        /* A single task runs on the calling thread without waking up the workers. */
+        if (tasks_count == 1)
+        {
+            process_task(0);
+        }
+        else
+        {
+            ThreadPool::Get().ParallelFor(tasks_count, process_task);
+        }
 
-        aiQuaternion::Interpolate(out, start_rotation_quat, end_rotation_quat, factor);
-        out = out.Normalize();
+        stats.instances_count = uint32_t(items_count);
+        stats.update_time     = (Timer::getTime() - start_time) * 1000.0;
 
+        return stats;
     }
-    void AnimatedModel::CalcInterpolatedPosition(aiVector3D& out, float animation_time, const aiNodeAnim* node_anim)
+
+    uint32_t AnimatedModel::CreateBoneMask(std::string_view root_node_name)
     {
-        if (node_anim->mNumPositionKeys == 1)
+        const int32_t root_index = m_skeleton.FindNode(root_node_name);
+
+        if (root_index < 0)
         {
-            out = node_anim->mPositionKeys[0].mValue;
-            return;
+            fprintf(stderr, "AnimatedModel::CreateBoneMask: there's no node named %.*s.\n", int(root_node_name.size()), root_node_name.data());
+            return AnimationLayer::NO_BONE_MASK;
         }
 
-        uint32_t position_index      = FindPosition(animation_time, node_anim);
-        uint32_t next_position_index = (position_index + 1);
+        /* The descendants of the root follow it in the skeleton's order and their parents precede them. */
+        std::vector<float> mask(m_skeleton.GetNodesCount(), 0.0f);
+        mask[root_index] = 1.0f;
 
-        assert(next_position_index < node_anim->mNumPositionKeys);
+        for (uint32_t i = root_index + 1; i < m_skeleton.GetNodesCount(); ++i)
+        {
+            const int32_t parent_index = m_skeleton.GetParentIndex(i);
+            mask[i] = parent_index >= 0 ? mask[parent_index] : 0.0f;
+        }
 
-        float delta_time = (float)(node_anim->mPositionKeys[next_position_index].mTime - node_anim->mPositionKeys[position_index].mTime);
-        float factor     = (animation_time - (float)node_anim->mPositionKeys[position_index].mTime) / delta_time;
+        m_bone_masks.push_back(std::move(mask));
 
-        assert(factor >= 0.0f && factor <= 1.0f);
+        return uint32_t(m_bone_masks.size() - 1);
+    }
 
-        const aiVector3D& start = node_anim->mPositionKeys[position_index].mValue;
-        const aiVector3D& end  = node_anim->mPositionKeys[next_position_index].mValue;
+    void AnimatedModel::UpdateBones(float dt)
+    {
+        AdvanceAnimation(dt, m_animation_state);
+        SamplePose(m_animation_state, m_pose, m_fade_pose);
 
-        aiVector3D delta = end - start;
-        out = start + factor * delta;
+        m_skeleton.ComputeBoneTransforms(m_pose, m_node_transforms, m_bone_palette);
     }
 
-    uint32_t AnimatedModel::FindScaling(float animation_time, const aiNodeAnim* node_anim)
+    void AnimatedModel::AdvanceAnimation(float dt, AnimationState& state) const
     {
-        assert(node_anim->mNumScalingKeys > 0);
+        state.animation_index = std::min(state.animation_index, m_animations_count - 1);
+        state.time            = WrapTime(state.animation_index, state.time + dt * state.speed);
 
-        for (uint32_t i = 0; i < node_anim->mNumScalingKeys - 1; i++)
+        if (state.fade_duration > 0.0f)
         {
-            if (animation_time < (float)node_anim->mScalingKeys[i + 1].mTime)
+            state.fade_time += dt;
+
+            if (state.fade_time >= state.fade_duration)
+            {
+                state.fade_time     = 0.0f;
+                state.fade_duration = 0.0f;
+            }
+            else
             {
-                return i;
+                state.previous_animation_index = std::min(state.previous_animation_index, m_animations_count - 1);
+                state.previous_time            = WrapTime(state.previous_animation_index, state.previous_time + dt * state.speed);
             }
         }
+    }
+
+    float AnimatedModel::WrapTime(uint32_t animation_index, float time) const
+    {
+        const float duration = m_animation_clips[animation_index].GetDuration();
+
+        if (duration <= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        time = fmod(time, duration);
+
+        return time < 0.0f ? time + duration : time;
+    }
+
+    void AnimatedModel::SamplePose(const AnimationState& state, Pose& pose, Pose& fade_pose, std::span<const uint8_t> node_mask) const
+    {
+        /* The nodes that the clip doesn't animate keep their bind pose. */
+        pose.CopyFrom(m_skeleton.GetBindPose());
+        m_animation_clips[state.animation_index].Sample(state.time, pose, node_mask);
 
-        assert(0);
+        if (state.fade_duration > 0.0f)
+        {
+            fade_pose.CopyFrom(m_skeleton.GetBindPose());
+            m_animation_clips[state.previous_animation_index].Sample(state.previous_time, fade_pose, node_mask);
 
-        return 0;
+            pose.Blend(fade_pose, 1.0f - state.GetFadeWeight());
+        }
     }
 
-    uint32_t AnimatedModel::FindRotation(float animation_time, const aiNodeAnim* node_anim)
+    void AnimatedModel::EvaluateLayers(std::span<const AnimationLayer> layers, Pose& pose, Pose& layer_pose, Pose& fade_pose, std::span<const uint8_t> node_mask) const
     {
-        assert(node_anim->mNumRotationKeys > 0);
+        if (layers.empty())
+        {
+            pose.CopyFrom(m_skeleton.GetBindPose());
+            return;
+        }
 
-        for (uint32_t i = 0; i < node_anim->mNumRotationKeys - 1; i++)
+        SamplePose(layers[0].state, pose, fade_pose, node_mask);
+
+        for (size_t i = 1; i < layers.size(); ++i)
         {
-            if (animation_time < (float)node_anim->mRotationKeys[i + 1].mTime)
+            const auto& layer = layers[i];
+
+            if (layer.weight <= 0.0f)
             {
-                return i;
+                continue;
             }
-        }
 
-        assert(0);
+            SamplePose(layer.state, layer_pose, fade_pose, node_mask);
 
-        return 0;
+            const auto mask = layer.bone_mask < m_bone_masks.size() ? std::span<const float>(m_bone_masks[layer.bone_mask]) : std::span<const float>();
+            pose.Blend(layer_pose, std::min(layer.weight, 1.0f), mask);
+        }
     }
 
-    uint32_t AnimatedModel::FindPosition(float animation_time, const aiNodeAnim* node_anim)
+    void AnimatedModel::LoadSkeleton(const aiNode* node, int32_t parent_index, std::unordered_map<std::string, uint32_t>& node_indices)
     {
-        for (uint32_t i = 0; i < node_anim->mNumPositionKeys - 1; i++)
+        const uint32_t node_index = m_skeleton.GetNodesCount();
+        const auto     bone_it    = m_bones_mapping.find(node->mName.C_Str());
+
+        aiVector3D   scaling;
+        aiQuaternion rotation;
+        aiVector3D   position;
+        node->mTransformation.Decompose(scaling, rotation, position);
+
+        m_skeleton.m_node_names  .push_back(node->mName.C_Str());
+        m_skeleton.m_parents     .push_back(parent_index);
+        m_skeleton.m_bone_indices.push_back(bone_it != m_bones_mapping.end() ? int32_t(bone_it->second) : -1);
+
+        m_skeleton.m_bind_pose.translations.push_back(vec3_cast(position));
+        m_skeleton.m_bind_pose.rotations   .push_back(glm::normalize(quat_cast(rotation)));
+        m_skeleton.m_bind_pose.scales      .push_back(vec3_cast(scaling));
+
+        node_indices.emplace(node->mName.C_Str(), node_index);
+
+        for (uint32_t i = 0; i < node->mNumChildren; ++i)
         {
-            if (animation_time < (float)node_anim->mPositionKeys[i + 1].mTime)
-            {
-                return i;
-            }
+            LoadSkeleton(node->mChildren[i], int32_t(node_index), node_indices);
         }
+    }
+
+    static constexpr uint32_t ANIMATION_CACHE_MAGIC   = 0x4d494e41; /* "ANIM" */
+    static constexpr uint32_t ANIMATION_CACHE_VERSION = 2;
+
+    void AnimatedModel::LoadAnimations(const aiScene* scene, const std::unordered_map<std::string, uint32_t>& node_indices)
+    {
+        m_animation_clips.reserve(scene->mNumAnimations);
 
-        assert(0);
+        for (uint32_t i = 0; i < scene->mNumAnimations; ++i)
+        {
+            m_animation_clips.push_back(AnimationClip::Bake(scene->mAnimations[i], node_indices, m_skeleton.GetNodesCount(), m_animation_compression));
+        }
 
-        return 0;
+        m_animations_count = uint32_t(m_animation_clips.size());
     }
 
-    const aiNodeAnim* AnimatedModel::FindNodeAnim(const aiAnimation* animation, std::string_view node_name)
+    bool AnimatedModel::LoadAnimationCache(const std::filesystem::path& cache_filepath, uint64_t source_hash)
     {
-        for (uint32_t i = 0; i < animation->mNumChannels; i++)
+        BinaryCacheReader reader;
+
+        if (!reader.Open(cache_filepath, ANIMATION_CACHE_MAGIC, ANIMATION_CACHE_VERSION, source_hash, GetAnimationCacheKey()))
         {
-            const aiNodeAnim* node_anim = animation->mChannels[i];
+            return false;
+        }
+
+        /* The count is checked before it's used to allocate the clips. */
+        const uint32_t clips_count = reader.Read<uint32_t>();
+
+        if (reader.HasFailed() || clips_count > reader.GetRemainingSize() / AnimationClip::MIN_SERIALIZED_SIZE)
+        {
+            fprintf(stderr, "Animation cache %s is corrupted, the animations will be recompressed.\n", cache_filepath.generic_string().c_str());
+            return false;
+        }
+
+        m_animation_clips.resize(clips_count);
 
-            if (std::string(node_anim->mNodeName.data) == node_name)
+        for (auto& clip : m_animation_clips)
+        {
+            if (!clip.Read(reader, m_skeleton.GetNodesCount()))
             {
-                return node_anim;
+                break;
             }
         }
 
-        return nullptr;
+        if (reader.HasFailed() || !reader.IsAtEnd())
+        {
+            fprintf(stderr, "Animation cache %s is corrupted, the animations will be recompressed.\n", cache_filepath.generic_string().c_str());
+            m_animation_clips.clear();
+
+            return false;
+        }
+
+        m_animations_count = uint32_t(m_animation_clips.size());
+
+        return true;
     }
 
-    void AnimatedModel::ReadNodeHierarchy(float animation_time, const aiNode* node, const glm::mat4& parent_transform)
+    bool AnimatedModel::SaveAnimationCache(const std::filesystem::path& cache_filepath, uint64_t source_hash) const
     {
-              std::string  node_name      = std::string(node->mName.data);
-        const aiAnimation* animation      = m_assimp_scene->mAnimations[m_current_animation];
-              glm::mat4    node_transform = mat4_cast(node->mTransformation);
-        const aiNodeAnim* node_anim       = FindNodeAnim(animation, node_name);
+        BinaryCacheWriter writer(ANIMATION_CACHE_MAGIC, ANIMATION_CACHE_VERSION, source_hash, GetAnimationCacheKey());
 
-        if (node_anim)
+        writer.Write(uint32_t(m_animation_clips.size()));
+
+        for (auto& clip : m_animation_clips)
         {
-            // Interpolate scaling and generate scaling transformation matrix
-            aiVector3D scaling;
-            CalcInterpolatedScaling(scaling, animation_time, node_anim);
-            glm::mat4 scaling_mat = glm::scale(glm::mat4(1.0), vec3_cast(scaling));
+            clip.Write(writer);
+        }
 
-            // Interpolate rotation and generate rotation transformation matrix
-            aiQuaternion rotation_quat;
-            CalcInterpolatedRotation(rotation_quat, animation_time, node_anim);
-            glm::quat rotation     = quat_cast(rotation_quat);
-            glm::mat4 rotation_mat = glm::toMat4(rotation);
+        return writer.Save(cache_filepath);
+    }
 
-            // Interpolate translation and generate translation transformation matrix
-            aiVector3D translation;
-            CalcInterpolatedPosition(translation, animation_time, node_anim);
-            glm::mat4 translation_mat = glm::translate(glm::mat4(1.0), vec3_cast(translation));
+    uint64_t AnimatedModel::GetAnimationCacheKey() const
+    {
+        /* The tolerances and the skeleton's size, the clips store the node indices. */
+        uint64_t key = m_skeleton.GetNodesCount();
 
-            // Combine the above transformations
-            node_transform = translation_mat * rotation_mat * scaling_mat;
+        for (float tolerance : { m_animation_compression.translation_tolerance, m_animation_compression.rotation_tolerance, m_animation_compression.scale_tolerance })
+        {
+            key = (key ^ std::bit_cast<uint32_t>(tolerance)) * 1099511628211ull;
         }
 
-        glm::mat4 global_transform = parent_transform * node_transform;
+        return key;
+    }
 
-        if (m_bones_mapping.find(node_name) != m_bones_mapping.end())
-        {
-            uint32_t bone_index = m_bones_mapping[node_name];
-            m_bone_infos[bone_index].m_final_transform = m_global_inverse_transform * global_transform * m_bone_infos[bone_index].m_bone_offset;
-        }
+    void AnimatedModel::PrintAnimationStats() const
+    {
+        size_t memory_size = 0, source_size = 0;
 
-        for (uint32_t i = 0; i < node->mNumChildren; i++)
+        for (auto& clip : m_animation_clips)
         {
-            ReadNodeHierarchy(animation_time, node->mChildren[i], global_transform);
+            auto& stats = clip.GetStats();
+
+            printf("Animation '%s': %.2f s, %u channels, %u of %u keys, %.1f KB (%.1f KB uncompressed, %.1f KB source keys), "
+                   "max error: translation %g, rotation %.4f deg, scale %g\n",
+                   clip.GetName().c_str(), clip.GetDuration(), clip.GetChannelsCount(), stats.keys_count, stats.source_keys_count,
+                   stats.memory_size / 1024.0, stats.uncompressed_size / 1024.0, stats.source_size / 1024.0,
+                   stats.max_translation_error, glm::degrees(stats.max_rotation_error), stats.max_scale_error);
+
+            memory_size += stats.memory_size;
+            source_size += stats.source_size;
         }
+
+        printf("Animations: %zu clips, %.1f KB (%.1f KB source keys)\n", m_animation_clips.size(), memory_size / 1024.0, source_size / 1024.0);
     }
 
     void AnimatedModel::LoadBones(uint32_t mesh_index, const aiMesh* mesh, std::vector<VertexBoneData>& bones)
@@ -284,36 +532,85 @@ namespace RGL
             Release();
         }
 
-        /* Load model */
-        m_assimp_scene = m_importer.ReadFile(filepath.generic_string(), aiProcess_Triangulate              |
-                                                                        aiProcess_GenSmoothNormals         | 
-                                                                        aiProcess_CalcTangentSpace         |
-                                                                        aiProcess_FlipUVs                  |
-                                                                        aiProcess_JoinIdenticalVertices    | 
-                                                                        aiProcess_RemoveRedundantMaterials | 
-                                                                        aiProcess_GenBoundingBoxes );
+        ReleasePreSkinningBuffers();
+
+        m_bones_mapping.clear();
+        m_bone_infos.clear();
+        m_bones_count = 0;
+        m_skeleton = {};
+        m_animation_clips.clear();
+        m_bone_masks.clear();
+        m_animation_state.animation_index = 0;
+        m_animation_state.time            = 0.0f;
+        m_animation_state.fade_duration   = 0.0f;
+
+        /* Load model. The scene is released when the importer goes out of scope, the animations are baked into the clips. */
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(filepath.generic_string(), aiProcess_Triangulate              |
+                                                                            aiProcess_GenSmoothNormals         | 
+                                                                            aiProcess_CalcTangentSpace         |
+                                                                            aiProcess_FlipUVs                  |
+                                                                            aiProcess_JoinIdenticalVertices    | 
+                                                                            aiProcess_RemoveRedundantMaterials | 
+                                                                            aiProcess_GenBoundingBoxes );
+
+        if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            fprintf(stderr, "Assimp error while loading mesh %s\n Error: %s\n", filepath.generic_string().c_str(), importer.GetErrorString());
+            return false;
+        }
 
-        if (!m_assimp_scene || m_assimp_scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !m_assimp_scene->mRootNode)
+        if (!ParseScene(scene, filepath))
         {
-            fprintf(stderr, "Assimp error while loading mesh %s\n Error: %s\n", filepath.generic_string(), m_importer.GetErrorString());
             return false;
         }
 
-        m_global_inverse_transform = mat4_cast(m_assimp_scene->mRootNode->mTransformation);
-        m_global_inverse_transform = glm::inverse(m_global_inverse_transform);
-        m_animations_count         = m_assimp_scene->mNumAnimations;
+        /* The bones are known after parsing the meshes. */
+        std::unordered_map<std::string, uint32_t> node_indices;
+        LoadSkeleton(scene->mRootNode, -1, node_indices);
+
+        m_skeleton.m_global_inverse_transform = AffineTransform(glm::inverse(mat4_cast(scene->mRootNode->mTransformation)));
+        m_skeleton.m_bone_offsets.resize(m_bones_count);
+
+        for (uint32_t i = 0; i < m_bones_count; ++i)
+        {
+            m_skeleton.m_bone_offsets[i] = AffineTransform(m_bone_infos[i].m_bone_offset);
+        }
+
+        m_skeleton.BuildReducedSkeleton();
+
+        /* The compressed clips are cached next to the mesh cache, keyed by the same source hash. */
+        const uint64_t source_hash          = m_mesh_cache_enabled ? HashModelSource(filepath) : 0;
+        const auto     animation_cache_path = BinaryCache::GetCachePath(filepath, ".rglanim");
+
+        if (source_hash == 0 || !LoadAnimationCache(animation_cache_path, source_hash))
+        {
+            LoadAnimations(scene, node_indices);
+
+            if (source_hash != 0)
+            {
+                SaveAnimationCache(animation_cache_path, source_hash);
+            }
+        }
+
+        PrintAnimationStats();
+
+        /* The buffers used by BoneTransform() are allocated once. */
+        m_pose     .Resize(m_skeleton.GetNodesCount());
+        m_fade_pose.Resize(m_skeleton.GetNodesCount());
+        m_node_transforms.resize(m_skeleton.GetNodesCount());
+        m_bone_palette.assign(m_bones_count, glm::mat4(1.0f));
 
-        return ParseScene(m_assimp_scene, filepath);
+        return true;
     }
 
     std::vector<std::string> AnimatedModel::GetAnimationsNames() const
     {
-        auto animations_count = m_assimp_scene->mNumAnimations;
-        std::vector<std::string> animations_names(animations_count);
+        std::vector<std::string> animations_names(m_animation_clips.size());
 
-        for (uint32_t i = 0; i < animations_count; ++i)
+        for (uint32_t i = 0; i < m_animation_clips.size(); ++i)
         {
-            animations_names[i] = m_assimp_scene->mAnimations[i]->mName.C_Str();
+            animations_names[i] = m_animation_clips[i].GetName();
         }
 
         return animations_names;
@@ -342,6 +639,7 @@ namespace RGL
             m_mesh_parts[i].m_indices_count = scene->mMeshes[i]->mNumFaces * 3;
             m_mesh_parts[i].m_base_vertex = vertices_count;
             m_mesh_parts[i].m_base_index = indices_count;
+            m_mesh_parts[i].m_index_offset = sizeof(uint32_t) * indices_count;
 
             vertices_count += scene->mMeshes[i]->mNumVertices;
             indices_count  += m_mesh_parts[i].m_indices_count;
@@ -383,6 +681,151 @@ namespace RGL
         return true;
     }
 
+    bool AnimatedModel::CreatePreSkinningBuffers(uint32_t max_instances)
+    {
+        ReleasePreSkinningBuffers();
+
+        if (m_vbo_name == 0 || max_instances == 0 || m_vertex_streams[BONE_IDS].size == 0 || m_vertex_streams[TANGENTS].size == 0)
+        {
+            fprintf(stderr, "AnimatedModel::CreatePreSkinningBuffers: the model doesn't have any skinned vertices.\n");
+            return false;
+        }
+
+        if (uint64_t(max_instances) * m_vertices_count > uint64_t(std::numeric_limits<int32_t>::max()))
+        {
+            fprintf(stderr, "AnimatedModel::CreatePreSkinningBuffers: %u instances of %u vertices exceed the base vertex range.\n", max_instances, m_vertices_count);
+            return false;
+        }
+
+        /* The input streams are copied to a separate buffer, so that their offsets are aligned for glBindBufferRange(). */
+        GLint offset_alignment;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+        offset_alignment = std::max(offset_alignment, 1);
+
+        GLsizeiptr input_size = 0;
+
+        for (auto& stream : m_vertex_streams)
+        {
+            stream.input_offset = input_size;
+            input_size         += (stream.size + offset_alignment - 1) / offset_alignment * offset_alignment;
+        }
+
+        glCreateBuffers     (1, &m_pre_skinning_input_buffer_name);
+        glNamedBufferStorage(m_pre_skinning_input_buffer_name, input_size, nullptr, 0);
+
+        for (auto& stream : m_vertex_streams)
+        {
+            glCopyNamedBufferSubData(m_vbo_name, m_pre_skinning_input_buffer_name, stream.vbo_offset, stream.input_offset, stream.size);
+        }
+
+        glCreateBuffers     (1, &m_skinned_vbo_name);
+        glNamedBufferStorage(m_skinned_vbo_name, GLsizeiptr(max_instances) * m_vertices_count * sizeof(SkinnedVertex), nullptr, 0);
+
+        glCreateVertexArrays      (1, &m_skinned_vao_name);
+        glVertexArrayVertexBuffer (m_skinned_vao_name, 0 /* bindingindex*/, m_skinned_vbo_name, 0, sizeof(SkinnedVertex) /*stride*/);
+        glVertexArrayElementBuffer(m_skinned_vao_name, m_ibo_name);
+
+        const GLuint relative_offsets[] = { offsetof(SkinnedVertex, position), offsetof(SkinnedVertex, texcoord), offsetof(SkinnedVertex, normal), offsetof(SkinnedVertex, tangent) };
+        const GLint  sizes[]            = { 3, 2, 3, 3 };
+
+        for (GLuint i = 0; i < std::size(sizes); ++i)
+        {
+            glEnableVertexArrayAttrib (m_skinned_vao_name, i /*attribindex*/);
+            glVertexArrayAttribFormat (m_skinned_vao_name, i /*attribindex*/, sizes[i], GL_FLOAT, GL_FALSE, relative_offsets[i]);
+            glVertexArrayAttribBinding(m_skinned_vao_name, i /*attribindex*/, 0 /*bindingindex*/);
+        }
+
+        /* The commands of an instance point to its skinned vertices with the base vertex and pass its index as the base instance. */
+        std::vector<DrawElementsIndirectCommand> commands(m_mesh_parts.size() * max_instances);
+
+        for (size_t p = 0; p < m_mesh_parts.size(); ++p)
+        {
+            for (uint32_t i = 0; i < max_instances; ++i)
+            {
+                auto& command = commands[p * max_instances + i];
+
+                command.count          = m_mesh_parts[p].m_indices_count;
+                command.instance_count = 1;
+                command.first_index    = m_mesh_parts[p].m_base_index;
+                command.base_vertex    = int32_t(i * m_vertices_count + m_mesh_parts[p].m_base_vertex);
+                command.base_instance  = i;
+            }
+        }
+
+        glCreateBuffers     (1, &m_pre_skinned_commands_buffer_name);
+        glNamedBufferStorage(m_pre_skinned_commands_buffer_name, commands.size() * sizeof(commands[0]), commands.data(), 0);
+
+        m_pre_skinning_max_instances = max_instances;
+
+        return true;
+    }
+
+    void AnimatedModel::ReleasePreSkinningBuffers()
+    {
+        glDeleteVertexArrays(1, &m_skinned_vao_name);
+        m_skinned_vao_name = 0;
+
+        glDeleteBuffers(1, &m_skinned_vbo_name);
+        m_skinned_vbo_name = 0;
+
+        glDeleteBuffers(1, &m_pre_skinning_input_buffer_name);
+        m_pre_skinning_input_buffer_name = 0;
+
+        glDeleteBuffers(1, &m_pre_skinned_commands_buffer_name);
+        m_pre_skinned_commands_buffer_name = 0;
+
+        m_pre_skinning_max_instances = 0;
+    }
+
+    uint32_t AnimatedModel::BindPreSkinningBuffers(GLuint first_binding_index)
+    {
+        if (m_pre_skinning_input_buffer_name == 0)
+        {
+            return 0;
+        }
+
+        for (uint32_t i = 0; i < VERTEX_STREAMS_COUNT; ++i)
+        {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, first_binding_index + i, m_pre_skinning_input_buffer_name, m_vertex_streams[i].input_offset, m_vertex_streams[i].size);
+        }
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, first_binding_index + VERTEX_STREAMS_COUNT, m_skinned_vbo_name);
+
+        return m_vertices_count;
+    }
+
+    void AnimatedModel::RenderPreSkinned(uint32_t instances_count)
+    {
+        instances_count = std::min(instances_count, m_pre_skinning_max_instances);
+
+        if (instances_count == 0)
+        {
+            return;
+        }
+
+        glBindVertexArray(m_skinned_vao_name);
+        glBindBuffer     (GL_DRAW_INDIRECT_BUFFER, m_pre_skinned_commands_buffer_name);
+
+        for (size_t p = 0; p < m_mesh_parts.size(); ++p)
+        {
+            if (m_mesh_parts[p].m_material_index < m_materials.size())
+            {
+                for (auto const& [texture_type, texture] : m_materials[m_mesh_parts[p].m_material_index]->m_texture_map)
+                {
+                    texture->Bind(uint32_t(texture_type));
+                }
+            }
+
+            const uint64_t commands_offset = p * m_pre_skinning_max_instances * sizeof(DrawElementsIndirectCommand);
+
+            glMultiDrawElementsIndirect(GLenum(m_draw_mode), m_mesh_parts[p].m_index_type, (void*)commands_offset, instances_count, 0 /* stride */);
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        m_render_stats.submitted_parts += uint32_t(m_mesh_parts.size());
+    }
+
     void AnimatedModel::LoadMeshPart(uint32_t mesh_index, const aiMesh* mesh, VertexData& vertex_data, std::vector<VertexBoneData>& bones_data)
     {
         const glm::vec3 zero_vec3(0.0f, 0.0f, 0.0f);
@@ -459,27 +902,25 @@ namespace RGL
 
         uint64_t offset = 0;
 
-        glNamedBufferSubData(m_vbo_name, offset, positions_size_bytes, vertex_data.positions.data());
-        offset += positions_size_bytes;
-
-        glNamedBufferSubData(m_vbo_name, offset, texcoords_size_bytes, vertex_data.texcoords.data());
-        offset += texcoords_size_bytes;
+        /* The ranges of the streams are kept for the pre-skinning, the absent ones have zero size. */
+        m_vertices_count = uint32_t(vertex_data.positions.size());
 
-        glNamedBufferSubData(m_vbo_name, offset, normals_size_bytes, vertex_data.normals.data());
-        offset += normals_size_bytes;
+        const void*   streams_data [VERTEX_STREAMS_COUNT] = { vertex_data.positions.data(), vertex_data.texcoords.data(), vertex_data.normals.data(), vertex_data.tangents.data(), bone_weights.data(), bone_ids.data() };
+        const GLsizei streams_sizes[VERTEX_STREAMS_COUNT] = { positions_size_bytes, texcoords_size_bytes, normals_size_bytes, tangents_size_bytes, bone_weights_size_bytes, bone_ids_size_bytes };
 
-        if (has_tangents)
+        for (uint32_t i = 0; i < VERTEX_STREAMS_COUNT; ++i)
         {
-            glNamedBufferSubData(m_vbo_name, offset, tangents_size_bytes, vertex_data.tangents.data());
-            offset += tangents_size_bytes;
-        }
+            m_vertex_streams[i] = {};
 
-        if (has_bones_data)
-        {
-            glNamedBufferSubData(m_vbo_name, offset, bone_weights_size_bytes, bone_weights.data());
-            offset += bone_weights_size_bytes;
+            if (streams_sizes[i] > 0)
+            {
+                glNamedBufferSubData(m_vbo_name, offset, streams_sizes[i], streams_data[i]);
+
+                m_vertex_streams[i].vbo_offset = GLintptr(offset);
+                m_vertex_streams[i].size       = streams_sizes[i];
 
-            glNamedBufferSubData(m_vbo_name, offset, bone_ids_size_bytes, bone_ids.data());
+                offset += streams_sizes[i];
+            }
         }
 
         glCreateBuffers     (1, &m_ibo_name);
@@ -1,25 +1,98 @@
 #pragma once
 
 #include "static_model.h"
+#include "animation_clip.h"
 
 #include <glm/mat2x4.hpp>
 #include <glm/mat4x4.hpp>
+#include <limits>
 #include <map>
+#include <string_view>
 
 namespace RGL
 {
+    /* Playback state of one instance of an AnimatedModel. The skeleton and the clips are shared by all of the instances. */
+    struct AnimationState
+    {
+        uint32_t animation_index = 0;
+        float    time            = 0.0f; /* In seconds. */
+        float    speed           = 1.0f;
+
+        /* The animation that is being faded out, while fade_time < fade_duration. */
+        uint32_t previous_animation_index = 0;
+        float    previous_time            = 0.0f;
+        float    fade_time                = 0.0f; /* In seconds. */
+        float    fade_duration            = 0.0f; /* 0 if there's no cross-fade in progress. */
+
+        /* Starts playing the animation from the beginning and blends it in over duration seconds.
+         * A cross-fade that is still in progress is cut short, its target becomes the animation that fades out. */
+        void CrossFade(uint32_t new_animation_index, float duration)
+        {
+            previous_animation_index = animation_index;
+            previous_time            = time;
+            animation_index          = new_animation_index;
+            time                     = 0.0f;
+            fade_time                = 0.0f;
+            fade_duration            = std::max(duration, 0.0f);
+        }
+
+        /* Weight of the current animation, the previous one has the remaining weight. */
+        float GetFadeWeight() const { return fade_duration > 0.0f ? std::min(fade_time / fade_duration, 1.0f) : 1.0f; }
+    };
+
+    /* One of the clips played by an instance. The first layer of an instance is the base pose, the other ones are blended over it
+     * in order, with the layer's weight scaled by the per node weights of its bone mask, see AnimatedModel::CreateBoneMask(). */
+    struct AnimationLayer
+    {
+        static constexpr uint32_t NO_BONE_MASK = std::numeric_limits<uint32_t>::max();
+
+        AnimationState state;
+        float          weight    = 1.0f; /* Ignored for the base layer. */
+        uint32_t       bone_mask = NO_BONE_MASK;
+    };
+
+    /* Instance evaluated by AnimatedModel::EvaluateInstances(), reduced instances use the reduced skeleton, see Skeleton::GetReducedNodesMask(). */
+    struct InstanceEvaluation
+    {
+        uint32_t instance_index;
+        bool     reduced;
+    };
+
+    struct AnimationUpdateStats
+    {
+        uint32_t instances_count = 0;
+        double   update_time     = 0.0; /* In milliseconds. */
+
+        double GetInstancesPerMillisecond() const { return update_time > 0.0 ? instances_count / update_time : 0.0; }
+    };
+
+    /* Output of the pre-skinning compute shaders, see AnimatedModel::BindPreSkinningBuffers(), tightly packed floats. */
+    struct SkinnedVertex
+    {
+        glm::vec3 position;
+        glm::vec2 texcoord;
+        glm::vec3 normal;
+        glm::vec3 tangent;
+    };
+
+    static_assert(sizeof(SkinnedVertex) == 44);
+
     class AnimatedModel : public StaticModel
     {
     public:
-        AnimatedModel() : m_bones_count             (0), 
-                          m_global_inverse_transform(glm::mat4(1.0)), 
-                          m_assimp_scene            (nullptr), 
-                          m_animation_speed         (1.0),
-                          m_current_animation_time  (0.0), 
-                          m_current_animation       (0), 
-                          m_animations_count        (0) {}
+        /* Number of instances evaluated by a single task of UpdateInstances(). */
+        static constexpr uint32_t INSTANCES_PER_TASK = 16;
+
+        AnimatedModel() : m_bones_count                     (0), 
+                          m_animations_count                (0),
+                          m_vertices_count                  (0),
+                          m_skinned_vao_name                (0),
+                          m_skinned_vbo_name                (0),
+                          m_pre_skinning_input_buffer_name  (0),
+                          m_pre_skinned_commands_buffer_name(0),
+                          m_pre_skinning_max_instances      (0) {}
 
-        virtual ~AnimatedModel() {}
+        virtual ~AnimatedModel() { ReleasePreSkinningBuffers(); }
 
         /* Used for Linear Blend Skinning */
         void BoneTransform(float dt, std::vector<glm::mat4>& transforms);
@@ -27,21 +100,84 @@ namespace RGL
         /* Used for Dual Quaternion Blend Skinning */
         void BoneTransform(float dt, std::vector<glm::mat2x4>& transforms);
 
+        /* Advances the animations of the instances by dt and writes their bone palettes to palettes, GetBonesCount() elements
+         * per instance, in the order of the instances. The instances are evaluated in parallel on the ThreadPool.
+         * The model's own animation, set with SetAnimation(), is not affected. */
+        AnimationUpdateStats UpdateInstances(float dt, std::span<AnimationState> instances, std::span<glm::mat4>   palettes) const;
+        AnimationUpdateStats UpdateInstances(float dt, std::span<AnimationState> instances, std::span<glm::mat2x4> palettes) const;
+
+        /* Layered version, instance i plays layers [i * layers_per_instance, (i + 1) * layers_per_instance).
+         * The poses are blended in per thread buffers that only grow, so the steady state updates don't allocate. */
+        AnimationUpdateStats UpdateInstances(float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat4>   palettes) const;
+        AnimationUpdateStats UpdateInstances(float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat2x4> palettes) const;
+
+        /* Building blocks of the layered UpdateInstances(), used by AnimationLodSystem to evaluate only some of the instances.
+         * AdvanceLayers() advances the time of all of the layers. EvaluateInstances() writes the palettes of the listed instances
+         * to their slots in palettes, in parallel, without advancing them. */
+        void                 AdvanceLayers    (float dt, std::span<AnimationLayer> layers) const;
+        AnimationUpdateStats EvaluateInstances(std::span<const AnimationLayer> layers, uint32_t layers_per_instance, std::span<const InstanceEvaluation> evaluations, std::span<glm::mat4>   palettes) const;
+        AnimationUpdateStats EvaluateInstances(std::span<const AnimationLayer> layers, uint32_t layers_per_instance, std::span<const InstanceEvaluation> evaluations, std::span<glm::mat2x4> palettes) const;
+
+        /* Removes the node and its descendants from the reduced skeleton used by the distant instances, e.g. the fingers. */
+        bool ExcludeFromReducedSkeleton(std::string_view node_name) { return m_skeleton.ExcludeFromReducedSkeleton(node_name); }
+
+        /* Creates a mask that selects the node and all of its descendants, e.g. the upper body from the spine up.
+         * Returns the index of the mask for AnimationLayer::bone_mask or AnimationLayer::NO_BONE_MASK if there's no such node. */
+        uint32_t CreateBoneMask(std::string_view root_node_name);
+
         bool Load(const std::filesystem::path& filepath) override;
 
+        /* Tolerances of the key reduction of the clips baked by the next Load(). If the mesh cache is enabled,
+         * the compressed clips are stored in an animation cache next to it and the next run skips the compression. */
+        void SetAnimationCompression(const AnimationCompressionSettings& settings) { m_animation_compression = settings; }
+
+        /* Prints the memory and the maximum reconstruction error of each clip. */
+        void PrintAnimationStats() const;
+
+        /* Pre-skinning: instead of skinning the vertices in every pass that draws the model, a compute shader skins them
+         * once per frame into a vertex buffer that holds the SkinnedVertex array of up to max_instances instances.
+         * RenderPreSkinned() draws it with the ordinary static mesh attributes: position, texcoord, normal and tangent at locations 0-3. */
+        bool CreatePreSkinningBuffers(uint32_t max_instances);
+        void ReleasePreSkinningBuffers();
+
+        /* Binds the SSBOs of the pre-skinning compute shader at consecutive indices starting at first_binding_index:
+         * the float positions (3 per vertex), texcoords (2), normals (3) and tangents (3), the vec4 bone weights, the ivec4 bone ids
+         * and the skinned vertices (11 floats per vertex, the vertices of instance i start at i * vertices_count).
+         * Returns the number of the vertices of a single instance. */
+        uint32_t BindPreSkinningBuffers(GLuint first_binding_index);
+
+        /* Draws the first instances_count pre-skinned instances with a single glMultiDrawElementsIndirect() call per mesh part.
+         * The instance's index is passed as the base instance, i.e. the shaders read it from gl_BaseInstance. */
+        void RenderPreSkinned(uint32_t instances_count);
+
+        uint32_t GetPreSkinningMaxInstancesCount() const { return m_pre_skinning_max_instances; }
+
         std::vector<std::string> GetAnimationsNames() const;
+        const AnimationClip&     GetAnimationClip(uint32_t animation_index) const { return m_animation_clips[animation_index]; }
         uint32_t                 GetAnimationsCount() const { return m_animations_count; }
         uint32_t                 GetBonesCount()      const { return m_bones_count; }
 
+        /* Skinning matrices computed by the last BoneTransform() call. */
+        std::span<const glm::mat4> GetBonePalette() const { return m_bone_palette; }
+
         void SetAnimation(uint32_t animation_index) 
         { 
-            m_current_animation      = std::max(0u, std::min(animation_index, m_animations_count - 1)); 
-            m_current_animation_time = 0.0f; 
+            m_animation_state.animation_index = std::max(0u, std::min(animation_index, m_animations_count - 1)); 
+            m_animation_state.time            = 0.0f; 
+            m_animation_state.fade_duration   = 0.0f;
         }
 
+        /* Blends the model's own animation into the new one over duration seconds, instead of switching immediately. */
+        void CrossFadeAnimation(uint32_t animation_index, float duration)
+        {
+            m_animation_state.CrossFade(std::min(animation_index, m_animations_count - 1), duration);
+        }
+
+        const Skeleton& GetSkeleton() const { return m_skeleton; }
+
         void SetAnimationSpeed(float speed)
         {
-            m_animation_speed = std::max(speed, 0.0f);
+            m_animation_state.speed = std::max(speed, 0.0f);
         }
 
     protected:
@@ -50,12 +186,10 @@ namespace RGL
         struct BoneInfo
         {
             glm::mat4 m_bone_offset;
-            glm::mat4 m_final_transform;
 
             BoneInfo()
             {
-                m_bone_offset     = glm::mat4(0.0);
-                m_final_transform = glm::mat4(0.0);
+                m_bone_offset = glm::mat4(0.0);
             }
         };
 
@@ -105,16 +239,30 @@ namespace RGL
             return to;
         }
 
-        virtual void CalcInterpolatedScaling (aiVector3D&   out, float animation_time, const aiNodeAnim* node_anim);
-        virtual void CalcInterpolatedRotation(aiQuaternion& out, float animation_time, const aiNodeAnim* node_anim);
-        virtual void CalcInterpolatedPosition(aiVector3D&   out, float animation_time, const aiNodeAnim* node_anim);
+        /* Advances the current animation by dt and updates the bone palette. */
+        void UpdateBones(float dt);
+
+        void  AdvanceAnimation(float dt, AnimationState& state) const;
+        float WrapTime        (uint32_t animation_index, float time) const;
 
-        virtual uint32_t FindScaling (float animation_time, const aiNodeAnim* node_anim);
-        virtual uint32_t FindRotation(float animation_time, const aiNodeAnim* node_anim);
-        virtual uint32_t FindPosition(float animation_time, const aiNodeAnim* node_anim);
+        /* Samples the state's animation, blended with the one that fades out, fade_pose is a scratch buffer.
+         * The nodes with 0 in the node mask, if it isn't empty, keep their bind pose. */
+        void SamplePose    (const AnimationState& state, Pose& pose, Pose& fade_pose, std::span<const uint8_t> node_mask = {}) const;
+        void EvaluateLayers(std::span<const AnimationLayer> layers, Pose& pose, Pose& layer_pose, Pose& fade_pose, std::span<const uint8_t> node_mask = {}) const;
 
-        virtual const aiNodeAnim* FindNodeAnim(const aiAnimation* animation, std::string_view node_name);
-        virtual void ReadNodeHierarchy(float animation_time, const aiNode* node, const glm::mat4& parent_transform);
+        /* Calls evaluate(item_index, pose, layer_pose, fade_pose) for items_count items in parallel, it returns the InstanceEvaluation
+         * of the pose it has written, then computes the instance's palette from the pose. palettes hold instances_count palettes. */
+        template<typename T, typename Evaluate>
+        AnimationUpdateStats UpdateInstancesImpl(size_t instances_count, size_t items_count, std::span<T> palettes, const Evaluate& evaluate) const;
+
+        /* Appends the node and its descendants to the skeleton in the depth first order, so that the parents precede their children. */
+        virtual void LoadSkeleton(const aiNode* node, int32_t parent_index, std::unordered_map<std::string, uint32_t>& node_indices);
+        virtual void LoadAnimations(const aiScene* scene, const std::unordered_map<std::string, uint32_t>& node_indices);
+
+        /* Animation cache */
+        bool     LoadAnimationCache(const std::filesystem::path& cache_filepath, uint64_t source_hash);
+        bool     SaveAnimationCache(const std::filesystem::path& cache_filepath, uint64_t source_hash) const;
+        uint64_t GetAnimationCacheKey() const;
 
         virtual void LoadBones(uint32_t mesh_index, const aiMesh* mesh, std::vector<VertexBoneData>& bones);
         virtual bool ParseScene(const aiScene* scene, const std::filesystem::path& filepath) override;
@@ -126,14 +274,37 @@ namespace RGL
         std::vector<BoneInfo>           m_bone_infos;
 
         uint32_t  m_bones_count;
-        glm::mat4 m_global_inverse_transform;
 
-        const aiScene*   m_assimp_scene;
-        Assimp::Importer m_importer;
+        Skeleton                     m_skeleton;
+        std::vector<AnimationClip>   m_animation_clips;
+        AnimationCompressionSettings m_animation_compression;
+        Pose                         m_pose;            /* The current animation's sample. */
+        Pose                         m_fade_pose;       /* The sample of the animation that fades out. */
+        std::vector<AffineTransform> m_node_transforms; /* Model space transformations of the nodes. */
+        std::vector<glm::mat4>       m_bone_palette;
+
+        std::vector<std::vector<float>> m_bone_masks; /* Per node weights of the masks created by CreateBoneMask(). */
+
+        AnimationState m_animation_state;
+        uint32_t       m_animations_count;
+
+        /* Vertex streams in m_vbo_name, in the order of BindPreSkinningBuffers(). */
+        enum VertexStream { POSITIONS, TEXCOORDS, NORMALS, TANGENTS, BONE_WEIGHTS, BONE_IDS, VERTEX_STREAMS_COUNT };
+
+        struct VertexStreamRange
+        {
+            GLintptr   vbo_offset   = 0;
+            GLintptr   input_offset = 0; /* In the pre-skinning input buffer, aligned for glBindBufferRange(). */
+            GLsizeiptr size         = 0;
+        };
+
+        VertexStreamRange m_vertex_streams[VERTEX_STREAMS_COUNT];
+        uint32_t          m_vertices_count;
 
-        float    m_animation_speed;
-        float    m_current_animation_time;
-        uint32_t m_current_animation;
-        uint32_t m_animations_count;
+        GLuint   m_skinned_vao_name;
+        GLuint   m_skinned_vbo_name;
+        GLuint   m_pre_skinning_input_buffer_name;
+        GLuint   m_pre_skinned_commands_buffer_name; /* Grouped by the mesh part, [part * max_instances + instance]. */
+        uint32_t m_pre_skinning_max_instances;
     };
 }
\ No newline at end of file
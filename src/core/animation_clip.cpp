@@ -0,0 +1,504 @@
+#include "animation_clip.h"
+#include "binary_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include <assimp/scene.h>
+
+namespace RGL
+{
+    /* Linear interpolation of the keys at time, cursor is the index of the last key at or before the previous, not later time. */
+    static glm::vec3 SampleKeys(const aiVectorKey* keys, uint32_t keys_count, double time, uint32_t& cursor, const glm::vec3& default_value)
+    {
+        if (keys_count == 0)
+        {
+            return default_value;
+        }
+
+        while (cursor + 1 < keys_count && keys[cursor + 1].mTime <= time)
+        {
+            ++cursor;
+        }
+
+        const glm::vec3 start(keys[cursor].mValue.x, keys[cursor].mValue.y, keys[cursor].mValue.z);
+
+        if (cursor + 1 == keys_count || time <= keys[cursor].mTime)
+        {
+            return start;
+        }
+
+        const glm::vec3 end   (keys[cursor + 1].mValue.x, keys[cursor + 1].mValue.y, keys[cursor + 1].mValue.z);
+        const double    factor = (time - keys[cursor].mTime) / (keys[cursor + 1].mTime - keys[cursor].mTime);
+
+        return glm::mix(start, end, float(factor));
+    }
+
+    static glm::quat SampleKeys(const aiQuatKey* keys, uint32_t keys_count, double time, uint32_t& cursor, const glm::quat& default_value)
+    {
+        if (keys_count == 0)
+        {
+            return default_value;
+        }
+
+        while (cursor + 1 < keys_count && keys[cursor + 1].mTime <= time)
+        {
+            ++cursor;
+        }
+
+        const glm::quat start(keys[cursor].mValue.w, keys[cursor].mValue.x, keys[cursor].mValue.y, keys[cursor].mValue.z);
+
+        if (cursor + 1 == keys_count || time <= keys[cursor].mTime)
+        {
+            return glm::normalize(start);
+        }
+
+        const glm::quat end   (keys[cursor + 1].mValue.w, keys[cursor + 1].mValue.x, keys[cursor + 1].mValue.y, keys[cursor + 1].mValue.z);
+        const double    factor = (time - keys[cursor].mTime) / (keys[cursor + 1].mTime - keys[cursor].mTime);
+
+        return glm::normalize(glm::slerp(start, end, float(factor)));
+    }
+
+    template<typename Key>
+    static void FindMinKeyInterval(const Key* keys, uint32_t keys_count, double& min_interval)
+    {
+        for (uint32_t i = 1; i < keys_count; ++i)
+        {
+            const double interval = keys[i].mTime - keys[i - 1].mTime;
+
+            if (interval > 0.0)
+            {
+                min_interval = std::min(min_interval, interval);
+            }
+        }
+    }
+
+    /* Range quantization of the vectors, 16 bits per component. */
+    static void PackVector(const glm::vec3& value, const glm::vec3& range_min, const glm::vec3& range_extent, uint16_t* packed)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            const float normalized = range_extent[i] > 0.0f ? (value[i] - range_min[i]) / range_extent[i] : 0.0f;
+            packed[i] = uint16_t(std::clamp(std::lround(normalized * 65535.0f), 0l, 65535l));
+        }
+    }
+
+    static glm::vec3 UnpackVector(const uint16_t* packed, const glm::vec3& range_min, const glm::vec3& range_extent)
+    {
+        return range_min + range_extent * (glm::vec3(packed[0], packed[1], packed[2]) * (1.0f / 65535.0f));
+    }
+
+    /* Smallest three: the index of the largest component in the top 2 bits, the other three components in [-1/sqrt(2), 1/sqrt(2)]
+     * quantized to 15 bits each. The largest component is made positive and reconstructed from the unit length. */
+    static constexpr float QUAT_COMPONENT_RANGE = 0.70710678f;
+
+    static void PackRotation(const glm::quat& rotation, uint16_t* packed)
+    {
+        float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+        int   largest       = 0;
+
+        for (int i = 1; i < 4; ++i)
+        {
+            if (std::abs(components[i]) > std::abs(components[largest]))
+            {
+                largest = i;
+            }
+        }
+
+        const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+        uint64_t    bits = uint64_t(largest);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (i != largest)
+            {
+                const float normalized = (sign * components[i] / QUAT_COMPONENT_RANGE) * 0.5f + 0.5f;
+                bits = (bits << 15) | uint64_t(std::clamp(std::lround(normalized * 32767.0f), 0l, 32767l));
+            }
+        }
+
+        packed[0] = uint16_t(bits >> 32);
+        packed[1] = uint16_t(bits >> 16);
+        packed[2] = uint16_t(bits);
+    }
+
+    static glm::quat UnpackRotation(const uint16_t* packed)
+    {
+        const uint64_t bits    = (uint64_t(packed[0]) << 32) | (uint64_t(packed[1]) << 16) | uint64_t(packed[2]);
+        const int      largest = int(bits >> 45);
+
+        float components[4];
+        float sum_squares = 0.0f;
+        int   shift       = 30;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (i != largest)
+            {
+                components[i] = (float((bits >> shift) & 0x7fff) * (1.0f / 32767.0f) * 2.0f - 1.0f) * QUAT_COMPONENT_RANGE;
+                sum_squares  += components[i] * components[i];
+                shift        -= 15;
+            }
+        }
+
+        components[largest] = std::sqrt(std::max(1.0f - sum_squares, 0.0f));
+
+        return glm::normalize(glm::quat(components[3], components[0], components[1], components[2]));
+    }
+
+    static float KeyError(const glm::vec3& a, const glm::vec3& b) { return glm::distance(a, b); }
+    static float KeyError(const glm::quat& a, const glm::quat& b) { return 2.0f * std::acos(std::min(std::abs(glm::dot(a, b)), 1.0f)); }
+
+    static glm::vec3 Interpolate(const glm::vec3& a, const glm::vec3& b, float factor) { return glm::mix(a, b, factor); }
+    static glm::quat Interpolate(const glm::quat& a, const glm::quat& b, float factor) { return glm::normalize(glm::slerp(a, b, factor)); }
+
+    AnimationClip AnimationClip::Bake(const aiAnimation* animation, const std::unordered_map<std::string, uint32_t>& node_indices, uint32_t nodes_count,
+                                      const AnimationCompressionSettings& settings)
+    {
+        AnimationClip clip;
+        clip.m_name = animation->mName.C_Str();
+        clip.m_node_channels.assign(nodes_count, -1);
+
+        const double ticks_per_second = animation->mTicksPerSecond != 0.0 ? animation->mTicksPerSecond : 25.0;
+
+        std::vector<const aiNodeAnim*> node_anims;
+        double min_key_interval = std::numeric_limits<double>::max();
+
+        for (uint32_t i = 0; i < animation->mNumChannels; ++i)
+        {
+            const aiNodeAnim* node_anim = animation->mChannels[i];
+            auto              it        = node_indices.find(node_anim->mNodeName.C_Str());
+
+            if (it == node_indices.end() || clip.m_node_channels[it->second] >= 0)
+            {
+                continue;
+            }
+
+            clip.m_node_channels[it->second] = int32_t(clip.m_channel_nodes.size());
+            clip.m_channel_nodes.push_back(it->second);
+            node_anims.push_back(node_anim);
+
+            FindMinKeyInterval(node_anim->mPositionKeys, node_anim->mNumPositionKeys, min_key_interval);
+            FindMinKeyInterval(node_anim->mRotationKeys, node_anim->mNumRotationKeys, min_key_interval);
+            FindMinKeyInterval(node_anim->mScalingKeys,  node_anim->mNumScalingKeys,  min_key_interval);
+
+            clip.m_stats.source_keys_count += node_anim->mNumPositionKeys + node_anim->mNumRotationKeys + node_anim->mNumScalingKeys;
+            clip.m_stats.source_size       += (node_anim->mNumPositionKeys + node_anim->mNumScalingKeys) * sizeof(aiVectorKey) + node_anim->mNumRotationKeys * sizeof(aiQuatKey);
+        }
+
+        clip.m_duration = float(std::max(animation->mDuration, 0.0) / ticks_per_second);
+
+        if (min_key_interval < std::numeric_limits<double>::max())
+        {
+            clip.m_sample_rate = std::min(float(ticks_per_second / min_key_interval), MAX_SAMPLE_RATE);
+        }
+
+        /* The key frames are stored in 16 bits. */
+        if (clip.m_duration > 0.0f)
+        {
+            clip.m_sample_rate = std::min(clip.m_sample_rate, float(std::numeric_limits<uint16_t>::max() - 1) / clip.m_duration);
+        }
+
+        clip.m_frames_count = std::max(uint32_t(std::ceil(clip.m_duration * clip.m_sample_rate - 1e-3f)) + 1, 2u);
+
+        const size_t channels_count = node_anims.size();
+        const double ticks_per_frame = ticks_per_second / clip.m_sample_rate;
+
+        /* Resample each channel at the uniform rate, then compress its tracks. */
+        std::vector<glm::vec3> translations(clip.m_frames_count);
+        std::vector<glm::quat> rotations   (clip.m_frames_count);
+        std::vector<glm::vec3> scales      (clip.m_frames_count);
+
+        clip.m_tracks.reserve(channels_count * TRACK_TYPES_COUNT);
+
+        for (size_t c = 0; c < channels_count; ++c)
+        {
+            const aiNodeAnim* node_anim = node_anims[c];
+
+            uint32_t position_cursor = 0;
+            uint32_t rotation_cursor = 0;
+            uint32_t scaling_cursor  = 0;
+
+            for (uint32_t frame = 0; frame < clip.m_frames_count; ++frame)
+            {
+                const double time = frame * ticks_per_frame;
+
+                translations[frame] = SampleKeys(node_anim->mPositionKeys, node_anim->mNumPositionKeys, time, position_cursor, glm::vec3(0.0f));
+                rotations   [frame] = SampleKeys(node_anim->mRotationKeys, node_anim->mNumRotationKeys, time, rotation_cursor, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+                scales      [frame] = SampleKeys(node_anim->mScalingKeys,  node_anim->mNumScalingKeys,  time, scaling_cursor,  glm::vec3(1.0f));
+            }
+
+            /* In the TrackType order. */
+            clip.AddTrack(std::span<const glm::vec3>(translations), settings.translation_tolerance);
+            clip.AddTrack(std::span<const glm::quat>(rotations),    settings.rotation_tolerance);
+            clip.AddTrack(std::span<const glm::vec3>(scales),       settings.scale_tolerance);
+
+            /* Reconstruction error, including the quantization's. */
+            const Track* tracks = &clip.m_tracks[c * TRACK_TYPES_COUNT];
+
+            for (uint32_t frame = 0; frame < clip.m_frames_count; ++frame)
+            {
+                clip.m_stats.max_translation_error = std::max(clip.m_stats.max_translation_error, KeyError(clip.SampleVector  (tracks[TRANSLATION], float(frame)), translations[frame]));
+                clip.m_stats.max_rotation_error    = std::max(clip.m_stats.max_rotation_error,    KeyError(clip.SampleRotation(tracks[ROTATION],    float(frame)), rotations   [frame]));
+                clip.m_stats.max_scale_error       = std::max(clip.m_stats.max_scale_error,       KeyError(clip.SampleVector  (tracks[SCALE],       float(frame)), scales      [frame]));
+            }
+        }
+
+        clip.m_stats.keys_count        = uint32_t(clip.m_key_values.size());
+        clip.m_stats.uncompressed_size = size_t(clip.m_frames_count) * channels_count * (2 * sizeof(glm::vec3) + sizeof(glm::quat));
+        clip.m_stats.memory_size       = clip.m_tracks    .size() * sizeof(Track)
+                                       + clip.m_key_frames.size() * sizeof(uint16_t)
+                                       + clip.m_key_values.size() * sizeof(PackedKey)
+                                       + clip.m_node_channels.size() * sizeof(int32_t)
+                                       + clip.m_channel_nodes.size() * sizeof(uint32_t);
+
+        return clip;
+    }
+
+    template<typename T>
+    void AnimationClip::AddTrack(std::span<const T> frames, float tolerance)
+    {
+        Track track;
+        track.range_min    = glm::vec3(0.0f);
+        track.range_extent = glm::vec3(0.0f);
+        track.first_key    = uint32_t(m_key_values.size());
+        track.keys_count   = 0;
+
+        /* Quantize all of the frames, the keys are removed based on the quantized values. */
+        std::vector<PackedKey> packed (frames.size());
+        std::vector<T>         decoded(frames.size());
+
+        if constexpr (std::is_same_v<T, glm::vec3>)
+        {
+            glm::vec3 range_max = frames[0];
+            track.range_min     = frames[0];
+
+            for (auto& value : frames)
+            {
+                track.range_min = glm::min(track.range_min, value);
+                range_max       = glm::max(range_max,       value);
+            }
+
+            track.range_extent = range_max - track.range_min;
+
+            for (size_t f = 0; f < frames.size(); ++f)
+            {
+                PackVector(frames[f], track.range_min, track.range_extent, packed[f].values);
+                decoded[f] = UnpackVector(packed[f].values, track.range_min, track.range_extent);
+            }
+        }
+        else
+        {
+            for (size_t f = 0; f < frames.size(); ++f)
+            {
+                PackRotation(frames[f], packed[f].values);
+                decoded[f] = UnpackRotation(packed[f].values);
+            }
+        }
+
+        auto add_key = [&](size_t frame)
+        {
+            m_key_frames.push_back(uint16_t(frame));
+            m_key_values.push_back(packed[frame]);
+            ++track.keys_count;
+        };
+
+        add_key(0);
+
+        const size_t last = frames.size() - 1;
+        bool is_constant  = true;
+
+        for (size_t f = 1; f <= last && is_constant; ++f)
+        {
+            is_constant = KeyError(decoded[f], decoded[0]) <= tolerance;
+        }
+
+        if (!is_constant)
+        {
+            /* Greedily extend the segment from the last key while the interpolation stays within the tolerance at every frame. */
+            size_t key = 0;
+
+            while (key < last)
+            {
+                size_t end = key + 1;
+
+                while (end < last)
+                {
+                    const size_t candidate = end + 1;
+                    bool         fits      = true;
+
+                    for (size_t f = key + 1; f < candidate && fits; ++f)
+                    {
+                        const float factor = float(f - key) / float(candidate - key);
+                        fits = KeyError(Interpolate(decoded[key], decoded[candidate], factor), decoded[f]) <= tolerance;
+                    }
+
+                    if (!fits)
+                    {
+                        break;
+                    }
+
+                    end = candidate;
+                }
+
+                add_key(end);
+                key = end;
+            }
+        }
+
+        m_tracks.push_back(track);
+    }
+
+    uint32_t AnimationClip::FindKey(const Track& track, float frame, float& factor) const
+    {
+        const uint16_t* first = m_key_frames.data() + track.first_key;
+        const uint16_t* last  = first + track.keys_count;
+        const uint16_t* next  = std::upper_bound(first + 1, last, frame, [](float value, uint16_t key_frame) { return value < float(key_frame); });
+
+        if (next == last)
+        {
+            factor = 0.0f;
+            return track.first_key + track.keys_count - 1;
+        }
+
+        const uint32_t key = uint32_t(next - m_key_frames.data()) - 1;
+        factor = (frame - float(m_key_frames[key])) / float(*next - m_key_frames[key]);
+
+        return key;
+    }
+
+    glm::vec3 AnimationClip::SampleVector(const Track& track, float frame) const
+    {
+        float           factor;
+        const uint32_t  key   = FindKey(track, frame, factor);
+        const glm::vec3 start = UnpackVector(m_key_values[key].values, track.range_min, track.range_extent);
+
+        if (factor <= 0.0f)
+        {
+            return start;
+        }
+
+        return glm::mix(start, UnpackVector(m_key_values[key + 1].values, track.range_min, track.range_extent), factor);
+    }
+
+    glm::quat AnimationClip::SampleRotation(const Track& track, float frame) const
+    {
+        float           factor;
+        const uint32_t  key   = FindKey(track, frame, factor);
+        const glm::quat start = UnpackRotation(m_key_values[key].values);
+
+        if (factor <= 0.0f)
+        {
+            return start;
+        }
+
+        return Interpolate(start, UnpackRotation(m_key_values[key + 1].values), factor);
+    }
+
+    void AnimationClip::Sample(float time, Pose& pose, std::span<const uint8_t> node_mask) const
+    {
+        if (m_frames_count < 2)
+        {
+            return;
+        }
+
+        const float  frame          = std::clamp(time * m_sample_rate, 0.0f, float(m_frames_count - 1));
+        const size_t channels_count = m_channel_nodes.size();
+
+        for (size_t c = 0; c < channels_count; ++c)
+        {
+            const uint32_t node_index = m_channel_nodes[c];
+
+            if (!node_mask.empty() && !node_mask[node_index])
+            {
+                continue;
+            }
+
+            const Track* tracks = &m_tracks[c * TRACK_TYPES_COUNT];
+
+            pose.translations[node_index] = SampleVector  (tracks[TRANSLATION], frame);
+            pose.rotations   [node_index] = SampleRotation(tracks[ROTATION],    frame);
+            pose.scales      [node_index] = SampleVector  (tracks[SCALE],       frame);
+        }
+    }
+
+    void AnimationClip::Write(BinaryCacheWriter& writer) const
+    {
+        writer.WriteString(m_name);
+        writer.Write(m_duration);
+        writer.Write(m_sample_rate);
+        writer.Write(m_frames_count);
+
+        /* Field by field, so that the padding of the struct doesn't end up in the file. */
+        writer.Write(m_stats.keys_count);
+        writer.Write(m_stats.source_keys_count);
+        writer.Write(uint64_t(m_stats.memory_size));
+        writer.Write(uint64_t(m_stats.uncompressed_size));
+        writer.Write(uint64_t(m_stats.source_size));
+        writer.Write(m_stats.max_translation_error);
+        writer.Write(m_stats.max_rotation_error);
+        writer.Write(m_stats.max_scale_error);
+
+        writer.WriteArray(m_node_channels);
+        writer.WriteArray(m_channel_nodes);
+        writer.WriteArray(m_tracks);
+        writer.WriteArray(m_key_frames);
+        writer.WriteArray(m_key_values);
+    }
+
+    bool AnimationClip::Read(BinaryCacheReader& reader, uint32_t nodes_count)
+    {
+        m_name = reader.ReadString();
+        reader.Read(m_duration);
+        reader.Read(m_sample_rate);
+        reader.Read(m_frames_count);
+
+        reader.Read(m_stats.keys_count);
+        reader.Read(m_stats.source_keys_count);
+        m_stats.memory_size       = size_t(reader.Read<uint64_t>());
+        m_stats.uncompressed_size = size_t(reader.Read<uint64_t>());
+        m_stats.source_size       = size_t(reader.Read<uint64_t>());
+        reader.Read(m_stats.max_translation_error);
+        reader.Read(m_stats.max_rotation_error);
+        reader.Read(m_stats.max_scale_error);
+
+        auto node_channels = reader.ReadArray<int32_t>();
+        auto channel_nodes = reader.ReadArray<uint32_t>();
+        auto tracks        = reader.ReadArray<Track>();
+        auto key_frames    = reader.ReadArray<uint16_t>();
+        auto key_values    = reader.ReadArray<PackedKey>();
+
+        if (reader.HasFailed() || m_frames_count < 2 || node_channels.size() != nodes_count ||
+            tracks.size() != channel_nodes.size() * TRACK_TYPES_COUNT || key_frames.size() != key_values.size())
+        {
+            return false;
+        }
+
+        for (uint32_t node_index : channel_nodes)
+        {
+            if (node_index >= nodes_count)
+            {
+                return false;
+            }
+        }
+
+        for (auto& track : tracks)
+        {
+            if (track.keys_count == 0 || track.first_key > key_frames.size() || track.keys_count > key_frames.size() - track.first_key)
+            {
+                return false;
+            }
+        }
+
+        /* The views point into the mapped file, which is closed with the reader. */
+        m_node_channels.assign(node_channels.begin(), node_channels.end());
+        m_channel_nodes.assign(channel_nodes.begin(), channel_nodes.end());
+        m_tracks       .assign(tracks       .begin(), tracks       .end());
+        m_key_frames   .assign(key_frames   .begin(), key_frames   .end());
+        m_key_values   .assign(key_values   .begin(), key_values   .end());
+
+        return true;
+    }
+}
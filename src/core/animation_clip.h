@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "skeleton.h"
+
+struct aiAnimation;
+
+namespace RGL
+{
+    class BinaryCacheWriter;
+    class BinaryCacheReader;
+
+    /* The keys that linear interpolation of their neighbours reproduces within these tolerances are removed. */
+    struct AnimationCompressionSettings
+    {
+        float translation_tolerance = 1e-4f; /* In the model's units. */
+        float rotation_tolerance    = 1e-4f; /* In radians. */
+        float scale_tolerance       = 1e-4f;
+    };
+
+    struct AnimationClipStats
+    {
+        uint32_t keys_count        = 0; /* The keys of all of the tracks that are kept. */
+        uint32_t source_keys_count = 0; /* Assimp's keys. */
+        size_t   memory_size       = 0; /* Bytes of the compressed tracks. */
+        size_t   uncompressed_size = 0; /* Bytes of the tracks sampled at the clip's rate as floats. */
+        size_t   source_size       = 0; /* Bytes of Assimp's keys. */
+
+        /* Maximum reconstruction errors at the sampled frames, the rotation error is the angle in radians. */
+        float max_translation_error = 0.0f;
+        float max_rotation_error    = 0.0f;
+        float max_scale_error       = 0.0f;
+    };
+
+    /* Animation resampled at a uniform rate and compressed: every animated node has a translation, a rotation and a scale track.
+     * The rotations are stored as the three smallest components of the quaternion quantized to 15 bits, the translations and
+     * the scales are quantized to 16 bits in the range of their track, and the keys that linear interpolation can reconstruct
+     * are removed. A key takes 8 bytes, sampling it doesn't allocate and takes logarithmic time in the number of the track's keys. */
+    class AnimationClip final
+    {
+    public:
+        /* The clips are resampled at the rate of their densest keys, which reproduces uniformly spaced keys exactly, up to this limit. */
+        static constexpr float MAX_SAMPLE_RATE     = 120.0f;
+        static constexpr float DEFAULT_SAMPLE_RATE = 30.0f; /* Used if none of the channels has more than one key. */
+
+        AnimationClip()
+            : m_duration    (0.0f),
+              m_sample_rate (DEFAULT_SAMPLE_RATE),
+              m_frames_count(0) {}
+
+        /* node_indices maps the names of the skeleton's nodes to their indices. The channels of the other nodes are skipped. */
+        static AnimationClip Bake(const aiAnimation* animation, const std::unordered_map<std::string, uint32_t>& node_indices, uint32_t nodes_count,
+                                  const AnimationCompressionSettings& settings = {});
+
+        /* Writes the transformations of the animated nodes at time (in seconds, clamped to [0, duration]) to pose.
+         * The transformations of the other nodes and of the nodes with 0 in the node mask, if it isn't empty, are not modified. */
+        void Sample(float time, Pose& pose, std::span<const uint8_t> node_mask = {}) const;
+
+        /* Serialization of the compressed clip, e.g. to the animation cache next to the mesh cache.
+         * Read() returns false if the data is corrupted or doesn't match a skeleton of nodes_count nodes. */
+        static constexpr size_t MIN_SERIALIZED_SIZE = 5 * sizeof(uint64_t); /* Lower bound of a written clip, the counts of its arrays. */
+
+        void Write(BinaryCacheWriter& writer) const;
+        bool Read (BinaryCacheReader& reader, uint32_t nodes_count);
+
+        /* Index of the node's channel or -1 if the clip doesn't animate the node. */
+        int32_t GetNodeChannel(uint32_t node_index) const { return m_node_channels[node_index]; }
+
+        const std::string&        GetName()          const { return m_name; }
+        const AnimationClipStats& GetStats()         const { return m_stats; }
+        float                     GetDuration()      const { return m_duration; }
+        float                     GetSampleRate()    const { return m_sample_rate; }
+        uint32_t                  GetFramesCount()   const { return m_frames_count; }
+        uint32_t                  GetChannelsCount() const { return uint32_t(m_channel_nodes.size()); }
+
+    private:
+        enum TrackType { TRANSLATION, ROTATION, SCALE, TRACK_TYPES_COUNT };
+
+        struct Track
+        {
+            glm::vec3 range_min;    /* Unused by the rotations. */
+            glm::vec3 range_extent;
+            uint32_t  first_key;
+            uint32_t  keys_count;   /* At least 1, the first key is at frame 0 and the last one at the last frame, unless it's the only one. */
+        };
+
+        /* Quantized vector or smallest three quaternion: 2 bits of the largest component's index and 3 x 15 bits. */
+        struct PackedKey
+        {
+            uint16_t values[3];
+        };
+
+        /* Quantizes the frames of a track and appends the keys that are kept. */
+        template<typename T>
+        void AddTrack(std::span<const T> frames, float tolerance);
+
+        glm::vec3 SampleVector(const Track& track, float frame) const;
+        glm::quat SampleRotation(const Track& track, float frame) const;
+
+        /* Index of the track's key at or before frame and the interpolation factor towards the next key. */
+        uint32_t FindKey(const Track& track, float frame, float& factor) const;
+
+        std::string m_name;
+        float       m_duration;     /* In seconds. */
+        float       m_sample_rate;  /* Frames per second. */
+        uint32_t    m_frames_count; /* At least 2, the last frame is at or after the end of the clip. */
+
+        std::vector<int32_t>  m_node_channels; /* Node index -> channel index or -1. */
+        std::vector<uint32_t> m_channel_nodes; /* Channel index -> node index. */
+
+        /* The tracks of a channel are stored contiguously, [channel * TRACK_TYPES_COUNT + type]. */
+        std::vector<Track>     m_tracks;
+        std::vector<uint16_t>  m_key_frames;
+        std::vector<PackedKey> m_key_values;
+
+        AnimationClipStats m_stats;
+    };
+}
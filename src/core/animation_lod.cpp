@@ -0,0 +1,195 @@
+#include "animation_lod.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include <glm/geometric.hpp>
+
+namespace RGL
+{
+    AnimationLodSystem::AnimationLodSystem()
+        : m_first_instance  (0),
+          m_dual_quaternions(false)
+    {
+    }
+
+    void AnimationLodSystem::Resize(uint32_t instances_count)
+    {
+        const size_t old_count = m_instances.size();
+
+        m_instances.resize(instances_count);
+
+        /* Stagger the reduced rate updates of the new instances over the frames. */
+        for (size_t i = old_count; i < m_instances.size(); ++i)
+        {
+            m_instances[i].updates_since_eval = uint32_t(i);
+        }
+
+        m_first_instance = instances_count > 0 ? m_first_instance % instances_count : 0;
+    }
+
+    void AnimationLodSystem::SelectLods(std::span<const glm::vec3> positions, float bounding_radius, const glm::vec3& camera_position, float projection_scale)
+    {
+        const size_t count = std::min(positions.size(), m_instances.size());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float distance    = std::max(glm::distance(positions[i], camera_position), 1e-3f);
+            const float screen_size = bounding_radius * projection_scale / distance;
+
+            uint8_t lod = 0;
+
+            while (lod < AnimationLodSettings::LODS_COUNT - 1 && screen_size < m_settings.lod_screen_sizes[lod])
+            {
+                ++lod;
+            }
+
+            m_instances[i].lod = lod;
+        }
+    }
+
+    void AnimationLodSystem::Invalidate()
+    {
+        for (auto& instance : m_instances)
+        {
+            instance.evaluated = false;
+        }
+    }
+
+    AnimationLodStats AnimationLodSystem::Update(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat4> palettes)
+    {
+        return UpdateImpl(model, dt, layers, layers_per_instance, palettes, m_cached_palettes);
+    }
+
+    AnimationLodStats AnimationLodSystem::Update(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat2x4> palettes)
+    {
+        return UpdateImpl(model, dt, layers, layers_per_instance, palettes, m_cached_palettes_dq);
+    }
+
+    template<typename T>
+    AnimationLodStats AnimationLodSystem::UpdateImpl(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<T> palettes, std::vector<T>& cached_palettes)
+    {
+        AnimationLodStats stats;
+
+        const Skeleton& skeleton        = model.GetSkeleton();
+        const uint32_t  bones_count     = skeleton.GetBonesCount();
+        const uint32_t  instances_count = layers_per_instance > 0 ? uint32_t(layers.size() / layers_per_instance) : 0;
+
+        if (instances_count == 0 || bones_count == 0 || palettes.size() < size_t(instances_count) * bones_count)
+        {
+            return stats;
+        }
+
+        const double start_time = Timer::getTime();
+
+        if (m_instances.size() != instances_count)
+        {
+            Resize(instances_count);
+        }
+
+        /* The cache holds the palettes of one skinning method, switching it invalidates them. */
+        if (m_dual_quaternions != std::is_same_v<T, glm::mat2x4>)
+        {
+            m_dual_quaternions = std::is_same_v<T, glm::mat2x4>;
+            Invalidate();
+        }
+
+        if (cached_palettes.size() < size_t(instances_count) * bones_count)
+        {
+            cached_palettes.resize(size_t(instances_count) * bones_count);
+        }
+
+        /* The skipped instances keep playing, so their poses are up to date when they are evaluated again. */
+        model.AdvanceLayers(dt, layers);
+
+        const uint32_t full_cost    = skeleton.GetNodesCount();
+        const uint32_t reduced_cost = skeleton.GetReducedNodesCount();
+        const uint32_t budget       = m_settings.max_bone_evaluations;
+
+        m_evaluations.clear();
+
+        for (auto& instance : m_instances)
+        {
+            ++instance.updates_since_eval;
+            ++stats.lod_instances_count[instance.lod];
+        }
+
+        auto interval = [&](const InstanceLod& instance) { return std::max(m_settings.update_intervals[instance.lod], 1u); };
+
+        m_due_instances.clear();
+
+        for (uint32_t n = 0; n < instances_count; ++n)
+        {
+            const uint32_t i        = (m_first_instance + n) % instances_count;
+            const auto&    instance = m_instances[i];
+
+            if (!instance.evaluated || instance.updates_since_eval >= interval(instance))
+            {
+                m_due_instances.push_back(i);
+            }
+        }
+
+        /* The instances that were never evaluated first, then the most overdue ones, so that the instances deferred by the budget
+         * claim it first in the next updates and are eventually evaluated. Then the nearest levels, then the rotated order. */
+        std::sort(m_due_instances.begin(), m_due_instances.end(), [&](uint32_t a, uint32_t b)
+        {
+            const auto& instance_a = m_instances[a];
+            const auto& instance_b = m_instances[b];
+
+            if (instance_a.evaluated != instance_b.evaluated)
+            {
+                return !instance_a.evaluated;
+            }
+
+            if (instance_a.evaluated)
+            {
+                const uint32_t overdue_a = instance_a.updates_since_eval - interval(instance_a);
+                const uint32_t overdue_b = instance_b.updates_since_eval - interval(instance_b);
+
+                if (overdue_a != overdue_b)
+                {
+                    return overdue_a > overdue_b;
+                }
+            }
+
+            if (instance_a.lod != instance_b.lod)
+            {
+                return instance_a.lod < instance_b.lod;
+            }
+
+            return (a + instances_count - m_first_instance) % instances_count < (b + instances_count - m_first_instance) % instances_count;
+        });
+
+        for (uint32_t i : m_due_instances)
+        {
+            auto&          instance = m_instances[i];
+            const bool     reduced  = instance.lod == AnimationLodSettings::LODS_COUNT - 1;
+            const uint32_t cost     = reduced ? reduced_cost : full_cost;
+
+            if (instance.evaluated && budget > 0 && stats.bone_evaluations_count + cost > budget)
+            {
+                ++stats.deferred_instances_count;
+                continue;
+            }
+
+            m_evaluations.push_back({ i, reduced });
+
+            instance.evaluated          = true;
+            instance.updates_since_eval = 0;
+            stats.bone_evaluations_count += cost;
+        }
+
+        m_first_instance = (m_first_instance + 1) % instances_count;
+
+        model.EvaluateInstances(layers, layers_per_instance, m_evaluations, std::span<T>(cached_palettes));
+
+        std::memcpy(palettes.data(), cached_palettes.data(), size_t(instances_count) * bones_count * sizeof(T));
+
+        stats.evaluated_instances_count = uint32_t(m_evaluations.size());
+        stats.update_time               = (Timer::getTime() - start_time) * 1000.0;
+
+        return stats;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "animated_model.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace RGL
+{
+    struct AnimationLodSettings
+    {
+        static constexpr uint32_t LODS_COUNT = 3;
+
+        /* Screen size thresholds of LOD 1 and LOD 2, the projected bounding radius as a fraction of half of the viewport's height. */
+        float lod_screen_sizes[LODS_COUNT - 1] = { 0.1f, 0.03f };
+
+        /* An instance of LOD l is evaluated every update_intervals[l] updates and keeps its last palette in between. */
+        uint32_t update_intervals[LODS_COUNT] = { 1, 2, 4 };
+
+        /* Maximum number of node evaluations per update, 0 for unlimited. The most overdue instances are evaluated first, then
+         * the nearest levels. The instances over the budget keep their last palette and get ahead of the newly due ones. */
+        uint32_t max_bone_evaluations = 0;
+    };
+
+    struct AnimationLodStats
+    {
+        uint32_t lod_instances_count[AnimationLodSettings::LODS_COUNT] = {};
+        uint32_t evaluated_instances_count = 0;
+        uint32_t deferred_instances_count  = 0; /* Due for an update but over the budget. */
+        uint32_t bone_evaluations_count    = 0; /* Nodes evaluated in the update, the reduced skeleton counts its nodes only. */
+        double   update_time               = 0.0; /* In milliseconds. */
+    };
+
+    /* Animation LOD of the instances of an AnimatedModel, updated with the layered AnimatedModel::UpdateInstances() layout.
+     * LOD 0 is evaluated every update, LOD 1 at a reduced rate and LOD 2 at a reduced rate with the reduced skeleton,
+     * see Skeleton::GetReducedNodesMask(). The palettes of the skipped instances are cached, so the output may be
+     * a different region of a BonePaletteBuffer each update. */
+    class AnimationLodSystem final
+    {
+    public:
+        AnimationLodSystem();
+
+        /* Sets the number of instances, the new instances are evaluated in the next update. */
+        void Resize(uint32_t instances_count);
+
+        /* Picks the instances' levels from their projected size, projection_scale is the camera's projection[1][1]. */
+        void SelectLods(std::span<const glm::vec3> positions, float bounding_radius, const glm::vec3& camera_position, float projection_scale);
+
+        /* Advances all of the layers, evaluates the due instances and writes the palettes of all of the instances. */
+        AnimationLodStats Update(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat4>   palettes);
+        AnimationLodStats Update(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<glm::mat2x4> palettes);
+
+        /* Forces the evaluation of all of the instances in the next update, e.g. after a change of the animations. */
+        void Invalidate();
+
+        AnimationLodSettings m_settings;
+
+    private:
+        struct InstanceLod
+        {
+            uint8_t  lod                 = 0;
+            bool     evaluated           = false; /* The cached palette is valid. */
+            uint32_t updates_since_eval  = 0;
+        };
+
+        template<typename T>
+        AnimationLodStats UpdateImpl(const AnimatedModel& model, float dt, std::span<AnimationLayer> layers, uint32_t layers_per_instance, std::span<T> palettes, std::vector<T>& cached_palettes);
+
+        std::vector<InstanceLod>        m_instances;
+        std::vector<InstanceEvaluation> m_evaluations;     /* Reused every update. */
+        std::vector<uint32_t>           m_due_instances;   /* Reused every update, sorted by priority. */
+        std::vector<glm::mat4>          m_cached_palettes;
+        std::vector<glm::mat2x4>        m_cached_palettes_dq;
+        uint32_t                        m_first_instance;  /* Rotates so that the budget doesn't starve the same instances. */
+        bool                            m_dual_quaternions;
+    };
+}
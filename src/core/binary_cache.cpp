@@ -0,0 +1,172 @@
+#include "binary_cache.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "filesystem.h"
+#include "util.h"
+
+namespace RGL
+{
+    // --------------------- BinaryCacheWriter -------------------------
+
+    BinaryCacheWriter::BinaryCacheWriter(uint32_t magic, uint32_t version, uint64_t source_hash, uint64_t key)
+    {
+        Write(BinaryCacheHeader{ magic, version, source_hash, key });
+    }
+
+    void BinaryCacheWriter::WriteString(const std::string& value)
+    {
+        Write(uint32_t(value.size()));
+        WriteBytes(value.data(), value.size());
+    }
+
+    bool BinaryCacheWriter::Save(const std::filesystem::path& filepath) const
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(filepath.parent_path(), ec);
+
+        auto tmp_filepath = filepath;
+        tmp_filepath += ".tmp";
+
+        {
+            std::ofstream file(tmp_filepath, std::ios::binary | std::ios::trunc);
+
+            if (!file || !file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size()))
+            {
+                fprintf(stderr, "Could not write the cache file %s\n", tmp_filepath.string().c_str());
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tmp_filepath, filepath, ec);
+
+        if (ec)
+        {
+            fprintf(stderr, "Could not write the cache file %s: %s\n", filepath.string().c_str(), ec.message().c_str());
+            std::filesystem::remove(tmp_filepath, ec);
+
+            return false;
+        }
+
+        return true;
+    }
+
+    void BinaryCacheWriter::WriteBytes(const void* data, size_t size)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+
+    void BinaryCacheWriter::Align()
+    {
+        m_buffer.resize((m_buffer.size() + ALIGNMENT - 1) & ~(ALIGNMENT - 1), 0);
+    }
+
+    // --------------------- BinaryCacheReader -------------------------
+
+    bool BinaryCacheReader::Open(const std::filesystem::path& filepath, uint32_t magic, uint32_t version, uint64_t source_hash, uint64_t key)
+    {
+        m_offset = 0;
+        m_failed = false;
+
+        if (!m_file.Open(filepath))
+        {
+            m_failed = true;
+            return false;
+        }
+
+        BinaryCacheHeader header;
+        if (!Read(header))
+        {
+            return false;
+        }
+
+        if (header.magic       != magic       ||
+            header.version     != version     ||
+            header.source_hash != source_hash ||
+            header.key         != key)
+        {
+            m_file.Close();
+            m_failed = true;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string BinaryCacheReader::ReadString()
+    {
+        uint32_t size = Read<uint32_t>();
+
+        if (m_failed || size > m_file.Size() - m_offset)
+        {
+            m_failed = true;
+            return "";
+        }
+
+        std::string value(reinterpret_cast<const char*>(m_file.Data() + m_offset), size);
+        m_offset += size;
+
+        return value;
+    }
+
+    bool BinaryCacheReader::ReadBytes(void* data, size_t size)
+    {
+        if (m_failed || size > m_file.Size() - m_offset)
+        {
+            m_failed = true;
+            return false;
+        }
+
+        std::memcpy(data, m_file.Data() + m_offset, size);
+        m_offset += size;
+
+        return true;
+    }
+
+    void BinaryCacheReader::Align()
+    {
+        m_offset = (m_offset + BinaryCacheWriter::ALIGNMENT - 1) & ~(BinaryCacheWriter::ALIGNMENT - 1);
+
+        if (m_offset > m_file.Size())
+        {
+            m_failed = true;
+            m_offset = m_file.Size();
+        }
+    }
+
+    // --------------------- BinaryCache -------------------------
+
+    std::filesystem::path BinaryCache::GetCachePath(const std::filesystem::path& source_filepath, const std::string& extension)
+    {
+        std::error_code ec;
+        auto canonical_path = std::filesystem::weakly_canonical(source_filepath, ec);
+
+        if (ec)
+        {
+            canonical_path = source_filepath;
+        }
+
+        auto path_string = canonical_path.generic_string();
+        auto path_hash   = Util::Hash(path_string.data(), path_string.size());
+
+        char hash_string[17];
+        snprintf(hash_string, sizeof(hash_string), "%016llx", (unsigned long long)path_hash);
+
+        return FileSystem::getRootPath() / "cache" / (source_filepath.stem().string() + "_" + hash_string + extension);
+    }
+
+    uint64_t BinaryCache::HashFile(const std::filesystem::path& filepath, uint64_t seed)
+    {
+        MappedFile file(filepath);
+
+        if (!file.IsOpen())
+        {
+            return 0;
+        }
+
+        return Util::Hash(file.Data(), file.Size(), seed);
+    }
+}
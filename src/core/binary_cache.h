@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace RGL
+{
+    /* Header shared by all of the binary cache files. */
+    struct BinaryCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t source_hash; /* Hash of the source asset(s) the cache was built from. */
+        uint64_t key;         /* Any additional state that affects the cached data, e.g. importer flags. */
+    };
+
+    /* Builds a cache file in memory and saves it to the disk in one go. */
+    class BinaryCacheWriter final
+    {
+    public:
+        static constexpr size_t ALIGNMENT = 16;
+
+        BinaryCacheWriter(uint32_t magic, uint32_t version, uint64_t source_hash, uint64_t key = 0);
+
+        template<typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            WriteBytes(&value, sizeof(T));
+        }
+
+        /* Writes the element count followed by the elements, aligned to ALIGNMENT bytes. */
+        template<typename T>
+        void WriteArray(std::span<const T> values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            Write(uint64_t(values.size()));
+            Align();
+            WriteBytes(values.data(), values.size_bytes());
+        }
+
+        template<typename T>
+        void WriteArray(const std::vector<T>& values) { WriteArray(std::span<const T>(values)); }
+
+        void WriteString(const std::string& value);
+
+        /* Writes to a temporary file first so that a reader never sees a partially written cache. */
+        bool Save(const std::filesystem::path& filepath) const;
+
+    private:
+        void WriteBytes(const void* data, size_t size);
+        void Align();
+
+        std::vector<unsigned char> m_buffer;
+    };
+
+    /* Reads a cache file directly from its memory mapping. */
+    class BinaryCacheReader final
+    {
+    public:
+        BinaryCacheReader() : m_offset(0), m_failed(false) {}
+
+        bool Open(const std::filesystem::path& filepath, uint32_t magic, uint32_t version, uint64_t source_hash, uint64_t key = 0);
+
+        template<typename T>
+        bool Read(T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            return ReadBytes(&value, sizeof(T));
+        }
+
+        template<typename T>
+        T Read()
+        {
+            T value{};
+            Read(value);
+
+            return value;
+        }
+
+        /* Returns a view into the mapped file; it stays valid as long as the reader is alive. */
+        template<typename T>
+        std::span<const T> ReadArray()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            uint64_t count = Read<uint64_t>();
+            Align();
+
+            if (m_failed || count > (m_file.Size() - m_offset) / sizeof(T))
+            {
+                m_failed = true;
+                return {};
+            }
+
+            auto data = reinterpret_cast<const T*>(m_file.Data() + m_offset);
+            m_offset += count * sizeof(T);
+
+            return { data, size_t(count) };
+        }
+
+        std::string ReadString();
+
+        bool   HasFailed()        const { return m_failed; }
+        bool   IsAtEnd()          const { return m_offset == m_file.Size(); }
+        size_t GetRemainingSize() const { return m_file.Size() - m_offset; }
+
+    private:
+        bool ReadBytes(void* data, size_t size);
+        void Align();
+
+        MappedFile m_file;
+        size_t     m_offset;
+        bool       m_failed;
+    };
+
+    class BinaryCache
+    {
+    public:
+        /* Returns <root>/cache/<source file stem>_<path hash><extension>. */
+        static std::filesystem::path GetCachePath(const std::filesystem::path& source_filepath, const std::string& extension);
+
+        /* Hashes the whole content of the file. Returns 0 if the file couldn't be read. */
+        static uint64_t HashFile(const std::filesystem::path& filepath, uint64_t seed = 14695981039346656037ull);
+    };
+}
@@ -0,0 +1,133 @@
+#include "bone_palette_buffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace RGL
+{
+    BonePaletteBuffer::BonePaletteBuffer()
+        : m_buffer       (0),
+          m_mapped_data  (nullptr),
+          m_fences       {},
+          m_region_index (0),
+          m_region_size  (0),
+          m_max_instances(0),
+          m_bones_count  (0)
+    {
+    }
+
+    BonePaletteBuffer::~BonePaletteBuffer()
+    {
+        Release();
+    }
+
+    bool BonePaletteBuffer::Create(uint32_t max_instances, uint32_t bones_count)
+    {
+        Release();
+
+        if (max_instances == 0 || bones_count == 0)
+        {
+            return false;
+        }
+
+        GLint offset_alignment;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+        offset_alignment = std::max(offset_alignment, 1);
+
+        /* Sized for the larger LBS palettes, the DQS palettes use the first half of each region. */
+        const size_t palettes_size = size_t(max_instances) * bones_count * sizeof(glm::mat4);
+        const size_t region_size   = (palettes_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+
+        if (region_size * FRAMES_IN_FLIGHT > size_t(std::numeric_limits<GLsizeiptr>::max()) || region_size > std::numeric_limits<uint32_t>::max())
+        {
+            fprintf(stderr, "Error: the bone palettes of %u instances don't fit in a buffer.\n", max_instances);
+            return false;
+        }
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glCreateBuffers     (1, &m_buffer);
+        glNamedBufferStorage(m_buffer, GLsizeiptr(region_size * FRAMES_IN_FLIGHT), nullptr, flags);
+
+        m_mapped_data = static_cast<uint8_t*>(glMapNamedBufferRange(m_buffer, 0, GLsizeiptr(region_size * FRAMES_IN_FLIGHT), flags));
+
+        if (!m_mapped_data)
+        {
+            fprintf(stderr, "Error: could not map the bone palettes buffer.\n");
+
+            glDeleteBuffers(1, &m_buffer);
+            m_buffer = 0;
+
+            return false;
+        }
+
+        m_region_size   = uint32_t(region_size);
+        m_max_instances = max_instances;
+        m_bones_count   = bones_count;
+
+        return true;
+    }
+
+    void BonePaletteBuffer::Release()
+    {
+        for (auto& fence : m_fences)
+        {
+            if (fence)
+            {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+        if (m_buffer != 0)
+        {
+            glUnmapNamedBuffer(m_buffer);
+            glDeleteBuffers(1, &m_buffer);
+        }
+
+        m_buffer        = 0;
+        m_mapped_data   = nullptr;
+        m_region_index  = 0;
+        m_region_size   = 0;
+        m_max_instances = 0;
+        m_bones_count   = 0;
+    }
+
+    void BonePaletteBuffer::BeginFrame()
+    {
+        m_region_index = (m_region_index + 1) % FRAMES_IN_FLIGHT;
+
+        if (auto& fence = m_fences[m_region_index])
+        {
+            /* Usually signaled already, the region was used FRAMES_IN_FLIGHT frames ago. */
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    void BonePaletteBuffer::EndFrame()
+    {
+        if (m_buffer != 0)
+        {
+            if (m_fences[m_region_index])
+            {
+                glDeleteSync(m_fences[m_region_index]);
+            }
+
+            m_fences[m_region_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    void BonePaletteBuffer::Bind(GLuint binding_index) const
+    {
+        if (m_buffer != 0)
+        {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding_index, m_buffer, GLintptr(m_region_index) * m_region_size, m_region_size);
+        }
+    }
+}
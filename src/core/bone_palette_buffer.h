@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <glad/glad.h>
+#include <glm/mat2x4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace RGL
+{
+    /* Bone palettes of many instances of an AnimatedModel, stored in a persistently mapped shader storage buffer.
+     * The buffer is split into FRAMES_IN_FLIGHT regions used round-robin, so that AnimatedModel::UpdateInstances() can write
+     * the palettes of the next frame directly to the buffer while the GPU still reads the previous ones.
+     * The palettes of instance i start at element i * bones_count, which the skinning shaders compute from gl_InstanceID. */
+    class BonePaletteBuffer final
+    {
+    public:
+        static constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+
+        BonePaletteBuffer();
+        ~BonePaletteBuffer();
+
+        BonePaletteBuffer(const BonePaletteBuffer&)            = delete;
+        BonePaletteBuffer& operator=(const BonePaletteBuffer&) = delete;
+
+        /* Allocates the storage for max_instances palettes of bones_count elements, either glm::mat4 (LBS) or glm::mat2x4 (DQS). */
+        bool Create(uint32_t max_instances, uint32_t bones_count);
+        void Release();
+
+        /* Switches to the next region and waits until the GPU has finished reading it. */
+        void BeginFrame();
+
+        /* Fences the current region, call after the draw calls that read it. */
+        void EndFrame();
+
+        /* The palettes of the first instances_count instances in the current region. */
+        std::span<glm::mat4>   GetPalettes  (uint32_t instances_count) { return GetPalettesAs<glm::mat4>  (instances_count); }
+        std::span<glm::mat2x4> GetPalettesDQ(uint32_t instances_count) { return GetPalettesAs<glm::mat2x4>(instances_count); }
+
+        /* Binds the current region to the shader storage buffer binding point. */
+        void Bind(GLuint binding_index) const;
+
+        uint32_t GetMaxInstancesCount() const { return m_max_instances; }
+        uint32_t GetBonesCount()        const { return m_bones_count; }
+
+    private:
+        template<typename T>
+        std::span<T> GetPalettesAs(uint32_t instances_count)
+        {
+            if (!m_mapped_data || instances_count > m_max_instances)
+            {
+                return {};
+            }
+
+            return std::span<T>(reinterpret_cast<T*>(m_mapped_data + m_region_index * m_region_size), size_t(instances_count) * m_bones_count);
+        }
+
+        GLuint   m_buffer;
+        uint8_t* m_mapped_data;
+        GLsync   m_fences[FRAMES_IN_FLIGHT];
+        uint32_t m_region_index;
+        uint32_t m_region_size; /* Bytes, rounded up to the offset alignment of the shader storage buffers. */
+        uint32_t m_max_instances;
+        uint32_t m_bones_count;
+    };
+}
@@ -1,9 +1,33 @@
 #include "camera.h"
+#include "camera_path.h"
 #include "window.h"
 
 namespace RGL
 {
     void Camera::update(double dt)
+    {
+        /* The scripted path of the headless benchmarks replaces the input. */
+        if (CameraPath::isActive())
+        {
+            CameraPath::apply(*this);
+        }
+        else
+        {
+            processInput(dt);
+        }
+
+        if (m_is_dirty)
+        {
+            glm::mat4 R = glm::mat4_cast(m_orientation);
+            glm::mat4 T = glm::translate(glm::mat4(1.0f), -m_position);
+
+            m_view = R * T;
+
+            m_is_dirty = false;
+        }
+    }
+
+    void Camera::processInput(double dt)
     {
         /* Camera Movement */
         auto movement_amount = m_move_speed * dt;
@@ -66,16 +90,6 @@ namespace RGL
                 m_mouse_pressed_position = Input::getMousePosition();
             }
         }
-
-        if (m_is_dirty)
-        {
-            glm::mat4 R = glm::mat4_cast(m_orientation);
-            glm::mat4 T = glm::translate(glm::mat4(1.0f), -m_position);
-
-            m_view = R * T;
-
-            m_is_dirty = false;
-        }
     }
 
     void Camera::move(const glm::vec3& position, const glm::vec3& dir, float amount)
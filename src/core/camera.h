@@ -161,6 +161,7 @@ namespace RGL
         bool      m_is_dirty;
         bool      m_is_mouse_move;
 
+        void processInput(double dt);
         void move(const glm::vec3 & position, const glm::vec3& dir, float amount);
     };
 }
@@ -0,0 +1,97 @@
+#include "camera_path.h"
+#include "camera.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace RGL
+{
+    std::vector<CameraPath::Key> CameraPath::m_keys;
+    double                       CameraPath::m_time = 0.0;
+
+    static glm::quat EulerToQuat(const glm::vec3 & angles)
+    {
+        /* The same order as Camera::setOrientation(). */
+        return glm::angleAxis(glm::radians(angles.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+               glm::angleAxis(glm::radians(angles.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+               glm::angleAxis(glm::radians(angles.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    bool CameraPath::load(const std::filesystem::path & filepath)
+    {
+        std::ifstream file(filepath);
+
+        if (!file)
+        {
+            fprintf(stderr, "Could not open the camera path %s\n", filepath.generic_string().c_str());
+            return false;
+        }
+
+        std::vector<Key> keys;
+        std::string      line;
+        uint32_t         line_number = 0;
+
+        while (std::getline(file, line))
+        {
+            ++line_number;
+
+            if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+            {
+                continue;
+            }
+
+            std::istringstream stream(line);
+            Key                key;
+
+            if (!(stream >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.orientation.x >> key.orientation.y >> key.orientation.z) ||
+                (!keys.empty() && key.time < keys.back().time))
+            {
+                fprintf(stderr, "Camera path %s: invalid key at line %u\n", filepath.generic_string().c_str(), line_number);
+                return false;
+            }
+
+            keys.push_back(key);
+        }
+
+        m_keys = std::move(keys);
+        m_time = 0.0;
+
+        return true;
+    }
+
+    void CameraPath::clear()
+    {
+        m_keys.clear();
+        m_time = 0.0;
+    }
+
+    void CameraPath::apply(Camera & camera)
+    {
+        if (m_keys.empty())
+        {
+            return;
+        }
+
+        auto next = std::upper_bound(m_keys.begin(), m_keys.end(), float(m_time), [](float time, const Key & key) { return time < key.time; });
+
+        if (next == m_keys.begin() || next == m_keys.end())
+        {
+            const Key & key = next == m_keys.begin() ? m_keys.front() : m_keys.back();
+
+            camera.setPosition   (key.position);
+            camera.setOrientation(key.orientation.x, key.orientation.y, key.orientation.z);
+
+            return;
+        }
+
+        const Key & start  = *(next - 1);
+        const Key & end    = *next;
+        const float factor = end.time > start.time ? (float(m_time) - start.time) / (end.time - start.time) : 1.0f;
+
+        camera.setPosition   (glm::mix(start.position, end.position, factor));
+        camera.setOrientation(glm::normalize(glm::slerp(EulerToQuat(start.orientation), EulerToQuat(end.orientation), factor)));
+    }
+}
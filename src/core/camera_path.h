@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace RGL
+{
+    class Camera;
+
+    /* Scripted camera path of the headless benchmarks. While it's active, Camera::update() follows it instead of the input. */
+    class CameraPath final
+    {
+    public:
+        struct Key
+        {
+            float     time;        /* In seconds. */
+            glm::vec3 position;
+            glm::vec3 orientation; /* Euler angles in degrees, see Camera::setOrientation(). */
+        };
+
+        /* Text file with one key per line: "time x y z pitch yaw roll", sorted by time. Empty lines and lines starting with # are skipped. */
+        static bool load(const std::filesystem::path & filepath);
+        static void clear();
+
+        /* Time on the path, the keys are interpolated linearly and the orientations spherically. */
+        static void setTime(double time) { m_time = time; }
+
+        static bool isActive() { return !m_keys.empty(); }
+        static void apply(Camera & camera);
+
+    private:
+        static std::vector<Key> m_keys;
+        static double           m_time;
+    };
+}
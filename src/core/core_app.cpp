@@ -1,13 +1,25 @@
 #include "core_app.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
 #include <vector>
 
 #include "stb_image_write.h"
 #include "stb_image_resize.h"
 
+#include "camera_path.h"
 #include "filesystem.h"
 #include "input.h"
+#include "profiler.h"
+#include "shader.h"
+#include "static_model.h"
+#include "texture_cache.h"
 #include "timer.h"
+#include "uniform_buffers.h"
 #include "window.h"
 
 #include "gui/gui.h"
@@ -15,9 +27,11 @@
 namespace RGL
 {
     CoreApp::CoreApp()
-        : m_frame_time(0.0),
-          m_fps       (0),
-          m_is_running(false)
+        : m_texture_cache_stats     {},
+          m_texture_cache_stats_time(-TEXTURE_CACHE_STATS_INTERVAL),
+          m_frame_time              (0.0),
+          m_fps                     (0),
+          m_is_running              (false)
     {
     }
 
@@ -25,14 +39,77 @@ namespace RGL
     {
     }
 
+    void CoreApp::parse_command_line(int argc, char * argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool has_value = i + 1 < argc;
+
+            if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                m_benchmark.headless = true;
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0 && has_value)
+            {
+                m_benchmark.frames_count = uint32_t(std::max(std::atoi(argv[++i]), 1));
+            }
+            else if (std::strcmp(argv[i], "--warmup") == 0 && has_value)
+            {
+                m_benchmark.warmup_frames = uint32_t(std::max(std::atoi(argv[++i]), 0));
+            }
+            else if (std::strcmp(argv[i], "--delta-time") == 0 && has_value)
+            {
+                m_benchmark.delta_time = std::max(std::atof(argv[++i]), 0.0);
+            }
+            else if (std::strcmp(argv[i], "--camera-path") == 0 && has_value)
+            {
+                m_benchmark.camera_path = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--report") == 0 && has_value)
+            {
+                m_benchmark.report_path = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--no-program-cache") == 0)
+            {
+                Shader::enableProgramCache(false);
+            }
+            else
+            {
+                fprintf(stderr, "Unknown or incomplete command line argument: %s\n", argv[i]);
+            }
+        }
+    }
+
     void CoreApp::init(unsigned int width, unsigned int height, const std::string & title, double framerate)
     {
         m_frame_time = 1.0 / framerate;
 
         /* Init window */
-        Window::createWindow(width, height, title);
+        if (m_benchmark.headless)
+        {
+            Window::createHeadless(width, height, title);
+
+            if (!m_benchmark.camera_path.empty() && !CameraPath::load(m_benchmark.camera_path))
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            Window::createWindow(width, height, title);
+            Shader::enableHotReload(true);
+        }
 
         init_app();
+
+        const auto & program_cache_stats = Shader::getProgramCacheStats();
+
+        if (program_cache_stats.programs_count > 0)
+        {
+            printf("Shader programs: %u linked, %u loaded from the program cache (%u rejected), %.1f ms compiling, %.1f ms loading, %.1f ms saved, %.1f ms waiting for the batches\n",
+                   program_cache_stats.programs_count, program_cache_stats.cache_hits, program_cache_stats.cache_rejected,
+                   program_cache_stats.compile_time, program_cache_stats.load_time, program_cache_stats.saved_time, program_cache_stats.batch_wait_time);
+        }
     }
 
     void CoreApp::render_gui()
@@ -54,9 +131,22 @@ namespace RGL
             ImGui::Text("Performance info\n");
             ImGui::Separator();
             ImGui::Text("%.1f FPS (%.3f ms/frame)", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+
+            if (const double time = Timer::getTime(); time - m_texture_cache_stats_time >= TEXTURE_CACHE_STATS_INTERVAL)
+            {
+                m_texture_cache_stats      = TextureCache::GetStats();
+                m_texture_cache_stats_time = time;
+            }
+
+            ImGui::Text("Textures: %u (%.1f MB), %u hits, %u misses", m_texture_cache_stats.resident_textures, m_texture_cache_stats.resident_bytes / (1024.0 * 1024.0), m_texture_cache_stats.hits, m_texture_cache_stats.misses);
+
+            auto render_stats = StaticModel::GetRenderStats();
+            ImGui::Text("Mesh parts: %u submitted, %u culled", render_stats.submitted_parts, render_stats.culled_parts);
         }
         ImGui::End();
         /* Overlay end */
+
+        Profiler::RenderGui();
     }
 
     unsigned int CoreApp::get_fps() const
@@ -71,7 +161,14 @@ namespace RGL
             return;
         }
 
-        run();
+        if (m_benchmark.headless)
+        {
+            run_headless();
+        }
+        else
+        {
+            run();
+        }
     }
 
     void CoreApp::stop()
@@ -152,6 +249,12 @@ namespace RGL
             unprocessed_time += passed_time;
             frame_counter += passed_time;
 
+            /* The frame starts with its first update. */
+            if (unprocessed_time > m_frame_time)
+            {
+                Profiler::BeginFrame();
+            }
+
             while (unprocessed_time > m_frame_time)
             {
                 should_render = true;
@@ -164,9 +267,13 @@ namespace RGL
                 }
 
                 /* Update input, game entities, etc. */
-                input();
-                update(m_frame_time);
-                Input::update();
+                {
+                    ProfileScope scope("Update", false);
+
+                    input();
+                    update(m_frame_time);
+                    Input::update();
+                }
 
                 if (frame_counter >= 1.0)
                 {
@@ -179,18 +286,224 @@ namespace RGL
 
             if (should_render)
             {
+                Shader::updateHotReload();
+
                 /* Render */
-                render();
+                StaticModel::ResetRenderStats();
+                UniformBuffers::BeginFrame();
+                {
+                    ProfileScope scope("Render");
+                    render();
+                }
 
-                GUI::prepare();
                 {
-                    render_gui();
+                    ProfileScope scope("GUI");
+
+                    GUI::prepare();
+                    {
+                        render_gui();
+                    }
+                    GUI::render();
                 }
-                GUI::render();
+                UniformBuffers::EndFrame();
+                Profiler::EndFrame();
 
                 Window::endFrame();
                 frames++;
             }
         }
+
+        Profiler::Release();
+        UniformBuffers::Release();
+    }
+
+    void CoreApp::run_headless()
+    {
+        m_is_running = true;
+
+        const double   delta_time   = m_benchmark.delta_time > 0.0 ? m_benchmark.delta_time : m_frame_time;
+        const uint32_t total_frames = m_benchmark.warmup_frames + m_benchmark.frames_count;
+
+        std::vector<double> cpu_times(total_frames, 0.0);
+        std::vector<double> gpu_times(total_frames, 0.0);
+
+        /* The GPU times are the frame scopes of the profiler, read back Profiler::FRAMES_IN_FLIGHT frames later. */
+        Profiler::SetEnabled(true);
+        const uint64_t first_profiler_frame = Profiler::GetNextFrameIndex();
+
+        auto read_gpu_time = [&](uint32_t frame)
+        {
+            if (auto profiler_frame = Profiler::FindFrame(first_profiler_frame + frame))
+            {
+                gpu_times[frame] = profiler_frame->scopes[0].gpu_end - profiler_frame->scopes[0].gpu_begin;
+            }
+        };
+
+        uint32_t frame = 0;
+
+        for (; frame < total_frames && m_is_running; ++frame)
+        {
+            const double start_time = Timer::getTime();
+            Profiler::BeginFrame();
+
+            if (frame >= Profiler::FRAMES_IN_FLIGHT)
+            {
+                read_gpu_time(frame - Profiler::FRAMES_IN_FLIGHT);
+            }
+
+            /* The camera path and the update advance by exactly delta_time per frame, the frames are repeatable. */
+            CameraPath::setTime(frame * delta_time);
+
+            {
+                ProfileScope scope("Update", false);
+
+                input();
+                update(delta_time);
+                Input::update();
+            }
+
+            StaticModel::ResetRenderStats();
+            UniformBuffers::BeginFrame();
+            {
+                ProfileScope scope("Render");
+                render();
+            }
+            UniformBuffers::EndFrame();
+            Profiler::EndFrame();
+
+            cpu_times[frame] = (Timer::getTime() - start_time) * 1000.0;
+
+            Window::endFrame();
+        }
+
+        Profiler::Flush();
+
+        for (uint32_t i = frame > Profiler::FRAMES_IN_FLIGHT ? frame - Profiler::FRAMES_IN_FLIGHT : 0; i < frame; ++i)
+        {
+            read_gpu_time(i);
+        }
+
+        /* Only the measured frames are reported. */
+        const uint32_t warmup_frames = std::min(m_benchmark.warmup_frames, frame);
+
+        cpu_times.erase(cpu_times.begin(), cpu_times.begin() + warmup_frames);
+        gpu_times.erase(gpu_times.begin(), gpu_times.begin() + warmup_frames);
+        cpu_times.resize(frame - warmup_frames);
+        gpu_times.resize(frame - warmup_frames);
+
+        write_benchmark_report(cpu_times, gpu_times, delta_time);
+
+        m_is_running = false;
+        Profiler::Release();
+        UniformBuffers::Release();
+    }
+
+    struct FrameTimesSummary
+    {
+        double mean = 0.0, min = 0.0, max = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0;
+    };
+
+    static FrameTimesSummary SummarizeFrameTimes(std::vector<double> times)
+    {
+        FrameTimesSummary summary;
+
+        if (times.empty())
+        {
+            return summary;
+        }
+
+        std::sort(times.begin(), times.end());
+
+        auto percentile = [&](double p) { return times[std::min(size_t(p * (times.size() - 1) + 0.5), times.size() - 1)]; };
+
+        summary.mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+        summary.min  = times.front();
+        summary.max  = times.back();
+        summary.p50  = percentile(0.50);
+        summary.p95  = percentile(0.95);
+        summary.p99  = percentile(0.99);
+
+        return summary;
+    }
+
+    static std::string EscapeJson(const std::string & value)
+    {
+        std::string escaped;
+
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (uint8_t(c) >= 0x20)
+            {
+                escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    bool CoreApp::write_benchmark_report(const std::vector<double> & cpu_times, const std::vector<double> & gpu_times, double delta_time) const
+    {
+        auto report_path = m_benchmark.report_path;
+
+        if (report_path.empty())
+        {
+            std::string filename = Window::getTitle();
+            std::replace_if(filename.begin(), filename.end(), [](char c) { return !std::isalnum(uint8_t(c)); }, '_');
+
+            report_path = FileSystem::getRootPath() / "benchmarks" / (filename + ".json");
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(report_path.parent_path(), ec);
+
+        FILE* file = fopen(report_path.string().c_str(), "w");
+
+        if (!file)
+        {
+            fprintf(stderr, "Could not write the benchmark report %s\n", report_path.generic_string().c_str());
+            return false;
+        }
+
+        const auto cpu = SummarizeFrameTimes(cpu_times);
+        const auto gpu = SummarizeFrameTimes(gpu_times);
+
+        auto write_summary = [&](const char* name, const FrameTimesSummary& summary)
+        {
+            fprintf(file, "  \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f },\n",
+                    name, summary.mean, summary.min, summary.max, summary.p50, summary.p95, summary.p99);
+        };
+
+        fprintf(file, "{\n");
+        fprintf(file, "  \"title\": \"%s\",\n",    EscapeJson(Window::getTitle()).c_str());
+        fprintf(file, "  \"renderer\": \"%s\",\n", EscapeJson((const char*)glGetString(GL_RENDERER)).c_str());
+        fprintf(file, "  \"width\": %d,\n",          Window::getWidth());
+        fprintf(file, "  \"height\": %d,\n",         Window::getHeight());
+        fprintf(file, "  \"frames\": %zu,\n",        cpu_times.size());
+        fprintf(file, "  \"delta_time\": %.6f,\n",   delta_time);
+        write_summary("cpu_ms", cpu);
+        write_summary("gpu_ms", gpu);
+        fprintf(file, "  \"per_frame\": [\n");
+
+        for (size_t i = 0; i < cpu_times.size(); ++i)
+        {
+            fprintf(file, "    { \"cpu_ms\": %.4f, \"gpu_ms\": %.4f }%s\n", cpu_times[i], gpu_times[i], i + 1 < cpu_times.size() ? "," : "");
+        }
+
+        fprintf(file, "  ]\n}\n");
+        fclose(file);
+
+        /* The scopes of the last Profiler::HISTORY_SIZE frames. */
+        auto trace_path = report_path;
+        Profiler::ExportChromeTrace(trace_path.replace_extension(".trace.json"));
+
+        printf("Benchmark: %zu frames, CPU %.3f ms (p95 %.3f ms), GPU %.3f ms (p95 %.3f ms), report: %s\n",
+               cpu_times.size(), cpu.mean, cpu.p95, gpu.mean, gpu.p95, report_path.generic_string().c_str());
+
+        return true;
     }
 }
@@ -1,9 +1,25 @@
 #pragma once
 #include "common.h"
+#include "texture_cache.h"
+#include <cstdint>
+#include <filesystem>
 #include <string>
+#include <vector>
 
 namespace RGL
 {
+    /* Headless benchmark mode: the demo renders a fixed number of frames offscreen, with a constant delta_time and
+     * an optional scripted camera path, then writes the CPU and GPU times of each frame to a JSON report and exits. */
+    struct BenchmarkSettings
+    {
+        bool                  headless      = false;
+        uint32_t              frames_count  = 300;
+        uint32_t              warmup_frames = 10;  /* Rendered before the measured frames, e.g. to compile the shaders. */
+        double                delta_time    = 0.0; /* 0 for 1 / framerate. */
+        std::filesystem::path camera_path;         /* See CameraPath::load(). */
+        std::filesystem::path report_path;         /* Defaults to <root>/benchmarks/<title>.json. */
+    };
+
     class CoreApp
     {
     public:
@@ -13,6 +29,10 @@ namespace RGL
         CoreApp(const CoreApp&)            = delete;
         CoreApp& operator=(const CoreApp&) = delete;
 
+        /* Call before init(): --headless [--frames N] [--warmup N] [--delta-time seconds] [--camera-path file] [--report file.json]
+         * and --no-program-cache, which links the shaders from their sources, e.g. to measure the cold start. */
+        void parse_command_line(int argc, char * argv[]);
+
         virtual void init(unsigned int width, unsigned int height, const std::string & title, double framerate = 60.0) final;
 
         virtual void init_app()                = 0;
@@ -30,6 +50,16 @@ namespace RGL
 
     private:
         void run();
+        void run_headless();
+        bool write_benchmark_report(const std::vector<double> & cpu_times, const std::vector<double> & gpu_times, double delta_time) const;
+
+        BenchmarkSettings m_benchmark;
+
+        /* Refreshed every TEXTURE_CACHE_STATS_INTERVAL seconds, TextureCache::GetStats() walks all of the cached textures. */
+        static constexpr double TEXTURE_CACHE_STATS_INTERVAL = 1.0;
+
+        TextureCache::Stats m_texture_cache_stats;
+        double              m_texture_cache_stats_time;
 
         double       m_frame_time;
         unsigned int m_fps;
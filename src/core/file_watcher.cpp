@@ -0,0 +1,152 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include "timer.h"
+#endif
+
+namespace RGL
+{
+#ifdef __linux__
+    FileWatcher::FileWatcher()
+        : m_inotify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {
+        if (m_inotify_fd < 0)
+        {
+            fprintf(stderr, "Could not initialize inotify, the files won't be watched.\n");
+        }
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        if (m_inotify_fd >= 0)
+        {
+            close(m_inotify_fd);
+        }
+    }
+
+    void FileWatcher::Watch(const std::filesystem::path & filepath)
+    {
+        auto [file, inserted] = m_files.emplace(filepath.lexically_normal().generic_string(), std::filesystem::file_time_type{});
+
+        if (!inserted || m_inotify_fd < 0)
+        {
+            return;
+        }
+
+        const auto directory = std::filesystem::path(file->first).parent_path().generic_string();
+
+        if (m_directories.contains(directory))
+        {
+            return;
+        }
+
+        int watch_descriptor = inotify_add_watch(m_inotify_fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+        if (watch_descriptor < 0)
+        {
+            fprintf(stderr, "Could not watch the directory %s.\n", directory.c_str());
+            return;
+        }
+
+        m_directories[directory]             = watch_descriptor;
+        m_watch_directories[watch_descriptor] = directory;
+    }
+
+    std::vector<std::filesystem::path> FileWatcher::Poll()
+    {
+        std::vector<std::filesystem::path> changed_files;
+
+        if (m_inotify_fd < 0)
+        {
+            return changed_files;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+
+        while (true)
+        {
+            const ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+
+            /* EAGAIN, no more events. */
+            if (length <= 0)
+            {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length;)
+            {
+                auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset    += sizeof(inotify_event) + event->len;
+
+                auto directory = m_watch_directories.find(event->wd);
+
+                if (event->len == 0 || directory == m_watch_directories.end())
+                {
+                    continue;
+                }
+
+                auto filepath = (directory->second.empty() ? std::string(event->name) : directory->second + "/" + event->name);
+
+                if (m_files.contains(filepath) && std::find(changed_files.begin(), changed_files.end(), filepath) == changed_files.end())
+                {
+                    changed_files.emplace_back(filepath);
+                }
+            }
+        }
+
+        return changed_files;
+    }
+#else
+    FileWatcher::FileWatcher()
+        : m_last_poll_time(0.0)
+    {
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+    }
+
+    void FileWatcher::Watch(const std::filesystem::path & filepath)
+    {
+        std::error_code error;
+        auto write_time = std::filesystem::last_write_time(filepath, error);
+
+        m_files.emplace(filepath.lexically_normal().generic_string(), error ? std::filesystem::file_time_type{} : write_time);
+    }
+
+    std::vector<std::filesystem::path> FileWatcher::Poll()
+    {
+        std::vector<std::filesystem::path> changed_files;
+
+        const double time = Timer::getTime();
+
+        if (time - m_last_poll_time < POLL_INTERVAL)
+        {
+            return changed_files;
+        }
+
+        m_last_poll_time = time;
+
+        for (auto & [filepath, last_write_time] : m_files)
+        {
+            std::error_code error;
+            auto write_time = std::filesystem::last_write_time(filepath, error);
+
+            if (!error && write_time != last_write_time)
+            {
+                last_write_time = write_time;
+                changed_files.emplace_back(filepath);
+            }
+        }
+
+        return changed_files;
+    }
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace RGL
+{
+    /* Reports the watched files that were written since the last Poll(). On Linux, the files' directories are watched
+     * with inotify, which also catches the editors that save through a temporary file and a rename. On the other platforms,
+     * the files' modification times are compared at most every POLL_INTERVAL seconds. */
+    class FileWatcher final
+    {
+    public:
+        static constexpr double POLL_INTERVAL = 0.5;
+
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&)            = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        /* filepath has to be absolute or relative to the working directory, Poll() reports it normalized, see lexically_normal(). */
+        void Watch(const std::filesystem::path & filepath);
+
+        /* Doesn't block. Every file is reported once per call, however many times it was written. */
+        std::vector<std::filesystem::path> Poll();
+
+    private:
+        std::unordered_map<std::string, std::filesystem::file_time_type> m_files; /* Watched file -> last write time, used by the polling. */
+
+#ifdef __linux__
+        int                                     m_inotify_fd;
+        std::unordered_map<std::string, int>    m_directories; /* Watched directory -> watch descriptor. */
+        std::unordered_map<int, std::string>    m_watch_directories;
+#else
+        double                                  m_last_poll_time;
+#endif
+    };
+}
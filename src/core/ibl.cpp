@@ -0,0 +1,507 @@
+#include "ibl.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "binary_cache.h"
+#include "filesystem.h"
+#include "shader.h"
+#include "texture.h"
+#include "timer.h"
+#include "util.h"
+
+namespace RGL
+{
+    static constexpr uint32_t IBL_CACHE_MAGIC        = 0x454c4249; /* "IBLE" */
+    static constexpr uint32_t IBL_CACHE_VERSION      = 1;
+    static constexpr uint32_t BRDF_LUT_CACHE_MAGIC   = 0x46445242; /* "BRDF" */
+    static constexpr uint32_t BRDF_LUT_CACHE_VERSION = 1;
+
+    static constexpr uint32_t WORK_GROUP_SIZE = 8; /* local_size_x and local_size_y of the bake shaders. */
+
+    /* Face size of the environment's mip projected on the SH basis, plenty for the 3 bands. */
+    static constexpr uint32_t SH_SOURCE_SIZE = 64;
+
+    /* Convolution of the bands 0..2 with the clamped cosine lobe, divided by PI. */
+    static constexpr float SH_COSINE_LOBE[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+    static uint32_t GetWorkGroupsCount(uint32_t size)
+    {
+        return (size + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
+    }
+
+    static uint32_t GetMipSize(uint32_t size, uint32_t level)
+    {
+        return std::max(size >> level, 1u);
+    }
+
+    /* The cubemaps are cached as shared exponent RGB9_E5 texels, a half of the RGBA16F size. */
+    static std::vector<uint32_t> ReadCubemapLevel(GLuint cubemap, uint32_t size, uint32_t level)
+    {
+        std::vector<uint32_t> texels(size_t(size) * size * 6);
+        glGetTextureImage(cubemap, level, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, GLsizei(texels.size() * sizeof(uint32_t)), texels.data());
+
+        return texels;
+    }
+
+    static void WriteCubemapLevel(GLuint cubemap, uint32_t size, uint32_t level, std::span<const uint32_t> texels)
+    {
+        glTextureSubImage3D(cubemap, level, 0, 0, 0 /* face */, size, size, 6, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, texels.data());
+    }
+
+    IBL::IBL()
+        : m_data            {},
+          m_environment_map (0),
+          m_prefiltered_map (0),
+          m_brdf_lut        (0),
+          m_ubo             (0),
+          m_brdf_lut_key    (0),
+          m_cache_enabled   (true)
+    {
+    }
+
+    IBL::~IBL()
+    {
+        ReleaseEnvironment();
+
+        if (m_brdf_lut != 0)
+        {
+            glDeleteTextures(1, &m_brdf_lut);
+        }
+
+        if (m_ubo != 0)
+        {
+            glDeleteBuffers(1, &m_ubo);
+        }
+    }
+
+    bool IBL::Load(const std::filesystem::path & hdr_filepath, const IBLSettings & settings)
+    {
+        if (settings.prefiltered_size < (1u << (PREFILTERED_MIP_LEVELS - 1)))
+        {
+            fprintf(stderr, "The prefiltered map has to be at least %u texels wide to have %u mip levels.\n", 1u << (PREFILTERED_MIP_LEVELS - 1), PREFILTERED_MIP_LEVELS);
+            return false;
+        }
+
+        const double start_time = Timer::getTime();
+
+        const uint64_t source_hash = BinaryCache::HashFile(hdr_filepath);
+
+        if (source_hash == 0)
+        {
+            fprintf(stderr, "Could not read the HDR map %s\n", hdr_filepath.generic_string().c_str());
+            return false;
+        }
+
+        const IBLSettings previous_settings = m_settings;
+        m_settings = settings;
+
+        /* The BRDF LUT doesn't depend on the HDR map, it is loaded once per settings. */
+        const auto brdf_lut_cache_filepath = FileSystem::getRootPath() / "cache" / "ibl_brdf_lut.rglbrdf";
+        bool       bake_brdf_lut           = m_brdf_lut == 0 || m_brdf_lut_key != GetBrdfLutCacheKey();
+
+        if (bake_brdf_lut && m_cache_enabled && LoadBrdfLutCache(brdf_lut_cache_filepath))
+        {
+            bake_brdf_lut = false;
+        }
+
+        const auto cache_filepath   = BinaryCache::GetCachePath(hdr_filepath, ".rglibl");
+        const bool bake_environment = !m_cache_enabled || !LoadCache(cache_filepath, source_hash);
+
+        Texture2D equirectangular_map;
+
+        if (bake_environment && !equirectangular_map.LoadHdr(hdr_filepath))
+        {
+            m_settings = previous_settings;
+            return false;
+        }
+
+        if (!CreateShaders(bake_environment, bake_brdf_lut))
+        {
+            m_settings = previous_settings;
+            return false;
+        }
+
+        if (bake_brdf_lut)
+        {
+            BakeBrdfLut();
+
+            if (m_cache_enabled)
+            {
+                SaveBrdfLutCache(brdf_lut_cache_filepath);
+            }
+        }
+
+        if (!bake_environment)
+        {
+            UploadData();
+
+            printf("Loaded IBL '%s' (warm, IBL cache) in %.2f ms\n", hdr_filepath.generic_string().c_str(), (Timer::getTime() - start_time) * 1000.0);
+            return true;
+        }
+
+        ReleaseEnvironment();
+
+        m_environment_map = CreateCubemap(m_settings.environment_size, Texture::GetMaxMipMapsLevels(m_settings.environment_size, m_settings.environment_size, 1));
+        m_prefiltered_map = CreateCubemap(m_settings.prefiltered_size, PREFILTERED_MIP_LEVELS);
+
+        BakeEnvironmentMap(equirectangular_map);
+        BakeIrradianceSH();
+        BakePrefilteredMap();
+        UploadData();
+
+        /* So that the reported time includes the GPU work. */
+        glFinish();
+
+        printf("Baked IBL '%s' (cold, compute shaders) in %.2f ms\n", hdr_filepath.generic_string().c_str(), (Timer::getTime() - start_time) * 1000.0);
+
+        if (m_cache_enabled)
+        {
+            SaveCache(cache_filepath, source_hash);
+        }
+
+        return true;
+    }
+
+    void IBL::Bind() const
+    {
+        glBindTextureUnit(PREFILTERED_MAP_UNIT, m_prefiltered_map);
+        glBindTextureUnit(BRDF_LUT_UNIT,        m_brdf_lut);
+        glBindBufferBase (GL_UNIFORM_BUFFER, IBL_UBO_BINDING_INDEX, m_ubo);
+    }
+
+    void IBL::BindEnvironmentMap(uint32_t unit) const
+    {
+        glBindTextureUnit(unit, m_environment_map);
+    }
+
+    bool IBL::CreateShaders(bool bake_environment, bool bake_brdf_lut)
+    {
+        const bool build_environment_shaders = bake_environment && !m_prefilter_shader;
+        const bool build_brdf_lut_shader     = bake_brdf_lut    && !m_brdf_lut_shader;
+
+        if (!build_environment_shaders && !build_brdf_lut_shader)
+        {
+            return true;
+        }
+
+        const std::string dir = "src/core/shaders/";
+
+        ShaderBatch shader_batch;
+
+        if (build_environment_shaders)
+        {
+            m_equirectangular_to_cubemap_shader = std::make_shared<Shader>(dir + "ibl_equirectangular_to_cubemap.comp");
+            shader_batch.add(m_equirectangular_to_cubemap_shader);
+
+            m_prefilter_shader = std::make_shared<Shader>(dir + "ibl_prefilter_cubemap.comp");
+            shader_batch.add(m_prefilter_shader);
+
+            m_irradiance_sh_shader = std::make_shared<Shader>(dir + "ibl_irradiance_sh.comp");
+            shader_batch.add(m_irradiance_sh_shader);
+        }
+
+        if (build_brdf_lut_shader)
+        {
+            m_brdf_lut_shader = std::make_shared<Shader>(dir + "ibl_brdf_lut.comp");
+            shader_batch.add(m_brdf_lut_shader);
+        }
+
+        if (!shader_batch.finish())
+        {
+            /* Built again by the next Load(). */
+            m_equirectangular_to_cubemap_shader.reset();
+            m_prefilter_shader.reset();
+            m_irradiance_sh_shader.reset();
+            m_brdf_lut_shader.reset();
+
+            return false;
+        }
+
+        return true;
+    }
+
+    void IBL::BakeEnvironmentMap(Texture2D & equirectangular_map)
+    {
+        const uint32_t work_groups_count = GetWorkGroupsCount(m_settings.environment_size);
+
+        m_equirectangular_to_cubemap_shader->bind();
+        equirectangular_map.Bind(0);
+
+        glBindImageTexture(0, m_environment_map, 0 /* level */, GL_TRUE /* layered */, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(work_groups_count, work_groups_count, 6);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+        /* The mips are sampled by the prefiltering and the SH projection. */
+        glGenerateTextureMipmap(m_environment_map);
+    }
+
+    void IBL::BakePrefilteredMap()
+    {
+        m_prefilter_shader->bind();
+        m_prefilter_shader->setUniform("u_sample_count", GLuint(m_settings.prefilter_samples));
+
+        glBindTextureUnit(0, m_environment_map);
+
+        for (uint32_t mip = 0; mip < PREFILTERED_MIP_LEVELS; ++mip)
+        {
+            const uint32_t work_groups_count = GetWorkGroupsCount(GetMipSize(m_settings.prefiltered_size, mip));
+
+            m_prefilter_shader->setUniform("u_roughness", float(mip) / float(PREFILTERED_MIP_LEVELS - 1));
+
+            glBindImageTexture(0, m_prefiltered_map, mip, GL_TRUE /* layered */, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glDispatchCompute(work_groups_count, work_groups_count, 6);
+        }
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+
+    void IBL::BakeIrradianceSH()
+    {
+        /* The mips are box filtered, so a small one is projected as accurately as the mip 0 for the low frequency bands. */
+        uint32_t lod = 0;
+
+        while (GetMipSize(m_settings.environment_size, lod) > SH_SOURCE_SIZE)
+        {
+            ++lod;
+        }
+
+        const uint32_t work_groups_count  = GetWorkGroupsCount(GetMipSize(m_settings.environment_size, lod));
+        const uint32_t partial_sums_count = work_groups_count * work_groups_count * 6 * 9;
+
+        GLuint partial_sums_buffer;
+        glCreateBuffers(1, &partial_sums_buffer);
+        glNamedBufferStorage(partial_sums_buffer, partial_sums_count * sizeof(glm::vec4), nullptr, 0);
+
+        m_irradiance_sh_shader->bind();
+        m_irradiance_sh_shader->setUniform("u_lod", float(lod));
+
+        glBindTextureUnit(0, m_environment_map);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, partial_sums_buffer);
+        glDispatchCompute(work_groups_count, work_groups_count, 6);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        std::vector<glm::vec4> partial_sums(partial_sums_count);
+        glGetNamedBufferSubData(partial_sums_buffer, 0, partial_sums_count * sizeof(glm::vec4), partial_sums.data());
+        glDeleteBuffers(1, &partial_sums_buffer);
+
+        glm::dvec3 sh[9] = {};
+
+        for (uint32_t i = 0; i < partial_sums_count; ++i)
+        {
+            sh[i % 9] += glm::dvec3(partial_sums[i]);
+        }
+
+        for (uint32_t i = 0; i < 9; ++i)
+        {
+            const uint32_t band = i == 0 ? 0 : (i < 4 ? 1 : 2);
+            m_data.irradiance_sh[i] = glm::vec4(glm::vec3(sh[i]) * SH_COSINE_LOBE[band], 0.0f);
+        }
+    }
+
+    void IBL::BakeBrdfLut()
+    {
+        const uint32_t work_groups_count = GetWorkGroupsCount(m_settings.brdf_lut_size);
+
+        if (m_brdf_lut != 0)
+        {
+            glDeleteTextures(1, &m_brdf_lut);
+        }
+
+        m_brdf_lut     = CreateBrdfLut(m_settings.brdf_lut_size);
+        m_brdf_lut_key = GetBrdfLutCacheKey();
+
+        m_brdf_lut_shader->bind();
+        m_brdf_lut_shader->setUniform("u_sample_count", GLuint(m_settings.brdf_lut_samples));
+
+        glBindImageTexture(0, m_brdf_lut, 0 /* level */, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+        glDispatchCompute(work_groups_count, work_groups_count, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+
+    void IBL::UploadData()
+    {
+        if (m_ubo == 0)
+        {
+            glCreateBuffers(1, &m_ubo);
+            glNamedBufferStorage(m_ubo, sizeof(IBLData), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+
+        glNamedBufferSubData(m_ubo, 0, sizeof(IBLData), &m_data);
+    }
+
+    bool IBL::LoadCache(const std::filesystem::path & cache_filepath, uint64_t source_hash)
+    {
+        BinaryCacheReader reader;
+
+        if (!reader.Open(cache_filepath, IBL_CACHE_MAGIC, IBL_CACHE_VERSION, source_hash, GetCacheKey()))
+        {
+            return false;
+        }
+
+        const uint32_t environment_size = m_settings.environment_size;
+        const uint32_t prefiltered_size = m_settings.prefiltered_size;
+
+        auto data = reader.Read<IBLData>();
+
+        /* The environment's mip 0, the other mips are generated. */
+        auto environment_texels = reader.ReadArray<uint32_t>();
+        bool is_valid           = environment_texels.size() == size_t(environment_size) * environment_size * 6;
+
+        std::span<const uint32_t> prefiltered_texels[PREFILTERED_MIP_LEVELS];
+
+        for (uint32_t mip = 0; mip < PREFILTERED_MIP_LEVELS; ++mip)
+        {
+            const uint32_t size = GetMipSize(prefiltered_size, mip);
+
+            prefiltered_texels[mip] = reader.ReadArray<uint32_t>();
+            is_valid               &= prefiltered_texels[mip].size() == size_t(size) * size * 6;
+        }
+
+        if (reader.HasFailed() || !reader.IsAtEnd() || !is_valid)
+        {
+            fprintf(stderr, "IBL cache %s is corrupted, the environment will be baked again.\n", cache_filepath.generic_string().c_str());
+            return false;
+        }
+
+        ReleaseEnvironment();
+
+        m_environment_map = CreateCubemap(environment_size, Texture::GetMaxMipMapsLevels(environment_size, environment_size, 1));
+        WriteCubemapLevel(m_environment_map, environment_size, 0, environment_texels);
+        glGenerateTextureMipmap(m_environment_map);
+
+        m_prefiltered_map = CreateCubemap(prefiltered_size, PREFILTERED_MIP_LEVELS);
+
+        for (uint32_t mip = 0; mip < PREFILTERED_MIP_LEVELS; ++mip)
+        {
+            WriteCubemapLevel(m_prefiltered_map, GetMipSize(prefiltered_size, mip), mip, prefiltered_texels[mip]);
+        }
+
+        m_data = data;
+
+        return true;
+    }
+
+    bool IBL::SaveCache(const std::filesystem::path & cache_filepath, uint64_t source_hash) const
+    {
+        BinaryCacheWriter writer(IBL_CACHE_MAGIC, IBL_CACHE_VERSION, source_hash, GetCacheKey());
+
+        writer.Write(m_data);
+        writer.WriteArray(ReadCubemapLevel(m_environment_map, m_settings.environment_size, 0));
+
+        for (uint32_t mip = 0; mip < PREFILTERED_MIP_LEVELS; ++mip)
+        {
+            writer.WriteArray(ReadCubemapLevel(m_prefiltered_map, GetMipSize(m_settings.prefiltered_size, mip), mip));
+        }
+
+        return writer.Save(cache_filepath);
+    }
+
+    bool IBL::LoadBrdfLutCache(const std::filesystem::path & cache_filepath)
+    {
+        BinaryCacheReader reader;
+
+        if (!reader.Open(cache_filepath, BRDF_LUT_CACHE_MAGIC, BRDF_LUT_CACHE_VERSION, 0, GetBrdfLutCacheKey()))
+        {
+            return false;
+        }
+
+        const uint32_t size = m_settings.brdf_lut_size;
+
+        /* RG16F texels. */
+        auto texels = reader.ReadArray<uint32_t>();
+
+        if (reader.HasFailed() || !reader.IsAtEnd() || texels.size() != size_t(size) * size)
+        {
+            fprintf(stderr, "BRDF LUT cache %s is corrupted, the LUT will be baked again.\n", cache_filepath.generic_string().c_str());
+            return false;
+        }
+
+        if (m_brdf_lut != 0)
+        {
+            glDeleteTextures(1, &m_brdf_lut);
+        }
+
+        m_brdf_lut     = CreateBrdfLut(size);
+        m_brdf_lut_key = GetBrdfLutCacheKey();
+
+        glTextureSubImage2D(m_brdf_lut, 0, 0, 0, size, size, GL_RG, GL_HALF_FLOAT, texels.data());
+
+        return true;
+    }
+
+    bool IBL::SaveBrdfLutCache(const std::filesystem::path & cache_filepath) const
+    {
+        const uint32_t size = m_settings.brdf_lut_size;
+
+        std::vector<uint32_t> texels(size_t(size) * size);
+        glGetTextureImage(m_brdf_lut, 0, GL_RG, GL_HALF_FLOAT, GLsizei(texels.size() * sizeof(uint32_t)), texels.data());
+
+        BinaryCacheWriter writer(BRDF_LUT_CACHE_MAGIC, BRDF_LUT_CACHE_VERSION, 0, GetBrdfLutCacheKey());
+        writer.WriteArray(texels);
+
+        return writer.Save(cache_filepath);
+    }
+
+    uint64_t IBL::GetCacheKey() const
+    {
+        const uint32_t key[] = { m_settings.environment_size, m_settings.prefiltered_size, m_settings.prefilter_samples, PREFILTERED_MIP_LEVELS, SH_SOURCE_SIZE };
+
+        return Util::Hash(key, sizeof(key));
+    }
+
+    uint64_t IBL::GetBrdfLutCacheKey() const
+    {
+        const uint32_t key[] = { m_settings.brdf_lut_size, m_settings.brdf_lut_samples };
+
+        return Util::Hash(key, sizeof(key));
+    }
+
+    GLuint IBL::CreateCubemap(uint32_t size, uint32_t levels)
+    {
+        GLuint cubemap;
+
+        glCreateTextures   (GL_TEXTURE_CUBE_MAP, 1, &cubemap);
+        glTextureStorage2D (cubemap, levels, GL_RGBA16F, size, size);
+        glTextureParameteri(cubemap, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(cubemap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(cubemap, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+        glTextureParameteri(cubemap, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+        glTextureParameteri(cubemap, GL_TEXTURE_WRAP_R,     GL_CLAMP_TO_EDGE);
+
+        return cubemap;
+    }
+
+    GLuint IBL::CreateBrdfLut(uint32_t size)
+    {
+        GLuint brdf_lut;
+
+        glCreateTextures   (GL_TEXTURE_2D, 1, &brdf_lut);
+        glTextureStorage2D (brdf_lut, 1, GL_RG16F, size, size);
+        glTextureParameteri(brdf_lut, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(brdf_lut, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(brdf_lut, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+        glTextureParameteri(brdf_lut, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+
+        return brdf_lut;
+    }
+
+    void IBL::ReleaseEnvironment()
+    {
+        if (m_environment_map != 0)
+        {
+            glDeleteTextures(1, &m_environment_map);
+            m_environment_map = 0;
+        }
+
+        if (m_prefiltered_map != 0)
+        {
+            glDeleteTextures(1, &m_prefiltered_map);
+            m_prefiltered_map = 0;
+        }
+    }
+}
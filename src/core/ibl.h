@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "uniform_buffers.h"
+
+namespace RGL
+{
+    class Shader;
+    class Texture2D;
+
+    struct IBLSettings
+    {
+        uint32_t environment_size  = 1024; /* Face size of the environment cubemap, a power of two. */
+        uint32_t prefiltered_size  = 512;  /* Face size of the mip 0 of the prefiltered cubemap, a power of two. */
+        uint32_t prefilter_samples = 1024; /* GGX importance samples per texel. */
+        uint32_t brdf_lut_size     = 512;
+        uint32_t brdf_lut_samples  = 1024;
+    };
+
+    /* Image based lighting precomputed from an equirectangular HDR map with compute shaders:
+     * - the environment cubemap with its mips, e.g. for the background,
+     * - the GGX prefiltered environment, PREFILTERED_MIP_LEVELS mips, roughness = mip / (PREFILTERED_MIP_LEVELS - 1),
+     * - the diffuse irradiance projected on 9 spherical harmonics coefficients, in the IBL uniform block,
+     * - the split sum BRDF lookup table, which doesn't depend on the HDR map.
+     * The baked data is cached in <root>/cache, keyed by the hash of the HDR file and the settings, so that the next Load()
+     * of the same map only uploads the textures. The bake shaders are built on the first cache miss.
+     * The shaders sample the IBL with core/shaders/ibl.glh. */
+    class IBL final
+    {
+    public:
+        static constexpr uint32_t PREFILTERED_MIP_LEVELS = 5;
+        static constexpr uint32_t PREFILTERED_MAP_UNIT   = 7;
+        static constexpr uint32_t BRDF_LUT_UNIT          = 8;
+
+        IBL();
+        ~IBL();
+
+        IBL(const IBL&)            = delete;
+        IBL& operator=(const IBL&) = delete;
+
+        /* Replaces the previously loaded environment, which is kept if the HDR map can't be loaded. */
+        bool Load(const std::filesystem::path & hdr_filepath, const IBLSettings & settings = {});
+
+        /* Binds the prefiltered map, the BRDF LUT and the SH coefficients to the units and the uniform block used by ibl.glh. */
+        void Bind() const;
+        void BindEnvironmentMap(uint32_t unit = 0) const;
+
+        /* If enabled, Load() reuses the baked data stored in the cache, and stores the data it bakes. */
+        void EnableCache(bool enable) { m_cache_enabled = enable; }
+
+        uint32_t       GetEnvironmentSize() const { return m_settings.environment_size; }
+        const IBLData& GetData()            const { return m_data; }
+
+    private:
+        bool CreateShaders(bool bake_environment, bool bake_brdf_lut);
+
+        void BakeEnvironmentMap(Texture2D & equirectangular_map);
+        void BakePrefilteredMap();
+        void BakeIrradianceSH();
+        void BakeBrdfLut();
+        void UploadData();
+
+        /* Cache */
+        bool LoadCache(const std::filesystem::path & cache_filepath, uint64_t source_hash);
+        bool SaveCache(const std::filesystem::path & cache_filepath, uint64_t source_hash) const;
+        bool LoadBrdfLutCache(const std::filesystem::path & cache_filepath);
+        bool SaveBrdfLutCache(const std::filesystem::path & cache_filepath) const;
+        uint64_t GetCacheKey() const;
+        uint64_t GetBrdfLutCacheKey() const;
+
+        static GLuint CreateCubemap(uint32_t size, uint32_t levels);
+        static GLuint CreateBrdfLut(uint32_t size);
+
+        void ReleaseEnvironment();
+
+        IBLSettings m_settings;
+        IBLData     m_data;
+
+        GLuint   m_environment_map;
+        GLuint   m_prefiltered_map;
+        GLuint   m_brdf_lut;
+        GLuint   m_ubo;
+        uint64_t m_brdf_lut_key; /* Settings the BRDF LUT was baked with, it is rebuilt only if they change. */
+        bool     m_cache_enabled;
+
+        std::shared_ptr<Shader> m_equirectangular_to_cubemap_shader;
+        std::shared_ptr<Shader> m_prefilter_shader;
+        std::shared_ptr<Shader> m_irradiance_sh_shader;
+        std::shared_ptr<Shader> m_brdf_lut_shader;
+    };
+}
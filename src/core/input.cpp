@@ -137,7 +137,8 @@ namespace RGL
 
     bool Input::getKey(KeyCode keyCode)
     {
-        return glfwGetKey(m_window, static_cast<int>(keyCode)) == GLFW_PRESS;
+        /* There's no window in the headless mode. */
+        return m_window && glfwGetKey(m_window, static_cast<int>(keyCode)) == GLFW_PRESS;
     }
 
     bool Input::getKeyDown(KeyCode keyCode)
@@ -152,7 +153,7 @@ namespace RGL
 
     bool Input::getMouse(KeyCode keyCode)
     {
-        return glfwGetMouseButton(m_window, static_cast<int>(keyCode)) == GLFW_PRESS;
+        return m_window && glfwGetMouseButton(m_window, static_cast<int>(keyCode)) == GLFW_PRESS;
     }
 
     bool Input::getMouseDown(KeyCode keyCode)
@@ -167,14 +168,23 @@ namespace RGL
 
     glm::vec2 Input::getMousePosition()
     {
-        double x_pos, y_pos;
-        glfwGetCursorPos(m_window, &x_pos, &y_pos);
+        double x_pos = 0.0, y_pos = 0.0;
+
+        if (m_window)
+        {
+            glfwGetCursorPos(m_window, &x_pos, &y_pos);
+        }
 
         return glm::vec2(x_pos, y_pos);
     }
 
     void Input::setMouseCursorVisibility(bool is_visible)
     {
+        if (!m_window)
+        {
+            return;
+        }
+
         if (is_visible)
         {
             glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -187,6 +197,9 @@ namespace RGL
 
     void Input::setMouseCursorPosition(const glm::vec2 & cursor_position)
     {
-        glfwSetCursorPos(m_window, cursor_position.x, cursor_position.y);
+        if (m_window)
+        {
+            glfwSetCursorPos(m_window, cursor_position.x, cursor_position.y);
+        }
     }
 }
\ No newline at end of file
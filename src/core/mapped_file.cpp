@@ -0,0 +1,109 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace RGL
+{
+    bool MappedFile::Open(const std::filesystem::path& filepath)
+    {
+        Close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileW(filepath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (!mapping)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (!data)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_file_handle    = file;
+        m_mapping_handle = mapping;
+        m_data           = static_cast<const unsigned char*>(data);
+        m_size           = size_t(file_size.QuadPart);
+#else
+        int fd = open(filepath.c_str(), O_RDONLY);
+
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        /* The mapping stays valid after the descriptor is closed. */
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const unsigned char*>(data);
+        m_size = size_t(file_stat.st_size);
+#endif
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (!m_data)
+        {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(HANDLE(m_mapping_handle));
+        CloseHandle(HANDLE(m_file_handle));
+#else
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+
+        m_data           = nullptr;
+        m_size           = 0;
+        m_file_handle    = nullptr;
+        m_mapping_handle = nullptr;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+namespace RGL
+{
+    /* Read-only memory mapping of a whole file. */
+    class MappedFile final
+    {
+    public:
+        MappedFile() : m_data(nullptr), m_size(0), m_file_handle(nullptr), m_mapping_handle(nullptr) {}
+        explicit MappedFile(const std::filesystem::path& filepath) : MappedFile() { Open(filepath); }
+        ~MappedFile() { Close(); }
+
+        MappedFile           (const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept
+            : m_data          (other.m_data),
+              m_size          (other.m_size),
+              m_file_handle   (other.m_file_handle),
+              m_mapping_handle(other.m_mapping_handle)
+        {
+            other.m_data           = nullptr;
+            other.m_size           = 0;
+            other.m_file_handle    = nullptr;
+            other.m_mapping_handle = nullptr;
+        }
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Close();
+
+                std::swap(m_data,           other.m_data);
+                std::swap(m_size,           other.m_size);
+                std::swap(m_file_handle,    other.m_file_handle);
+                std::swap(m_mapping_handle, other.m_mapping_handle);
+            }
+
+            return *this;
+        }
+
+        bool Open(const std::filesystem::path& filepath);
+        void Close();
+
+        bool                 IsOpen() const { return m_data != nullptr; }
+        const unsigned char* Data()   const { return m_data; }
+        size_t               Size()   const { return m_size; }
+
+    private:
+        const unsigned char* m_data;
+        size_t               m_size;
+
+        /* Native handles: HANDLEs on Windows, unused on POSIX systems. */
+        void* m_file_handle;
+        void* m_mapping_handle;
+    };
+}
@@ -10,6 +10,7 @@ namespace RGL
         // Texture type order must match the order in pbr-lighting.glh
         // TextureType is being cast to uint32_t during the mesh rendering.
         enum class TextureType { ALBEDO, NORMAL, METALLIC, ROUGHNESS, AO, EMISSIVE };
+        static constexpr uint32_t TEXTURE_TYPES_COUNT = 6;
 
         Material();
         ~Material();
@@ -31,5 +32,6 @@ namespace RGL
         std::map<std::string, bool>                       m_bool_map;
 
         friend class StaticModel;
+        friend class AnimatedModel;
     };
 }
\ No newline at end of file
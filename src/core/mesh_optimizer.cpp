@@ -0,0 +1,360 @@
+#include "mesh_optimizer.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <glm/geometric.hpp>
+
+namespace RGL
+{
+    /* Parameters of the Forsyth's scoring function, taken from the original article. */
+    static constexpr uint32_t MAX_CACHE_SIZE      = 32;
+    static constexpr float    CACHE_DECAY_POWER   = 1.5f;
+    static constexpr float    LAST_TRIANGLE_SCORE = 0.75f;
+    static constexpr float    VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr float    VALENCE_BOOST_POWER = 0.5f;
+
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    static float VertexScore(int32_t cache_position, uint32_t live_triangles_count)
+    {
+        /* The vertex is not used by any of the remaining triangles. */
+        if (live_triangles_count == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+
+        if (cache_position >= 0)
+        {
+            /* The vertices of the last triangle get a fixed score so that the next triangle doesn't reuse them too eagerly. */
+            if (cache_position < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                score = std::pow(1.0f - float(cache_position - 3) / float(MAX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+            }
+        }
+
+        /* Boost the vertices with only a few triangles left, so that they don't linger. */
+        score += VALENCE_BOOST_SCALE * std::pow(float(live_triangles_count), -VALENCE_BOOST_POWER);
+
+        return score;
+    }
+
+    VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertices_count, uint32_t cache_size)
+    {
+        VertexCacheStats stats;
+        stats.triangles_count = uint32_t(indices.size() / 3);
+
+        /* A vertex is in the FIFO cache if less than cache_size vertices have been transformed since it was. */
+        std::vector<uint32_t> cache_timestamps(vertices_count, 0);
+        std::vector<bool>     is_referenced   (vertices_count, false);
+        uint32_t              timestamp = cache_size + 1;
+
+        for (auto index : indices)
+        {
+            if (timestamp - cache_timestamps[index] > cache_size)
+            {
+                cache_timestamps[index] = timestamp++;
+                stats.vertices_transformed++;
+            }
+
+            if (!is_referenced[index])
+            {
+                is_referenced[index] = true;
+                stats.vertices_count++;
+            }
+        }
+
+        return stats;
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertices_count)
+    {
+        const size_t triangles_count = indices.size() / 3;
+
+        if (triangles_count == 0)
+        {
+            return;
+        }
+
+        /* Triangles adjacent to each vertex. The first live_triangles[v] entries are the ones that haven't been emitted yet. */
+        std::vector<uint32_t> live_triangles   (vertices_count, 0);
+        std::vector<uint32_t> adjacency_offsets(vertices_count + 1, 0);
+        std::vector<uint32_t> adjacency        (indices.size());
+
+        for (auto index : indices)
+        {
+            live_triangles[index]++;
+        }
+
+        for (size_t v = 0; v < vertices_count; ++v)
+        {
+            adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+        }
+
+        {
+            std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                adjacency[fill_offsets[indices[i]]++] = uint32_t(i / 3);
+            }
+        }
+
+        /* Initial scores, none of the vertices are in the cache. */
+        std::vector<int32_t> cache_positions(vertices_count, -1);
+        std::vector<float>   vertex_scores  (vertices_count);
+        std::vector<float>   triangle_scores(triangles_count, 0.0f);
+        std::vector<bool>    is_emitted     (triangles_count, false);
+
+        for (size_t v = 0; v < vertices_count; ++v)
+        {
+            vertex_scores[v] = VertexScore(-1, live_triangles[v]);
+        }
+
+        for (size_t t = 0; t < triangles_count; ++t)
+        {
+            triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+        }
+
+        std::vector<uint32_t> output(indices.size());
+
+        uint32_t cache    [MAX_CACHE_SIZE + 3];
+        uint32_t new_cache[MAX_CACHE_SIZE + 3];
+        uint32_t cache_count = 0;
+
+        size_t  input_cursor  = 0;
+        int64_t best_triangle = -1;
+
+        for (size_t output_triangle = 0; output_triangle < triangles_count; ++output_triangle)
+        {
+            /* Dead end - none of the cached vertices has any triangles left, continue with the next triangle in the input order. */
+            if (best_triangle < 0)
+            {
+                while (is_emitted[input_cursor])
+                {
+                    ++input_cursor;
+                }
+
+                best_triangle = int64_t(input_cursor);
+            }
+
+            const uint32_t triangle[3] = { indices[best_triangle * 3 + 0], indices[best_triangle * 3 + 1], indices[best_triangle * 3 + 2] };
+
+            std::copy(triangle, triangle + 3, output.begin() + output_triangle * 3);
+            is_emitted[best_triangle] = true;
+
+            /* Remove the triangle from the live adjacency lists of its vertices. */
+            for (auto v : triangle)
+            {
+                auto begin = adjacency.begin() + adjacency_offsets[v];
+                auto end   = begin + live_triangles[v];
+                auto it    = std::find(begin, end, uint32_t(best_triangle));
+
+                std::iter_swap(it, end - 1);
+                live_triangles[v]--;
+            }
+
+            /* Move the triangle's vertices to the front of the LRU cache. */
+            uint32_t new_cache_count = 0;
+
+            for (auto v : triangle)
+            {
+                if (std::find(new_cache, new_cache + new_cache_count, v) == new_cache + new_cache_count)
+                {
+                    new_cache[new_cache_count++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < cache_count; ++i)
+            {
+                if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3)
+                {
+                    new_cache[new_cache_count++] = cache[i];
+                }
+            }
+
+            /* Update the scores of the cached vertices, including the ones that have just been evicted, and of their triangles. */
+            for (uint32_t i = 0; i < new_cache_count; ++i)
+            {
+                const uint32_t v = new_cache[i];
+
+                cache_positions[v] = i < MAX_CACHE_SIZE ? int32_t(i) : -1;
+
+                const float score = VertexScore(cache_positions[v], live_triangles[v]);
+                const float delta = score - vertex_scores[v];
+
+                vertex_scores[v] = score;
+
+                for (uint32_t j = adjacency_offsets[v]; j < adjacency_offsets[v] + live_triangles[v]; ++j)
+                {
+                    triangle_scores[adjacency[j]] += delta;
+                }
+            }
+
+            cache_count = std::min(new_cache_count, MAX_CACHE_SIZE);
+            std::copy(new_cache, new_cache + cache_count, cache);
+
+            /* The next triangle is the best scoring one among the triangles that use the cached vertices. */
+            float best_score = -std::numeric_limits<float>::max();
+            best_triangle    = -1;
+
+            for (uint32_t i = 0; i < cache_count; ++i)
+            {
+                const uint32_t v = cache[i];
+
+                for (uint32_t j = adjacency_offsets[v]; j < adjacency_offsets[v] + live_triangles[v]; ++j)
+                {
+                    const uint32_t t = adjacency[j];
+
+                    if (triangle_scores[t] > best_score)
+                    {
+                        best_score    = triangle_scores[t];
+                        best_triangle = t;
+                    }
+                }
+            }
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions)
+    {
+        const size_t triangles_count = indices.size() / 3;
+
+        if (triangles_count == 0)
+        {
+            return;
+        }
+
+        /* A new cluster starts wherever all three vertices of a triangle miss the cache, so that reordering
+         * the clusters doesn't affect the vertex cache efficiency much. */
+        std::vector<uint32_t> cluster_offsets;
+        std::vector<uint32_t> cache_timestamps(positions.size(), 0);
+        uint32_t              timestamp = ANALYZE_CACHE_SIZE + 1;
+
+        for (size_t t = 0; t < triangles_count; ++t)
+        {
+            uint32_t cache_misses = 0;
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = indices[t * 3 + k];
+
+                if (timestamp - cache_timestamps[v] > ANALYZE_CACHE_SIZE)
+                {
+                    cache_timestamps[v] = timestamp++;
+                    cache_misses++;
+                }
+            }
+
+            if (t == 0 || cache_misses == 3)
+            {
+                cluster_offsets.push_back(uint32_t(t));
+            }
+        }
+
+        cluster_offsets.push_back(uint32_t(triangles_count));
+
+        const size_t clusters_count = cluster_offsets.size() - 1;
+
+        if (clusters_count < 2)
+        {
+            return;
+        }
+
+        /* Area weighted centroids and normals of the clusters. */
+        std::vector<glm::vec3> cluster_centroids(clusters_count, glm::vec3(0.0f));
+        std::vector<glm::vec3> cluster_normals  (clusters_count, glm::vec3(0.0f));
+        std::vector<float>     cluster_areas    (clusters_count, 0.0f);
+
+        glm::vec3 mesh_centroid = glm::vec3(0.0f);
+        float     mesh_area     = 0.0f;
+
+        for (size_t c = 0; c < clusters_count; ++c)
+        {
+            for (uint32_t t = cluster_offsets[c]; t < cluster_offsets[c + 1]; ++t)
+            {
+                const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+                const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+                const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float     area   = glm::length(normal);
+
+                cluster_centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+                cluster_normals  [c] += normal;
+                cluster_areas    [c] += area;
+            }
+
+            mesh_centroid += cluster_centroids[c];
+            mesh_area     += cluster_areas[c];
+        }
+
+        if (mesh_area > 0.0f)
+        {
+            mesh_centroid /= mesh_area;
+        }
+
+        /* Clusters that face away from the mesh's center are more likely to occlude the other ones, so they are drawn first. */
+        std::vector<float> cluster_sort_keys(clusters_count, 0.0f);
+
+        for (size_t c = 0; c < clusters_count; ++c)
+        {
+            const float normal_length = glm::length(cluster_normals[c]);
+
+            if (cluster_areas[c] > 0.0f && normal_length > 0.0f)
+            {
+                cluster_sort_keys[c] = glm::dot(cluster_centroids[c] / cluster_areas[c] - mesh_centroid, cluster_normals[c] / normal_length);
+            }
+        }
+
+        std::vector<uint32_t> cluster_order(clusters_count);
+        std::iota(cluster_order.begin(), cluster_order.end(), 0);
+        std::stable_sort(cluster_order.begin(), cluster_order.end(), [&cluster_sort_keys](uint32_t a, uint32_t b) { return cluster_sort_keys[a] > cluster_sort_keys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        for (auto c : cluster_order)
+        {
+            output.insert(output.end(), indices.begin() + cluster_offsets[c] * 3, indices.begin() + cluster_offsets[c + 1] * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::span<uint32_t> indices, size_t vertices_count)
+    {
+        std::vector<uint32_t> remap(vertices_count, INVALID_INDEX);
+        uint32_t              next_vertex = 0;
+
+        for (auto& index : indices)
+        {
+            if (remap[index] == INVALID_INDEX)
+            {
+                remap[index] = next_vertex++;
+            }
+
+            index = remap[index];
+        }
+
+        /* Keep the unreferenced vertices at the end, so that the vertex count of the mesh doesn't change. */
+        for (auto& new_index : remap)
+        {
+            if (new_index == INVALID_INDEX)
+            {
+                new_index = next_vertex++;
+            }
+        }
+
+        return remap;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace RGL
+{
+    /* Post-transform vertex cache statistics of a triangle list. */
+    struct VertexCacheStats
+    {
+        uint32_t vertices_transformed = 0; /* Number of cache misses. */
+        uint32_t vertices_count       = 0; /* Number of unique vertices referenced by the indices. */
+        uint32_t triangles_count      = 0;
+
+        /* Average cache miss ratio, i.e. transformed vertices per triangle. 0.5 is the best case for a regular grid, 3.0 the worst. */
+        float GetACMR() const { return triangles_count > 0 ? float(vertices_transformed) / float(triangles_count) : 0.0f; }
+
+        /* Average transform to vertex ratio. 1.0 means that every vertex is transformed exactly once. */
+        float GetATVR() const { return vertices_count > 0 ? float(vertices_transformed) / float(vertices_count) : 0.0f; }
+
+        VertexCacheStats& operator+=(const VertexCacheStats& other)
+        {
+            vertices_transformed += other.vertices_transformed;
+            vertices_count       += other.vertices_count;
+            triangles_count      += other.triangles_count;
+
+            return *this;
+        }
+    };
+
+    /* Reorders indexed triangle lists to reduce the vertex shader invocations, overdraw and vertex fetch cost.
+     * All the functions work on a single mesh, i.e. the indices have to be in [0, vertices_count). */
+    class MeshOptimizer
+    {
+    public:
+        /* Size of the simulated FIFO cache used for the statistics. */
+        static constexpr uint32_t ANALYZE_CACHE_SIZE = 16;
+
+        static VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertices_count, uint32_t cache_size = ANALYZE_CACHE_SIZE);
+
+        /* Reorders the triangles to maximize the post-transform vertex cache hits (T. Forsyth, "Linear-Speed Vertex Cache Optimisation"). */
+        static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertices_count);
+
+        /* Splits the cache optimized triangles into clusters at the cache flushes and sorts the clusters so that the outward facing ones
+         * are drawn first (P. Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+         * Should be called after OptimizeVertexCache(). */
+        static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions);
+
+        /* Rewrites the indices so that the vertices are referenced in the order of their first use.
+         * Returns the remap table, remap[old_index] == new_index, that has to be applied to all of the vertex streams with RemapVertices(). */
+        static std::vector<uint32_t> OptimizeVertexFetch(std::span<uint32_t> indices, size_t vertices_count);
+
+        template<typename T>
+        static void RemapVertices(std::span<T> vertices, const std::vector<uint32_t>& remap)
+        {
+            std::vector<T> remapped_vertices(vertices.size());
+
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                remapped_vertices[remap[i]] = vertices[i];
+            }
+
+            std::copy(remapped_vertices.begin(), remapped_vertices.end(), vertices.begin());
+        }
+    };
+}
@@ -1,12 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+
+#include <glad/glad.h>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
 namespace RGL
 {
     constexpr static uint32_t INVALID_MATERIAL = 0xffffffff;
 
+    /* Vertex layouts of the model's vertex buffer, see StaticModel::SetVertexFormat(). */
+    enum class VertexFormat { SEPARATE, INTERLEAVED, COMPACT };
+
+    /* VertexFormat::INTERLEAVED, 44 bytes. */
     struct Vertex
     {
         Vertex() = default;
@@ -17,6 +26,20 @@ namespace RGL
         glm::vec3 m_tangent;
     };
 
+    /* VertexFormat::COMPACT, 24 bytes. */
+    struct CompactVertex
+    {
+        CompactVertex() = default;
+
+        glm::vec3 m_position;
+        uint32_t  m_normal;   /* GL_INT_2_10_10_10_REV, normalized */
+        uint32_t  m_texcoord; /* 2x GL_HALF_FLOAT */
+        uint32_t  m_tangent;  /* GL_INT_2_10_10_10_REV, normalized */
+    };
+
+    static_assert(sizeof(Vertex)        == 44);
+    static_assert(sizeof(CompactVertex) == 24);
+
     class MeshPart final
     {
     public:
@@ -24,13 +47,25 @@ namespace RGL
             : m_base_vertex   (0),
               m_base_index    (0),
               m_material_index(INVALID_MATERIAL),
-              m_indices_count (0) { }
+              m_indices_count (0),
+              m_index_type    (GL_UNSIGNED_INT),
+              m_index_offset  (0),
+              m_aabb_min      (-std::numeric_limits<float>::max()),
+              m_aabb_max      ( std::numeric_limits<float>::max()),
+              m_bounding_sphere(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::max()) { }
 
     private:
         uint32_t m_base_vertex;
         uint32_t m_base_index;
         uint32_t m_material_index;
         uint32_t m_indices_count;
+        uint32_t m_index_type;   /* GL_UNSIGNED_INT or GL_UNSIGNED_SHORT */
+        uint32_t m_index_offset; /* In bytes, from the beginning of the index buffer. */
+
+        /* Bounds in the model space. The default ones are infinite, so the part is never culled. */
+        glm::vec3 m_aabb_min;
+        glm::vec3 m_aabb_max;
+        glm::vec4 m_bounding_sphere; /* xyz - center, w - radius */
 
         friend class StaticModel;
         friend class AnimatedModel;
@@ -0,0 +1,647 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include <glm/common.hpp>
+
+#include "filesystem.h"
+#include "timer.h"
+#include "window.h"
+
+#include "gui/gui.h"
+
+namespace RGL
+{
+    bool                               Profiler::s_enabled            = true;
+    bool                               Profiler::s_created            = false;
+    bool                               Profiler::s_in_frame           = false;
+    bool                               Profiler::s_paused             = false;
+    uint64_t                           Profiler::s_frame_index        = 0;
+    double                             Profiler::s_gpu_clock_offset   = 0.0;
+    Profiler::PendingFrame             Profiler::s_pending_frames[FRAMES_IN_FLIGHT] = {};
+    uint32_t                           Profiler::s_pending_index      = 0;
+    int32_t                            Profiler::s_scope_stack[MAX_DEPTH] = {};
+    uint32_t                           Profiler::s_scope_stack_size   = 0;
+    uint32_t                           Profiler::s_dropped_scopes     = 0;
+    std::vector<Profiler::Frame>       Profiler::s_history;
+    uint32_t                           Profiler::s_history_index      = 0;
+    uint32_t                           Profiler::s_history_count      = 0;
+    std::vector<Profiler::ScopeStats>  Profiler::s_stats;
+
+    /* Weight of the new sample in the rolling averages. */
+    static constexpr float AVERAGE_FACTOR = 0.05f;
+
+    void Profiler::Create()
+    {
+        for (auto& pending_frame : s_pending_frames)
+        {
+            glCreateQueries(GL_TIMESTAMP, MAX_SCOPES * 2, pending_frame.queries);
+            pending_frame.frame.scopes.reserve(MAX_SCOPES);
+            pending_frame.pending = false;
+        }
+
+        s_history.resize(HISTORY_SIZE);
+
+        for (auto& frame : s_history)
+        {
+            frame.scopes.reserve(MAX_SCOPES);
+        }
+
+        /* The offset between the clocks, to place the GPU scopes on the CPU's timeline in the trace. */
+        GLint64 gpu_time = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+
+        s_gpu_clock_offset = Timer::getTime() - gpu_time / 1e9;
+        s_created          = true;
+    }
+
+    void Profiler::Release()
+    {
+        if (!s_created)
+        {
+            return;
+        }
+
+        for (auto& pending_frame : s_pending_frames)
+        {
+            glDeleteQueries(MAX_SCOPES * 2, pending_frame.queries);
+            pending_frame.frame.scopes.clear();
+            pending_frame.pending = false;
+        }
+
+        s_history.clear();
+        s_stats.clear();
+
+        s_history_index = 0;
+        s_history_count = 0;
+        s_in_frame      = false;
+        s_created       = false;
+    }
+
+    void Profiler::Flush()
+    {
+        if (!s_created || s_in_frame)
+        {
+            return;
+        }
+
+        /* From the oldest frame, the one after the current pending index, to the newest. */
+        for (uint32_t i = 1; i <= FRAMES_IN_FLIGHT; ++i)
+        {
+            auto& pending_frame = s_pending_frames[(s_pending_index + i) % FRAMES_IN_FLIGHT];
+
+            if (pending_frame.pending)
+            {
+                Resolve(pending_frame);
+            }
+        }
+    }
+
+    void Profiler::BeginFrame()
+    {
+        if (!s_enabled || s_in_frame)
+        {
+            return;
+        }
+
+        if (!s_created)
+        {
+            Create();
+        }
+
+        s_pending_index = (s_pending_index + 1) % FRAMES_IN_FLIGHT;
+
+        auto& pending_frame = s_pending_frames[s_pending_index];
+
+        /* Usually available already, the frame was submitted FRAMES_IN_FLIGHT frames ago. */
+        if (pending_frame.pending)
+        {
+            Resolve(pending_frame);
+        }
+
+        pending_frame.frame.index     = s_frame_index++;
+        pending_frame.frame.cpu_start = Timer::getTime();
+        pending_frame.frame.scopes.clear();
+
+        s_in_frame         = true;
+        s_scope_stack_size = 0;
+        s_dropped_scopes   = 0;
+
+        BeginScope("Frame", true);
+    }
+
+    void Profiler::EndFrame()
+    {
+        if (!s_in_frame)
+        {
+            return;
+        }
+
+        if (s_scope_stack_size > 1)
+        {
+            fprintf(stderr, "Profiler: %u scopes are still open at the end of the frame.\n", s_scope_stack_size - 1);
+        }
+
+        while (s_scope_stack_size > 0)
+        {
+            EndScope();
+        }
+
+        s_pending_frames[s_pending_index].pending = true;
+        s_in_frame = false;
+    }
+
+    void Profiler::BeginScope(const char* name, bool gpu)
+    {
+        if (!s_in_frame)
+        {
+            return;
+        }
+
+        auto&         pending_frame = s_pending_frames[s_pending_index];
+        auto&         scopes        = pending_frame.frame.scopes;
+        const int32_t parent        = s_scope_stack_size > 0 ? s_scope_stack[std::min(s_scope_stack_size, MAX_DEPTH) - 1] : -1;
+        int32_t       index         = -1;
+
+        /* The children of the dropped scopes are dropped as well. */
+        if (s_scope_stack_size < MAX_DEPTH && scopes.size() < MAX_SCOPES && (s_scope_stack_size == 0 || parent >= 0))
+        {
+            index = int32_t(scopes.size());
+
+            Scope scope       = {};
+            scope.name        = name;
+            scope.parent      = parent;
+            scope.depth       = s_scope_stack_size;
+            scope.gpu         = gpu;
+            scope.cpu_begin   = (Timer::getTime() - pending_frame.frame.cpu_start) * 1000.0;
+
+            if (gpu)
+            {
+                glQueryCounter(pending_frame.queries[index * 2 + 0], GL_TIMESTAMP);
+            }
+
+            scopes.push_back(scope);
+        }
+        else
+        {
+            ++s_dropped_scopes;
+        }
+
+        if (s_scope_stack_size < MAX_DEPTH)
+        {
+            s_scope_stack[s_scope_stack_size] = index;
+        }
+
+        ++s_scope_stack_size;
+    }
+
+    void Profiler::EndScope()
+    {
+        if (!s_in_frame || s_scope_stack_size == 0)
+        {
+            return;
+        }
+
+        --s_scope_stack_size;
+
+        if (s_scope_stack_size >= MAX_DEPTH || s_scope_stack[s_scope_stack_size] < 0)
+        {
+            return;
+        }
+
+        auto&         pending_frame = s_pending_frames[s_pending_index];
+        const int32_t index         = s_scope_stack[s_scope_stack_size];
+        auto&         scope         = pending_frame.frame.scopes[index];
+
+        if (scope.gpu)
+        {
+            glQueryCounter(pending_frame.queries[index * 2 + 1], GL_TIMESTAMP);
+        }
+
+        scope.cpu_end = (Timer::getTime() - pending_frame.frame.cpu_start) * 1000.0;
+    }
+
+    void Profiler::Resolve(PendingFrame& pending_frame)
+    {
+        auto& frame = pending_frame.frame;
+
+        pending_frame.pending = false;
+
+        if (frame.scopes.empty())
+        {
+            return;
+        }
+
+        GLuint64 frame_begin = 0;
+        glGetQueryObjectui64v(pending_frame.queries[0], GL_QUERY_RESULT, &frame_begin);
+
+        for (size_t i = 0; i < frame.scopes.size(); ++i)
+        {
+            auto& scope = frame.scopes[i];
+
+            if (scope.gpu)
+            {
+                GLuint64 begin_time, end_time;
+                glGetQueryObjectui64v(pending_frame.queries[i * 2 + 0], GL_QUERY_RESULT, &begin_time);
+                glGetQueryObjectui64v(pending_frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end_time);
+
+                scope.gpu_begin = double(int64_t(begin_time - frame_begin)) / 1e6;
+                scope.gpu_end   = double(int64_t(end_time   - frame_begin)) / 1e6;
+            }
+        }
+
+        frame.gpu_start = frame_begin / 1e9 + s_gpu_clock_offset;
+
+        if (s_paused)
+        {
+            return;
+        }
+
+        UpdateStats(frame);
+
+        /* Swapping keeps the reserved capacity of both of the frames, the history doesn't allocate. */
+        auto& history_frame = s_history[s_history_index];
+        std::swap(history_frame, frame);
+
+        s_history_index = (s_history_index + 1) % HISTORY_SIZE;
+        s_history_count = std::min(s_history_count + 1, HISTORY_SIZE);
+    }
+
+    void Profiler::UpdateStats(Frame& frame)
+    {
+        for (auto& scope : frame.scopes)
+        {
+            const int32_t parent = scope.parent >= 0 ? int32_t(frame.scopes[scope.parent].stats_index) : -1;
+
+            auto it = std::find_if(s_stats.begin(), s_stats.end(), [&](const ScopeStats& stats)
+            {
+                return stats.parent == parent && (stats.name == scope.name || std::strcmp(stats.name, scope.name) == 0);
+            });
+
+            if (it == s_stats.end())
+            {
+                ScopeStats new_stats = {};
+                new_stats.name   = scope.name;
+                new_stats.parent = parent;
+
+                it = s_stats.insert(s_stats.end(), new_stats);
+            }
+
+            auto& stats = *it;
+            scope.stats_index = uint32_t(it - s_stats.begin());
+
+            const float cpu_time   = float(scope.cpu_end - scope.cpu_begin);
+            const float gpu_time   = scope.gpu ? float(scope.gpu_end - scope.gpu_begin) : 0.0f;
+            const bool  same_frame = stats.samples_count > 0 && stats.last_frame == frame.index;
+
+            stats.gpu = stats.gpu || scope.gpu;
+
+            if (!same_frame)
+            {
+                stats.cpu_history[stats.samples_count % HISTORY_SIZE] = 0.0f;
+                stats.gpu_history[stats.samples_count % HISTORY_SIZE] = 0.0f;
+                stats.last_frame = frame.index;
+                ++stats.samples_count;
+            }
+
+            const uint32_t sample = (stats.samples_count - 1) % HISTORY_SIZE;
+
+            stats.cpu_history[sample] += cpu_time;
+            stats.gpu_history[sample] += gpu_time;
+
+            /* The average is linear in the sample, the repeated scopes of a frame add their weighted times. */
+            if (stats.samples_count == 1)
+            {
+                stats.cpu_average = stats.cpu_history[sample];
+                stats.gpu_average = stats.gpu_history[sample];
+            }
+            else if (same_frame)
+            {
+                stats.cpu_average += cpu_time * AVERAGE_FACTOR;
+                stats.gpu_average += gpu_time * AVERAGE_FACTOR;
+            }
+            else
+            {
+                stats.cpu_average = glm::mix(stats.cpu_average, cpu_time, AVERAGE_FACTOR);
+                stats.gpu_average = glm::mix(stats.gpu_average, gpu_time, AVERAGE_FACTOR);
+            }
+        }
+    }
+
+    float Profiler::GetPercentile(const ScopeStats& stats, float p, bool gpu)
+    {
+        const uint32_t count = std::min(stats.samples_count, HISTORY_SIZE);
+
+        if (count == 0)
+        {
+            return 0.0f;
+        }
+
+        std::array<float, HISTORY_SIZE> samples;
+        std::copy_n(gpu ? stats.gpu_history : stats.cpu_history, count, samples.begin());
+
+        const uint32_t n = std::min(uint32_t(p * (count - 1) + 0.5f), count - 1);
+        std::nth_element(samples.begin(), samples.begin() + n, samples.begin() + count);
+
+        return samples[n];
+    }
+
+    const Profiler::ScopeStats* Profiler::FindStats(const char* name)
+    {
+        auto it = std::find_if(s_stats.begin(), s_stats.end(), [&](const ScopeStats& stats) { return std::strcmp(stats.name, name) == 0; });
+
+        return it != s_stats.end() ? &*it : nullptr;
+    }
+
+    const Profiler::Frame* Profiler::GetLastFrame()
+    {
+        if (s_history_count == 0)
+        {
+            return nullptr;
+        }
+
+        return &s_history[(s_history_index + HISTORY_SIZE - 1) % HISTORY_SIZE];
+    }
+
+    const Profiler::Frame* Profiler::FindFrame(uint64_t index)
+    {
+        /* From the newest frame, the requested one is usually among the last ones. */
+        for (uint32_t i = 1; i <= s_history_count; ++i)
+        {
+            const auto& frame = s_history[(s_history_index + HISTORY_SIZE - i) % HISTORY_SIZE];
+
+            if (frame.index == index)
+            {
+                return &frame;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static ImU32 GetScopeColor(uint32_t stats_index)
+    {
+        static const ImU32 colors[] =
+        {
+            IM_COL32(232, 118,  86, 255), IM_COL32(240, 170,  80, 255), IM_COL32(226, 208,  94, 255), IM_COL32(150, 200,  96, 255),
+            IM_COL32( 94, 190, 160, 255), IM_COL32( 96, 160, 222, 255), IM_COL32(150, 130, 220, 255), IM_COL32(214, 122, 180, 255)
+        };
+
+        return colors[stats_index % IM_ARRAYSIZE(colors)];
+    }
+
+    void Profiler::RenderTimeline(const Frame& frame, bool gpu)
+    {
+        const Scope& root     = frame.scopes[0];
+        const double duration = gpu ? root.gpu_end - root.gpu_begin : root.cpu_end - root.cpu_begin;
+
+        uint32_t max_depth = 0;
+
+        for (auto& scope : frame.scopes)
+        {
+            if (!gpu || scope.gpu)
+            {
+                max_depth = std::max(max_depth, scope.depth);
+            }
+        }
+
+        ImGui::Text("%s %.3f ms", gpu ? "GPU" : "CPU", duration);
+
+        const float  row_height = ImGui::GetTextLineHeightWithSpacing();
+        const float  width      = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+        const ImVec2 origin     = ImGui::GetCursorScreenPos();
+        const double scale      = duration > 0.0 ? width / duration : 0.0;
+
+        ImGui::Dummy(ImVec2(width, row_height * (max_depth + 1)));
+
+        auto draw_list = ImGui::GetWindowDrawList();
+
+        for (auto& scope : frame.scopes)
+        {
+            if (gpu && !scope.gpu)
+            {
+                continue;
+            }
+
+            const double begin = gpu ? scope.gpu_begin : scope.cpu_begin;
+            const double end   = gpu ? scope.gpu_end   : scope.cpu_end;
+
+            const ImVec2 min(origin.x + float(begin * scale), origin.y + scope.depth * row_height);
+            const ImVec2 max(std::max(origin.x + float(end * scale), min.x + 1.0f), min.y + row_height - 1.0f);
+
+            draw_list->AddRectFilled(min, max, GetScopeColor(scope.stats_index));
+
+            if (max.x - min.x > ImGui::CalcTextSize(scope.name).x + 4.0f)
+            {
+                draw_list->PushClipRect(min, max, true);
+                draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(20, 20, 20, 255), scope.name);
+                draw_list->PopClipRect();
+            }
+
+            if (ImGui::IsMouseHoveringRect(min, max))
+            {
+                const auto& stats = s_stats[scope.stats_index];
+
+                ImGui::BeginTooltip();
+                ImGui::Text("%s", scope.name);
+                ImGui::Separator();
+                ImGui::Text("%.3f ms, average %.3f ms", end - begin, gpu ? stats.gpu_average : stats.cpu_average);
+                ImGui::Text("p50 %.3f ms, p95 %.3f ms, p99 %.3f ms", GetPercentile(stats, 0.5f, gpu), GetPercentile(stats, 0.95f, gpu), GetPercentile(stats, 0.99f, gpu));
+                ImGui::EndTooltip();
+            }
+        }
+    }
+
+    void Profiler::RenderStatsTree(int32_t parent)
+    {
+        for (size_t i = 0; i < s_stats.size(); ++i)
+        {
+            const auto& stats = s_stats[i];
+
+            /* The scopes that haven't been recorded for the whole history are hidden, e.g. the ones of a disabled pass. */
+            if (stats.parent != parent || s_frame_index - stats.last_frame > HISTORY_SIZE + FRAMES_IN_FLIGHT)
+            {
+                continue;
+            }
+
+            const bool has_children = std::any_of(s_stats.begin(), s_stats.end(), [&](const ScopeStats& child) { return child.parent == int32_t(i); });
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+
+            ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+            flags |= ImGuiTreeNodeFlags_SpanFullWidth;
+
+            if (!has_children)
+            {
+                flags |= ImGuiTreeNodeFlags_Leaf;
+                flags |= ImGuiTreeNodeFlags_NoTreePushOnOpen;
+            }
+
+            ImGui::PushID(int(i));
+            const bool open = ImGui::TreeNodeEx(stats.name, flags);
+            ImGui::PopID();
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.cpu_average);
+            ImGui::TableNextColumn();
+
+            if (stats.gpu)
+            {
+                ImGui::Text("%.3f", stats.gpu_average);
+            }
+            else
+            {
+                ImGui::Text("-");
+            }
+
+            /* The percentiles of the GPU time of the GPU scopes, of the CPU time of the others. */
+            for (float p : { 0.5f, 0.95f, 0.99f })
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", GetPercentile(stats, p, stats.gpu));
+            }
+
+            if (open && has_children)
+            {
+                RenderStatsTree(int32_t(i));
+                ImGui::TreePop();
+            }
+        }
+    }
+
+    void Profiler::RenderGui()
+    {
+        static std::string export_message;
+
+        ImGui::SetNextWindowSize(ImVec2(640, 420), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+
+        if (ImGui::Begin("Profiler"))
+        {
+            ImGui::Checkbox("Enabled", &s_enabled);
+            ImGui::SameLine();
+            ImGui::Checkbox("Pause", &s_paused);
+            ImGui::SameLine();
+
+            if (ImGui::Button("Export Chrome trace"))
+            {
+                std::string filename = Window::getTitle();
+                std::replace_if(filename.begin(), filename.end(), [](char c) { return !std::isalnum(uint8_t(c)); }, '_');
+
+                const auto filepath = FileSystem::getRootPath() / "profiles" / (filename + ".trace.json");
+
+                export_message = ExportChromeTrace(filepath) ? "Exported to " + filepath.generic_string() : "Export failed";
+            }
+
+            if (!export_message.empty())
+            {
+                ImGui::Text("%s", export_message.c_str());
+            }
+
+            if (auto frame = GetLastFrame())
+            {
+                ImGui::Separator();
+                ImGui::Text("Frame %llu, the statistics cover the last %u frames.", (unsigned long long)frame->index, std::min(s_history_count, HISTORY_SIZE));
+
+                if (s_dropped_scopes > 0)
+                {
+                    ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.3f, 1.0f), "%u scopes over the limits were dropped.", s_dropped_scopes);
+                }
+
+                RenderTimeline(*frame, false);
+                RenderTimeline(*frame, true);
+
+                ImGui::Spacing();
+
+                if (ImGui::BeginTable("Profiler scopes", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+                {
+                    ImGui::TableSetupColumn("Scope");
+                    ImGui::TableSetupColumn("CPU ms");
+                    ImGui::TableSetupColumn("GPU ms");
+                    ImGui::TableSetupColumn("p50");
+                    ImGui::TableSetupColumn("p95");
+                    ImGui::TableSetupColumn("p99");
+                    ImGui::TableHeadersRow();
+
+                    RenderStatsTree(-1);
+
+                    ImGui::EndTable();
+                }
+            }
+        }
+        ImGui::End();
+    }
+
+    static void WriteJsonString(FILE* file, const char* value)
+    {
+        fputc('"', file);
+
+        for (const char* c = value; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                fputc('\\', file);
+            }
+
+            if (uint8_t(*c) >= 0x20)
+            {
+                fputc(*c, file);
+            }
+        }
+
+        fputc('"', file);
+    }
+
+    bool Profiler::ExportChromeTrace(const std::filesystem::path& filepath)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(filepath.parent_path(), ec);
+
+        FILE* file = fopen(filepath.string().c_str(), "w");
+
+        if (!file)
+        {
+            fprintf(stderr, "Could not write the profiler trace %s\n", filepath.generic_string().c_str());
+            return false;
+        }
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+        /* The timestamps are in microseconds since the start of the oldest frame. */
+        const uint32_t first_frame = (s_history_index + HISTORY_SIZE - s_history_count) % HISTORY_SIZE;
+        const double   start_time  = s_history_count > 0 ? std::min(s_history[first_frame].cpu_start, s_history[first_frame].gpu_start) : 0.0;
+
+        for (uint32_t n = 0; n < s_history_count; ++n)
+        {
+            const auto& frame = s_history[(first_frame + n) % HISTORY_SIZE];
+
+            for (auto& scope : frame.scopes)
+            {
+                fprintf(file, ",\n{\"name\":");
+                WriteJsonString(file, scope.name);
+                fprintf(file, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                        (frame.cpu_start - start_time) * 1e6 + scope.cpu_begin * 1e3, (scope.cpu_end - scope.cpu_begin) * 1e3, (unsigned long long)frame.index);
+
+                if (scope.gpu)
+                {
+                    fprintf(file, ",\n{\"name\":");
+                    WriteJsonString(file, scope.name);
+                    fprintf(file, ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                            (frame.gpu_start - start_time) * 1e6 + scope.gpu_begin * 1e3, (scope.gpu_end - scope.gpu_begin) * 1e3, (unsigned long long)frame.index);
+                }
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        return true;
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace RGL
+{
+    /* Hierarchical CPU and GPU profiler. The scopes are opened with ProfileScope and nest, the frame is the root scope.
+     * The GPU scopes write GL_TIMESTAMP queries that are read back FRAMES_IN_FLIGHT frames later, so they don't stall the pipeline.
+     * The scope names are not copied, they have to outlive the profiler, e.g. string literals. */
+    class Profiler
+    {
+    public:
+        static constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+        static constexpr uint32_t MAX_SCOPES       = 128; /* Per frame, including the frame itself. The scopes over it are dropped. */
+        static constexpr uint32_t MAX_DEPTH        = 32;
+        static constexpr uint32_t HISTORY_SIZE     = 240; /* Frames kept for the percentiles and the trace export. */
+
+        struct Scope
+        {
+            const char* name;
+            int32_t     parent;      /* Index of the parent scope in the frame, -1 for the frame. */
+            uint32_t    depth;
+            uint32_t    stats_index;
+            bool        gpu;
+            double      cpu_begin;   /* In milliseconds since the start of the frame on the CPU. */
+            double      cpu_end;
+            double      gpu_begin;   /* In milliseconds since the start of the frame on the GPU, 0 for the CPU scopes. */
+            double      gpu_end;
+        };
+
+        struct Frame
+        {
+            uint64_t           index     = 0;
+            double             cpu_start = 0.0; /* In seconds, Timer::getTime(). */
+            double             gpu_start = 0.0; /* In seconds, converted to the CPU clock. */
+            std::vector<Scope> scopes;          /* Preorder, scopes[0] is the frame. */
+        };
+
+        /* Statistics of a scope path, e.g. Frame/Render/Lighting. The times of the scopes of the same path in a frame are summed. */
+        struct ScopeStats
+        {
+            const char* name;
+            int32_t     parent;        /* Index of the parent's statistics or -1. */
+            bool        gpu;
+            float       cpu_average;   /* Rolling averages in milliseconds. */
+            float       gpu_average;
+            float       cpu_history[HISTORY_SIZE];
+            float       gpu_history[HISTORY_SIZE];
+            uint32_t    samples_count;
+            uint64_t    last_frame;
+        };
+
+        /* Called by CoreApp around update() and render(). */
+        static void BeginFrame();
+        static void EndFrame();
+        static void Release();
+
+        /* Reads back the frames still in flight, e.g. before the history is used at the end of a benchmark. Stalls the pipeline. */
+        static void Flush();
+
+        static void BeginScope(const char* name, bool gpu);
+        static void EndScope();
+
+        static void SetEnabled(bool enabled) { s_enabled = enabled; }
+        static bool IsEnabled()              { return s_enabled; }
+
+        /* Percentile p in [0, 1] of the scope's times in the history. */
+        static float GetPercentile(const ScopeStats& stats, float p, bool gpu);
+
+        /* The first statistics of a scope with this name or nullptr. */
+        static const ScopeStats* FindStats(const char* name);
+
+        static const std::vector<ScopeStats>& GetStats() { return s_stats; }
+
+        /* The last frame that has been read back or nullptr. */
+        static const Frame* GetLastFrame();
+
+        /* The frame with this index if it has been read back and is still in the history, or nullptr. */
+        static const Frame* FindFrame(uint64_t index);
+
+        /* Index of the next frame started by BeginFrame(). */
+        static uint64_t GetNextFrameIndex() { return s_frame_index; }
+
+        /* The timeline of the last frame and the statistics of the scopes in the "Profiler" window. */
+        static void RenderGui();
+
+        /* Chrome trace event format (chrome://tracing, Perfetto) of the frames in the history, the CPU and the GPU on separate tracks. */
+        static bool ExportChromeTrace(const std::filesystem::path& filepath);
+
+    private:
+        struct PendingFrame
+        {
+            Frame    frame;
+            GLuint   queries[MAX_SCOPES * 2]; /* Begin and end timestamps of every scope. */
+            bool     pending;
+        };
+
+        static void Create();
+        static void Resolve(PendingFrame& pending_frame);
+        static void UpdateStats(Frame& frame);
+        static void RenderTimeline(const Frame& frame, bool gpu);
+        static void RenderStatsTree(int32_t parent);
+
+        static bool                    s_enabled;
+        static bool                    s_created;
+        static bool                    s_in_frame;
+        static bool                    s_paused;           /* Stops recording, e.g. to inspect the displayed frame. */
+        static uint64_t                s_frame_index;
+        static double                  s_gpu_clock_offset; /* CPU time - GPU time, in seconds. */
+        static PendingFrame            s_pending_frames[FRAMES_IN_FLIGHT];
+        static uint32_t                s_pending_index;
+        static int32_t                 s_scope_stack[MAX_DEPTH]; /* Open scopes, -1 for the dropped ones. */
+        static uint32_t                s_scope_stack_size;
+        static uint32_t                s_dropped_scopes;
+        static std::vector<Frame>      s_history;          /* Ring buffer of the resolved frames. */
+        static uint32_t                s_history_index;    /* Next frame to write. */
+        static uint32_t                s_history_count;
+        static std::vector<ScopeStats> s_stats;
+    };
+
+    /* Profiles the enclosing block. The GPU scopes measure both the CPU and the GPU time. */
+    class ProfileScope final
+    {
+    public:
+        explicit ProfileScope(const char* name, bool gpu = true) { Profiler::BeginScope(name, gpu); }
+        ~ProfileScope()                                         { Profiler::EndScope(); }
+
+        ProfileScope(const ProfileScope&)            = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    };
+}
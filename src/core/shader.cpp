@@ -1,15 +1,36 @@
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 
+#include "binary_cache.h"
+#include "file_watcher.h"
 #include "filesystem.h"
 #include "shader.h"
+#include "shader_preprocessor.h"
+#include "timer.h"
 #include "util.h"
 
 namespace RGL
 {
+    static constexpr uint32_t PROGRAM_CACHE_MAGIC   = 0x474f5250; /* "PROG" */
+    static constexpr uint32_t PROGRAM_CACHE_VERSION = 2; /* 2: the compile time excludes the work overlapped with the link. */
+
+    bool              Shader::s_program_cache_enabled = true;
+    ProgramCacheStats Shader::s_program_cache_stats;
+
+    std::unique_ptr<FileWatcher> Shader::s_file_watcher;
+    std::vector<Shader*>         Shader::s_hot_reload_shaders;
+
     Shader::Shader()
-        : m_program_id(0),
-          m_is_linked(false)
+        : m_transform_feedback_mode(GL_INTERLEAVED_ATTRIBS),
+          m_program_id       (0),
+          m_is_linked        (false),
+          m_link_pending     (false),
+          m_use_program_cache(false),
+          m_source_hash      (0),
+          m_submit_time      (0.0)
     {
         m_program_id = glCreateProgram();
 
@@ -66,6 +87,8 @@ namespace RGL
 
     Shader::~Shader()
     {
+        std::erase(s_hot_reload_shaders, this);
+
         if (m_program_id != 0)
         {
             glDeleteProgram(m_program_id);
@@ -73,7 +96,25 @@ namespace RGL
         }
     }
 
-    void Shader::addShader(const std::filesystem::path & filepath, GLuint type) const
+    static std::string GetPreprocessorError(const std::filesystem::path & filepath, const PreprocessedShader & preprocessed)
+    {
+        if (preprocessed.succeeded)
+        {
+            return {};
+        }
+
+        std::string error;
+
+        for (auto & missing_file : preprocessed.missing_files)
+        {
+            error += missing_file == preprocessed.files[0] ? filepath.generic_string() + ": could not open the file.\n"
+                                                           : filepath.generic_string() + ": missing include " + missing_file.generic_string() + ".\n";
+        }
+
+        return error;
+    }
+
+    void Shader::addShader(const std::filesystem::path & filepath, GLuint type)
     {
         if (m_program_id == 0)
         {
@@ -87,367 +128,766 @@ namespace RGL
             return;
         }
 
-        GLuint shaderObject = glCreateShader(type);
+        auto preprocessed = ShaderPreprocessor::Process(filepath);
+        auto error        = GetPreprocessorError(filepath, preprocessed);
+
+        m_sources.push_back({ type, filepath, std::move(preprocessed.code), std::move(preprocessed.files), std::move(error) });
+
+        registerHotReload();
+    }
+
+    void Shader::compileShader(const ShaderSource & source)
+    {
+        GLuint shaderObject = glCreateShader(source.type);
 
         if (shaderObject == 0)
         {
-            fprintf(stderr, "Error while creating %s.\n", filepath.c_str());
+            m_error_log += "Error while creating " + source.filepath.generic_string() + ".\n";
 
             return;
         }
 
+        const char * shader_code = source.code.c_str();
 
-        std::string           code = Util::LoadFile(filepath);
-        std::filesystem::path dir  = FileSystem::getRootPath() / filepath.parent_path();
-
-        code = Util::LoadShaderIncludes(code, dir);
-
-        const char * shader_code = code.c_str();
-
+        /* The status is checked in finishLink(), so that the compilation doesn't block. */
         glShaderSource(shaderObject, 1, &shader_code, nullptr);
         glCompileShader(shaderObject);
+        glAttachShader(m_program_id, shaderObject);
 
-        GLint result;
-        glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+        m_shader_objects.push_back({ shaderObject, &source });
+    }
 
-        if (result == GL_FALSE)
-        {
-            fprintf(stderr, "\n%s compilation failed!\n", filepath.string().c_str());
+    bool Shader::hasPreprocessorErrors() const
+    {
+        return std::any_of(m_sources.begin(), m_sources.end(), [](const ShaderSource & source) { return !source.error.empty(); });
+    }
 
-            GLint logLen;
-            glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &logLen);
+    static std::string GetInfoLog(GLuint object, bool program)
+    {
+        GLint logLen = 0;
+        program ? glGetProgramiv(object, GL_INFO_LOG_LENGTH, &logLen) : glGetShaderiv(object, GL_INFO_LOG_LENGTH, &logLen);
 
-            if (logLen > 0)
-            {
-                char * log = static_cast<char *>(malloc(logLen));
+        std::string log(std::max(logLen, 1), '\0');
 
-                GLsizei written;
-                glGetShaderInfoLog(shaderObject, logLen, &written, log);
+        GLsizei written = 0;
+        program ? glGetProgramInfoLog(object, logLen, &written, log.data()) : glGetShaderInfoLog(object, logLen, &written, log.data());
+        log.resize(written);
 
-                fprintf(stderr, "Shader log: \n%s", log);
-                free(log);
-            }
-            getchar();
+        return log;
+    }
+
+    void Shader::enableParallelCompile()
+    {
+        static bool initialized = false;
+
+        if (initialized)
+        {
             return;
         }
 
-        glAttachShader(m_program_id, shaderObject);
-        glDeleteShader(shaderObject);
+        /* Lets the driver pick the number of its compiler threads. */
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        else if (GLAD_GL_ARB_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+
+        initialized = true;
     }
 
     bool Shader::link()
     {
-        glLinkProgram(m_program_id);
+        beginLink();
 
-        GLint status;
-        glGetProgramiv(m_program_id, GL_LINK_STATUS, &status);
+        if (!finishLink())
+        {
+            fprintf(stderr, "%s", m_error_log.c_str());
+            return false;
+        }
 
-        if (status == GL_FALSE)
+        return true;
+    }
+
+    void Shader::beginLink()
+    {
+        if (m_program_id == 0 || m_link_pending || m_is_linked)
+        {
+            return;
+        }
+
+        enableParallelCompile();
+
+        const double start_time = Timer::getTime();
+
+        m_submit_time  = 0.0;
+        m_link_pending = true;
+        m_error_log.clear();
+
+        m_name.clear();
+
+        for (size_t i = 0; i < m_sources.size(); ++i)
         {
-            fprintf(stderr, "Failed to link shader program!\n");
+            m_name += (i > 0 ? ", " : "") + m_sources[i].filepath.generic_string();
+        }
 
-            GLint logLen;
-            glGetProgramiv(m_program_id, GL_INFO_LOG_LENGTH, &logLen);
+        /* The shaders with missing files aren't compiled, finishLink() fails with the preprocessor's errors. */
+        if (hasPreprocessorErrors())
+        {
+            m_error_log = "\nFailed to build shader program " + m_name + "!\n";
 
-            if (logLen > 0)
+            for (auto & source : m_sources)
             {
-                char* log = (char*)malloc(logLen);
-                GLsizei written;
-                glGetProgramInfoLog(m_program_id, logLen, &written, log);
+                m_error_log += source.error;
+            }
+
+            return;
+        }
+
+        /* The cache is skipped if the driver doesn't support any program binary format. */
+        GLint binary_formats_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats_count);
+
+        m_use_program_cache = s_program_cache_enabled && binary_formats_count > 0 && !m_sources.empty();
 
-                fprintf(stderr, "Program log: \n%s", log);
-                free(log);
+        if (m_use_program_cache)
+        {
+            m_source_hash = hashProgramSource();
+
+            char hash_string[17];
+            snprintf(hash_string, sizeof(hash_string), "%016llx", (unsigned long long)Util::Hash(&m_source_hash, sizeof(m_source_hash), getDriverHash()));
+
+            m_cache_filepath = FileSystem::getRootPath() / "cache" / "programs" / (std::string(hash_string) + ".rglprog");
+
+            if (loadProgramBinary(m_cache_filepath, m_source_hash))
+            {
+                m_link_pending = false;
+                return;
             }
         }
-        else
+
+        for (auto & source : m_sources)
         {
-            m_is_linked = true;
+            compileShader(source);
+        }
 
-            addAllSubroutines();
+        if (m_use_program_cache)
+        {
+            glProgramParameteri(m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         }
 
-        return m_is_linked;
-    }
+        glLinkProgram(m_program_id);
 
-    void Shader::setTransformFeedbackVaryings(const std::vector<const char*>& output_names, GLenum buffer_mode) const
-    {
-        glTransformFeedbackVaryings(m_program_id, output_names.size(), output_names.data(), buffer_mode);
+        m_submit_time = (Timer::getTime() - start_time) * 1000.0;
     }
 
-    void Shader::bind() const
+    bool Shader::isLinkCompleted() const
     {
-        if (m_program_id != 0 && m_is_linked)
+        if (!m_link_pending || hasPreprocessorErrors())
         {
-            glUseProgram(m_program_id);
+            return true;
         }
-    }
-
-    bool Shader::getUniformLocation(const std::string & uniform_name)
-    {
-        GLint uniform_location = glGetUniformLocation(m_program_id, uniform_name.c_str());
 
-        if (uniform_location != -1)
+        /* Without the extension, there's no way to ask without blocking. */
+        if (!GLAD_GL_KHR_parallel_shader_compile && !GLAD_GL_ARB_parallel_shader_compile)
         {
-            m_uniforms_locations[uniform_name] = uniform_location;
             return true;
         }
 
-        return false;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(m_program_id, GL_COMPLETION_STATUS_KHR, &completed);
+
+        return completed == GL_TRUE;
     }
 
-    void Shader::setUniform(const std::string & uniformName, float value)
+    bool Shader::finishLink()
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (!m_link_pending)
         {
-            glProgramUniform1f(m_program_id, m_uniforms_locations[uniformName], value);
+            return m_is_linked;
         }
-        else
+
+        const double start_time = Timer::getTime();
+
+        m_link_pending = false;
+
+        if (hasPreprocessorErrors())
+        {
+            return false;
+        }
+
+        GLint status;
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &status);
+
+        if (status == GL_FALSE)
         {
-            if (getUniformLocation(uniformName))
+            bool compiled = true;
+
+            for (auto & [shader_object, source] : m_shader_objects)
+            {
+                GLint result;
+                glGetShaderiv(shader_object, GL_COMPILE_STATUS, &result);
+
+                if (result == GL_FALSE)
+                {
+                    m_error_log += "\n" + source->filepath.generic_string() + " compilation failed!\nShader log: \n" +
+                                   ShaderPreprocessor::MapErrorLog(GetInfoLog(shader_object, false), source->files);
+                    compiled     = false;
+                }
+            }
+
+            if (compiled)
             {
-                glProgramUniform1f(m_program_id, m_uniforms_locations[uniformName], value);
+                m_error_log += "\nFailed to link shader program " + m_name + "!\nProgram log: \n" + GetInfoLog(m_program_id, true);
             }
         }
-    }
 
-    void Shader::setUniform(const std::string & uniformName, int value)
-    {
-        if (m_uniforms_locations.count(uniformName))
+        for (auto & [shader_object, source] : m_shader_objects)
         {
-            glProgramUniform1i(m_program_id, m_uniforms_locations[uniformName], value);
+            glDetachShader(m_program_id, shader_object);
+            glDeleteShader(shader_object);
         }
-        else
+
+        m_shader_objects.clear();
+
+        if (status == GL_FALSE)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform1i(m_program_id, m_uniforms_locations[uniformName], value);
-            }
+            return false;
         }
+
+        m_is_linked = true;
+
+        addAllSubroutines();
+        addAllUniforms();
+
+        /* Only the time spent in the GL calls of beginLink() and blocked here. The work that the caller does in between, while
+         * the driver compiles in the background, isn't charged to the program, nor stored in its cached binary. */
+        const double compile_time = m_submit_time + (Timer::getTime() - start_time) * 1000.0;
+
+        ++s_program_cache_stats.programs_count;
+        s_program_cache_stats.compile_time += compile_time;
+
+        if (m_use_program_cache)
+        {
+            saveProgramBinary(m_cache_filepath, m_source_hash, compile_time);
+        }
+
+        return true;
     }
 
-    void Shader::setUniform(const std::string & uniformName, GLuint value)
+    bool ShaderBatch::add(const std::shared_ptr<Shader> & shader)
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (!shader)
         {
-            glProgramUniform1ui(m_program_id, m_uniforms_locations.at(uniformName), value);
+            return false;
         }
-        else
+
+        shader->beginLink();
+        m_shaders.push_back(shader);
+
+        return true;
+    }
+
+    bool ShaderBatch::isReady() const
+    {
+        return std::all_of(m_shaders.begin(), m_shaders.end(), [](const std::shared_ptr<Shader> & shader) { return shader->isLinkCompleted(); });
+    }
+
+    bool ShaderBatch::finish()
+    {
+        const double start_time = Timer::getTime();
+
+        std::string errors;
+        uint32_t    failed_count = 0;
+
+        for (auto & shader : m_shaders)
         {
-            if (getUniformLocation(uniformName))
+            if (!shader->finishLink())
             {
-                glProgramUniform1ui(m_program_id, m_uniforms_locations[uniformName], value);
+                errors += shader->getErrorLog();
+                ++failed_count;
             }
         }
+
+        if (failed_count > 0)
+        {
+            fprintf(stderr, "%u of %zu shader programs failed to build:\n%s\n", failed_count, m_shaders.size(), errors.c_str());
+        }
+
+        Shader::s_program_cache_stats.batch_wait_time += (Timer::getTime() - start_time) * 1000.0;
+
+        m_shaders.clear();
+
+        return failed_count == 0;
     }
 
-    void Shader::setUniform(const std::string & uniformName, GLsizei count, float * value)
+    uint64_t Shader::hashProgramSource() const
     {
-        if (m_uniforms_locations.count(uniformName))
+        uint64_t hash = Util::Hash(m_transform_feedback_varyings.data(), m_transform_feedback_varyings.size());
+
+        for (auto & source : m_sources)
         {
-            glProgramUniform1fv(m_program_id, m_uniforms_locations[uniformName], count, value);
+            hash = Util::Hash(&source.type, sizeof(source.type), hash);
+            hash = Util::Hash(source.code.data(), source.code.size(), hash);
         }
-        else
+
+        return hash;
+    }
+
+    uint64_t Shader::getDriverHash()
+    {
+        static const uint64_t driver_hash = []
         {
-            if (getUniformLocation(uniformName))
+            uint64_t hash = 14695981039346656037ull;
+
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
             {
-                glProgramUniform1fv(m_program_id, m_uniforms_locations[uniformName], count, value);
+                auto value = reinterpret_cast<const char*>(glGetString(name));
+
+                if (value)
+                {
+                    hash = Util::Hash(value, strlen(value), hash);
+                }
             }
-        }
+
+            return hash;
+        }();
+
+        return driver_hash;
     }
 
-    void Shader::setUniform(const std::string & uniformName, GLsizei count, int * value)
+    bool Shader::loadProgramBinary(const std::filesystem::path & cache_filepath, uint64_t source_hash)
     {
-        if (m_uniforms_locations.count(uniformName))
+        const double start_time = Timer::getTime();
+
+        BinaryCacheReader reader;
+
+        if (!reader.Open(cache_filepath, PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, source_hash, getDriverHash()))
         {
-            glProgramUniform1iv(m_program_id, m_uniforms_locations[uniformName], count, value);
+            return false;
         }
-        else
+
+        const auto format       = reader.Read<GLenum>();
+        const auto compile_time = reader.Read<double>();
+        const auto binary       = reader.ReadArray<uint8_t>();
+
+        if (reader.HasFailed() || binary.empty())
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform1iv(m_program_id, m_uniforms_locations[uniformName], count, value);
-            }
+            return false;
         }
+
+        glProgramBinary(m_program_id, format, binary.data(), GLsizei(binary.size()));
+
+        GLint status;
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &status);
+
+        if (status == GL_FALSE)
+        {
+            ++s_program_cache_stats.cache_rejected;
+            return false;
+        }
+
+        m_is_linked = true;
+
+        addAllSubroutines();
+        addAllUniforms();
+
+        const double load_time = (Timer::getTime() - start_time) * 1000.0;
+
+        ++s_program_cache_stats.programs_count;
+        ++s_program_cache_stats.cache_hits;
+        s_program_cache_stats.load_time  += load_time;
+        s_program_cache_stats.saved_time += compile_time - load_time;
+
+        return true;
     }
 
-    void Shader::setUniform(const std::string & uniformName, GLsizei count, glm::vec3 * vectors)
+    void Shader::saveProgramBinary(const std::filesystem::path & cache_filepath, uint64_t source_hash, double compile_time) const
     {
-        if (m_uniforms_locations.count(uniformName))
+        GLint binary_length = 0;
+        glGetProgramiv(m_program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+
+        if (binary_length <= 0)
         {
-            glProgramUniform3fv(m_program_id, m_uniforms_locations[uniformName], count, glm::value_ptr(vectors[0]));
+            return;
         }
-        else
+
+        std::vector<uint8_t> binary(binary_length);
+        GLenum               format = 0;
+
+        glGetProgramBinary(m_program_id, binary_length, &binary_length, &format, binary.data());
+        binary.resize(binary_length);
+
+        BinaryCacheWriter writer(PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, source_hash, getDriverHash());
+        writer.Write(format);
+        writer.Write(compile_time);
+        writer.WriteArray(binary);
+        writer.Save(cache_filepath);
+    }
+
+    void Shader::setTransformFeedbackVaryings(const std::vector<const char*>& output_names, GLenum buffer_mode)
+    {
+        glTransformFeedbackVaryings(m_program_id, output_names.size(), output_names.data(), buffer_mode);
+
+        m_transform_feedback_varyings = std::to_string(buffer_mode);
+        m_transform_feedback_mode     = buffer_mode;
+        m_transform_feedback_names.assign(output_names.begin(), output_names.end());
+
+        for (auto name : output_names)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform3fv(m_program_id, m_uniforms_locations[uniformName], count, glm::value_ptr(vectors[0]));
-            }
+            m_transform_feedback_varyings += std::string(" ") + name;
         }
     }
 
-    void Shader::setUniform(const std::string & uniformName, const glm::vec2 & vector)
+    std::string Shader::injectDefines(const std::string & code, const ShaderDefines & defines)
     {
-        if (m_uniforms_locations.count(uniformName))
+        /* #version has to stay the first directive, the defines go right after it. */
+        size_t insert_position = 0;
+
+        if (size_t version_position = code.find("#version"); version_position != std::string::npos)
         {
-            glProgramUniform2fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+            insert_position = code.find('\n', version_position);
+            insert_position = insert_position == std::string::npos ? code.size() : insert_position + 1;
         }
-        else
+
+        std::string injected;
+
+        for (auto & [name, value] : defines)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform2fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
-            }
+            injected += "#define " + name + " " + value + "\n";
         }
+
+        /* Keeps the line numbers of the compiler's errors. */
+        injected += "#line " + std::to_string(std::count(code.begin(), code.begin() + insert_position, '\n') + 1) + "\n";
+
+        return code.substr(0, insert_position) + injected + code.substr(insert_position);
     }
 
-    void Shader::setUniform(const std::string & uniformName, const glm::vec3 & vector)
+    Shader & Shader::getPermutation(const ShaderDefines & defines)
     {
-        if (m_uniforms_locations.count(uniformName))
+        uint64_t key = 14695981039346656037ull;
+
+        for (auto & [name, value] : defines)
         {
-            glProgramUniform3fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+            key = Util::Hash(name.c_str(),  name.size()  + 1, key);
+            key = Util::Hash(value.c_str(), value.size() + 1, key);
         }
-        else
+
+        if (auto it = m_permutations.find(key); it != m_permutations.end())
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform3fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
-            }
+            return it->second ? *it->second : *this;
         }
-    }
 
-    void Shader::setUniform(const std::string & uniformName, const glm::vec4 & vector)
-    {
-        if (m_uniforms_locations.count(uniformName))
+        auto permutation = std::make_unique<Shader>();
+
+        for (auto & source : m_sources)
         {
-            glProgramUniform4fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+            permutation->m_sources.push_back({ source.type, source.filepath, injectDefines(source.code, defines), source.files, source.error });
         }
-        else
+
+        permutation->m_defines = defines;
+        copyTransformFeedbackVaryings(*permutation);
+
+        if (m_sources.empty() || !permutation->link())
         {
-            if (getUniformLocation(uniformName))
+            fprintf(stderr, "Failed to build a permutation of shader program %u, using the program without the defines.\n", m_program_id);
+            permutation.reset();
+
+            /* The programs that are only used through their permutations aren't linked up front. */
+            if (!m_is_linked)
             {
-                glProgramUniform4fv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+                link();
             }
         }
+        else
+        {
+            permutation->registerHotReload();
+        }
+
+        auto & result = m_permutations[key];
+        result        = std::move(permutation);
+
+        return result ? *result : *this;
     }
 
-    void Shader::setUniform(const std::string& uniformName, const glm::uvec2& vector)
+    void Shader::copyTransformFeedbackVaryings(Shader & shader) const
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (m_transform_feedback_names.empty())
         {
-            glProgramUniform2uiv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+            return;
         }
-        else
+
+        std::vector<const char*> names;
+
+        for (auto & name : m_transform_feedback_names)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform2uiv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
-            }
+            names.push_back(name.c_str());
         }
+
+        shader.setTransformFeedbackVaryings(names, m_transform_feedback_mode);
     }
 
-    void Shader::setUniform(const std::string& uniformName, const glm::uvec3& vector)
+    Shader & Shader::bindPermutation(const ShaderDefines & defines)
     {
-        if (m_uniforms_locations.count(uniformName))
+        Shader & permutation = getPermutation(defines);
+        permutation.bind();
+
+        return permutation;
+    }
+
+    void Shader::enableHotReload(bool enable)
+    {
+        if (!enable)
         {
-            glProgramUniform3uiv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
+            s_file_watcher.reset();
+            return;
         }
-        else
+
+        if (s_file_watcher)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform3uiv(m_program_id, m_uniforms_locations[uniformName], 1, glm::value_ptr(vector));
-            }
+            return;
+        }
+
+        s_file_watcher = std::make_unique<FileWatcher>();
+
+        for (auto shader : s_hot_reload_shaders)
+        {
+            shader->registerHotReload();
         }
     }
 
-    void Shader::setUniform(const std::string & uniformName, const glm::mat3 & matrix)
+    void Shader::updateHotReload()
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (!s_file_watcher)
         {
-            glProgramUniformMatrix3fv(m_program_id, m_uniforms_locations[uniformName], 1, GL_FALSE, glm::value_ptr(matrix));
+            return;
         }
-        else
+
+        const auto changed_files = s_file_watcher->Poll();
+
+        for (auto & filepath : changed_files)
+        {
+            ShaderPreprocessor::Invalidate(filepath);
+        }
+
+        /* The rebuilt programs aren't registered, so the list doesn't change in the loop. */
+        for (auto shader : s_hot_reload_shaders)
         {
-            if (getUniformLocation(uniformName))
+            /* The shaders that were never linked, e.g. the bases of the permutations, are skipped, the failed ones are retried. */
+            const bool was_built = shader->m_is_linked || !shader->m_error_log.empty();
+
+            if (was_built && !changed_files.empty() && shader->dependsOn(changed_files))
             {
-                glProgramUniformMatrix3fv(m_program_id, m_uniforms_locations[uniformName], 1, GL_FALSE, glm::value_ptr(matrix));
+                shader->beginReload();
+            }
+            else if (shader->m_reload && shader->m_reload->isLinkCompleted())
+            {
+                shader->finishReload();
             }
         }
     }
 
-    void Shader::setUniform(const std::string & uniformName, const glm::mat4 & matrix)
+    void Shader::registerHotReload()
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (std::find(s_hot_reload_shaders.begin(), s_hot_reload_shaders.end(), this) == s_hot_reload_shaders.end())
         {
-            glProgramUniformMatrix4fv(m_program_id, m_uniforms_locations[uniformName], 1, GL_FALSE, glm::value_ptr(matrix));
+            s_hot_reload_shaders.push_back(this);
         }
-        else
+
+        if (!s_file_watcher)
+        {
+            return;
+        }
+
+        for (auto & source : m_sources)
         {
-            if (getUniformLocation(uniformName))
+            for (auto & filepath : source.files)
             {
-                glProgramUniformMatrix4fv(m_program_id, m_uniforms_locations[uniformName], 1, GL_FALSE, glm::value_ptr(matrix));
+                s_file_watcher->Watch(filepath);
             }
         }
     }
 
-    void Shader::setUniform(const std::string& uniformName, float* values, unsigned count)
+    bool Shader::dependsOn(const std::vector<std::filesystem::path> & filepaths) const
     {
-        if (m_uniforms_locations.count(uniformName))
-        {
-            glProgramUniform1fv(m_program_id, m_uniforms_locations[uniformName], count, &values[0]);
-        }
-        else
+        for (auto & source : m_sources)
         {
-            if (getUniformLocation(uniformName))
+            for (auto & filepath : filepaths)
             {
-                glProgramUniform1fv(m_program_id, m_uniforms_locations[uniformName], count, &values[0]);
+                if (std::find(source.files.begin(), source.files.end(), filepath) != source.files.end())
+                {
+                    return true;
+                }
             }
         }
+
+        return false;
     }
 
-    void Shader::setUniform(const std::string& uniformName, glm::vec2* values, unsigned count)
+    void Shader::beginReload()
     {
-        if (m_uniforms_locations.count(uniformName))
-        {
-            glProgramUniform2fv(m_program_id, m_uniforms_locations[uniformName], count, &values[0][0]);
-        }
-        else
+        /* A pending rebuild is replaced, its sources are out of date. */
+        auto reload = std::make_unique<Shader>();
+
+        for (auto & source : m_sources)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniform2fv(m_program_id, m_uniforms_locations[uniformName], count, &values[0][0]);
-            }
+            auto preprocessed = ShaderPreprocessor::Process(source.filepath);
+            auto code         = m_defines.empty() ? std::move(preprocessed.code) : injectDefines(preprocessed.code, m_defines);
+            auto error        = GetPreprocessorError(source.filepath, preprocessed);
+
+            reload->m_sources.push_back({ source.type, source.filepath, std::move(code), std::move(preprocessed.files), std::move(error) });
         }
+
+        copyTransformFeedbackVaryings(*reload);
+
+        reload->beginLink();
+        m_reload = std::move(reload);
     }
 
-    void Shader::setUniform(const std::string & uniformName, glm::mat4 * matrices, unsigned count)
+    void Shader::finishReload()
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (!m_reload->finishLink())
         {
-            glProgramUniformMatrix4fv(m_program_id, m_uniforms_locations[uniformName], count, GL_FALSE, &matrices[0][0][0]);
+            fprintf(stderr, "%s\nHot reload of %s failed, the previous program is kept.\n", m_reload->m_error_log.c_str(), m_reload->m_name.c_str());
+
+            m_error_log = m_reload->m_error_log;
+            m_reload.reset();
+
+            return;
         }
-        else
+
+        /* Swapped between the frames, the previous program is deleted with m_reload. */
+        std::swap(m_program_id, m_reload->m_program_id);
+        std::swap(m_sources,    m_reload->m_sources);
+
+        m_uniforms_locations.swap(m_reload->m_uniforms_locations);
+        m_subroutine_indices.swap(m_reload->m_subroutine_indices);
+        m_active_subroutine_uniform_locations.swap(m_reload->m_active_subroutine_uniform_locations);
+
+        m_is_linked = true;
+        m_error_log.clear();
+
+        /* The permutations that failed are retried with the new sources. */
+        std::erase_if(m_permutations, [](const auto & permutation) { return !permutation.second; });
+
+        printf("Reloaded %s\n", m_reload->m_name.c_str());
+
+        m_reload.reset();
+        registerHotReload();
+    }
+
+    void Shader::bind() const
+    {
+        if (m_program_id != 0 && m_is_linked)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniformMatrix4fv(m_program_id, m_uniforms_locations[uniformName], count, GL_FALSE, &matrices[0][0][0]);
-            }
+            glUseProgram(m_program_id);
         }
     }
 
-    void Shader::setUniform(const std::string& uniformName, glm::mat2x4* matrices, unsigned count)
+    GLint Shader::getUniformLocation(std::string_view uniform_name)
     {
-        if (m_uniforms_locations.count(uniformName))
+        if (auto it = m_uniforms_locations.find(uniform_name); it != m_uniforms_locations.end())
         {
-            glProgramUniformMatrix2x4fv(m_program_id, m_uniforms_locations[uniformName], count, GL_FALSE, &matrices[0][0][0]);
+            return it->second;
         }
-        else
+
+        /* The uniforms are known only after linking, don't cache anything before. */
+        if (!m_is_linked)
         {
-            if (getUniformLocation(uniformName))
-            {
-                glProgramUniformMatrix2x4fv(m_program_id, m_uniforms_locations[uniformName], count, GL_FALSE, &matrices[0][0][0]);
-            }
+            return -1;
         }
+
+        fprintf(stderr, "Warning: uniform %.*s is not active in program %u.\n", int(uniform_name.size()), uniform_name.data(), m_program_id);
+
+        m_uniforms_locations.emplace(uniform_name, -1);
+        return -1;
+    }
+
+    void Shader::setUniform(GLint location, float value)
+    {
+        glProgramUniform1f(m_program_id, location, value);
+    }
+
+    void Shader::setUniform(GLint location, int value)
+    {
+        glProgramUniform1i(m_program_id, location, value);
+    }
+
+    void Shader::setUniform(GLint location, GLuint value)
+    {
+        glProgramUniform1ui(m_program_id, location, value);
+    }
+
+    void Shader::setUniform(GLint location, GLsizei count, float * value)
+    {
+        glProgramUniform1fv(m_program_id, location, count, value);
+    }
+
+    void Shader::setUniform(GLint location, GLsizei count, int * value)
+    {
+        glProgramUniform1iv(m_program_id, location, count, value);
+    }
+
+    void Shader::setUniform(GLint location, GLsizei count, glm::vec3 * vectors)
+    {
+        glProgramUniform3fv(m_program_id, location, count, glm::value_ptr(vectors[0]));
+    }
+
+    void Shader::setUniform(GLint location, const glm::vec2 & vector)
+    {
+        glProgramUniform2fv(m_program_id, location, 1, glm::value_ptr(vector));
+    }
+
+    void Shader::setUniform(GLint location, const glm::vec3 & vector)
+    {
+        glProgramUniform3fv(m_program_id, location, 1, glm::value_ptr(vector));
+    }
+
+    void Shader::setUniform(GLint location, const glm::vec4 & vector)
+    {
+        glProgramUniform4fv(m_program_id, location, 1, glm::value_ptr(vector));
+    }
+
+    void Shader::setUniform(GLint location, const glm::uvec2& vector)
+    {
+        glProgramUniform2uiv(m_program_id, location, 1, glm::value_ptr(vector));
+    }
+
+    void Shader::setUniform(GLint location, const glm::uvec3& vector)
+    {
+        glProgramUniform3uiv(m_program_id, location, 1, glm::value_ptr(vector));
+    }
+
+    void Shader::setUniform(GLint location, const glm::mat3 & matrix)
+    {
+        glProgramUniformMatrix3fv(m_program_id, location, 1, GL_FALSE, glm::value_ptr(matrix));
+    }
+
+    void Shader::setUniform(GLint location, const glm::mat4 & matrix)
+    {
+        glProgramUniformMatrix4fv(m_program_id, location, 1, GL_FALSE, glm::value_ptr(matrix));
+    }
+
+    void Shader::setUniform(GLint location, float* values, unsigned count)
+    {
+        glProgramUniform1fv(m_program_id, location, count, &values[0]);
+    }
+
+    void Shader::setUniform(GLint location, glm::vec2* values, unsigned count)
+    {
+        glProgramUniform2fv(m_program_id, location, count, &values[0][0]);
+    }
+
+    void Shader::setUniform(GLint location, glm::mat4 * matrices, unsigned count)
+    {
+        glProgramUniformMatrix4fv(m_program_id, location, count, GL_FALSE, &matrices[0][0][0]);
+    }
+
+    void Shader::setUniform(GLint location, glm::mat2x4* matrices, unsigned count)
+    {
+        glProgramUniformMatrix2x4fv(m_program_id, location, count, GL_FALSE, &matrices[0][0][0]);
     }
 
     void Shader::setSubroutine(ShaderType shader_type, const std::string & subroutine_name)
@@ -493,4 +933,46 @@ namespace RGL
             }
         }
     }
+
+    void Shader::addAllUniforms()
+    {
+        m_uniforms_locations.clear();
+
+        GLint num_uniforms = 0;
+        glGetProgramInterfaceiv(m_program_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &num_uniforms);
+
+        const GLenum properties[] = { GL_NAME_LENGTH, GL_LOCATION, GL_ARRAY_SIZE };
+        const GLint properties_size = sizeof(properties) / sizeof(properties[0]);
+
+        for (GLint i = 0; i < num_uniforms; ++i)
+        {
+            GLint values[properties_size];
+            glGetProgramResourceiv(m_program_id, GL_UNIFORM, i, properties_size, properties, properties_size, nullptr, values);
+
+            /* Members of the uniform blocks don't have locations. */
+            if (values[1] == -1)
+            {
+                continue;
+            }
+
+            std::vector<char> name_data(values[0]);
+            glGetProgramResourceName(m_program_id, GL_UNIFORM, i, name_data.size(), nullptr, &name_data[0]);
+            std::string uniform_name(name_data.begin(), name_data.end() - 1);
+
+            m_uniforms_locations[uniform_name] = values[1];
+
+            /* Arrays are reported as "name[0]", register the name without the subscript and all of the elements, which have consecutive locations. */
+            if (uniform_name.ends_with("[0]"))
+            {
+                uniform_name.resize(uniform_name.size() - 3);
+
+                m_uniforms_locations[uniform_name] = values[1];
+
+                for (GLint element = 1; element < values[2]; ++element)
+                {
+                    m_uniforms_locations[uniform_name + "[" + std::to_string(element) + "]"] = values[1] + element;
+                }
+            }
+        }
+    }
 }
@@ -2,7 +2,10 @@
 
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <glad/glad.h>
@@ -13,6 +16,23 @@
 
 namespace RGL
 {
+    class FileWatcher;
+
+    struct ProgramCacheStats
+    {
+        uint32_t programs_count  = 0;   /* Linked programs. */
+        uint32_t cache_hits      = 0;
+        uint32_t cache_rejected  = 0;   /* Cached binaries that the driver didn't accept, e.g. after a driver update. */
+        double   compile_time    = 0.0; /* In milliseconds, compiling and linking of the programs that weren't loaded from the cache. */
+        double   load_time       = 0.0; /* In milliseconds, loading of the cached binaries. */
+        double   saved_time      = 0.0; /* In milliseconds, the compile times of the cached programs minus their load times. */
+        double   batch_wait_time = 0.0; /* In milliseconds, spent in ShaderBatch::finish() waiting for the driver. */
+    };
+
+    /* Preprocessor defines of a permutation, e.g. { { "PCF_SAMPLES", "64" }, { "HARD_SHADOWS", "" } }. Sorted by name,
+     * so that the same set of defines always selects the same permutation. */
+    using ShaderDefines = std::map<std::string, std::string>;
+
     class Shader final
     {
     public:
@@ -49,42 +69,181 @@ namespace RGL
 
         ~Shader();
 
+        /* Compiles the stages and links the program, or loads the program binary from <root>/cache/programs if the cache has one
+         * for the same expanded sources, transform feedback varyings and driver. A rejected binary falls back to compiling.
+         * Prints the errors and returns false if the program couldn't be built. */
         bool link();
-        void setTransformFeedbackVaryings(const std::vector<const char*>& output_names, GLenum buffer_mode) const;
+
+        /* link() split in two: beginLink() submits the compilation and the link without waiting for them, so that they run on
+         * the driver's threads with GL_KHR_parallel_shader_compile. isLinkCompleted() polls GL_COMPLETION_STATUS_KHR and never
+         * blocks, finishLink() waits if needed and stores the errors in getErrorLog() instead of printing them. See ShaderBatch. */
+        void beginLink();
+        bool isLinkCompleted() const;
+        bool finishLink();
+
+        const std::string & getErrorLog() const { return m_error_log; }
+
+        /* Variant of the program with the defines injected after the #version line of every stage, so that the settings that
+         * are constant for a draw are folded by the compiler instead of branching per fragment. It's built at the first request,
+         * through the program cache, and kept until this shader is destroyed, the later requests are a hash lookup. The variants
+         * have their own uniforms. If a variant fails to build, its errors are printed once and this shader is returned instead, it is linked then if it wasn't. */
+        Shader & getPermutation(const ShaderDefines & defines);
+        Shader & bindPermutation(const ShaderDefines & defines);
+
+        void setTransformFeedbackVaryings(const std::vector<const char*>& output_names, GLenum buffer_mode);
         void bind() const;
 
-        void setUniform(const std::string & uniform_name, float value);
-        void setUniform(const std::string & uniform_name, int value);
-        void setUniform(const std::string & uniform_name, GLuint value);
-        void setUniform(const std::string & uniform_name, GLsizei count, float * value);
-        void setUniform(const std::string & uniform_name, GLsizei count, int * value);
-        void setUniform(const std::string & uniform_name, GLsizei count, glm::vec3 * vectors);
-        void setUniform(const std::string & uniform_name, const glm::vec2 & vector);
-        void setUniform(const std::string & uniform_name, const glm::vec3 & vector);
-        void setUniform(const std::string & uniform_name, const glm::vec4 & vector);
-        void setUniform(const std::string & uniform_name, const glm::uvec2 & vector);
-        void setUniform(const std::string & uniform_name, const glm::uvec3 & vector);
-        void setUniform(const std::string & uniform_name, const glm::mat3 & matrix);
-        void setUniform(const std::string & uniform_name, const glm::mat4 & matrix);
-        void setUniform(const std::string & uniform_name, float* values, unsigned count);
-        void setUniform(const std::string & uniform_name, glm::vec2* values, unsigned count);
-        void setUniform(const std::string & uniform_name, glm::mat4 * matrices, unsigned count);
-        void setUniform(const std::string & uniform_name, glm::mat2x4 * matrices, unsigned count);
+        /* Location of an active uniform, reflected at link(). Can be cached by the caller and passed to the setUniform() overloads
+         * that take the location, which skip the name lookup. Returns -1, which is ignored by setUniform(), if there's no such uniform. */
+        GLint getUniformLocation(std::string_view uniform_name);
+
+        void setUniform(std::string_view uniform_name, float value)                        { setUniform(getUniformLocation(uniform_name), value); }
+        void setUniform(std::string_view uniform_name, int value)                          { setUniform(getUniformLocation(uniform_name), value); }
+        void setUniform(std::string_view uniform_name, GLuint value)                       { setUniform(getUniformLocation(uniform_name), value); }
+        void setUniform(std::string_view uniform_name, GLsizei count, float * value)       { setUniform(getUniformLocation(uniform_name), count, value); }
+        void setUniform(std::string_view uniform_name, GLsizei count, int * value)         { setUniform(getUniformLocation(uniform_name), count, value); }
+        void setUniform(std::string_view uniform_name, GLsizei count, glm::vec3 * vectors) { setUniform(getUniformLocation(uniform_name), count, vectors); }
+        void setUniform(std::string_view uniform_name, const glm::vec2 & vector)           { setUniform(getUniformLocation(uniform_name), vector); }
+        void setUniform(std::string_view uniform_name, const glm::vec3 & vector)           { setUniform(getUniformLocation(uniform_name), vector); }
+        void setUniform(std::string_view uniform_name, const glm::vec4 & vector)           { setUniform(getUniformLocation(uniform_name), vector); }
+        void setUniform(std::string_view uniform_name, const glm::uvec2 & vector)          { setUniform(getUniformLocation(uniform_name), vector); }
+        void setUniform(std::string_view uniform_name, const glm::uvec3 & vector)          { setUniform(getUniformLocation(uniform_name), vector); }
+        void setUniform(std::string_view uniform_name, const glm::mat3 & matrix)           { setUniform(getUniformLocation(uniform_name), matrix); }
+        void setUniform(std::string_view uniform_name, const glm::mat4 & matrix)           { setUniform(getUniformLocation(uniform_name), matrix); }
+        void setUniform(std::string_view uniform_name, float* values, unsigned count)      { setUniform(getUniformLocation(uniform_name), values, count); }
+        void setUniform(std::string_view uniform_name, glm::vec2* values, unsigned count)  { setUniform(getUniformLocation(uniform_name), values, count); }
+        void setUniform(std::string_view uniform_name, glm::mat4 * matrices, unsigned count)   { setUniform(getUniformLocation(uniform_name), matrices, count); }
+        void setUniform(std::string_view uniform_name, glm::mat2x4 * matrices, unsigned count) { setUniform(getUniformLocation(uniform_name), matrices, count); }
+
+        void setUniform(GLint location, float value);
+        void setUniform(GLint location, int value);
+        void setUniform(GLint location, GLuint value);
+        void setUniform(GLint location, GLsizei count, float * value);
+        void setUniform(GLint location, GLsizei count, int * value);
+        void setUniform(GLint location, GLsizei count, glm::vec3 * vectors);
+        void setUniform(GLint location, const glm::vec2 & vector);
+        void setUniform(GLint location, const glm::vec3 & vector);
+        void setUniform(GLint location, const glm::vec4 & vector);
+        void setUniform(GLint location, const glm::uvec2 & vector);
+        void setUniform(GLint location, const glm::uvec3 & vector);
+        void setUniform(GLint location, const glm::mat3 & matrix);
+        void setUniform(GLint location, const glm::mat4 & matrix);
+        void setUniform(GLint location, float* values, unsigned count);
+        void setUniform(GLint location, glm::vec2* values, unsigned count);
+        void setUniform(GLint location, glm::mat4 * matrices, unsigned count);
+        void setUniform(GLint location, glm::mat2x4 * matrices, unsigned count);
 
         void setSubroutine(ShaderType shader_type, const std::string& subroutine_name);
 
+        static void enableProgramCache(bool enable) { s_program_cache_enabled = enable; }
+
+        static const ProgramCacheStats & getProgramCacheStats() { return s_program_cache_stats; }
+
+        /* The files of the programs and their includes are watched. When one of them is written, the programs that depend on it,
+         * including the permutations, are rebuilt in the background and swapped in by updateHotReload() once they are linked.
+         * A program that fails to build keeps its previous version and prints the errors. A rebuilt program starts with
+         * the default uniform values and new locations, the uniforms that are set only once have to be set again. */
+        static void enableHotReload(bool enable);
+
+        /* Called every frame by CoreApp. */
+        static void updateHotReload();
+
     private:
+        struct ShaderSource
+        {
+            GLenum                             type;
+            std::filesystem::path              filepath;
+            std::string                        code;  /* With the includes expanded. */
+            std::vector<std::filesystem::path> files; /* The file and its includes, see ShaderPreprocessor. */
+            std::string                        error; /* Of the preprocessor, the program fails to link if it isn't empty. */
+        };
+
+        bool hasPreprocessorErrors() const;
         void addAllSubroutines();
+        void addAllUniforms();
+
+        void addShader(const std::filesystem::path & filepath, GLuint type);
+        void compileShader(const ShaderSource & source);
+
+        static void enableParallelCompile();
+
+        uint64_t hashProgramSource() const;
+        bool loadProgramBinary(const std::filesystem::path & cache_filepath, uint64_t source_hash);
+        void saveProgramBinary(const std::filesystem::path & cache_filepath, uint64_t source_hash, double compile_time) const;
+
+        static uint64_t getDriverHash();
+
+        static std::string injectDefines(const std::string & code, const ShaderDefines & defines);
 
-        void addShader(const std::filesystem::path & filepath, GLuint type) const;
-        bool getUniformLocation(const std::string & uniform_name);
+        void copyTransformFeedbackVaryings(Shader & shader) const;
+
+        void registerHotReload();
+        bool dependsOn(const std::vector<std::filesystem::path> & filepaths) const;
+        void beginReload();
+        void finishReload();
+
+        static bool              s_program_cache_enabled;
+        static ProgramCacheStats s_program_cache_stats;
+
+        friend class ShaderBatch;
+
+        static std::unique_ptr<FileWatcher> s_file_watcher;       /* Null if the hot reload is disabled. */
+        static std::vector<Shader*>         s_hot_reload_shaders; /* The shaders built from files and their permutations. */
+
+        /* Compiled at link(), unless the program binary is loaded from the cache. Kept afterwards for the permutations. */
+        std::vector<ShaderSource> m_sources;
+        std::string               m_transform_feedback_varyings; /* Names and the buffer mode, part of the cache key. */
+        std::vector<std::string>  m_transform_feedback_names;    /* Replayed on the permutations. */
+        GLenum                    m_transform_feedback_mode;
+
+        /* Hash of the defines -> variant, nullptr if it failed to build. */
+        std::unordered_map<uint64_t, std::unique_ptr<Shader>> m_permutations;
+        ShaderDefines                                          m_defines; /* Of a permutation, injected again by the reloads. */
+
+        std::unique_ptr<Shader> m_reload; /* Rebuilt program, until it's linked. */
 
         std::map<std::string, GLuint> m_subroutine_indices;
         std::map<GLenum, GLuint> m_active_subroutine_uniform_locations;
 
-        std::map<std::string, GLint> m_uniforms_locations;
+        /* Transparent hash, so that the lookups by std::string_view don't allocate. */
+        struct StringHash
+        {
+            using is_transparent = void;
+
+            size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+        };
+
+        /* Active uniforms, plus the names that were set but aren't active, stored with location -1 so that they are reported only once. */
+        std::unordered_map<std::string, GLint, StringHash, std::equal_to<>> m_uniforms_locations;
 
         GLuint m_program_id;
         bool m_is_linked;
+
+        /* State of the submitted link, see beginLink(). */
+        bool                                                   m_link_pending;
+        bool                                                   m_use_program_cache;
+        uint64_t                                               m_source_hash;
+        double                                                 m_submit_time;     /* In milliseconds, spent in beginLink(). */
+        std::filesystem::path                                  m_cache_filepath;
+        std::vector<std::pair<GLuint, const ShaderSource*>>    m_shader_objects;  /* Attached until finishLink() for their logs. */
+        std::string                                            m_name;            /* The stages' file paths, for the errors. */
+        std::string                                            m_error_log;
+    };
+
+    /* Builds several programs at once: add() submits each of them, so that the driver compiles them in parallel while the caller
+     * does other work, e.g. loads the models and the textures. finish() waits for them and reports all of the errors together. */
+    class ShaderBatch final
+    {
+    public:
+        bool add(const std::shared_ptr<Shader> & shader);
+
+        /* True if all of the programs are built, doesn't block. */
+        bool isReady() const;
+
+        /* Returns false if any of the programs failed to build. */
+        bool finish();
+
+    private:
+        std::vector<std::shared_ptr<Shader>> m_shaders;
     };
 }
@@ -0,0 +1,181 @@
+#include "shader_preprocessor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <string_view>
+
+#include "filesystem.h"
+
+namespace RGL
+{
+    std::unordered_map<std::string, ShaderPreprocessor::ParsedFile> ShaderPreprocessor::s_files;
+
+    PreprocessedShader ShaderPreprocessor::Process(const std::filesystem::path & filepath)
+    {
+        const auto shader_filepath = (FileSystem::getRootPath() / filepath).lexically_normal();
+
+        PreprocessedShader result;
+        result.files.push_back(shader_filepath);
+
+        Expand(shader_filepath, shader_filepath.parent_path(), 0, result);
+
+        return result;
+    }
+
+    void ShaderPreprocessor::Invalidate(const std::filesystem::path & filepath)
+    {
+        s_files.erase(filepath.lexically_normal().generic_string());
+    }
+
+    void ShaderPreprocessor::Clear()
+    {
+        s_files.clear();
+    }
+
+    const ShaderPreprocessor::ParsedFile & ShaderPreprocessor::Parse(const std::filesystem::path & filepath)
+    {
+        const auto key = filepath.generic_string();
+
+        if (auto it = s_files.find(key); it != s_files.end())
+        {
+            return it->second;
+        }
+
+        std::ifstream file(filepath, std::ios::binary);
+
+        if (!file)
+        {
+            /* Not cached, the file may be created later, e.g. by an editor that saves through a temporary file. */
+            static const ParsedFile missing_file = { {}, false };
+
+            fprintf(stderr, "Could not open file %s\n", key.c_str());
+            return missing_file;
+        }
+
+        const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        ParsedFile parsed = { {}, true };
+        Chunk      chunk  = { {}, {}, 0 };
+
+        size_t   position    = 0;
+        uint32_t line_number = 0;
+
+        while (position < text.size())
+        {
+            size_t line_end = text.find('\n', position);
+            line_end = line_end == std::string::npos ? text.size() : line_end;
+
+            std::string_view line(text.data() + position, line_end - position);
+
+            position = line_end + 1;
+            ++line_number;
+
+            if (size_t first = line.find_first_not_of(" \t"); first != std::string_view::npos && line.substr(first).starts_with("#include"))
+            {
+                size_t open  = line.find_first_of("\"<", first);
+                size_t close = open == std::string_view::npos ? std::string_view::npos : line.find_first_of("\">", open + 1);
+
+                if (close != std::string_view::npos)
+                {
+                    chunk.include   = std::string(line.substr(open + 1, close - open - 1));
+                    chunk.next_line = line_number + 1;
+
+                    parsed.chunks.push_back(std::move(chunk));
+                    chunk = { {}, {}, 0 };
+
+                    continue;
+                }
+            }
+
+            chunk.text.append(line);
+            chunk.text += '\n';
+        }
+
+        parsed.chunks.push_back(std::move(chunk));
+
+        return s_files.emplace(key, std::move(parsed)).first->second;
+    }
+
+    void ShaderPreprocessor::Expand(const std::filesystem::path & filepath, const std::filesystem::path & shader_dir, uint32_t source_index, PreprocessedShader & result)
+    {
+        const ParsedFile & file = Parse(filepath);
+
+        if (!file.loaded)
+        {
+            result.missing_files.push_back(filepath);
+            result.succeeded = false;
+            return;
+        }
+
+        for (auto & chunk : file.chunks)
+        {
+            result.code += chunk.text;
+
+            if (chunk.include.empty())
+            {
+                continue;
+            }
+
+            auto include_filepath = (filepath.parent_path() / chunk.include).lexically_normal();
+
+            if (!std::filesystem::exists(include_filepath))
+            {
+                include_filepath = (shader_dir / chunk.include).lexically_normal();
+            }
+
+            /* Included before, the directive's line is kept empty so that the line numbers don't change. */
+            if (std::find(result.files.begin(), result.files.end(), include_filepath) != result.files.end())
+            {
+                result.code += '\n';
+                continue;
+            }
+
+            const uint32_t include_index = uint32_t(result.files.size());
+            result.files.push_back(include_filepath);
+
+            result.code += "#line 1 " + std::to_string(include_index) + "\n";
+            Expand(include_filepath, shader_dir, include_index, result);
+            result.code += "#line " + std::to_string(chunk.next_line) + " " + std::to_string(source_index) + "\n";
+        }
+    }
+
+    std::string ShaderPreprocessor::MapErrorLog(const std::string & log, const std::vector<std::filesystem::path> & files)
+    {
+        /* NVIDIA: "2(41) : error ...", Mesa: "2:41(5): error: ...", AMD: "ERROR: 2:41: ...". */
+        static const std::regex location_pattern(R"(^((?:ERROR|WARNING): )?(\d+)([:(]\d+))");
+
+        const auto root_path = FileSystem::getRootPath();
+
+        std::string mapped_log;
+        size_t      position = 0;
+
+        while (position < log.size())
+        {
+            size_t line_end = log.find('\n', position);
+            line_end = line_end == std::string::npos ? log.size() : line_end + 1;
+
+            const std::string line = log.substr(position, line_end - position);
+            position = line_end;
+
+            std::smatch match;
+
+            if (std::regex_search(line, match, location_pattern))
+            {
+                const size_t source_index = std::stoul(match[2].str());
+
+                if (source_index < files.size())
+                {
+                    mapped_log += match[1].str() + files[source_index].lexically_relative(root_path).generic_string() + match[3].str() + match.suffix().str();
+                    continue;
+                }
+            }
+
+            mapped_log += line;
+        }
+
+        return mapped_log;
+    }
+}
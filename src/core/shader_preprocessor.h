@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace RGL
+{
+    /* A shader's source with its #include directives expanded. */
+    struct PreprocessedShader
+    {
+        std::string                        code;
+        std::vector<std::filesystem::path> files; /* Absolute paths, files[0] is the shader. The index is the #line source string number. */
+        std::vector<std::filesystem::path> missing_files; /* The shader or the includes that couldn't be opened. */
+        bool                               succeeded = true;
+    };
+
+    /* Expands the #include "file" directives of the shaders. Every file is read and split at its includes once, the later
+     * expansions reuse the parsed file until Invalidate() is called for it, e.g. when it changes on disk.
+     * A file is expanded once per shader, the later includes of it are skipped like with include guards, which also breaks cycles.
+     * The includes are resolved relative to the including file and then relative to the shader, like before.
+     * The expanded files are delimited by #line directives with their index in files as the source string number, so that
+     * MapErrorLog() can translate the compiler's messages back to the files and lines. */
+    class ShaderPreprocessor final
+    {
+    public:
+        /* filepath is relative to the root directory. */
+        static PreprocessedShader Process(const std::filesystem::path & filepath);
+
+        static void Invalidate(const std::filesystem::path & filepath);
+        static void Clear();
+
+        /* Replaces the source string numbers in the compiler's log, e.g. "2(41) : error" or "ERROR: 2:41:", with the files' paths. */
+        static std::string MapErrorLog(const std::string & log, const std::vector<std::filesystem::path> & files);
+
+    private:
+        /* A run of lines of a file, followed by an include, if include isn't empty. */
+        struct Chunk
+        {
+            std::string text;
+            std::string include;
+            uint32_t    next_line; /* Line after the include, 1-based. */
+        };
+
+        struct ParsedFile
+        {
+            std::vector<Chunk> chunks;
+            bool               loaded;
+        };
+
+        static const ParsedFile & Parse(const std::filesystem::path & filepath);
+        static void Expand(const std::filesystem::path & filepath, const std::filesystem::path & shader_dir, uint32_t source_index, PreprocessedShader & result);
+
+        static std::unordered_map<std::string, ParsedFile> s_files; /* Absolute path -> parsed file. */
+    };
+}
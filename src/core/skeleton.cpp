@@ -0,0 +1,120 @@
+#include "skeleton.h"
+
+#include <glm/geometric.hpp>
+
+namespace RGL
+{
+    void Pose::Blend(const Pose& target, float weight, std::span<const float> mask)
+    {
+        const size_t nodes_count = translations.size();
+
+        for (size_t i = 0; i < nodes_count; ++i)
+        {
+            const float w = mask.empty() ? weight : weight * mask[i];
+
+            if (w <= 0.0f)
+            {
+                continue;
+            }
+
+            const glm::quat& target_rotation = target.rotations[i];
+            const float      sign            = glm::dot(rotations[i], target_rotation) < 0.0f ? -1.0f : 1.0f;
+
+            translations[i] = glm::mix(translations[i], target.translations[i], w);
+            rotations   [i] = glm::normalize(rotations[i] * (1.0f - w) + target_rotation * (sign * w));
+            scales      [i] = glm::mix(scales[i], target.scales[i], w);
+        }
+    }
+
+    int32_t Skeleton::FindNode(std::string_view node_name) const
+    {
+        for (size_t i = 0; i < m_node_names.size(); ++i)
+        {
+            if (m_node_names[i] == node_name)
+            {
+                return int32_t(i);
+            }
+        }
+
+        return -1;
+    }
+
+    bool Skeleton::ExcludeFromReducedSkeleton(std::string_view node_name)
+    {
+        const int32_t node_index = FindNode(node_name);
+
+        if (node_index < 0)
+        {
+            return false;
+        }
+
+        /* The descendants of the node follow it and their parents precede them. */
+        std::vector<uint8_t> is_excluded(m_parents.size(), 0);
+        is_excluded[node_index] = 1;
+
+        for (size_t i = node_index; i < m_parents.size(); ++i)
+        {
+            is_excluded[i] = is_excluded[i] || (m_parents[i] >= 0 && is_excluded[m_parents[i]]);
+
+            if (is_excluded[i] && m_parents[i] >= 0)
+            {
+                m_reduced_nodes_mask[i] = 0;
+            }
+        }
+
+        m_reduced_nodes_count = uint32_t(std::count(m_reduced_nodes_mask.begin(), m_reduced_nodes_mask.end(), 1));
+
+        return true;
+    }
+
+    void Skeleton::BuildReducedSkeleton()
+    {
+        const size_t nodes_count = m_parents.size();
+
+        m_bind_transforms.resize(nodes_count);
+
+        for (size_t i = 0; i < nodes_count; ++i)
+        {
+            m_bind_transforms[i] = AffineTransform::FromTRS(m_bind_pose.translations[i], m_bind_pose.rotations[i], m_bind_pose.scales[i]);
+        }
+
+        /* The nodes without children are left out, unless one of them is the root. */
+        m_reduced_nodes_mask.assign(nodes_count, 0);
+
+        for (size_t i = 0; i < nodes_count; ++i)
+        {
+            if (m_parents[i] < 0)
+            {
+                m_reduced_nodes_mask[i] = 1;
+            }
+            else
+            {
+                m_reduced_nodes_mask[m_parents[i]] = 1;
+            }
+        }
+
+        m_reduced_nodes_count = uint32_t(std::count(m_reduced_nodes_mask.begin(), m_reduced_nodes_mask.end(), 1));
+    }
+
+    void Skeleton::ComputeBoneTransforms(const Pose& pose, std::span<AffineTransform> node_transforms, std::span<glm::mat4> palette, bool reduced) const
+    {
+        const size_t nodes_count = m_parents.size();
+
+        for (size_t i = 0; i < nodes_count; ++i)
+        {
+            const AffineTransform local  = !reduced || m_reduced_nodes_mask[i] ? AffineTransform::FromTRS(pose.translations[i], pose.rotations[i], pose.scales[i])
+                                                                               : m_bind_transforms[i];
+            const int32_t         parent = m_parents[i];
+
+            /* The global inverse transformation is applied to the root, so that all of the nodes inherit it. */
+            node_transforms[i] = (parent >= 0 ? node_transforms[parent] : m_global_inverse_transform) * local;
+
+            const int32_t bone_index = m_bone_indices[i];
+
+            if (bone_index >= 0)
+            {
+                palette[bone_index] = (node_transforms[i] * m_bone_offsets[bone_index]).ToMat4();
+            }
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace RGL
+{
+    /* Affine transformation stored as the first three rows of a 4x4 matrix, the last row is implicitly (0, 0, 0, 1).
+     * Concatenating two transformations takes 9 vec4 multiply-adds. */
+    struct AffineTransform
+    {
+        glm::vec4 rows[3];
+
+        AffineTransform()
+            : rows{ glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+                    glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+                    glm::vec4(0.0f, 0.0f, 1.0f, 0.0f) } {}
+
+        explicit AffineTransform(const glm::mat4& m)
+            : rows{ glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]),
+                    glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]),
+                    glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]) } {}
+
+        /* translation * rotation * scale, rotation has to be normalized. */
+        static AffineTransform FromTRS(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+        {
+            const float xx = rotation.x * rotation.x, yy = rotation.y * rotation.y, zz = rotation.z * rotation.z;
+            const float xy = rotation.x * rotation.y, xz = rotation.x * rotation.z, yz = rotation.y * rotation.z;
+            const float wx = rotation.w * rotation.x, wy = rotation.w * rotation.y, wz = rotation.w * rotation.z;
+
+            AffineTransform t;
+            t.rows[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * scale.x,         2.0f * (xy - wz)  * scale.y,         2.0f * (xz + wy)  * scale.z, translation.x);
+            t.rows[1] = glm::vec4(        2.0f * (xy + wz)  * scale.x, (1.0f - 2.0f * (xx + zz)) * scale.y,         2.0f * (yz - wx)  * scale.z, translation.y);
+            t.rows[2] = glm::vec4(        2.0f * (xz - wy)  * scale.x,         2.0f * (yz + wx)  * scale.y, (1.0f - 2.0f * (xx + yy)) * scale.z, translation.z);
+
+            return t;
+        }
+
+        glm::mat4 ToMat4() const
+        {
+            return glm::mat4(glm::vec4(rows[0].x, rows[1].x, rows[2].x, 0.0f),
+                             glm::vec4(rows[0].y, rows[1].y, rows[2].y, 0.0f),
+                             glm::vec4(rows[0].z, rows[1].z, rows[2].z, 0.0f),
+                             glm::vec4(rows[0].w, rows[1].w, rows[2].w, 1.0f));
+        }
+
+        AffineTransform operator*(const AffineTransform& other) const
+        {
+            AffineTransform t;
+
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                t.rows[i] = rows[i].x * other.rows[0] + rows[i].y * other.rows[1] + rows[i].z * other.rows[2] + glm::vec4(0.0f, 0.0f, 0.0f, rows[i].w);
+            }
+
+            return t;
+        }
+    };
+
+    /* Local transformations of a skeleton's nodes in the SoA layout, indexed by the node index. */
+    struct Pose
+    {
+        std::vector<glm::vec3> translations;
+        std::vector<glm::quat> rotations;
+        std::vector<glm::vec3> scales;
+
+        void Resize(uint32_t nodes_count)
+        {
+            translations.resize(nodes_count, glm::vec3(0.0f));
+            rotations   .resize(nodes_count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+            scales      .resize(nodes_count, glm::vec3(1.0f));
+        }
+
+        /* Copies the transformations without reallocating if the poses have the same size. */
+        void CopyFrom(const Pose& other)
+        {
+            std::copy(other.translations.begin(), other.translations.end(), translations.begin());
+            std::copy(other.rotations   .begin(), other.rotations   .end(), rotations   .begin());
+            std::copy(other.scales      .begin(), other.scales      .end(), scales      .begin());
+        }
+
+        /* Moves the transformations towards target's by weight * mask[node], an empty mask stands for all ones.
+         * The rotations are blended with nlerp along the shorter arc. Doesn't allocate. */
+        void Blend(const Pose& target, float weight, std::span<const float> mask = {});
+
+        uint32_t GetNodesCount() const { return uint32_t(translations.size()); }
+    };
+
+    /* Node hierarchy of an animated model, flattened into arrays sorted so that the parents precede their children. */
+    class Skeleton final
+    {
+    public:
+        Skeleton() = default;
+
+        /* Computes the model space transformations of the nodes in a single pass and writes the skinning matrices of the bones to palette.
+         * node_transforms is a scratch buffer of GetNodesCount() elements, palette has GetBonesCount() elements.
+         * If reduced is set, the nodes outside of the reduced skeleton keep their bind pose relative to their parents. */
+        void ComputeBoneTransforms(const Pose& pose, std::span<AffineTransform> node_transforms, std::span<glm::mat4> palette, bool reduced = false) const;
+
+        /* Local transformations of the nodes in the scene, used for the nodes that are not animated. */
+        const Pose& GetBindPose() const { return m_bind_pose; }
+
+        /* Index of the first node with the name or -1 if there's no such node. */
+        int32_t FindNode(std::string_view node_name) const;
+
+        const std::string& GetNodeName(uint32_t node_index) const { return m_node_names[node_index]; }
+
+        /* Reduced skeleton used by the distant instances, by default all of the nodes but the leaves, e.g. the finger tips and the facial bones.
+         * The mask has 1 for the nodes that are evaluated, see AnimationClip::Sample(). */
+        std::span<const uint8_t> GetReducedNodesMask()  const { return m_reduced_nodes_mask; }
+        uint32_t                 GetReducedNodesCount() const { return m_reduced_nodes_count; }
+
+        /* Removes the node and its descendants from the reduced skeleton. The root always stays. Returns false if there's no such node. */
+        bool ExcludeFromReducedSkeleton(std::string_view node_name);
+
+        int32_t  GetParentIndex(uint32_t node_index) const { return m_parents[node_index]; }
+        int32_t  GetBoneIndex  (uint32_t node_index) const { return m_bone_indices[node_index]; }
+        uint32_t GetNodesCount()                     const { return uint32_t(m_parents.size()); }
+        uint32_t GetBonesCount()                     const { return uint32_t(m_bone_offsets.size()); }
+
+    private:
+        std::vector<std::string>     m_node_names;
+        std::vector<int32_t>         m_parents;      /* -1 for the root. */
+        std::vector<int32_t>         m_bone_indices; /* -1 if the node isn't a bone. */
+        std::vector<AffineTransform> m_bone_offsets; /* Indexed by the bone index, transform from the mesh space to the bone space. */
+        AffineTransform              m_global_inverse_transform;
+        Pose                         m_bind_pose;
+        std::vector<AffineTransform> m_bind_transforms;    /* Local transformations of the bind pose. */
+        std::vector<uint8_t>         m_reduced_nodes_mask;
+        uint32_t                     m_reduced_nodes_count = 0;
+
+        /* Called once the nodes and the bind pose are known. */
+        void BuildReducedSkeleton();
+
+        friend class AnimatedModel;
+    };
+}
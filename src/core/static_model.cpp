@@ -1,62 +1,98 @@
 #include "static_model.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/component_wise.hpp>
+#include <glm/gtc/matrix_access.hpp>
 
 #include <assimp/postprocess.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define RGL_SSE
+    #include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <utility>
+
+#include "binary_cache.h"
+#include "mesh_optimizer.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+#include "timer.h"
 #include "util.h"
 
 namespace RGL
 {
-    void StaticModel::Render(uint32_t num_instances)
+    /* Changing the importer flags invalidates the mesh cache. */
+    static constexpr uint32_t IMPORTER_FLAGS = aiProcess_Triangulate              |
+                                               aiProcess_GenSmoothNormals         |
+                                               aiProcess_GenUVCoords              |
+                                               aiProcess_CalcTangentSpace         |
+                                               aiProcess_FlipUVs                  |
+                                               aiProcess_JoinIdenticalVertices    |
+                                               aiProcess_RemoveRedundantMaterials |
+                                               aiProcess_GenBoundingBoxes;
+
+    /* Bump the version whenever the layout of the cache file changes. */
+    static constexpr uint32_t MESH_CACHE_MAGIC   = 0x4853454d; /* "MESH" */
+    static constexpr uint32_t MESH_CACHE_VERSION = 4;
+
+    /* For the embedded textures, which aren't shared. The cached ones get their wrapping mode from TextureCache. */
+    static void SetTextureWraping(Texture2D& texture, bool repeat)
     {
-        glBindVertexArray(m_vao_name);
-
-        for (unsigned int i = 0; i < m_mesh_parts.size(); i++)
+        if (repeat)
         {
-            if (!m_materials.empty())
-            {
-                const unsigned int material_index = m_mesh_parts[i].m_material_index;
+            texture.SetWraping(TextureWrapingCoordinate::S, TextureWrapingParam::REPEAT);
+            texture.SetWraping(TextureWrapingCoordinate::T, TextureWrapingParam::REPEAT);
+        }
+    }
 
-                assert(material_index < m_materials.size());
+    void StaticModel::Render(uint32_t num_instances)
+    {
+        RenderMeshParts(nullptr, num_instances, nullptr);
+    }
 
-                for (auto const& [texture_type, texture] : m_materials[material_index]->m_texture_map)
-                {
-                    texture->Bind(uint32_t(texture_type));
-                }
-            }
+    void StaticModel::Render(std::shared_ptr<Shader>& shader, uint32_t num_instances)
+    {
+        RenderMeshParts(shader.get(), num_instances, nullptr);
+    }
 
-            if (num_instances == 0)
-            {
-                glDrawElementsBaseVertex(GLenum(m_draw_mode),
-                                         m_mesh_parts[i].m_indices_count,
-                                         GL_UNSIGNED_INT,
-                                         (void*)(sizeof(unsigned int) * m_mesh_parts[i].m_base_index),
-                                         m_mesh_parts[i].m_base_vertex);
-            }
-            else
-            {
-                glDrawElementsInstancedBaseVertex(GLenum(m_draw_mode),
-                                                  m_mesh_parts[i].m_indices_count,
-                                                  GL_UNSIGNED_INT,
-                                                  (void*)(sizeof(unsigned int) * m_mesh_parts[i].m_base_index),
-                                                  num_instances,
-                                                  m_mesh_parts[i].m_base_vertex);
-            }
-        }
+    void StaticModel::Render(const glm::mat4& view_projection, uint32_t num_instances)
+    {
+        FrustumCull({ &view_projection, 1 });
+        RenderMeshParts(nullptr, num_instances, &m_parts_visibility);
+    }
 
-        glBindTextureUnit(0, 0);
+    void StaticModel::Render(const glm::mat4& view_projection, std::shared_ptr<Shader>& shader, uint32_t num_instances)
+    {
+        FrustumCull({ &view_projection, 1 });
+        RenderMeshParts(shader.get(), num_instances, &m_parts_visibility);
     }
 
-    void StaticModel::Render(std::shared_ptr<Shader>& shader, uint32_t num_instances)
+    void StaticModel::Render(std::span<const glm::mat4> view_projections, uint32_t num_instances)
+    {
+        FrustumCull(view_projections);
+        RenderMeshParts(nullptr, num_instances, &m_parts_visibility);
+    }
+
+    void StaticModel::RenderMeshParts(Shader* shader, uint32_t num_instances, const std::vector<uint8_t>* visibility)
     {
         glBindVertexArray(m_vao_name);
     
         for (unsigned int i = 0 ; i < m_mesh_parts.size() ; i++) 
         {
+            if (visibility && !(*visibility)[i])
+            {
+                m_render_stats.culled_parts++;
+                continue;
+            }
+
             if (!m_materials.empty())
             {
                 const unsigned int material_index = m_mesh_parts[i].m_material_index;
@@ -69,19 +105,22 @@ namespace RGL
                 }
 
                 // Set uniforms based on the data in the material
-                for (auto& [uniform_name, value] : m_materials[material_index]->m_bool_map)
+                if (shader)
                 {
-                    shader->setUniform(uniform_name, value);
-                }
+                    for (auto& [uniform_name, value] : m_materials[material_index]->m_bool_map)
+                    {
+                        shader->setUniform(uniform_name, value);
+                    }
 
-                for (auto& [uniform_name, value] : m_materials[material_index]->m_float_map)
-                {
-                    shader->setUniform(uniform_name, value);
-                }
+                    for (auto& [uniform_name, value] : m_materials[material_index]->m_float_map)
+                    {
+                        shader->setUniform(uniform_name, value);
+                    }
 
-                for (auto& [uniform_name, value] : m_materials[material_index]->m_vec3_map)
-                {
-                    shader->setUniform(uniform_name, value);
+                    for (auto& [uniform_name, value] : m_materials[material_index]->m_vec3_map)
+                    {
+                        shader->setUniform(uniform_name, value);
+                    }
                 }
             }
 
@@ -89,24 +128,109 @@ namespace RGL
             {
                 glDrawElementsBaseVertex(GLenum(m_draw_mode), 
                                          m_mesh_parts[i].m_indices_count,
-                                         GL_UNSIGNED_INT,
-                                         (void*)(sizeof(unsigned int) * m_mesh_parts[i].m_base_index),
+                                         m_mesh_parts[i].m_index_type,
+                                         (void*)uint64_t(m_mesh_parts[i].m_index_offset),
                                          m_mesh_parts[i].m_base_vertex);
             }
             else
             {
                 glDrawElementsInstancedBaseVertex(GLenum(m_draw_mode),
                                                   m_mesh_parts[i].m_indices_count,
-                                                  GL_UNSIGNED_INT,
-                                                  (void*)(sizeof(unsigned int) * m_mesh_parts[i].m_base_index),
+                                                  m_mesh_parts[i].m_index_type,
+                                                  (void*)uint64_t(m_mesh_parts[i].m_index_offset),
                                                   num_instances,
                                                   m_mesh_parts[i].m_base_vertex);
             }
+
+            m_render_stats.submitted_parts++;
         }
 
         glBindTextureUnit(0, 0);
     }
 
+    void StaticModel::RenderIndirect(GLuint materials_binding_index, GLuint draw_materials_binding_index)
+    {
+        if (m_draw_indirect_buffer_name == 0)
+        {
+            CreateIndirectBuffers();
+        }
+
+        glBindVertexArray(m_vao_name);
+        glBindBuffer     (GL_DRAW_INDIRECT_BUFFER, m_draw_indirect_buffer_name);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, materials_binding_index, m_materials_ssbo_name);
+
+        for (auto& batch : m_indirect_batches)
+        {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, draw_materials_binding_index, m_draw_materials_ssbo_name, batch.draw_materials_offset, batch.draws_count * sizeof(uint32_t));
+
+            glMultiDrawElementsIndirect(GLenum(m_draw_mode), batch.index_type, (void*)batch.commands_offset, batch.draws_count, 0 /* stride */);
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        m_render_stats.submitted_parts += uint32_t(m_mesh_parts.size());
+    }
+
+    uint32_t StaticModel::BindIndirectCullingBuffers(GLuint first_binding_index)
+    {
+        if (m_draw_indirect_buffer_name == 0)
+        {
+            CreateIndirectBuffers();
+        }
+
+        static const uint32_t clear_val = 0;
+        glClearNamedBufferData(m_draw_counts_buffer_name, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val);
+
+        const GLuint buffers[] = { m_draw_infos_ssbo_name, m_draw_indirect_buffer_name, m_culled_commands_buffer_name, m_culled_draw_materials_ssbo_name, m_draw_counts_buffer_name };
+
+        for (uint32_t i = 0; i < std::size(buffers); ++i)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, first_binding_index + i, buffers[i]);
+        }
+
+        return GetIndirectDrawsCount();
+    }
+
+    void StaticModel::RenderIndirectCount(GLuint materials_binding_index, GLuint draw_materials_binding_index)
+    {
+        if (m_draw_indirect_buffer_name == 0)
+        {
+            CreateIndirectBuffers();
+        }
+
+        glBindVertexArray(m_vao_name);
+        glBindBuffer     (GL_DRAW_INDIRECT_BUFFER, m_culled_commands_buffer_name);
+        glBindBuffer     (GL_PARAMETER_BUFFER,     m_draw_counts_buffer_name);
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, materials_binding_index, m_materials_ssbo_name);
+
+        for (size_t i = 0; i < m_indirect_batches.size(); ++i)
+        {
+            auto& batch = m_indirect_batches[i];
+
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, draw_materials_binding_index, m_culled_draw_materials_ssbo_name, batch.draw_materials_offset, batch.draws_count * sizeof(uint32_t));
+
+            glMultiDrawElementsIndirectCount(GLenum(m_draw_mode), batch.index_type, (void*)batch.commands_offset, GLintptr(i * sizeof(uint32_t)), batch.draws_count, 0 /* stride */);
+        }
+
+        glBindBuffer(GL_PARAMETER_BUFFER,     0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        /* The number of the visible parts is known only on the GPU. */
+        m_render_stats.submitted_parts += uint32_t(m_mesh_parts.size());
+    }
+
+    uint32_t StaticModel::GetIndirectDrawsCount() const
+    {
+        uint32_t draws_count = 0;
+
+        for (auto& batch : m_indirect_batches)
+        {
+            draws_count += batch.draws_count;
+        }
+
+        return draws_count;
+    }
+
     bool StaticModel::Load(const std::filesystem::path& filepath)
     {
         /* Release the previously loaded mesh if it was loaded. */
@@ -115,27 +239,87 @@ namespace RGL
             Release();
         }
 
+        const double start_time = Timer::getTime();
+
+        /* Try the mesh cache first. */
+        std::filesystem::path cache_filepath;
+        uint64_t              source_hash = 0;
+
+        if (m_mesh_cache_enabled)
+        {
+            cache_filepath = BinaryCache::GetCachePath(filepath, ".rglmesh");
+            source_hash    = HashModelSource(filepath);
+
+            if (LoadMeshCache(cache_filepath, source_hash))
+            {
+                printf("Loaded model '%s' (warm, mesh cache) in %.2f ms, %u bytes per vertex\n", filepath.generic_string().c_str(), (Timer::getTime() - start_time) * 1000.0, GetBytesPerVertex(m_vertex_format));
+                return true;
+            }
+
+            /* The cache might have been partially loaded. */
+            Release();
+        }
+
         /* Load model */
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(filepath.generic_string(), aiProcess_Triangulate              | 
-                                                                            aiProcess_GenSmoothNormals         | 
-                                                                            aiProcess_GenUVCoords              |
-                                                                            aiProcess_CalcTangentSpace         |
-                                                                            aiProcess_FlipUVs                  |
-                                                                            aiProcess_JoinIdenticalVertices    | 
-                                                                            aiProcess_RemoveRedundantMaterials | 
-                                                                            aiProcess_GenBoundingBoxes );
+        const aiScene* scene = importer.ReadFile(filepath.generic_string(), IMPORTER_FLAGS);
 
         if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
-            fprintf(stderr, "Assimp error while loading mesh %s\n Error: %s\n", filepath.generic_string(), importer.GetErrorString());
+            fprintf(stderr, "Assimp error while loading mesh %s\n Error: %s\n", filepath.generic_string().c_str(), importer.GetErrorString());
+            return false;
+        }
+
+        VertexData                    vertex_data;
+        std::vector<TextureReference> texture_references;
+
+        if (!ImportScene(scene, filepath, vertex_data, texture_references))
+        {
             return false;
         }
 
-        return ParseScene(scene, filepath);
+        if (m_mesh_optimization_enabled)
+        {
+            OptimizeMeshParts(vertex_data);
+        }
+
+        LoadTextures(texture_references);
+        CreateBuffers(vertex_data);
+
+        printf("Loaded model '%s' (cold, Assimp) in %.2f ms, %u bytes per vertex\n", filepath.generic_string().c_str(), (Timer::getTime() - start_time) * 1000.0, GetBytesPerVertex(m_vertex_format));
+
+        if (m_mesh_cache_enabled && source_hash != 0)
+        {
+            SaveMeshCache(cache_filepath, source_hash, vertex_data, texture_references);
+        }
+
+        return true;
     }
 
     bool StaticModel::ParseScene(const aiScene* scene, const std::filesystem::path& filepath)
+    {
+        VertexData                    vertex_data;
+        std::vector<TextureReference> texture_references;
+
+        if (!ImportScene(scene, filepath, vertex_data, texture_references))
+        {
+            return false;
+        }
+
+        if (m_mesh_optimization_enabled)
+        {
+            OptimizeMeshParts(vertex_data);
+        }
+
+        LoadTextures(texture_references);
+
+        /* Populate buffers on the GPU with the model's data. */
+        CreateBuffers(vertex_data);
+
+        return true;
+    }
+
+    bool StaticModel::ImportScene(const aiScene* scene, const std::filesystem::path& filepath, VertexData& vertex_data, std::vector<TextureReference>& texture_references)
     {
         m_mesh_parts.resize(scene->mNumMeshes);
         m_materials.resize(scene->mNumMaterials);
@@ -145,8 +329,6 @@ namespace RGL
             m_materials[i] = std::make_shared<Material>();
         }
 
-        VertexData vertex_data;
-
         uint32_t vertices_count = 0;
         uint32_t indices_count  = 0;
 
@@ -180,19 +362,18 @@ namespace RGL
 
             min = glm::min(min, vec3_cast(mesh->mAABB.mMin));
             max = glm::max(max, vec3_cast(mesh->mAABB.mMax));
+
+            /* Keep the part's AABB for culling. */
+            auto& mesh_part = m_mesh_parts[i];
+            mesh_part.m_aabb_min        = vec3_cast(mesh->mAABB.mMin);
+            mesh_part.m_aabb_max        = vec3_cast(mesh->mAABB.mMax);
+            mesh_part.m_bounding_sphere = CalcBoundingSphere({ vertex_data.positions.data() + mesh_part.m_base_vertex, mesh->mNumVertices }, mesh_part.m_aabb_min, mesh_part.m_aabb_max);
         }
 
         m_unit_scale = 1.0f / glm::compMax(max - min);
 
-        /* Load materials. */
-        if (!LoadMaterials(scene, filepath))
-        {
-            fprintf(stderr, "Assimp error while loading mesh %s\n Error: Could not load the materials.\n", filepath.generic_string());
-            return false;
-        }
-
-        /* Populate buffers on the GPU with the model's data. */
-        CreateBuffers(vertex_data);
+        /* Load materials' parameters, textures are loaded later on. */
+        CollectMaterials(scene, filepath, texture_references);
 
         return true;
     }
@@ -226,7 +407,66 @@ namespace RGL
         }
     }
 
+    void StaticModel::OptimizeMeshParts(VertexData& vertex_data)
+    {
+        const double start_time = Timer::getTime();
+
+        std::vector<VertexCacheStats> stats_before(m_mesh_parts.size());
+        std::vector<VertexCacheStats> stats_after (m_mesh_parts.size());
+
+        /* The mesh parts use disjoint ranges of the vertex and index buffers, so each one can be optimized on its own thread. */
+        ThreadPool::Get().ParallelFor(m_mesh_parts.size(), [&](size_t i)
+        {
+            const MeshPart& mesh_part      = m_mesh_parts[i];
+            const size_t    vertices_end   = i + 1 < m_mesh_parts.size() ? m_mesh_parts[i + 1].m_base_vertex : vertex_data.positions.size();
+            const size_t    vertices_count = vertices_end - mesh_part.m_base_vertex;
+
+            std::span<uint32_t>  indices  (vertex_data.indices.data()   + mesh_part.m_base_index,  mesh_part.m_indices_count);
+            std::span<glm::vec3> positions(vertex_data.positions.data() + mesh_part.m_base_vertex, vertices_count);
+            std::span<glm::vec2> texcoords(vertex_data.texcoords.data() + mesh_part.m_base_vertex, vertices_count);
+            std::span<glm::vec3> normals  (vertex_data.normals.data()   + mesh_part.m_base_vertex, vertices_count);
+            std::span<glm::vec3> tangents (vertex_data.tangents.data()  + mesh_part.m_base_vertex, vertices_count);
+
+            stats_before[i] = MeshOptimizer::AnalyzeVertexCache(indices, vertices_count);
+
+            MeshOptimizer::OptimizeVertexCache(indices, vertices_count);
+            MeshOptimizer::OptimizeOverdraw   (indices, positions);
+
+            auto remap = MeshOptimizer::OptimizeVertexFetch(indices, vertices_count);
+            MeshOptimizer::RemapVertices(positions, remap);
+            MeshOptimizer::RemapVertices(texcoords, remap);
+            MeshOptimizer::RemapVertices(normals,   remap);
+            MeshOptimizer::RemapVertices(tangents,  remap);
+
+            stats_after[i] = MeshOptimizer::AnalyzeVertexCache(indices, vertices_count);
+        });
+
+        VertexCacheStats total_before, total_after;
+
+        for (size_t i = 0; i < m_mesh_parts.size(); ++i)
+        {
+            total_before += stats_before[i];
+            total_after  += stats_after[i];
+        }
+
+        printf("Optimized %zu mesh parts in %.2f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO cache of %u vertices)\n",
+               m_mesh_parts.size(), (Timer::getTime() - start_time) * 1000.0,
+               total_before.GetACMR(), total_after.GetACMR(),
+               total_before.GetATVR(), total_after.GetATVR(),
+               MeshOptimizer::ANALYZE_CACHE_SIZE);
+    }
+
     bool StaticModel::LoadMaterials(const aiScene* scene, const std::filesystem::path& filepath)
+    {
+        std::vector<TextureReference> texture_references;
+
+        CollectMaterials(scene, filepath, texture_references);
+        LoadTextures(texture_references);
+
+        return true;
+    }
+
+    void StaticModel::CollectMaterials(const aiScene* scene, const std::filesystem::path& filepath, std::vector<TextureReference>& texture_references)
     {
         // Extract the directory part from the file name
         std::string::size_type last_slash_index = filepath.generic_string().rfind("/");
@@ -245,18 +485,16 @@ namespace RGL
             dir = filepath.generic_string().substr(0, last_slash_index);
         }
 
-        bool ret = true;
-
         for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
         {
             auto pMaterial = scene->mMaterials[i];
 
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_BASE_COLOR,        Material::TextureType::ALBEDO,    dir);
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_NORMALS,           Material::TextureType::NORMAL,    dir);
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_EMISSIVE,          Material::TextureType::EMISSIVE,  dir);
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_AMBIENT_OCCLUSION, Material::TextureType::AO,        dir);
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_DIFFUSE_ROUGHNESS, Material::TextureType::ROUGHNESS, dir);
-            ret |= LoadMaterialTextures(scene, pMaterial, i, aiTextureType_METALNESS,         Material::TextureType::METALLIC,  dir);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_BASE_COLOR,        Material::TextureType::ALBEDO,    dir, texture_references);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_NORMALS,           Material::TextureType::NORMAL,    dir, texture_references);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_EMISSIVE,          Material::TextureType::EMISSIVE,  dir, texture_references);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_AMBIENT_OCCLUSION, Material::TextureType::AO,        dir, texture_references);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_DIFFUSE_ROUGHNESS, Material::TextureType::ROUGHNESS, dir, texture_references);
+            LoadMaterialTextures(scene, pMaterial, i, aiTextureType_METALNESS,         Material::TextureType::METALLIC,  dir, texture_references);
 
             /* Load material parameters */
             aiColor3D color_rgb;
@@ -284,11 +522,9 @@ namespace RGL
                 m_materials[i]->AddFloat("u_metallic", value);
             }
         }
-
-        return ret;
     }
 
-    bool StaticModel::LoadMaterialTextures(const aiScene* scene, const aiMaterial* material, uint32_t material_index, aiTextureType type, Material::TextureType texture_type, const std::string& directory) const
+    void StaticModel::LoadMaterialTextures(const aiScene* scene, const aiMaterial* material, uint32_t material_index, aiTextureType type, Material::TextureType texture_type, const std::string& directory, std::vector<TextureReference>& texture_references) const
     {
         if (material->GetTextureCount(type) > 0)
         {
@@ -298,36 +534,25 @@ namespace RGL
             // Only one texture of a given type is being loaded
             if (material->GetTexture(type, 0, &path, NULL, NULL, NULL, NULL, texture_map_mode) == AI_SUCCESS)
             {
-                bool is_srgb = (type == aiTextureType_DIFFUSE) || (type == aiTextureType_EMISSIVE) || (type == aiTextureType_BASE_COLOR);
+                TextureReference texture_reference;
+                texture_reference.material_index = material_index;
+                texture_reference.texture_type   = texture_type;
+                texture_reference.is_srgb        = (type == aiTextureType_DIFFUSE) || (type == aiTextureType_EMISSIVE) || (type == aiTextureType_BASE_COLOR);
+                texture_reference.repeat         = texture_map_mode[0] == aiTextureMapMode_Wrap;
 
-                std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>();
                 const aiTexture* paiTexture = scene->GetEmbeddedTexture(path.C_Str());
 
                 if (paiTexture)
                 {
-                    // Load embedded
+                    // Embedded, the data stays valid as long as the scene is alive
                     uint32_t data_size = paiTexture->mHeight > 0 ? paiTexture->mWidth * paiTexture->mHeight : paiTexture->mWidth;
-                    
-                    if (texture->Load(reinterpret_cast<unsigned char*>(paiTexture->pcData), data_size, is_srgb))
-                    {
-                        printf("Loaded embedded texture for the model '%s'\n", path.C_Str());
-                        m_materials[material_index]->AddTexture(texture_type, texture);
-
-                        if (texture_map_mode[0] == aiTextureMapMode_Wrap)
-                        {
-                            texture->SetWraping(RGL::TextureWrapingCoordinate::S, RGL::TextureWrapingParam::REPEAT);
-                            texture->SetWraping(RGL::TextureWrapingCoordinate::T, RGL::TextureWrapingParam::REPEAT);
-                        }
-                    }
-                    else
-                    {
-                        fprintf(stderr, "Error loading embedded texture for the model %s.\n", path.C_Str());
-                        return false;
-                    }
+
+                    texture_reference.path          = path.C_Str();
+                    texture_reference.embedded_data = { reinterpret_cast<const unsigned char*>(paiTexture->pcData), data_size };
                 }
                 else
                 {
-                    // Load from file
+                    // From file
                     std::string p(path.data);
 
                     if (p.substr(0, 2) == ".\\")
@@ -335,96 +560,452 @@ namespace RGL
                         p = p.substr(2, p.size() - 2);
                     }
 
-                    std::string full_path = directory + "/" + p;
-                    if (!texture->Load(full_path, is_srgb))
-                    {
-                        fprintf(stderr, "Error loading texture %s.\n", full_path.c_str());
-                        return false;
-                    }
-                    else
-                    {
-                        printf("Loaded texture '%s'\n", full_path.c_str());
-                        m_materials[material_index]->AddTexture(texture_type, texture);
-
-                        if (texture_map_mode[0] == aiTextureMapMode_Wrap)
-                        {
-                            texture->SetWraping(RGL::TextureWrapingCoordinate::S, RGL::TextureWrapingParam::REPEAT);
-                            texture->SetWraping(RGL::TextureWrapingCoordinate::T, RGL::TextureWrapingParam::REPEAT);
-                        }
-                    }
+                    texture_reference.path = directory + "/" + p;
                 }
-            }
 
-            if (texture_type == Material::TextureType::ALBEDO)    m_materials[material_index]->AddBool("u_has_albedo_map",    true);
-            if (texture_type == Material::TextureType::NORMAL)    m_materials[material_index]->AddBool("u_has_normal_map",    true);
-            if (texture_type == Material::TextureType::EMISSIVE)  m_materials[material_index]->AddBool("u_has_emissive_map",  true);
-            if (texture_type == Material::TextureType::AO)        m_materials[material_index]->AddBool("u_has_ao_map",        true);
-            if (texture_type == Material::TextureType::METALLIC)  m_materials[material_index]->AddBool("u_has_metallic_map",  true);
-            if (texture_type == Material::TextureType::ROUGHNESS) m_materials[material_index]->AddBool("u_has_roughness_map", true);
+                texture_references.push_back(texture_reference);
+            }
         }
-
-        return true;
     }
 
-    void StaticModel::CreateBuffers(VertexData& vertex_data)
+    void StaticModel::LoadTextures(const std::vector<TextureReference>& texture_references)
     {
-        bool has_tangents = !vertex_data.tangents.empty();
+        auto textures = m_parallel_texture_loading ? LoadTexturesParallel(texture_references) : LoadTexturesSerial(texture_references);
 
-        const GLsizei positions_size_bytes = vertex_data.positions.size() * sizeof(vertex_data.positions[0]);
-        const GLsizei texcoords_size_bytes = vertex_data.texcoords.size() * sizeof(vertex_data.texcoords[0]);
-        const GLsizei normals_size_bytes   = vertex_data.normals  .size() * sizeof(vertex_data.normals  [0]);
-        const GLsizei tangents_size_bytes  = has_tangents ? vertex_data.tangents .size() * sizeof(vertex_data.tangents [0]) : 0;
-        const GLsizei total_size_bytes     = positions_size_bytes + texcoords_size_bytes + normals_size_bytes + tangents_size_bytes;
+        for (uint32_t i = 0; i < texture_references.size(); ++i)
+        {
+            auto& texture_reference = texture_references[i];
+            auto& texture           = textures[i];
 
-        glCreateBuffers     (1, &m_vbo_name);
-        glNamedBufferStorage(m_vbo_name, total_size_bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            if (!texture)
+            {
+                continue;
+            }
 
-        uint64_t offset = 0;
-        glNamedBufferSubData(m_vbo_name, offset, positions_size_bytes, vertex_data.positions.data());
+            auto& material = m_materials[texture_reference.material_index];
+            material->AddTexture(texture_reference.texture_type, texture);
 
-        offset += positions_size_bytes;
-        glNamedBufferSubData(m_vbo_name, offset, texcoords_size_bytes, vertex_data.texcoords.data());
+            if (texture_reference.texture_type == Material::TextureType::ALBEDO)    material->AddBool("u_has_albedo_map",    true);
+            if (texture_reference.texture_type == Material::TextureType::NORMAL)    material->AddBool("u_has_normal_map",    true);
+            if (texture_reference.texture_type == Material::TextureType::EMISSIVE)  material->AddBool("u_has_emissive_map",  true);
+            if (texture_reference.texture_type == Material::TextureType::AO)        material->AddBool("u_has_ao_map",        true);
+            if (texture_reference.texture_type == Material::TextureType::METALLIC)  material->AddBool("u_has_metallic_map",  true);
+            if (texture_reference.texture_type == Material::TextureType::ROUGHNESS) material->AddBool("u_has_roughness_map", true);
+        }
+    }
 
-        offset += texcoords_size_bytes;
-        glNamedBufferSubData(m_vbo_name, offset, normals_size_bytes, vertex_data.normals.data());
+    std::vector<std::shared_ptr<Texture2D>> StaticModel::LoadTexturesSerial(const std::vector<TextureReference>& texture_references) const
+    {
+        std::vector<std::shared_ptr<Texture2D>> textures(texture_references.size());
 
-        if(has_tangents)
+        for (uint32_t i = 0; i < texture_references.size(); ++i)
         {
-            offset += normals_size_bytes;
-            glNamedBufferSubData(m_vbo_name, offset, tangents_size_bytes, vertex_data.tangents.data());
-        }
+            auto& texture_reference = texture_references[i];
 
-        glCreateBuffers     (1, &m_ibo_name);
-        glNamedBufferStorage(m_ibo_name, sizeof(vertex_data.indices[0]) * vertex_data.indices.size(), vertex_data.indices.data(), GL_DYNAMIC_STORAGE_BIT);
+            std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>();
 
-        glCreateVertexArrays(1, &m_vao_name);
+            if (!texture_reference.embedded_data.empty())
+            {
+                if (texture->Load(texture_reference.embedded_data.data(), texture_reference.embedded_data.size(), texture_reference.is_srgb))
+                {
+                    SetTextureWraping(*texture, texture_reference.repeat);
+                    printf("Loaded embedded texture for the model '%s'\n", texture_reference.path.c_str());
+                    textures[i] = texture;
+                }
+                else
+                {
+                    fprintf(stderr, "Error loading embedded texture for the model %s.\n", texture_reference.path.c_str());
+                }
+            }
+            else
+            {
+                textures[i] = TextureCache::Load(texture_reference.path, texture_reference.is_srgb, 0, texture_reference.repeat);
 
-        offset = 0;
-        glVertexArrayVertexBuffer(m_vao_name, 0 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.positions[0]) /*stride*/);
-                          
-        offset += positions_size_bytes;
-        glVertexArrayVertexBuffer(m_vao_name, 1 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.texcoords[0]) /*stride*/);
-        
-        offset += texcoords_size_bytes;
-        glVertexArrayVertexBuffer(m_vao_name, 2 /* bindingindex*/, m_vbo_name,  offset, sizeof(vertex_data.normals[0]) /*stride*/);
+                if (textures[i])
+                {
+                    printf("Loaded texture '%s'\n", texture_reference.path.c_str());
+                }
+                else
+                {
+                    fprintf(stderr, "Error loading texture %s.\n", texture_reference.path.c_str());
+                }
+            }
+        }
 
-        if (has_tangents)
+        return textures;
+    }
+
+    std::vector<std::shared_ptr<Texture2D>> StaticModel::LoadTexturesParallel(const std::vector<TextureReference>& texture_references) const
+    {
+        struct DecodedImage
         {
-            offset += normals_size_bytes;
-            glVertexArrayVertexBuffer(m_vao_name, 3 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.tangents[0]) /*stride*/);
-        }
+            const TextureReference* source;
+            ImageData               metadata;
+            unsigned char*          data;
+        };
 
-        glVertexArrayElementBuffer(m_vao_name, m_ibo_name);
+        std::vector<std::shared_ptr<Texture2D>> textures(texture_references.size());
 
-                          glEnableVertexArrayAttrib(m_vao_name, 0 /*attribindex*/); // positions
-                          glEnableVertexArrayAttrib(m_vao_name, 1 /*attribindex*/); // texcoords
-                          glEnableVertexArrayAttrib(m_vao_name, 2 /*attribindex*/); // normals
-        if (has_tangents) glEnableVertexArrayAttrib(m_vao_name, 3 /*attribindex*/); // tangents
+        /* Every image is decoded only once, even if it's used by many materials.
+           The ones already loaded by other models are taken from the texture cache. */
+        std::vector<DecodedImage>       images;
+        std::vector<uint32_t>           image_indices(texture_references.size());
+        std::map<std::string, uint32_t> image_lookup;
 
-                          glVertexArrayAttribFormat(m_vao_name, 0 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
-                          glVertexArrayAttribFormat(m_vao_name, 1 /*attribindex */, 2 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
-                          glVertexArrayAttribFormat(m_vao_name, 2 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
-        if (has_tangents) glVertexArrayAttribFormat(m_vao_name, 3 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/);
+        for (uint32_t i = 0; i < texture_references.size(); ++i)
+        {
+            auto& texture_reference = texture_references[i];
+            bool  is_embedded       = !texture_reference.embedded_data.empty();
+
+            if (!is_embedded)
+            {
+                textures[i] = TextureCache::Find(texture_reference.path, texture_reference.is_srgb, 0, texture_reference.repeat);
+
+                if (textures[i])
+                {
+                    continue;
+                }
+            }
+
+            auto key = is_embedded ? "embedded:" + texture_reference.path : texture_reference.path;
+
+            auto [it, is_inserted] = image_lookup.try_emplace(key, uint32_t(images.size()));
+
+            if (is_inserted)
+            {
+                images.push_back({ &texture_reference, ImageData(), nullptr });
+            }
+
+            image_indices[i] = it->second;
+        }
+
+        /* Decode the images on the worker threads. */
+        const double decode_start_time = Timer::getTime();
+
+        ThreadPool::Get().ParallelFor(images.size(), [&images](size_t i)
+        {
+            auto& image = images[i];
+
+            if (!image.source->embedded_data.empty())
+            {
+                image.data = Util::LoadTextureData(image.source->embedded_data.data(), uint32_t(image.source->embedded_data.size()), image.metadata);
+            }
+            else
+            {
+                image.data = Util::LoadTextureData(image.source->path, image.metadata);
+            }
+        });
+
+        const double decode_time = Timer::getTime() - decode_start_time;
+
+        /* Upload the decoded images on the GL thread, once per image, color space and wrapping mode. */
+        const double upload_start_time = Timer::getTime();
+
+        std::map<std::tuple<uint32_t, bool, bool>, std::shared_ptr<Texture2D>> uploaded_textures;
+
+        for (uint32_t i = 0; i < texture_references.size(); ++i)
+        {
+            auto& texture_reference = texture_references[i];
+
+            if (textures[i])
+            {
+                continue;
+            }
+
+            auto& image = images[image_indices[i]];
+
+            if (!image.data)
+            {
+                continue;
+            }
+
+            auto& texture = uploaded_textures[{ image_indices[i], texture_reference.is_srgb, texture_reference.repeat }];
+
+            if (!texture)
+            {
+                texture = std::make_shared<Texture2D>();
+                texture->Create(image.data, image.metadata, texture_reference.is_srgb);
+
+                if (texture_reference.embedded_data.empty())
+                {
+                    TextureCache::Insert(texture_reference.path, texture_reference.is_srgb, 0, texture_reference.repeat, texture);
+                }
+                else
+                {
+                    SetTextureWraping(*texture, texture_reference.repeat);
+                }
+
+                printf("Loaded texture '%s'\n", texture_reference.path.c_str());
+            }
+
+            textures[i] = texture;
+        }
+
+        for (auto& image : images)
+        {
+            if (image.data)
+            {
+                Util::ReleaseTextureData(image.data);
+            }
+            else
+            {
+                fprintf(stderr, "Error loading texture %s.\n", image.source->path.c_str());
+            }
+        }
+
+        const double upload_time = Timer::getTime() - upload_start_time;
+
+        printf("Decoded %zu images on %u threads in %.2f ms, uploaded %zu textures in %.2f ms\n", images.size(), ThreadPool::Get().GetThreadsCount() + 1, decode_time * 1000.0, uploaded_textures.size(), upload_time * 1000.0);
+        TextureCache::PrintStats();
+
+        return textures;
+    }
+
+    bool StaticModel::LoadMeshCache(const std::filesystem::path& cache_filepath, uint64_t source_hash)
+    {
+        BinaryCacheReader reader;
+
+        if (!reader.Open(cache_filepath, MESH_CACHE_MAGIC, MESH_CACHE_VERSION, source_hash, GetMeshCacheKey()))
+        {
+            return false;
+        }
+
+        /* Mesh parts */
+        reader.Read(m_unit_scale);
+
+        auto mesh_parts = reader.ReadArray<MeshPart>();
+        m_mesh_parts.assign(mesh_parts.begin(), mesh_parts.end());
+
+        /* Vertex data, used directly from the mapped file. */
+        VertexDataView vertex_data;
+        vertex_data.positions = reader.ReadArray<glm::vec3>();
+        vertex_data.texcoords = reader.ReadArray<glm::vec2>();
+        vertex_data.normals   = reader.ReadArray<glm::vec3>();
+        vertex_data.tangents  = reader.ReadArray<glm::vec3>();
+        vertex_data.indices   = reader.ReadArray<uint32_t>();
+
+        /* Materials */
+        m_materials.resize(reader.Read<uint32_t>());
+
+        for (auto& material : m_materials)
+        {
+            material = std::make_shared<Material>();
+
+            uint32_t vec3_count = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < vec3_count && !reader.HasFailed(); ++i)
+            {
+                auto name = reader.ReadString();
+                material->AddVector3(name, reader.Read<glm::vec3>());
+            }
+
+            uint32_t float_count = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < float_count && !reader.HasFailed(); ++i)
+            {
+                auto name = reader.ReadString();
+                material->AddFloat(name, reader.Read<float>());
+            }
+
+            uint32_t bool_count = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < bool_count && !reader.HasFailed(); ++i)
+            {
+                auto name = reader.ReadString();
+                material->AddBool(name, reader.Read<uint8_t>() != 0);
+            }
+
+            if (reader.HasFailed())
+            {
+                break;
+            }
+        }
+
+        /* Textures */
+        std::vector<TextureReference> texture_references(reader.HasFailed() ? 0 : reader.Read<uint32_t>());
+
+        for (auto& texture_reference : texture_references)
+        {
+            texture_reference.material_index = reader.Read<uint32_t>();
+            texture_reference.texture_type   = Material::TextureType(reader.Read<uint32_t>());
+            texture_reference.is_srgb        = reader.Read<uint8_t>() != 0;
+            texture_reference.repeat         = reader.Read<uint8_t>() != 0;
+            texture_reference.path           = reader.ReadString();
+            texture_reference.embedded_data  = reader.ReadArray<unsigned char>();
+
+            if (reader.HasFailed() || texture_reference.material_index >= m_materials.size())
+            {
+                break;
+            }
+        }
+
+        if (reader.HasFailed() || !reader.IsAtEnd())
+        {
+            fprintf(stderr, "Mesh cache %s is corrupted, the model will be reimported.\n", cache_filepath.generic_string().c_str());
+            return false;
+        }
+
+        LoadTextures(texture_references);
+        CreateBuffers(vertex_data);
+
+        return true;
+    }
+
+    bool StaticModel::SaveMeshCache(const std::filesystem::path& cache_filepath, uint64_t source_hash, const VertexData& vertex_data, const std::vector<TextureReference>& texture_references) const
+    {
+        BinaryCacheWriter writer(MESH_CACHE_MAGIC, MESH_CACHE_VERSION, source_hash, GetMeshCacheKey());
+
+        /* Mesh parts */
+        writer.Write(m_unit_scale);
+        writer.WriteArray(m_mesh_parts);
+
+        /* Vertex data */
+        writer.WriteArray(vertex_data.positions);
+        writer.WriteArray(vertex_data.texcoords);
+        writer.WriteArray(vertex_data.normals);
+        writer.WriteArray(vertex_data.tangents);
+        writer.WriteArray(vertex_data.indices);
+
+        /* Materials */
+        writer.Write(uint32_t(m_materials.size()));
+
+        for (auto& material : m_materials)
+        {
+            writer.Write(uint32_t(material->m_vec3_map.size()));
+            for (auto& [uniform_name, value] : material->m_vec3_map)
+            {
+                writer.WriteString(uniform_name);
+                writer.Write(value);
+            }
+
+            writer.Write(uint32_t(material->m_float_map.size()));
+            for (auto& [uniform_name, value] : material->m_float_map)
+            {
+                writer.WriteString(uniform_name);
+                writer.Write(value);
+            }
+
+            writer.Write(uint32_t(material->m_bool_map.size()));
+            for (auto& [uniform_name, value] : material->m_bool_map)
+            {
+                writer.WriteString(uniform_name);
+                writer.Write(uint8_t(value));
+            }
+        }
+
+        /* Textures */
+        writer.Write(uint32_t(texture_references.size()));
+
+        for (auto& texture_reference : texture_references)
+        {
+            writer.Write(texture_reference.material_index);
+            writer.Write(uint32_t(texture_reference.texture_type));
+            writer.Write(uint8_t(texture_reference.is_srgb));
+            writer.Write(uint8_t(texture_reference.repeat));
+            writer.WriteString(texture_reference.path);
+            writer.WriteArray(texture_reference.embedded_data);
+        }
+
+        return writer.Save(cache_filepath);
+    }
+
+    uint64_t StaticModel::GetMeshCacheKey() const
+    {
+        return uint64_t(IMPORTER_FLAGS) | (uint64_t(m_mesh_optimization_enabled) << 32);
+    }
+
+    uint64_t StaticModel::HashModelSource(const std::filesystem::path& filepath)
+    {
+        uint64_t hash = BinaryCache::HashFile(filepath);
+
+        if (hash == 0)
+        {
+            return 0;
+        }
+
+        /* Include the companion files that hold the model's data, e.g. *.bin for glTF or *.mtl for Wavefront OBJ. */
+        for (auto& extension : { ".bin", ".mtl" })
+        {
+            auto companion_filepath = filepath;
+            companion_filepath.replace_extension(extension);
+
+            if (companion_filepath != filepath && std::filesystem::exists(companion_filepath))
+            {
+                hash = BinaryCache::HashFile(companion_filepath, hash);
+            }
+        }
+
+        return hash;
+    }
+
+    void StaticModel::CreateBuffers(const VertexDataView& vertex_data)
+    {
+        if (m_vertex_format != VertexFormat::SEPARATE)
+        {
+            CreateInterleavedBuffers(vertex_data);
+            return;
+        }
+
+        for (auto& mesh_part : m_mesh_parts)
+        {
+            mesh_part.m_index_type   = GL_UNSIGNED_INT;
+            mesh_part.m_index_offset = sizeof(uint32_t) * mesh_part.m_base_index;
+        }
+
+        bool has_tangents = !vertex_data.tangents.empty();
+
+        const GLsizei positions_size_bytes = vertex_data.positions.size() * sizeof(vertex_data.positions[0]);
+        const GLsizei texcoords_size_bytes = vertex_data.texcoords.size() * sizeof(vertex_data.texcoords[0]);
+        const GLsizei normals_size_bytes   = vertex_data.normals  .size() * sizeof(vertex_data.normals  [0]);
+        const GLsizei tangents_size_bytes  = has_tangents ? vertex_data.tangents .size() * sizeof(vertex_data.tangents [0]) : 0;
+        const GLsizei total_size_bytes     = positions_size_bytes + texcoords_size_bytes + normals_size_bytes + tangents_size_bytes;
+
+        glCreateBuffers     (1, &m_vbo_name);
+        glNamedBufferStorage(m_vbo_name, total_size_bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+        uint64_t offset = 0;
+        glNamedBufferSubData(m_vbo_name, offset, positions_size_bytes, vertex_data.positions.data());
+
+        offset += positions_size_bytes;
+        glNamedBufferSubData(m_vbo_name, offset, texcoords_size_bytes, vertex_data.texcoords.data());
+
+        offset += texcoords_size_bytes;
+        glNamedBufferSubData(m_vbo_name, offset, normals_size_bytes, vertex_data.normals.data());
+
+        if(has_tangents)
+        {
+            offset += normals_size_bytes;
+            glNamedBufferSubData(m_vbo_name, offset, tangents_size_bytes, vertex_data.tangents.data());
+        }
+
+        glCreateBuffers     (1, &m_ibo_name);
+        glNamedBufferStorage(m_ibo_name, sizeof(vertex_data.indices[0]) * vertex_data.indices.size(), vertex_data.indices.data(), GL_DYNAMIC_STORAGE_BIT);
+
+        glCreateVertexArrays(1, &m_vao_name);
+
+        offset = 0;
+        glVertexArrayVertexBuffer(m_vao_name, 0 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.positions[0]) /*stride*/);
+                          
+        offset += positions_size_bytes;
+        glVertexArrayVertexBuffer(m_vao_name, 1 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.texcoords[0]) /*stride*/);
+        
+        offset += texcoords_size_bytes;
+        glVertexArrayVertexBuffer(m_vao_name, 2 /* bindingindex*/, m_vbo_name,  offset, sizeof(vertex_data.normals[0]) /*stride*/);
+
+        if (has_tangents)
+        {
+            offset += normals_size_bytes;
+            glVertexArrayVertexBuffer(m_vao_name, 3 /* bindingindex*/, m_vbo_name, offset, sizeof(vertex_data.tangents[0]) /*stride*/);
+        }
+
+        glVertexArrayElementBuffer(m_vao_name, m_ibo_name);
+
+                          glEnableVertexArrayAttrib(m_vao_name, 0 /*attribindex*/); // positions
+                          glEnableVertexArrayAttrib(m_vao_name, 1 /*attribindex*/); // texcoords
+                          glEnableVertexArrayAttrib(m_vao_name, 2 /*attribindex*/); // normals
+        if (has_tangents) glEnableVertexArrayAttrib(m_vao_name, 3 /*attribindex*/); // tangents
+
+                          glVertexArrayAttribFormat(m_vao_name, 0 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
+                          glVertexArrayAttribFormat(m_vao_name, 1 /*attribindex */, 2 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
+                          glVertexArrayAttribFormat(m_vao_name, 2 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/); 
+        if (has_tangents) glVertexArrayAttribFormat(m_vao_name, 3 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, 0 /*relativeoffset*/);
 
                           glVertexArrayAttribBinding(m_vao_name, 0 /*attribindex*/, 0 /*bindingindex*/); // positions
                           glVertexArrayAttribBinding(m_vao_name, 1 /*attribindex*/, 1 /*bindingindex*/); // texcoords
@@ -432,6 +1013,367 @@ namespace RGL
         if (has_tangents) glVertexArrayAttribBinding(m_vao_name, 3 /*attribindex*/, 3 /*bindingindex*/); // tangents
     }
 
+    void StaticModel::CreateInterleavedBuffers(const VertexDataView& vertex_data)
+    {
+        const bool   is_compact     = m_vertex_format == VertexFormat::COMPACT;
+        const bool   has_tangents   = !vertex_data.tangents.empty();
+        const size_t vertices_count = vertex_data.positions.size();
+
+        /* Vertices */
+        glCreateBuffers(1, &m_vbo_name);
+
+        if (is_compact)
+        {
+            std::vector<CompactVertex> vertices(vertices_count);
+
+            for (size_t i = 0; i < vertices_count; ++i)
+            {
+                vertices[i].m_position = vertex_data.positions[i];
+                vertices[i].m_normal   = glm::packSnorm3x10_1x2(glm::vec4(vertex_data.normals[i], 0.0f));
+                vertices[i].m_texcoord = glm::packHalf2x16(vertex_data.texcoords[i]);
+                vertices[i].m_tangent  = has_tangents ? glm::packSnorm3x10_1x2(glm::vec4(vertex_data.tangents[i], 0.0f)) : 0;
+            }
+
+            glNamedBufferStorage(m_vbo_name, sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        }
+        else
+        {
+            std::vector<Vertex> vertices(vertices_count);
+
+            for (size_t i = 0; i < vertices_count; ++i)
+            {
+                vertices[i].m_position = vertex_data.positions[i];
+                vertices[i].m_normal   = vertex_data.normals[i];
+                vertices[i].m_texcoord = vertex_data.texcoords[i];
+                vertices[i].m_tangent  = has_tangents ? vertex_data.tangents[i] : glm::vec3(0.0f);
+            }
+
+            glNamedBufferStorage(m_vbo_name, sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        }
+
+        /* Indices, 16-bit ones are used only by the compact format. Every part starts at a 4-byte aligned offset. */
+        std::vector<unsigned char> indices;
+        indices.reserve(sizeof(uint32_t) * vertex_data.indices.size());
+
+        for (auto& mesh_part : m_mesh_parts)
+        {
+            auto part_indices = vertex_data.indices.subspan(mesh_part.m_base_index, mesh_part.m_indices_count);
+            bool use_16bit    = is_compact && !part_indices.empty() && *std::max_element(part_indices.begin(), part_indices.end()) <= 0xffff;
+
+            indices.resize((indices.size() + 3) & ~size_t(3));
+
+            mesh_part.m_index_type   = use_16bit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            mesh_part.m_index_offset = uint32_t(indices.size());
+
+            if (use_16bit)
+            {
+                for (auto index : part_indices)
+                {
+                    uint16_t index16 = uint16_t(index);
+                    indices.insert(indices.end(), reinterpret_cast<unsigned char*>(&index16), reinterpret_cast<unsigned char*>(&index16) + sizeof(index16));
+                }
+            }
+            else
+            {
+                auto bytes = std::as_bytes(part_indices);
+                indices.insert(indices.end(), reinterpret_cast<const unsigned char*>(bytes.data()), reinterpret_cast<const unsigned char*>(bytes.data()) + bytes.size());
+            }
+        }
+
+        glCreateBuffers     (1, &m_ibo_name);
+        glNamedBufferStorage(m_ibo_name, indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+
+        /* Vertex array */
+        const GLsizei stride = is_compact ? sizeof(CompactVertex) : sizeof(Vertex);
+
+        glCreateVertexArrays      (1, &m_vao_name);
+        glVertexArrayVertexBuffer (m_vao_name, 0 /* bindingindex*/, m_vbo_name, 0 /* offset */, stride);
+        glVertexArrayElementBuffer(m_vao_name, m_ibo_name);
+
+                          glEnableVertexArrayAttrib(m_vao_name, 0 /*attribindex*/); // positions
+                          glEnableVertexArrayAttrib(m_vao_name, 1 /*attribindex*/); // texcoords
+                          glEnableVertexArrayAttrib(m_vao_name, 2 /*attribindex*/); // normals
+        if (has_tangents) glEnableVertexArrayAttrib(m_vao_name, 3 /*attribindex*/); // tangents
+
+        if (is_compact)
+        {
+                              glVertexArrayAttribFormat(m_vao_name, 0 /*attribindex */, 3 /* size */, GL_FLOAT,              GL_FALSE, offsetof(CompactVertex, m_position));
+                              glVertexArrayAttribFormat(m_vao_name, 1 /*attribindex */, 2 /* size */, GL_HALF_FLOAT,         GL_FALSE, offsetof(CompactVertex, m_texcoord));
+                              glVertexArrayAttribFormat(m_vao_name, 2 /*attribindex */, 4 /* size */, GL_INT_2_10_10_10_REV, GL_TRUE,  offsetof(CompactVertex, m_normal));
+            if (has_tangents) glVertexArrayAttribFormat(m_vao_name, 3 /*attribindex */, 4 /* size */, GL_INT_2_10_10_10_REV, GL_TRUE,  offsetof(CompactVertex, m_tangent));
+        }
+        else
+        {
+                              glVertexArrayAttribFormat(m_vao_name, 0 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_position));
+                              glVertexArrayAttribFormat(m_vao_name, 1 /*attribindex */, 2 /* size */, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_texcoord));
+                              glVertexArrayAttribFormat(m_vao_name, 2 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_normal));
+            if (has_tangents) glVertexArrayAttribFormat(m_vao_name, 3 /*attribindex */, 3 /* size */, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_tangent));
+        }
+
+                          glVertexArrayAttribBinding(m_vao_name, 0 /*attribindex*/, 0 /*bindingindex*/); // positions
+                          glVertexArrayAttribBinding(m_vao_name, 1 /*attribindex*/, 0 /*bindingindex*/); // texcoords
+                          glVertexArrayAttribBinding(m_vao_name, 2 /*attribindex*/, 0 /*bindingindex*/); // normals
+        if (has_tangents) glVertexArrayAttribBinding(m_vao_name, 3 /*attribindex*/, 0 /*bindingindex*/); // tangents
+    }
+
+    void StaticModel::CreateIndirectBuffers()
+    {
+        static const std::string has_texture_flag_names[Material::TEXTURE_TYPES_COUNT] =
+        {
+            "u_has_albedo_map", "u_has_normal_map", "u_has_metallic_map", "u_has_roughness_map", "u_has_ao_map", "u_has_emissive_map"
+        };
+
+        ReleaseIndirectBuffers();
+
+        /* Materials, the last one is used by the mesh parts without any material. */
+        auto default_material = std::make_shared<Material>();
+
+        std::vector<MaterialGPUData> materials_data(m_materials.size() + 1);
+
+        for (size_t i = 0; i < materials_data.size(); ++i)
+        {
+            auto& material      = i < m_materials.size() ? m_materials[i] : default_material;
+            auto& material_data = materials_data[i];
+
+            material_data.albedo        = glm::vec4(material->GetVector3("u_albedo"),   1.0f);
+            material_data.emission      = glm::vec4(material->GetVector3("u_emission"), 1.0f);
+            material_data.metallic      = material->GetFloat("u_metallic");
+            material_data.roughness     = material->GetFloat("u_roughness");
+            material_data.ao            = material->GetFloat("u_ao");
+            material_data.texture_flags = 0;
+
+            for (uint32_t t = 0; t < Material::TEXTURE_TYPES_COUNT; ++t)
+            {
+                auto texture = material->m_texture_map.find(Material::TextureType(t));
+
+                material_data.texture_handles[t] = texture != material->m_texture_map.end() ? texture->second->GetBindlessHandle() : 0;
+                material_data.texture_flags     |= material->GetBool(has_texture_flag_names[t]) ? 1u << t : 0u;
+            }
+        }
+
+        /* Draw commands, grouped by the index type as glMultiDrawElementsIndirect() accepts only one. */
+        GLint ssbo_offset_alignment;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssbo_offset_alignment);
+
+        const size_t draw_materials_alignment = std::max<size_t>(1, ssbo_offset_alignment / sizeof(uint32_t));
+
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<uint32_t>                    draw_materials;
+        std::vector<IndirectDrawInfo>            draw_infos;
+
+        commands  .reserve(m_mesh_parts.size());
+        draw_infos.reserve(m_mesh_parts.size());
+
+        for (GLenum index_type : { GL_UNSIGNED_INT, GL_UNSIGNED_SHORT })
+        {
+            const uint32_t index_size = index_type == GL_UNSIGNED_INT ? sizeof(uint32_t) : sizeof(uint16_t);
+
+            IndirectBatch batch = { index_type, 0, commands.size() * sizeof(DrawElementsIndirectCommand), draw_materials.size() * sizeof(uint32_t) };
+
+            for (auto& mesh_part : m_mesh_parts)
+            {
+                if (mesh_part.m_index_type != index_type)
+                {
+                    continue;
+                }
+
+                const uint32_t material_index = mesh_part.m_material_index < m_materials.size() ? mesh_part.m_material_index : uint32_t(m_materials.size());
+
+                draw_infos.push_back({ mesh_part.m_bounding_sphere,
+                                       material_index,
+                                       uint32_t(m_indirect_batches.size()),
+                                       uint32_t(batch.commands_offset       / sizeof(DrawElementsIndirectCommand)),
+                                       uint32_t(batch.draw_materials_offset / sizeof(uint32_t)) });
+
+                commands.push_back({ mesh_part.m_indices_count, 1, mesh_part.m_index_offset / index_size, int32_t(mesh_part.m_base_vertex), 0 });
+                draw_materials.push_back(material_index);
+
+                batch.draws_count++;
+            }
+
+            if (batch.draws_count > 0)
+            {
+                m_indirect_batches.push_back(batch);
+                draw_materials.resize((draw_materials.size() + draw_materials_alignment - 1) / draw_materials_alignment * draw_materials_alignment, 0);
+            }
+        }
+
+        glCreateBuffers     (1, &m_draw_indirect_buffer_name);
+        glNamedBufferStorage(m_draw_indirect_buffer_name, std::max<size_t>(1, commands.size()) * sizeof(commands[0]), commands.data(), 0 /* flags */);
+
+        glCreateBuffers     (1, &m_materials_ssbo_name);
+        glNamedBufferStorage(m_materials_ssbo_name, materials_data.size() * sizeof(materials_data[0]), materials_data.data(), 0 /* flags */);
+
+        glCreateBuffers     (1, &m_draw_materials_ssbo_name);
+        glNamedBufferStorage(m_draw_materials_ssbo_name, std::max<size_t>(1, draw_materials.size()) * sizeof(draw_materials[0]), draw_materials.data(), 0 /* flags */);
+
+        /* GPU culling, the culled buffers have the same layout as the source ones and are filled by the culling shader. */
+        glCreateBuffers     (1, &m_draw_infos_ssbo_name);
+        glNamedBufferStorage(m_draw_infos_ssbo_name, std::max<size_t>(1, draw_infos.size()) * sizeof(draw_infos[0]), draw_infos.data(), 0 /* flags */);
+
+        glCreateBuffers     (1, &m_culled_commands_buffer_name);
+        glNamedBufferStorage(m_culled_commands_buffer_name, std::max<size_t>(1, commands.size()) * sizeof(commands[0]), nullptr, 0 /* flags */);
+
+        glCreateBuffers     (1, &m_culled_draw_materials_ssbo_name);
+        glNamedBufferStorage(m_culled_draw_materials_ssbo_name, std::max<size_t>(1, draw_materials.size()) * sizeof(draw_materials[0]), nullptr, 0 /* flags */);
+
+        glCreateBuffers     (1, &m_draw_counts_buffer_name);
+        glNamedBufferStorage(m_draw_counts_buffer_name, std::max<size_t>(1, m_indirect_batches.size()) * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    void StaticModel::ReleaseIndirectBuffers()
+    {
+        glDeleteBuffers(1, &m_draw_indirect_buffer_name);
+        m_draw_indirect_buffer_name = 0;
+
+        glDeleteBuffers(1, &m_materials_ssbo_name);
+        m_materials_ssbo_name = 0;
+
+        glDeleteBuffers(1, &m_draw_materials_ssbo_name);
+        m_draw_materials_ssbo_name = 0;
+
+        glDeleteBuffers(1, &m_draw_infos_ssbo_name);
+        m_draw_infos_ssbo_name = 0;
+
+        glDeleteBuffers(1, &m_culled_commands_buffer_name);
+        m_culled_commands_buffer_name = 0;
+
+        glDeleteBuffers(1, &m_culled_draw_materials_ssbo_name);
+        m_culled_draw_materials_ssbo_name = 0;
+
+        glDeleteBuffers(1, &m_draw_counts_buffer_name);
+        m_draw_counts_buffer_name = 0;
+
+        m_indirect_batches.clear();
+    }
+
+    glm::vec4 StaticModel::CalcBoundingSphere(std::span<const glm::vec3> positions, const glm::vec3& aabb_min, const glm::vec3& aabb_max)
+    {
+        const glm::vec3 center = 0.5f * (aabb_min + aabb_max);
+
+        float radius_squared = 0.0f;
+
+        for (auto& position : positions)
+        {
+            radius_squared = std::max(radius_squared, glm::dot(position - center, position - center));
+        }
+
+        return glm::vec4(center, std::sqrt(radius_squared));
+    }
+
+    void StaticModel::CalcBounds(MeshPart& mesh_part, std::span<const glm::vec3> positions)
+    {
+        mesh_part.m_aabb_min = glm::vec3( std::numeric_limits<float>::max());
+        mesh_part.m_aabb_max = glm::vec3(-std::numeric_limits<float>::max());
+
+        for (auto& position : positions)
+        {
+            mesh_part.m_aabb_min = glm::min(mesh_part.m_aabb_min, position);
+            mesh_part.m_aabb_max = glm::max(mesh_part.m_aabb_max, position);
+        }
+
+        mesh_part.m_bounding_sphere = CalcBoundingSphere(positions, mesh_part.m_aabb_min, mesh_part.m_aabb_max);
+    }
+
+    void StaticModel::FrustumCull(std::span<const glm::mat4> view_projections)
+    {
+        const size_t parts_count = m_mesh_parts.size();
+
+        if (m_culling_bounds.radius.empty() && parts_count > 0)
+        {
+            const size_t padded_count = (parts_count + 3) & ~size_t(3);
+
+            /* The padding spheres have a negative radius and are never visible. */
+            m_culling_bounds.center_x.assign(padded_count,  0.0f);
+            m_culling_bounds.center_y.assign(padded_count,  0.0f);
+            m_culling_bounds.center_z.assign(padded_count,  0.0f);
+            m_culling_bounds.radius  .assign(padded_count, -1.0f);
+
+            for (size_t i = 0; i < parts_count; ++i)
+            {
+                m_culling_bounds.center_x[i] = m_mesh_parts[i].m_bounding_sphere.x;
+                m_culling_bounds.center_y[i] = m_mesh_parts[i].m_bounding_sphere.y;
+                m_culling_bounds.center_z[i] = m_mesh_parts[i].m_bounding_sphere.z;
+                m_culling_bounds.radius  [i] = m_mesh_parts[i].m_bounding_sphere.w;
+            }
+        }
+
+        m_parts_visibility.assign(m_culling_bounds.radius.size(), 0);
+
+        for (auto& view_projection : view_projections)
+        {
+            /* Gribb-Hartmann plane extraction, the planes point inwards. */
+            const glm::vec4 row0 = glm::row(view_projection, 0);
+            const glm::vec4 row1 = glm::row(view_projection, 1);
+            const glm::vec4 row2 = glm::row(view_projection, 2);
+            const glm::vec4 row3 = glm::row(view_projection, 3);
+
+            glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+
+            for (auto& plane : planes)
+            {
+                plane /= glm::length(glm::vec3(plane));
+            }
+
+            /* A sphere is visible if it's not entirely behind any of the planes. Four spheres are tested at once. */
+            for (size_t i = 0; i < m_culling_bounds.radius.size(); i += 4)
+            {
+#ifdef RGL_SSE
+                const __m128 center_x = _mm_loadu_ps(&m_culling_bounds.center_x[i]);
+                const __m128 center_y = _mm_loadu_ps(&m_culling_bounds.center_y[i]);
+                const __m128 center_z = _mm_loadu_ps(&m_culling_bounds.center_z[i]);
+                const __m128 radius   = _mm_loadu_ps(&m_culling_bounds.radius  [i]);
+
+                const __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+                /* Zero or positive radius, so that the padding spheres fail the test. */
+                __m128 is_visible = _mm_cmpge_ps(radius, _mm_setzero_ps());
+
+                for (auto& plane : planes)
+                {
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+                    distance        = _mm_add_ps(_mm_mul_ps(center_y, _mm_set1_ps(plane.y)), distance);
+                    distance        = _mm_add_ps(_mm_mul_ps(center_z, _mm_set1_ps(plane.z)), distance);
+
+                    is_visible = _mm_and_ps(is_visible, _mm_cmpgt_ps(distance, negative_radius));
+                }
+
+                const int visibility_mask = _mm_movemask_ps(is_visible);
+#else
+                int visibility_mask = 0;
+
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    const glm::vec4 sphere(m_culling_bounds.center_x[i + k], m_culling_bounds.center_y[i + k], m_culling_bounds.center_z[i + k], m_culling_bounds.radius[i + k]);
+
+                    bool is_visible = sphere.w >= 0.0f;
+
+                    for (auto& plane : planes)
+                    {
+                        is_visible &= glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w > -sphere.w;
+                    }
+
+                    visibility_mask |= int(is_visible) << k;
+                }
+#endif
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    m_parts_visibility[i + k] |= (visibility_mask >> k) & 1;
+                }
+            }
+        }
+    }
+
+    uint32_t StaticModel::GetBytesPerVertex(VertexFormat format)
+    {
+        switch (format)
+        {
+            case VertexFormat::COMPACT:     return sizeof(CompactVertex);
+            case VertexFormat::INTERLEAVED: return sizeof(Vertex);
+            default:                        return 2 * sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3);
+        }
+    }
+
     /* The first available input attribute index is 4. */
     void StaticModel::AddAttributeBuffer(GLuint attrib_index, GLuint binding_index, GLint format_size, GLenum data_type, GLuint buffer_id, GLsizei stride, GLuint divisor)
     {
@@ -449,6 +1391,9 @@ namespace RGL
     {
         assert(mesh_id < m_mesh_parts.size());
 
+        /* The indirect buffers are rebuilt with the new texture on the next RenderIndirect() call. */
+        ReleaseIndirectBuffers();
+
         /* If the mesh part doesn't have any material assigned, add the new one. */
         if (m_mesh_parts[mesh_id].m_material_index == INVALID_MATERIAL)
         {
@@ -514,14 +1459,17 @@ namespace RGL
             CalcTangentSpace(vertex_data);
         }
 
-        CreateBuffers(vertex_data);
-        
         MeshPart mesh_part;
         mesh_part.m_base_index   = 0;
         mesh_part.m_base_vertex  = 0;
         mesh_part.m_indices_count = vertex_data.indices.size();
 
+        CalcBounds(mesh_part, vertex_data.positions);
+
         m_mesh_parts.push_back(mesh_part);
+
+        /* Mesh parts have to be known, as the index format is chosen per part. */
+        CreateBuffers(vertex_data);
     }
 
     void StaticModel::GenCone(float height, float radius, uint32_t slices, uint32_t stacks)
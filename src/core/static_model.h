@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <span>
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -25,6 +26,77 @@ namespace RGL
         std::vector<uint32_t>  indices;
     };
 
+    /* Non-owning view of the vertex streams, e.g. of the VertexData or of the data stored in the mesh cache. */
+    struct VertexDataView
+    {
+        VertexDataView() = default;
+        VertexDataView(const VertexData& vertex_data)
+            : positions(vertex_data.positions),
+              texcoords(vertex_data.texcoords),
+              normals  (vertex_data.normals),
+              tangents (vertex_data.tangents),
+              indices  (vertex_data.indices)
+        {}
+
+        std::span<const glm::vec3> positions;
+        std::span<const glm::vec2> texcoords;
+        std::span<const glm::vec3> normals;
+        std::span<const glm::vec3> tangents;
+        std::span<const uint32_t>  indices;
+    };
+
+    /* Texture referenced by the model's material, loaded after the mesh data has been imported. */
+    struct TextureReference
+    {
+        uint32_t                       material_index;
+        Material::TextureType          texture_type;
+        std::string                    path;          /* Full path to the file or the embedded texture's name. */
+        std::span<const unsigned char> embedded_data; /* Compressed image data if the texture is embedded. */
+        bool                           is_srgb;
+        bool                           repeat;
+    };
+
+    /* Material parameters read by the shaders in StaticModel::RenderIndirect(), std430 layout. */
+    struct MaterialGPUData
+    {
+        uint64_t  texture_handles[Material::TEXTURE_TYPES_COUNT]; /* Bindless handles indexed by Material::TextureType, 0 if there's no texture. */
+        glm::vec4 albedo;
+        glm::vec4 emission;
+        float     metallic;
+        float     roughness;
+        float     ao;
+        uint32_t  texture_flags;                                  /* Bit i is set if the u_has_*_map flag of the texture type i is set. */
+    };
+
+    static_assert(sizeof(MaterialGPUData) == 96);
+
+    struct DrawElementsIndirectCommand
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t  base_vertex;
+        uint32_t base_instance;
+    };
+
+    /* Per command input of the GPU culling shaders, see StaticModel::BindIndirectCullingBuffers(), std430 layout. */
+    struct IndirectDrawInfo
+    {
+        glm::vec4 bounding_sphere;     /* Model space center and radius of the mesh part. */
+        uint32_t  material_index;
+        uint32_t  batch_index;         /* Index of the batch's counter in the draw counts buffer. */
+        uint32_t  first_command;       /* The visible commands of the batch are appended starting at this index... */
+        uint32_t  first_draw_material; /* ...and their material indices starting at this one. */
+    };
+
+    static_assert(sizeof(IndirectDrawInfo) == 32);
+
+    struct RenderStats
+    {
+        uint32_t submitted_parts = 0;
+        uint32_t culled_parts    = 0;
+    };
+
     enum class DrawMode { POINTS         = GL_POINTS, 
                           LINES          = GL_LINES, 
                           TRIANGLES      = GL_TRIANGLES, 
@@ -39,7 +111,18 @@ namespace RGL
               m_vao_name  (0),
               m_vbo_name  (0),
               m_ibo_name  (0),
-              m_draw_mode (DrawMode::TRIANGLES)
+              m_draw_indirect_buffer_name(0),
+              m_materials_ssbo_name      (0),
+              m_draw_materials_ssbo_name (0),
+              m_draw_infos_ssbo_name     (0),
+              m_culled_commands_buffer_name    (0),
+              m_culled_draw_materials_ssbo_name(0),
+              m_draw_counts_buffer_name        (0),
+              m_draw_mode (DrawMode::TRIANGLES),
+              m_mesh_cache_enabled(true),
+              m_mesh_optimization_enabled(true),
+              m_parallel_texture_loading(true),
+              m_vertex_format(VertexFormat::SEPARATE)
         {
         }
 
@@ -55,12 +138,33 @@ namespace RGL
               m_vao_name  (other.m_vao_name),
               m_vbo_name  (other.m_vbo_name),
               m_ibo_name  (other.m_ibo_name),
-              m_draw_mode (other.m_draw_mode)
+              m_draw_indirect_buffer_name(other.m_draw_indirect_buffer_name),
+              m_materials_ssbo_name      (other.m_materials_ssbo_name),
+              m_draw_materials_ssbo_name (other.m_draw_materials_ssbo_name),
+              m_draw_infos_ssbo_name     (other.m_draw_infos_ssbo_name),
+              m_culled_commands_buffer_name    (other.m_culled_commands_buffer_name),
+              m_culled_draw_materials_ssbo_name(other.m_culled_draw_materials_ssbo_name),
+              m_draw_counts_buffer_name        (other.m_draw_counts_buffer_name),
+              m_indirect_batches         (std::move(other.m_indirect_batches)),
+              m_culling_bounds           (std::move(other.m_culling_bounds)),
+              m_parts_visibility         (std::move(other.m_parts_visibility)),
+              m_draw_mode (other.m_draw_mode),
+              m_mesh_cache_enabled(other.m_mesh_cache_enabled),
+              m_mesh_optimization_enabled(other.m_mesh_optimization_enabled),
+              m_parallel_texture_loading(other.m_parallel_texture_loading),
+              m_vertex_format(other.m_vertex_format)
         {
             other.m_unit_scale = 1;
             other.m_vao_name   = 0;
             other.m_vbo_name   = 0;
             other.m_ibo_name   = 0;
+            other.m_draw_indirect_buffer_name = 0;
+            other.m_materials_ssbo_name       = 0;
+            other.m_draw_materials_ssbo_name  = 0;
+            other.m_draw_infos_ssbo_name      = 0;
+            other.m_culled_commands_buffer_name     = 0;
+            other.m_culled_draw_materials_ssbo_name = 0;
+            other.m_draw_counts_buffer_name         = 0;
             other.m_draw_mode  = DrawMode::TRIANGLES;
         }
 
@@ -76,7 +180,21 @@ namespace RGL
                 std::swap(m_vao_name,   other.m_vao_name);
                 std::swap(m_vbo_name,   other.m_vbo_name);
                 std::swap(m_ibo_name,   other.m_ibo_name);
+                std::swap(m_draw_indirect_buffer_name, other.m_draw_indirect_buffer_name);
+                std::swap(m_materials_ssbo_name,       other.m_materials_ssbo_name);
+                std::swap(m_draw_materials_ssbo_name,  other.m_draw_materials_ssbo_name);
+                std::swap(m_draw_infos_ssbo_name,      other.m_draw_infos_ssbo_name);
+                std::swap(m_culled_commands_buffer_name,     other.m_culled_commands_buffer_name);
+                std::swap(m_culled_draw_materials_ssbo_name, other.m_culled_draw_materials_ssbo_name);
+                std::swap(m_draw_counts_buffer_name,         other.m_draw_counts_buffer_name);
+                std::swap(m_indirect_batches,          other.m_indirect_batches);
+                std::swap(m_culling_bounds,            other.m_culling_bounds);
+                std::swap(m_parts_visibility,          other.m_parts_visibility);
                 std::swap(m_draw_mode,  other.m_draw_mode);
+                std::swap(m_mesh_cache_enabled, other.m_mesh_cache_enabled);
+                std::swap(m_mesh_optimization_enabled, other.m_mesh_optimization_enabled);
+                std::swap(m_parallel_texture_loading, other.m_parallel_texture_loading);
+                std::swap(m_vertex_format, other.m_vertex_format);
             }
 
             return *this;
@@ -88,10 +206,53 @@ namespace RGL
         virtual void SetDrawMode(DrawMode mode) { m_draw_mode = mode; }
         virtual float GetUnitScaleFactor() const { return m_unit_scale; }
 
+        /* If enabled, Load() stores the imported data in a binary cache and reuses it on the next run. */
+        void EnableMeshCache(bool enable) { m_mesh_cache_enabled = enable; }
+
+        /* If enabled, Load() reorders the triangles and vertices of each mesh part for the vertex cache, overdraw and vertex fetch. */
+        void EnableMeshOptimization(bool enable) { m_mesh_optimization_enabled = enable; }
+
+        /* If enabled, the material textures are decoded on the worker threads and uploaded in one batch. */
+        void EnableParallelTextureLoading(bool enable) { m_parallel_texture_loading = enable; }
+
+        /* Layout of the vertex buffer created by the next Load() or Gen*() call.
+         * VertexFormat::COMPACT stores 10:10:10:2 normals and tangents, half float texcoords
+         * and 16-bit indices for the mesh parts that use less than 65536 vertices. */
+        void         SetVertexFormat(VertexFormat format) { m_vertex_format = format; }
+        VertexFormat GetVertexFormat() const { return m_vertex_format; }
+        static uint32_t GetBytesPerVertex(VertexFormat format);
+
         virtual bool Load(const std::filesystem::path& filepath);
         virtual void Render(uint32_t num_instances = 0);
         virtual void Render(std::shared_ptr<Shader> & shader, uint32_t num_instances = 0);
 
+        /* Frustum culled rendering. The frustum planes are extracted from view_projection, which has to include the model's transformation,
+         * i.e. projection * view * model, as the mesh parts' bounding spheres are tested in the model space. */
+        virtual void Render(const glm::mat4& view_projection, uint32_t num_instances = 0);
+        virtual void Render(const glm::mat4& view_projection, std::shared_ptr<Shader> & shader, uint32_t num_instances = 0);
+
+        /* Renders the mesh parts that are inside of any of the frusta, e.g. of the shadow cascades rendered in a single pass. */
+        virtual void Render(std::span<const glm::mat4> view_projections, uint32_t num_instances = 0);
+
+        /* Draws all of the mesh parts with a single glMultiDrawElementsIndirect() call per index type.
+         * The shaders read the parameters of the draw's material from the MaterialGPUData array bound at materials_binding_index,
+         * using the material index stored at index gl_DrawID of the uint array bound at draw_materials_binding_index.
+         * The material textures are passed as bindless handles, see Texture::IsBindlessSupported().
+         * The buffers are built on the first call from the current materials. */
+        virtual void RenderIndirect(GLuint materials_binding_index, GLuint draw_materials_binding_index);
+
+        /* GPU driven rendering. Binds the following SSBOs at consecutive indices starting at first_binding_index:
+         * the IndirectDrawInfo array, the DrawElementsIndirectCommand array of RenderIndirect(), the culled commands,
+         * the culled draw materials and the uint draw counts of the batches, which are reset to 0.
+         * A compute shader appends the visible commands with atomicAdd() on the batch's count, then RenderIndirectCount()
+         * draws them with glMultiDrawElementsIndirectCount(). Returns the number of commands the shader has to process. */
+        virtual uint32_t BindIndirectCullingBuffers(GLuint first_binding_index);
+        virtual void     RenderIndirectCount(GLuint materials_binding_index, GLuint draw_materials_binding_index);
+
+        /* Number of mesh parts submitted and culled by all of the models since the last ResetRenderStats() call. */
+        static RenderStats GetRenderStats()   { return m_render_stats; }
+        static void        ResetRenderStats() { m_render_stats = {}; }
+
         /* Primitives */
         virtual void GenCone       (float    height      = 3.0f, float radius         = 1.5f, uint32_t slices = 10, uint32_t stacks = 10);
         virtual void GenCube       (float    radius      = 1.0f, float texcoord_scale = 1.0f);
@@ -114,10 +275,31 @@ namespace RGL
         static inline glm::mat4 mat4_cast(const aiMatrix3x3& m)  { return glm::transpose(glm::make_mat3(&m.a1)); }
 
         virtual bool ParseScene(const aiScene* scene, const std::filesystem::path& filepath);
+        virtual bool ImportScene(const aiScene* scene, const std::filesystem::path& filepath, VertexData& vertex_data, std::vector<TextureReference>& texture_references);
         virtual void LoadMeshPart(const aiMesh* mesh, VertexData& vertex_data);
+        virtual void OptimizeMeshParts(VertexData& vertex_data);
         virtual bool LoadMaterials(const aiScene* scene, const std::filesystem::path& filepath);
-        virtual bool LoadMaterialTextures(const aiScene* scene, const aiMaterial* material, uint32_t material_index, aiTextureType type, Material::TextureType texture_type, const std::string& directory) const;
-        virtual void CreateBuffers(VertexData& vertex_data);
+        virtual void CollectMaterials(const aiScene* scene, const std::filesystem::path& filepath, std::vector<TextureReference>& texture_references);
+        virtual void LoadMaterialTextures(const aiScene* scene, const aiMaterial* material, uint32_t material_index, aiTextureType type, Material::TextureType texture_type, const std::string& directory, std::vector<TextureReference>& texture_references) const;
+        virtual void LoadTextures(const std::vector<TextureReference>& texture_references);
+        std::vector<std::shared_ptr<Texture2D>> LoadTexturesSerial  (const std::vector<TextureReference>& texture_references) const;
+        std::vector<std::shared_ptr<Texture2D>> LoadTexturesParallel(const std::vector<TextureReference>& texture_references) const;
+        virtual void CreateBuffers(const VertexDataView& vertex_data);
+        void RenderMeshParts(Shader* shader, uint32_t num_instances, const std::vector<uint8_t>* visibility);
+
+        /* Frustum culling */
+        static glm::vec4 CalcBoundingSphere(std::span<const glm::vec3> positions, const glm::vec3& aabb_min, const glm::vec3& aabb_max);
+        void CalcBounds(MeshPart& mesh_part, std::span<const glm::vec3> positions);
+        void FrustumCull(std::span<const glm::mat4> view_projections);
+        void CreateIndirectBuffers();
+        void ReleaseIndirectBuffers();
+        void CreateInterleavedBuffers(const VertexDataView& vertex_data);
+
+        /* Mesh cache */
+        bool LoadMeshCache(const std::filesystem::path& cache_filepath, uint64_t source_hash);
+        bool SaveMeshCache(const std::filesystem::path& cache_filepath, uint64_t source_hash, const VertexData& vertex_data, const std::vector<TextureReference>& texture_references) const;
+        uint64_t GetMeshCacheKey() const;
+        static uint64_t HashModelSource(const std::filesystem::path& filepath);
 
         virtual void CalcTangentSpace(VertexData& vertex_data);
         virtual void GenPrimitive(VertexData& vertex_data, bool generate_tangents = true);
@@ -126,6 +308,10 @@ namespace RGL
         {
             m_unit_scale = 1.0;
 
+            ReleaseIndirectBuffers();
+
+            m_culling_bounds = {};
+
             glDeleteBuffers(1, &m_vbo_name);
             m_vbo_name = 0;
 
@@ -141,6 +327,17 @@ namespace RGL
             m_materials.clear();
         }
 
+        /* Commands of RenderIndirect() that share the index type, the draw materials are bound with glBindBufferRange() so that gl_DrawID starts at 0. */
+        struct IndirectBatch
+        {
+            GLenum   index_type;
+            uint32_t draws_count;
+            uint64_t commands_offset;       /* In bytes */
+            uint64_t draw_materials_offset; /* In bytes */
+        };
+
+        uint32_t GetIndirectDrawsCount() const;
+
         std::vector<MeshPart> m_mesh_parts;
         std::vector<std::shared_ptr<Material>> m_materials;
 
@@ -148,6 +345,35 @@ namespace RGL
         GLuint   m_vao_name;
         GLuint   m_vbo_name;
         GLuint   m_ibo_name;
+        GLuint   m_draw_indirect_buffer_name;
+        GLuint   m_materials_ssbo_name;
+        GLuint   m_draw_materials_ssbo_name;
+        GLuint   m_draw_infos_ssbo_name;
+        GLuint   m_culled_commands_buffer_name;
+        GLuint   m_culled_draw_materials_ssbo_name;
+        GLuint   m_draw_counts_buffer_name;
+
+        std::vector<IndirectBatch> m_indirect_batches;
+
+        /* Bounding spheres of the mesh parts in the SoA layout, padded to a multiple of 4, built on the first culled Render() call. */
+        struct CullingBounds
+        {
+            std::vector<float> center_x;
+            std::vector<float> center_y;
+            std::vector<float> center_z;
+            std::vector<float> radius;
+        };
+
+        CullingBounds        m_culling_bounds;
+        std::vector<uint8_t> m_parts_visibility;
+
+        inline static RenderStats m_render_stats;
+
         DrawMode m_draw_mode;
+        bool     m_mesh_cache_enabled;
+        bool     m_mesh_optimization_enabled;
+        bool     m_parallel_texture_loading;
+
+        VertexFormat m_vertex_format;
     };
 }
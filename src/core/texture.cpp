@@ -1,7 +1,10 @@
 #include "texture.h"
+#include "window.h"
 
 #include <glm/glm.hpp>
 
+#include <cstring>
+
 #define TINYDDSLOADER_IMPLEMENTATION
 #include <tinyddsloader.h>
 
@@ -23,6 +26,14 @@ namespace
         GLSwizzle m_swizzle;
     };
 
+    /* GL_ARB_bindless_texture is not a part of the generated GLAD loader. */
+    using GetTextureHandleProc          = GLuint64 (APIENTRY*)(GLuint texture);
+    using MakeTextureHandleResidentProc = void     (APIENTRY*)(GLuint64 handle);
+
+    GetTextureHandleProc          glGetTextureHandleARB_             = nullptr;
+    MakeTextureHandleResidentProc glMakeTextureHandleResidentARB_    = nullptr;
+    MakeTextureHandleResidentProc glMakeTextureHandleNonResidentARB_ = nullptr;
+
     bool translateDdsFormat(DDSFile::DXGIFormat fmt, GLFormat* outFormat)
     {
         static const GLSwizzle sws[] = 
@@ -153,6 +164,55 @@ namespace RGL
 
     // --------------------- Texture -------------------------
 
+    uint64_t Texture::GetBindlessHandle()
+    {
+        if (m_bindless_handle == 0 && m_obj_name != 0 && IsBindlessSupported())
+        {
+            m_bindless_handle = glGetTextureHandleARB_(m_obj_name);
+            glMakeTextureHandleResidentARB_(m_bindless_handle);
+        }
+
+        return m_bindless_handle;
+    }
+
+    bool Texture::IsBindlessSupported()
+    {
+        static const bool is_supported = []
+        {
+            GLint extensions_count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_count);
+
+            bool has_extension = false;
+
+            for (GLint i = 0; i < extensions_count && !has_extension; ++i)
+            {
+                has_extension = std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_bindless_texture") == 0;
+            }
+
+            if (!has_extension)
+            {
+                return false;
+            }
+
+            glGetTextureHandleARB_             = (GetTextureHandleProc)         Window::getProcAddress("glGetTextureHandleARB");
+            glMakeTextureHandleResidentARB_    = (MakeTextureHandleResidentProc)Window::getProcAddress("glMakeTextureHandleResidentARB");
+            glMakeTextureHandleNonResidentARB_ = (MakeTextureHandleResidentProc)Window::getProcAddress("glMakeTextureHandleNonResidentARB");
+
+            return glGetTextureHandleARB_ && glMakeTextureHandleResidentARB_ && glMakeTextureHandleNonResidentARB_;
+        }();
+
+        return is_supported;
+    }
+
+    void Texture::ReleaseBindlessHandle()
+    {
+        if (m_bindless_handle != 0)
+        {
+            glMakeTextureHandleNonResidentARB_(m_bindless_handle);
+            m_bindless_handle = 0;
+        }
+    }
+
     void Texture::SetFiltering(TextureFiltering type, TextureFilteringParam param)
     {
         if (type == TextureFiltering::MAG && param > TextureFilteringParam::LINEAR)
@@ -207,7 +267,8 @@ namespace RGL
 
     bool Texture2D::Load(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps)
     {
-        auto data = Util::LoadTextureData(filepath, m_metadata);
+        ImageData metadata;
+        auto data = Util::LoadTextureData(filepath, metadata);
 
         if (!data)
         {
@@ -215,46 +276,16 @@ namespace RGL
             return false;
         }
 
-        GLenum format          = 0;
-        GLenum internal_format = 0;
-
-        if (m_metadata.channels == 1)
-        {
-            format          = GL_RED;
-            internal_format = GL_R8;
-        }
-        else if (m_metadata.channels == 3)
-        {
-            format          = GL_RGB;
-            internal_format = is_srgb ? GL_SRGB8 : GL_RGB8;
-        }
-        else if (m_metadata.channels == 4)
-        {
-            format          = GL_RGBA;
-            internal_format = is_srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
-        }
-
-        const GLuint max_num_mipmaps = GetMaxMipMapsLevels(m_metadata.width, m_metadata.height, 0);
-                     num_mipmaps     = num_mipmaps == 0 ? max_num_mipmaps : glm::clamp(num_mipmaps, 1u, max_num_mipmaps);
-
-        glCreateTextures       (GLenum(TextureType::Texture2D), 1, &m_obj_name);
-        glTextureStorage2D     (m_obj_name, num_mipmaps /* levels */, internal_format, m_metadata.width, m_metadata.height);
-        glTextureSubImage2D    (m_obj_name, 0 /* level */, 0 /* xoffset */, 0 /* yoffset */, m_metadata.width, m_metadata.height, format, GL_UNSIGNED_BYTE, data);
-        glGenerateTextureMipmap(m_obj_name);
-
-        SetFiltering(TextureFiltering::MIN,       TextureFilteringParam::LINEAR_MIP_LINEAR);
-        SetFiltering(TextureFiltering::MAG,       TextureFilteringParam::LINEAR);
-        SetWraping  (TextureWrapingCoordinate::S, TextureWrapingParam::CLAMP_TO_EDGE);
-        SetWraping  (TextureWrapingCoordinate::T, TextureWrapingParam::CLAMP_TO_EDGE);
-
+        Create(data, metadata, is_srgb, num_mipmaps);
         Util::ReleaseTextureData(data);
 
         return true;
     }
 
-    bool Texture2D::Load(unsigned char* memory_data, uint32_t data_size, bool is_srgb, uint32_t num_mipmaps)
+    bool Texture2D::Load(const unsigned char* memory_data, uint32_t data_size, bool is_srgb, uint32_t num_mipmaps)
     {
-        auto data = Util::LoadTextureData(memory_data, data_size, m_metadata);
+        ImageData metadata;
+        auto data = Util::LoadTextureData(memory_data, data_size, metadata);
 
         if (!data)
         {
@@ -262,6 +293,16 @@ namespace RGL
             return false;
         }
 
+        Create(data, metadata, is_srgb, num_mipmaps);
+        Util::ReleaseTextureData(data);
+
+        return true;
+    }
+
+    bool Texture2D::Create(const unsigned char* data, const ImageData& metadata, bool is_srgb, uint32_t num_mipmaps)
+    {
+        m_metadata = metadata;
+
         GLenum format          = 0;
         GLenum internal_format = 0;
 
@@ -284,7 +325,6 @@ namespace RGL
         const GLuint max_num_mipmaps = GetMaxMipMapsLevels(m_metadata.width, m_metadata.height, 0);
                      num_mipmaps     = num_mipmaps == 0 ? max_num_mipmaps : glm::clamp(num_mipmaps, 1u, max_num_mipmaps);
 
-
         glCreateTextures       (GLenum(TextureType::Texture2D), 1, &m_obj_name);
         glTextureStorage2D     (m_obj_name, num_mipmaps /* levels */, internal_format, m_metadata.width, m_metadata.height);
         glTextureSubImage2D    (m_obj_name, 0 /* level */, 0 /* xoffset */, 0 /* yoffset */, m_metadata.width, m_metadata.height, format, GL_UNSIGNED_BYTE, data);
@@ -295,8 +335,6 @@ namespace RGL
         SetWraping  (TextureWrapingCoordinate::S, TextureWrapingParam::CLAMP_TO_EDGE);
         SetWraping  (TextureWrapingCoordinate::T, TextureWrapingParam::CLAMP_TO_EDGE);
 
-        Util::ReleaseTextureData(data);
-
         return true;
     }
 
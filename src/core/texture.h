@@ -92,9 +92,10 @@ namespace RGL
         Texture           (const Texture&) = delete;
         Texture& operator=(const Texture&) = delete;
 
-        Texture(Texture&& other) noexcept : m_metadata(other.m_metadata), m_type(other.m_type), m_obj_name(other.m_obj_name)
+        Texture(Texture&& other) noexcept : m_metadata(other.m_metadata), m_type(other.m_type), m_obj_name(other.m_obj_name), m_bindless_handle(other.m_bindless_handle)
         {
-            other.m_obj_name = 0;
+            other.m_obj_name        = 0;
+            other.m_bindless_handle = 0;
         }
 
         Texture& operator=(Texture&& other) noexcept
@@ -106,6 +107,7 @@ namespace RGL
                 std::swap(m_metadata, other.m_metadata);
                 std::swap(m_type,     other.m_type);
                 std::swap(m_obj_name, other.m_obj_name);
+                std::swap(m_bindless_handle, other.m_bindless_handle);
             }
 
             return *this;
@@ -123,6 +125,11 @@ namespace RGL
         
         virtual ImageData GetMetadata() const { return m_metadata; };
 
+        /* Returns the resident GL_ARB_bindless_texture handle of the texture, creating it on the first call.
+         * The texture's parameters can't be changed once the handle has been created. */
+        uint64_t GetBindlessHandle();
+        static bool IsBindlessSupported();
+
         static uint8_t GetMaxMipMapsLevels(uint32_t width, uint32_t height, uint32_t depth)
         {
             uint8_t num_levels = 1 + std::floor(std::log2(std::max(width, std::max(height, depth))));
@@ -130,10 +137,12 @@ namespace RGL
         }
 
     protected:
-        Texture() : m_type(TextureType::NONE), m_obj_name(0) {}
+        Texture() : m_type(TextureType::NONE), m_obj_name(0), m_bindless_handle(0) {}
 
         void Release()
         {
+            ReleaseBindlessHandle();
+
             glDeleteTextures(1, &m_obj_name);
             m_obj_name = 0;
         }
@@ -141,6 +150,10 @@ namespace RGL
         ImageData   m_metadata;
         TextureType m_type;
         GLuint      m_obj_name;
+        uint64_t    m_bindless_handle;
+
+    private:
+        void ReleaseBindlessHandle();
     };
 
     class Texture2D : public Texture
@@ -148,7 +161,10 @@ namespace RGL
     public:
         Texture2D() = default;
         bool Load(const std::filesystem::path & filepath, bool is_srgb = false, uint32_t num_mipmaps = 0);
-        bool Load(unsigned char* memory_data, uint32_t data_size, bool is_srgb = false, uint32_t num_mipmaps = 0);
+        bool Load(const unsigned char* memory_data, uint32_t data_size, bool is_srgb = false, uint32_t num_mipmaps = 0);
+
+        /* Creates the texture from an already decoded 8-bit image, e.g. decoded on a worker thread. */
+        bool Create(const unsigned char* data, const ImageData& metadata, bool is_srgb = false, uint32_t num_mipmaps = 0);
         bool LoadHdr(const std::filesystem::path& filepath, uint32_t num_mipmaps = 0);
         bool LoadDds(const std::filesystem::path& filepath);
     };
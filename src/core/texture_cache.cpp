@@ -0,0 +1,118 @@
+#include "texture_cache.h"
+
+#include <cstdio>
+
+namespace RGL
+{
+    std::map<TextureCache::Key, std::weak_ptr<Texture2D>> TextureCache::s_textures;
+    std::mutex                                            TextureCache::s_mutex;
+    uint32_t                                              TextureCache::s_hits   = 0;
+    uint32_t                                              TextureCache::s_misses = 0;
+
+    std::shared_ptr<Texture2D> TextureCache::Load(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat)
+    {
+        if (auto texture = Find(filepath, is_srgb, num_mipmaps, repeat))
+        {
+            return texture;
+        }
+
+        auto texture = std::make_shared<Texture2D>();
+
+        if (!texture->Load(filepath, is_srgb, num_mipmaps))
+        {
+            return nullptr;
+        }
+
+        Insert(filepath, is_srgb, num_mipmaps, repeat, texture);
+
+        return texture;
+    }
+
+    std::shared_ptr<Texture2D> TextureCache::Find(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat)
+    {
+        auto key = MakeKey(filepath, is_srgb, num_mipmaps, repeat);
+
+        std::lock_guard lock(s_mutex);
+
+        auto it = s_textures.find(key);
+
+        if (it != s_textures.end())
+        {
+            if (auto texture = it->second.lock())
+            {
+                s_hits++;
+                return texture;
+            }
+
+            s_textures.erase(it);
+        }
+
+        s_misses++;
+        return nullptr;
+    }
+
+    void TextureCache::Insert(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat, const std::shared_ptr<Texture2D>& texture)
+    {
+        auto key = MakeKey(filepath, is_srgb, num_mipmaps, repeat);
+
+        if (repeat)
+        {
+            texture->SetWraping(TextureWrapingCoordinate::S, TextureWrapingParam::REPEAT);
+            texture->SetWraping(TextureWrapingCoordinate::T, TextureWrapingParam::REPEAT);
+        }
+
+        std::lock_guard lock(s_mutex);
+        s_textures[key] = texture;
+    }
+
+    TextureCache::Stats TextureCache::GetStats()
+    {
+        std::lock_guard lock(s_mutex);
+
+        Stats stats = { s_hits, s_misses, 0, 0 };
+
+        for (auto it = s_textures.begin(); it != s_textures.end();)
+        {
+            auto texture = it->second.lock();
+
+            if (!texture)
+            {
+                it = s_textures.erase(it);
+                continue;
+            }
+
+            auto metadata    = texture->GetMetadata();
+            auto num_mipmaps = std::get<2>(it->first);
+
+            if (num_mipmaps == 0)
+            {
+                num_mipmaps = Texture::GetMaxMipMapsLevels(metadata.width, metadata.height, 0);
+            }
+
+            for (uint32_t level = 0; level < num_mipmaps; ++level)
+            {
+                stats.resident_bytes += uint64_t(std::max(1u, metadata.width >> level)) * std::max(1u, metadata.height >> level) * metadata.channels;
+            }
+
+            stats.resident_textures++;
+            ++it;
+        }
+
+        return stats;
+    }
+
+    void TextureCache::PrintStats()
+    {
+        auto stats = GetStats();
+
+        printf("Texture cache: %u hits, %u misses, %u resident textures (%.2f MB)\n", stats.hits, stats.misses, stats.resident_textures, stats.resident_bytes / (1024.0 * 1024.0));
+    }
+
+    TextureCache::Key TextureCache::MakeKey(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat)
+    {
+        std::error_code ec;
+        auto canonical_path = std::filesystem::weakly_canonical(filepath, ec);
+
+        return { ec ? filepath.generic_string() : canonical_path.generic_string(), is_srgb, num_mipmaps, repeat };
+    }
+}
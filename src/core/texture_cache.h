@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "texture.h"
+
+namespace RGL
+{
+    /* Process-wide cache of the 2D textures loaded from files.
+     * Only weak references are kept, so a texture is released as soon as nobody uses it.
+     * Note that the cached textures are shared, i.e. changing e.g. the filtering affects all of the users. The wrapping mode
+     * is part of the key instead and it's set when the texture is created, before any bindless handle makes it immutable. */
+    class TextureCache
+    {
+    public:
+        struct Stats
+        {
+            uint32_t hits;
+            uint32_t misses;
+            uint32_t resident_textures;
+            uint64_t resident_bytes; /* Estimated, including the mipmaps. */
+        };
+
+        /* If repeat is set, the texture wraps with REPEAT, otherwise with CLAMP_TO_EDGE. */
+        static std::shared_ptr<Texture2D> Load(const std::filesystem::path& filepath, bool is_srgb = false, uint32_t num_mipmaps = 0, bool repeat = false);
+
+        /* Used by the loaders that decode the images by themselves, e.g. on the worker threads. Insert() sets the wrapping mode. */
+        static std::shared_ptr<Texture2D> Find  (const std::filesystem::path& filepath, bool is_srgb = false, uint32_t num_mipmaps = 0, bool repeat = false);
+        static void                       Insert(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat, const std::shared_ptr<Texture2D>& texture);
+
+        static Stats GetStats();
+        static void  PrintStats();
+
+    private:
+        using Key = std::tuple<std::string, bool, uint32_t, bool>;
+
+        static Key MakeKey(const std::filesystem::path& filepath, bool is_srgb, uint32_t num_mipmaps, bool repeat);
+
+        static std::map<Key, std::weak_ptr<Texture2D>> s_textures;
+        static std::mutex                              s_mutex;
+        static uint32_t                                s_hits;
+        static uint32_t                                s_misses;
+    };
+}
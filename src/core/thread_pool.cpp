@@ -0,0 +1,181 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace RGL
+{
+    ThreadPool::ThreadPool(uint32_t num_threads)
+        : m_stop(false)
+    {
+        if (num_threads == 0)
+        {
+            num_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        m_workers.reserve(num_threads);
+
+        for (uint32_t i = 0; i < num_threads; ++i)
+        {
+            m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::Get()
+    {
+        static ThreadPool thread_pool;
+        return thread_pool;
+    }
+
+    void ThreadPool::ParallelFor(size_t count, JobFunction function, const void* context)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        Job* job = nullptr;
+
+        if (count > 1 && !m_workers.empty())
+        {
+            std::lock_guard lock(m_mutex);
+
+            for (auto& slot : m_jobs)
+            {
+                if (!slot.in_use)
+                {
+                    job = &slot;
+                    break;
+                }
+            }
+
+            if (job)
+            {
+                job->function       = function;
+                job->context        = context;
+                job->count          = count;
+                job->next_index     = 0;
+                job->finished_count = 0;
+                job->workers_count  = 0;
+                job->in_use         = true;
+            }
+        }
+
+        /* Nothing to share, or all of the slots are taken, e.g. by the calls that this one is nested in. */
+        if (!job)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                function(context, i);
+            }
+
+            return;
+        }
+
+        const size_t helpers_count = std::min(count - 1, m_workers.size());
+
+        for (size_t i = 0; i < helpers_count; ++i)
+        {
+            m_condition.notify_one();
+        }
+
+        ProcessJob(*job);
+
+        /* The workers that joined the job may still be reading it after the last index has finished. */
+        std::unique_lock lock(m_mutex);
+        m_job_finished_condition.wait(lock, [job] { return job->finished_count == job->count && job->workers_count == 0; });
+
+        job->in_use = false;
+    }
+
+    ThreadPool::Job* ThreadPool::FindPendingJob()
+    {
+        for (auto& job : m_jobs)
+        {
+            if (job.in_use && job.next_index < job.count)
+            {
+                return &job;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void ThreadPool::ProcessJob(Job& job)
+    {
+        size_t index;
+        while ((index = job.next_index++) < job.count)
+        {
+            job.function(job.context, index);
+            ++job.finished_count;
+        }
+    }
+
+    void ThreadPool::Push(std::function<void()>&& task)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            Job*                  job = nullptr;
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_condition.wait(lock, [this, &job] { return m_stop || (job = FindPendingJob()) || !m_tasks.empty(); });
+
+                if (job)
+                {
+                    ++job->workers_count;
+                }
+                else if (m_stop && m_tasks.empty())
+                {
+                    return;
+                }
+                else
+                {
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+            }
+
+            if (job)
+            {
+                ProcessJob(*job);
+
+                std::lock_guard lock(m_mutex);
+
+                if (--job->workers_count == 0 && job->finished_count == job->count)
+                {
+                    m_job_finished_condition.notify_all();
+                }
+
+                continue;
+            }
+
+            task();
+        }
+    }
+}
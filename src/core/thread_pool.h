@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace RGL
+{
+    /* Fixed size pool of worker threads. Tasks must not call OpenGL functions. */
+    class ThreadPool final
+    {
+    public:
+        explicit ThreadPool(uint32_t num_threads = 0);
+        ~ThreadPool();
+
+        ThreadPool           (const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /* Process-wide pool with one worker per hardware thread, except the main one. */
+        static ThreadPool& Get();
+
+        template<typename F>
+        std::future<std::invoke_result_t<F>> Enqueue(F&& task)
+        {
+            using ResultType = std::invoke_result_t<F>;
+
+            auto packaged_task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+            auto future        = packaged_task->get_future();
+
+            Push([packaged_task] { (*packaged_task)(); });
+
+            return future;
+        }
+
+        /* Calls func(i) for i in [0, count). The calling thread takes part in the work and returns when all calls have finished.
+         * It doesn't allocate, the workers get func through one of the preallocated job slots. */
+        template<typename F>
+        void ParallelFor(size_t count, const F& func)
+        {
+            ParallelFor(count, [](const void* context, size_t index) { (*static_cast<const F*>(context))(index); }, &func);
+        }
+
+        using JobFunction = void(*)(const void* context, size_t index);
+
+        void ParallelFor(size_t count, JobFunction function, const void* context);
+
+        uint32_t GetThreadsCount() const { return uint32_t(m_workers.size()); }
+
+    private:
+        /* A ParallelFor() call. The indices are claimed with next_index, the slot is released once all of them have
+         * finished and no worker refers to it anymore. */
+        struct Job
+        {
+            JobFunction         function       = nullptr;
+            const void*         context        = nullptr;
+            size_t              count          = 0;
+            std::atomic<size_t> next_index     { 0 };
+            std::atomic<size_t> finished_count { 0 };
+            uint32_t            workers_count  = 0; /* Guarded by m_mutex. */
+            bool                in_use         = false;
+        };
+
+        /* Concurrent or nested ParallelFor() calls beyond this run on the calling thread only. */
+        static constexpr uint32_t MAX_JOBS = 8;
+
+        void Push(std::function<void()>&& task);
+        void WorkerLoop();
+
+        /* Returns a job with indices left to claim, or nullptr. Requires m_mutex. */
+        Job* FindPendingJob();
+
+        /* Claims and processes the job's indices until none is left. */
+        static void ProcessJob(Job& job);
+
+        std::vector<std::thread>          m_workers;
+        std::deque<std::function<void()>> m_tasks;
+        std::array<Job, MAX_JOBS>         m_jobs;
+        std::mutex                        m_mutex;
+        std::condition_variable           m_condition;
+        std::condition_variable           m_job_finished_condition;
+        bool                              m_stop;
+    };
+}
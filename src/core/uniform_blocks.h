@@ -0,0 +1,61 @@
+/* Uniform blocks shared by the C++ code and the shaders, std140 layout.
+ * C++ code should include uniform_buffers.h, the shaders include this file directly,
+ * e.g. #include "../../core/uniform_blocks.h" from a demo's directory. */
+#ifdef __cplusplus
+#pragma once
+#define vec3 alignas(16) glm::vec3
+#define vec4 alignas(16) glm::vec4
+#define mat4 alignas(16) glm::mat4
+
+namespace RGL
+{
+#endif
+
+#define FRAME_UBO_BINDING_INDEX  0
+#define OBJECT_UBO_BINDING_INDEX 1
+#define IBL_UBO_BINDING_INDEX    2
+
+struct FrameData
+{
+    mat4  view;
+    mat4  projection;
+    mat4  view_projection;
+    vec3  cam_pos;
+    float near_z;
+    float far_z;
+};
+
+struct ObjectData
+{
+    mat4 model;
+    mat4 mvp;
+    mat4 normal_matrix; /* The upper left 3x3 part is used, std140 would pad the columns of a mat3 anyway. */
+};
+
+struct IBLData
+{
+    vec4 irradiance_sh[9]; /* rgb, SH coefficients of the bands 0..2 of the diffuse irradiance / PI, see core/shaders/ibl.glh. */
+};
+
+#ifdef __cplusplus
+}
+
+#undef vec3
+#undef vec4
+#undef mat4
+#else
+layout (std140, binding = FRAME_UBO_BINDING_INDEX) uniform FrameUBO
+{
+    FrameData u_frame;
+};
+
+layout (std140, binding = OBJECT_UBO_BINDING_INDEX) uniform ObjectUBO
+{
+    ObjectData u_object;
+};
+
+layout (std140, binding = IBL_UBO_BINDING_INDEX) uniform IBLUBO
+{
+    IBLData u_ibl;
+};
+#endif
@@ -0,0 +1,177 @@
+#include "uniform_buffers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp>
+
+#include "camera.h"
+
+namespace RGL
+{
+    GLuint    UniformBuffers::s_buffer            = 0;
+    uint8_t*  UniformBuffers::s_mapped_data       = nullptr;
+    GLsync    UniformBuffers::s_fences[FRAMES_IN_FLIGHT] = {};
+    uint32_t  UniformBuffers::s_region_index      = 0;
+    uint32_t  UniformBuffers::s_region_offset     = 0;
+    uint32_t  UniformBuffers::s_offset_alignment  = 256;
+    bool      UniformBuffers::s_overflow_reported = false;
+    glm::mat4 UniformBuffers::s_view_projection   = glm::mat4(1.0f);
+
+    void UniformBuffers::BeginFrame()
+    {
+        s_region_index  = (s_region_index + 1) % FRAMES_IN_FLIGHT;
+        s_region_offset = 0;
+
+        if (auto& fence = s_fences[s_region_index])
+        {
+            /* Usually signaled already, the region was used FRAMES_IN_FLIGHT frames ago. */
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    void UniformBuffers::EndFrame()
+    {
+        if (s_buffer != 0 && s_region_offset > 0)
+        {
+            s_fences[s_region_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    void UniformBuffers::Release()
+    {
+        for (auto& fence : s_fences)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        if (s_buffer != 0)
+        {
+            glUnmapNamedBuffer(s_buffer);
+            glDeleteBuffers(1, &s_buffer);
+        }
+
+        s_buffer        = 0;
+        s_mapped_data   = nullptr;
+        s_region_offset = 0;
+    }
+
+    uint32_t UniformBuffers::PushFrameData(const FrameData& frame_data)
+    {
+        s_view_projection = frame_data.view_projection;
+
+        uint32_t offset = Push(&frame_data, sizeof(frame_data));
+        BindFrameData(offset);
+
+        return offset;
+    }
+
+    uint32_t UniformBuffers::PushFrameData(const Camera& camera)
+    {
+        FrameData frame_data;
+        frame_data.view            = camera.m_view;
+        frame_data.projection      = camera.m_projection;
+        frame_data.view_projection = camera.m_projection * camera.m_view;
+        frame_data.cam_pos         = camera.position();
+        frame_data.near_z          = camera.NearPlane();
+        frame_data.far_z           = camera.FarPlane();
+
+        return PushFrameData(frame_data);
+    }
+
+    uint32_t UniformBuffers::PushObjectData(const ObjectData& object_data)
+    {
+        uint32_t offset = Push(&object_data, sizeof(object_data));
+        BindObjectData(offset);
+
+        return offset;
+    }
+
+    uint32_t UniformBuffers::PushObjectData(const glm::mat4& model)
+    {
+        ObjectData object_data;
+        object_data.model         = model;
+        object_data.mvp           = s_view_projection * model;
+        object_data.normal_matrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+
+        return PushObjectData(object_data);
+    }
+
+    void UniformBuffers::BindFrameData(uint32_t offset)
+    {
+        if (offset != INVALID_OFFSET)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UBO_BINDING_INDEX, s_buffer, offset, sizeof(FrameData));
+        }
+    }
+
+    void UniformBuffers::BindObjectData(uint32_t offset)
+    {
+        if (offset != INVALID_OFFSET)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UBO_BINDING_INDEX, s_buffer, offset, sizeof(ObjectData));
+        }
+    }
+
+    bool UniformBuffers::Create()
+    {
+        GLint offset_alignment;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+        s_offset_alignment = std::max<uint32_t>(1, offset_alignment);
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glCreateBuffers     (1, &s_buffer);
+        glNamedBufferStorage(s_buffer, FRAMES_IN_FLIGHT * REGION_SIZE, nullptr, flags);
+
+        s_mapped_data = static_cast<uint8_t*>(glMapNamedBufferRange(s_buffer, 0, FRAMES_IN_FLIGHT * REGION_SIZE, flags));
+
+        if (!s_mapped_data)
+        {
+            fprintf(stderr, "Error: could not map the uniform buffer.\n");
+
+            glDeleteBuffers(1, &s_buffer);
+            s_buffer = 0;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    uint32_t UniformBuffers::Push(const void* data, uint32_t size)
+    {
+        if (s_buffer == 0 && !Create())
+        {
+            return INVALID_OFFSET;
+        }
+
+        uint32_t region_offset = (s_region_offset + s_offset_alignment - 1) / s_offset_alignment * s_offset_alignment;
+
+        if (region_offset + size > REGION_SIZE)
+        {
+            if (!s_overflow_reported)
+            {
+                fprintf(stderr, "Error: the uniform data of a single frame exceeds %u bytes.\n", REGION_SIZE);
+                s_overflow_reported = true;
+            }
+
+            return INVALID_OFFSET;
+        }
+
+        uint32_t offset = s_region_index * REGION_SIZE + region_offset;
+        std::memcpy(s_mapped_data + offset, data, size);
+
+        s_region_offset = region_offset + size;
+
+        return offset;
+    }
+}
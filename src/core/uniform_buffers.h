@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "uniform_blocks.h"
+
+namespace RGL
+{
+    class Camera;
+
+    static_assert(sizeof(FrameData)  == 224);
+    static_assert(sizeof(ObjectData) == 192);
+    static_assert(sizeof(IBLData)    == 144);
+
+    /* Per frame and per object constants of the uniform blocks declared in uniform_blocks.h.
+     * The data is written to a persistently mapped buffer split into FRAMES_IN_FLIGHT regions, used round-robin,
+     * so that the CPU never overwrites the data that the GPU may still read. Every Push*() call writes a new copy
+     * and binds it, the returned offset can be used to bind it again later in the same frame, e.g. for another pass. */
+    class UniformBuffers
+    {
+    public:
+        static constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+        static constexpr uint32_t REGION_SIZE      = 512 * 1024; /* Bytes available per frame. */
+        static constexpr uint32_t INVALID_OFFSET   = std::numeric_limits<uint32_t>::max();
+
+        /* Called by CoreApp around render(). BeginFrame() waits until the GPU has finished reading the region it reuses. */
+        static void BeginFrame();
+        static void EndFrame();
+        static void Release();
+
+        static uint32_t PushFrameData(const FrameData& frame_data);
+        static uint32_t PushFrameData(const Camera& camera);
+
+        static uint32_t PushObjectData(const ObjectData& object_data);
+
+        /* Computes the mvp and the normal matrix using the view projection matrix of the last pushed frame data. */
+        static uint32_t PushObjectData(const glm::mat4& model);
+
+        static void BindFrameData (uint32_t offset);
+        static void BindObjectData(uint32_t offset);
+
+    private:
+        static bool     Create();
+        static uint32_t Push(const void* data, uint32_t size);
+
+        static GLuint    s_buffer;
+        static uint8_t*  s_mapped_data;
+        static GLsync    s_fences[FRAMES_IN_FLIGHT];
+        static uint32_t  s_region_index;
+        static uint32_t  s_region_offset;   /* Write offset in the current region. */
+        static uint32_t  s_offset_alignment;
+        static bool      s_overflow_reported;
+        static glm::mat4 s_view_projection;
+    };
+}
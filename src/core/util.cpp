@@ -115,7 +115,7 @@ namespace RGL
         return data;
     }
 
-    unsigned char* Util::LoadTextureData(unsigned char* memory_data, uint32_t data_size, ImageData& image_data, int desired_number_of_channels)
+    unsigned char* Util::LoadTextureData(const unsigned char* memory_data, uint32_t data_size, ImageData& image_data, int desired_number_of_channels)
     {
         int width, height, channels_in_file;
         unsigned char* data = stbi_load_from_memory(memory_data, data_size, &width, &height, &channels_in_file, desired_number_of_channels);
@@ -155,4 +155,18 @@ namespace RGL
     {
         stbi_image_free(data);
     }
+
+    uint64_t Util::Hash(const void* data, size_t size, uint64_t seed)
+    {
+        auto     bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash  = seed;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
 }
@@ -56,12 +56,21 @@ namespace RGL
         *          Has to be freed with stbi_image_free(data)!
         */
         static unsigned char* LoadTextureData    (const std::filesystem::path& filepath,                        ImageData& image_data, int desired_number_of_channels = 0);
-        static unsigned char* LoadTextureData    (unsigned char*               memory_data, uint32_t data_size, ImageData& image_data, int desired_number_of_channels = 0);
+        static unsigned char* LoadTextureData    (const unsigned char*         memory_data, uint32_t data_size, ImageData& image_data, int desired_number_of_channels = 0);
         static float        * LoadTextureDataHdr (const std::filesystem::path& filepath,                        ImageData& image_data, int desired_number_of_channels = 0);
         
         static void ReleaseTextureData (unsigned char* data);
         static void ReleaseTextureData (float*         data);
 
+        /**
+        * @brief   Computes a 64-bit FNV-1a hash of a memory block.
+        * @param   data Pointer to the data to be hashed.
+        * @param   size Size of the data in bytes.
+        * @param   seed Previous hash value, used to chain several blocks.
+        * @returns 64-bit hash value.
+        */
+        static uint64_t Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
         static double RandomDouble()
         {
             // Returns a random real in [0,1).
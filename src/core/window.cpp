@@ -4,6 +4,13 @@
 #include "input.h"
 #include "gui/gui.h"
 
+#include <cstring>
+
+#ifdef RGL_EGL_AVAILABLE
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 namespace RGL
 {
     GLFWwindow * Window::m_window          = nullptr;
@@ -13,6 +20,13 @@ namespace RGL
     glm::ivec2   Window::m_window_size     = glm::ivec2(0);
     glm::ivec2   Window::m_viewport_size   = glm::ivec2(0);
 
+    bool         Window::m_is_headless              = false;
+    GLuint       Window::m_default_framebuffer      = 0;
+    GLuint       Window::m_default_renderbuffers[2] = { 0, 0 };
+    void *       Window::m_egl_display              = nullptr;
+    void *       Window::m_egl_context              = nullptr;
+    void *       Window::m_egl_surface              = nullptr;
+
     Window::Window()
     {
     }
@@ -58,8 +72,192 @@ namespace RGL
 
         glfwMakeContextCurrent(m_window);
 
+        initContext();
+
+        /* Set the viewport */
+        glfwGetWindowPos(m_window, &m_window_pos.x, &m_window_pos.y);
+        glfwGetFramebufferSize(m_window, &m_viewport_size.x, &m_viewport_size.y);
+
+        glViewport(0, 0, m_viewport_size.x, m_viewport_size.y);
+        setViewportMatrix(m_viewport_size.x, m_viewport_size.y);
+
+        setVSync(false);
+        glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+
+        /* Init Input & GUI */
+        Input::init(m_window);
+        GUI::init(m_window);
+    }
+
+    void Window::createHeadless(unsigned int width, unsigned int height, const std::string & title)
+    {
+        m_title       = title;
+        m_window_size = glm::ivec2(width, height);
+        m_is_headless = true;
+
+        if (!createEGLContext())
+        {
+            /* Fall back to a hidden window, which still needs a display server. */
+            if (!glfwInit())
+            {
+                std::cerr << "ERROR: Could not initialize GLFW." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            glfwSetErrorCallback(error_callback);
+
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, MIN_GL_VERSION_MAJOR);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, MIN_GL_VERSION_MINOR);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+            m_window = glfwCreateWindow(1, 1, title.c_str(), nullptr, nullptr);
+
+            if (!m_window)
+            {
+                std::cerr << "ERROR: Could not create a headless OpenGL context." << std::endl;
+
+                glfwTerminate();
+                exit(EXIT_FAILURE);
+            }
+
+            glfwMakeContextCurrent(m_window);
+            glfwSwapInterval(0);
+        }
+
+        initContext();
+
+        m_viewport_size = m_window_size;
+        setViewportMatrix(m_viewport_size.x, m_viewport_size.y);
+
+        createDefaultFramebuffer();
+        bindDefaultFramebuffer();
+    }
+
+    bool Window::createEGLContext()
+    {
+    #ifdef RGL_EGL_AVAILABLE
+        EGLDisplay display = EGL_NO_DISPLAY;
+
+        /* Prefer the surfaceless platform, it doesn't need a display server. */
+        const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+        if (client_extensions && std::strstr(client_extensions, "EGL_MESA_platform_surfaceless"))
+        {
+            auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+            if (get_platform_display)
+            {
+                display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            }
+        }
+
+        if (display == EGL_NO_DISPLAY)
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        EGLint major, minor;
+
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            std::cerr << "WARNING: Could not initialize EGL." << std::endl;
+            return false;
+        }
+
+        const char* display_extensions = eglQueryString(display, EGL_EXTENSIONS);
+        const bool  is_surfaceless     = display_extensions && std::strstr(display_extensions, "EGL_KHR_surfaceless_context");
+
+        const EGLint config_attributes[] = { EGL_SURFACE_TYPE,    is_surfaceless ? 0 : EGL_PBUFFER_BIT,
+                                             EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                             EGL_RED_SIZE,        8,
+                                             EGL_GREEN_SIZE,      8,
+                                             EGL_BLUE_SIZE,       8,
+                                             EGL_NONE };
+
+        EGLConfig config;
+        EGLint    configs_count = 0;
+
+        if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, config_attributes, &config, 1, &configs_count) || configs_count == 0)
+        {
+            std::cerr << "WARNING: Could not find an EGL config for desktop OpenGL." << std::endl;
+            eglTerminate(display);
+
+            return false;
+        }
+
+        const EGLint context_attributes[] = { EGL_CONTEXT_MAJOR_VERSION,       MIN_GL_VERSION_MAJOR,
+                                              EGL_CONTEXT_MINOR_VERSION,       MIN_GL_VERSION_MINOR,
+                                              EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                          #ifdef _DEBUG
+                                              EGL_CONTEXT_OPENGL_DEBUG,        EGL_TRUE,
+                                          #endif
+                                              EGL_NONE };
+
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+        EGLSurface surface = EGL_NO_SURFACE;
+
+        if (context != EGL_NO_CONTEXT && !is_surfaceless)
+        {
+            /* The frames are rendered to the offscreen framebuffer, the pbuffer only makes the context current. */
+            const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+        }
+
+        if (context == EGL_NO_CONTEXT || (!is_surfaceless && surface == EGL_NO_SURFACE) || !eglMakeCurrent(display, surface, surface, context))
+        {
+            std::cerr << "WARNING: Could not create an EGL context." << std::endl;
+            eglTerminate(display);
+
+            return false;
+        }
+
+        printf("EGL %d.%d, %s context\n", major, minor, is_surfaceless ? "surfaceless" : "pbuffer");
+
+        m_egl_display = display;
+        m_egl_context = context;
+        m_egl_surface = surface;
+
+        return true;
+    #else
+        return false;
+    #endif
+    }
+
+    void Window::createDefaultFramebuffer()
+    {
+        glCreateRenderbuffers(2, m_default_renderbuffers);
+        glNamedRenderbufferStorage(m_default_renderbuffers[0], GL_RGBA8,            m_viewport_size.x, m_viewport_size.y);
+        glNamedRenderbufferStorage(m_default_renderbuffers[1], GL_DEPTH24_STENCIL8, m_viewport_size.x, m_viewport_size.y);
+
+        glCreateFramebuffers(1, &m_default_framebuffer);
+        glNamedFramebufferRenderbuffer(m_default_framebuffer, GL_COLOR_ATTACHMENT0,        GL_RENDERBUFFER, m_default_renderbuffers[0]);
+        glNamedFramebufferRenderbuffer(m_default_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_default_renderbuffers[1]);
+
+        if (glCheckNamedFramebufferStatus(m_default_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "ERROR: The headless framebuffer is incomplete." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    void * Window::getProcAddress(const char * name)
+    {
+    #ifdef RGL_EGL_AVAILABLE
+        if (m_egl_context)
+        {
+            return (void *)eglGetProcAddress(name);
+        }
+    #endif
+
+        return (void *)glfwGetProcAddress(name);
+    }
+
+    void Window::initContext()
+    {
         /* Initialize GLAD */
-        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        if (!gladLoadGLLoader((GLADloadproc)getProcAddress))
         {
             std::cerr << "ERROR: Could not initialize GLAD." << std::endl;
             exit(EXIT_FAILURE);
@@ -87,31 +285,23 @@ namespace RGL
         const GLubyte* glsl_version   = glGetString(GL_SHADING_LANGUAGE_VERSION);
 
         printf("%s %s\nDriver: %s\nGLSL Version: %s\n\n", vendor_name, renderer_name, driver_version, glsl_version);
-
-        /* Set the viewport */
-        glfwGetWindowPos(m_window, &m_window_pos.x, &m_window_pos.y);
-        glfwGetFramebufferSize(m_window, &m_viewport_size.x, &m_viewport_size.y);
-
-        glViewport(0, 0, m_viewport_size.x, m_viewport_size.y);
-        setViewportMatrix(m_viewport_size.x, m_viewport_size.y);
-
-        setVSync(false);
-        glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
-
-        /* Init Input & GUI */
-        Input::init(m_window);
-        GUI::init(m_window);
     }
 
     void Window::endFrame()
     {
+        /* The headless frames stay in the offscreen framebuffer. */
+        if (m_is_headless)
+        {
+            return;
+        }
+
         glfwPollEvents();
         glfwSwapBuffers(m_window);
     }
 
     int Window::isCloseRequested()
     {
-        return glfwWindowShouldClose(m_window);
+        return m_is_headless ? 0 : glfwWindowShouldClose(m_window);
     }
 
     int Window::getWidth()
@@ -153,12 +343,15 @@ namespace RGL
     {
         auto value = enabled ? true : false;
 
-        glfwSwapInterval(value);
+        if (!m_is_headless)
+        {
+            glfwSwapInterval(value);
+        }
     }
 
     void Window::bindDefaultFramebuffer()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_default_framebuffer);
         glViewport(0, 0, m_viewport_size.x, m_viewport_size.y);
     }
 
@@ -17,6 +17,11 @@ namespace RGL
         ~Window();
 
         static void createWindow(unsigned int width, unsigned int height, const std::string & title);
+
+        /* Creates an OpenGL context without a window: an EGL surfaceless context, or a pbuffer one if the driver
+         * doesn't support it, or a hidden GLFW window if EGL isn't available. The frames are rendered to an offscreen
+         * framebuffer of the given size, bound by bindDefaultFramebuffer(). There's no input and no GUI. */
+        static void createHeadless(unsigned int width, unsigned int height, const std::string & title);
         static void endFrame();
 
         static int isCloseRequested();
@@ -33,6 +38,13 @@ namespace RGL
         static void setVSync(bool enabled);
         static void bindDefaultFramebuffer();
 
+        /* 0, or the offscreen framebuffer in the headless mode. Use it instead of 0 to render to the screen. */
+        static GLuint getDefaultFramebuffer() { return m_default_framebuffer; }
+        static bool   isHeadless()            { return m_is_headless; }
+
+        /* Address of an OpenGL function from the API that created the context. */
+        static void * getProcAddress(const char * name);
+
     private:
         static GLFWwindow * m_window;
         static std::string  m_title;
@@ -41,7 +53,18 @@ namespace RGL
         static glm::ivec2   m_window_size;
         static glm::ivec2   m_viewport_size;
 
+        /* Headless mode */
+        static bool   m_is_headless;
+        static GLuint m_default_framebuffer;
+        static GLuint m_default_renderbuffers[2]; /* Color and depth-stencil. */
+        static void * m_egl_display;
+        static void * m_egl_context;
+        static void * m_egl_surface;
+
         static void setViewportMatrix(int width, int height);
+        static bool createEGLContext();
+        static void createDefaultFramebuffer();
+        static void initContext(); /* Loads the functions, enables the debug output and prints the driver info. */
 
         static void error_callback(int error, const char* description)
         {
@@ -2,6 +2,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 Simple3d::Simple3d()
@@ -66,8 +67,7 @@ void Simple3d::init_app()
     auto texture_spot = std::make_shared<RGL::Texture2D>();
     texture_spot->Load(RGL::FileSystem::getResourcesPath() / "models/spot/spot.png");
 
-    auto texture_bricks = std::make_shared<RGL::Texture2D>();
-    texture_bricks->Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png");
+    auto texture_bricks = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png");
 
     m_objects[0].AddTexture(texture_spot);
     m_objects[5].AddTexture(texture_bricks);
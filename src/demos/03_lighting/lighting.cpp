@@ -2,6 +2,8 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "texture_cache.h"
+#include "uniform_buffers.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -80,12 +82,12 @@ void Lighting::init_app()
     m_objects_model_matrices.emplace_back(glm::translate(glm::mat4(1.0), glm::vec3(10.0,  0.0, -5)) * glm::rotate(glm::mat4(1.0), glm::radians(90.0f), glm::vec3(1, 0, 0)));  // quad
     m_objects_model_matrices.emplace_back(glm::translate(glm::mat4(1.0), glm::vec3( 0.0, -1.0, -5)));                                                                         // ground plane
 
+    m_objects_data_offsets.resize(m_objects.size());
+
     /* Add textures to the objects. */
-    auto texture_default_diffuse = std::make_shared<RGL::Texture2D>();
-    texture_default_diffuse->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto texture_default_diffuse = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
 
-    auto texture_bricks = std::make_shared<RGL::Texture2D>();
-    texture_bricks->Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
+    auto texture_bricks = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
 
     m_objects[5].AddTexture(texture_bricks);
 
@@ -165,17 +167,22 @@ void Lighting::render()
     /* Put render specific code here. Don't update variables here! */
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    /* The camera and the objects' transformations are uploaded once and shared by all of the passes. */
+    RGL::UniformBuffers::PushFrameData(*m_camera);
+
+    for (unsigned i = 0; i < m_objects.size(); ++i)
+    {
+        m_objects_data_offsets[i] = RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
+    }
+
     m_ambient_light_shader->bind();
     m_ambient_light_shader->setUniform("ambient_factor", m_ambient_factor);
     m_ambient_light_shader->setUniform("gamma",          m_gamma);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
-
     /* First, render the ambient color only for the opaque objects. */
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        //m_ambient_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_ambient_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(m_objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -196,16 +203,13 @@ void Lighting::render()
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
     
-    m_directional_light_shader->setUniform("cam_pos",            m_camera->position());
     m_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power",     m_specular_power.x);
     m_directional_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(m_objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -221,16 +225,13 @@ void Lighting::render()
     m_point_light_shader->setUniform("point_light.position",        m_point_light_properties.position);
     m_point_light_shader->setUniform("point_light.range",           m_point_light_properties.range);
 
-    m_point_light_shader->setUniform("cam_pos",            m_camera->position());
     m_point_light_shader->setUniform("specular_intensity", m_specular_intenstiy.y);
     m_point_light_shader->setUniform("specular_power",     m_specular_power.y);
     m_point_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_point_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_point_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_point_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(m_objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -248,16 +249,13 @@ void Lighting::render()
     m_spot_light_shader->setUniform("spot_light.direction",             m_spot_light_properties.direction);
     m_spot_light_shader->setUniform("spot_light.cutoff",                glm::radians(90.0f - m_spot_light_properties.cutoff));
 
-    m_spot_light_shader->setUniform("cam_pos",            m_camera->position());
     m_spot_light_shader->setUniform("specular_intensity", m_specular_intenstiy.z);
     m_spot_light_shader->setUniform("specular_power",     m_specular_power.z);
     m_spot_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_spot_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_spot_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_spot_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(m_objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
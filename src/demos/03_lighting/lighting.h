@@ -84,6 +84,7 @@ private:
 
     std::vector<RGL::StaticModel> m_objects;
     std::vector<glm::mat4> m_objects_model_matrices;
+    std::vector<uint32_t> m_objects_data_offsets; /* Of the objects' data pushed in the current frame, see UniformBuffers. */
 
     DirectionalLight m_dir_light_properties;
     PointLight       m_point_light_properties;
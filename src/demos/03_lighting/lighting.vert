@@ -3,9 +3,7 @@ layout (location = 0) in vec3 in_pos;
 layout (location = 1) in vec2 in_texcoord;
 layout (location = 2) in vec3 in_normal;
 
-uniform mat4 model;
-uniform mat4 mvp;
-uniform mat3 normal_matrix;
+#include "../../core/uniform_blocks.h"
 
 out vec2 texcoord;
 out vec3 world_pos;
@@ -13,9 +11,9 @@ out vec3 normal;
 
 void main()
 {
-    world_pos = vec3(model * vec4(in_pos, 1.0));
+    world_pos = vec3(u_object.model * vec4(in_pos, 1.0));
     texcoord  = in_texcoord;
-    normal    = normal_matrix * in_normal;
+    normal    = mat3(u_object.normal_matrix) * in_normal;
 
-    gl_Position = mvp * vec4(in_pos, 1.0);
+    gl_Position = u_object.mvp * vec4(in_pos, 1.0);
 }
\ No newline at end of file
@@ -5,9 +5,10 @@
 
 using namespace RGL;
 
-int main()
+int main(int argc, char* argv[])
 {
     std::shared_ptr<CoreApp> app = std::make_shared<Lighting>();
+    app->parse_command_line(argc, argv);
     app->init(WINDOW_WIDTH, WINDOW_HEIGHT, "Lighting Demo" /*title*/, 60.0 /*framerate*/);
     app->start();
 
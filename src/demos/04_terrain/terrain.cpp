@@ -2,6 +2,8 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 Terrain::Terrain()
@@ -88,11 +90,9 @@ void Terrain::init_app()
     m_objects_model_matrices.emplace_back(glm::translate(glm::mat4(1.0), glm::vec3(10.0, 1.0 + m_terrain_model->getHeightOfTerrain(10.0, -5.0, m_terrain_position.x, m_terrain_position.z), -5)) * glm::rotate(glm::mat4(1.0), glm::radians(90.0f), glm::vec3(1, 0, 0)));  // quad
 
     /* Add textures to the objects. */
-    auto texture_default_diffuse = std::make_shared<RGL::Texture2D>();
-    texture_default_diffuse->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto texture_default_diffuse = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
 
-    auto texture_bricks = std::make_shared<RGL::Texture2D>();
-    texture_bricks->Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
+    auto texture_bricks = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
 
     m_objects[5].AddTexture(texture_bricks);
 
@@ -220,13 +220,21 @@ void Terrain::render()
     m_ambient_light_shader->setUniform("ambient_factor", m_ambient_factor);
     m_ambient_light_shader->setUniform("gamma",          m_gamma);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
+    RGL::UniformBuffers::PushFrameData(*m_camera);
+
+    std::vector<uint32_t> objects_data_offsets(m_objects.size());
+
+    for (unsigned i = 0; i < m_objects.size(); ++i)
+    {
+        objects_data_offsets[i] = RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
+    }
+
+    uint32_t terrain_data_offset = RGL::UniformBuffers::PushObjectData(m_terrain_model_matrix);
 
     /* First, render the ambient color only for the opaque objects. */
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        //m_ambient_light_shader->setUniform("normal_matrix", glm::transpose(glm::inverse(glm::mat3(m_objects_model_matrices[i]))));
-        m_ambient_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -239,8 +247,7 @@ void Terrain::render()
     m_terrain_ambient_light_shader->setUniform("slope_rock_threshold",   m_slope_rock_threshold);
     m_terrain_ambient_light_shader->setUniform("texcoord_tiling_factor", m_texcoord_tiling_factor);
 
-    m_terrain_ambient_light_shader->setUniform("normal_matrix", glm::transpose(glm::inverse(glm::mat3(m_terrain_model_matrix))));
-    m_terrain_ambient_light_shader->setUniform("mvp",           view_projection * m_terrain_model_matrix);
+    RGL::UniformBuffers::BindObjectData(terrain_data_offset);
     m_terrain_model->Render();
 
     /*
@@ -259,16 +266,13 @@ void Terrain::render()
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
     
-    m_directional_light_shader->setUniform("cam_pos",            m_camera->position());
     m_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power",     m_specular_power.x);
     m_directional_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model",         m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::transpose(glm::inverse(glm::mat3(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -284,16 +288,13 @@ void Terrain::render()
     m_point_light_shader->setUniform("point_light.position",        m_point_light_properties.position);
     m_point_light_shader->setUniform("point_light.range",           m_point_light_properties.range);
 
-    m_point_light_shader->setUniform("cam_pos",            m_camera->position());
     m_point_light_shader->setUniform("specular_intensity", m_specular_intenstiy.y);
     m_point_light_shader->setUniform("specular_power",     m_specular_power.y);
     m_point_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_point_light_shader->setUniform("model",         m_objects_model_matrices[i]);
-        m_point_light_shader->setUniform("normal_matrix", glm::transpose(glm::inverse(glm::mat3(m_objects_model_matrices[i]))));
-        m_point_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
@@ -311,21 +312,18 @@ void Terrain::render()
     m_spot_light_shader->setUniform("spot_light.direction",             m_spot_light_properties.direction);
     m_spot_light_shader->setUniform("spot_light.cutoff",                glm::radians(90.0f - m_spot_light_properties.cutoff));
 
-    m_spot_light_shader->setUniform("cam_pos",            m_camera->position());
     m_spot_light_shader->setUniform("specular_intensity", m_specular_intenstiy.z);
     m_spot_light_shader->setUniform("specular_power",     m_specular_power.z);
     m_spot_light_shader->setUniform("gamma",              m_gamma);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_spot_light_shader->setUniform("model",         m_objects_model_matrices[i]);
-        m_spot_light_shader->setUniform("normal_matrix", glm::transpose(glm::inverse(glm::mat3(m_objects_model_matrices[i]))));
-        m_spot_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i].Render();
     }
 
-    render_terrain(view_projection);
+    render_terrain(terrain_data_offset);
 
     /* Enable writing to the depth buffer. */
     glDepthMask(GL_TRUE);
@@ -333,11 +331,8 @@ void Terrain::render()
     glDisable(GL_BLEND);
 }
 
-void Terrain::render_terrain(const glm::mat4& view_projection)
+void Terrain::render_terrain(uint32_t terrain_data_offset)
 {
-    auto terrain_normal_matrix = glm::transpose(glm::inverse(glm::mat3(m_terrain_model_matrix)));
-    auto mvp                   = view_projection * m_terrain_model_matrix;
-
     for (uint32_t i = 0; i < m_terrain_textures.size(); ++i)
     {
         m_terrain_textures[i]->Bind(i);
@@ -350,7 +345,6 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_terrain_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
 
-    m_terrain_directional_light_shader->setUniform("cam_pos",            m_camera->position());
     m_terrain_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_terrain_directional_light_shader->setUniform("specular_power",     m_specular_power.x);
     m_terrain_directional_light_shader->setUniform("gamma",              m_gamma);
@@ -359,9 +353,7 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_directional_light_shader->setUniform("slope_rock_threshold",   m_slope_rock_threshold);
     m_terrain_directional_light_shader->setUniform("texcoord_tiling_factor", m_texcoord_tiling_factor);
 
-    m_terrain_directional_light_shader->setUniform("model",         m_terrain_model_matrix);
-    m_terrain_directional_light_shader->setUniform("normal_matrix", terrain_normal_matrix);
-    m_terrain_directional_light_shader->setUniform("mvp",           mvp);
+    RGL::UniformBuffers::BindObjectData(terrain_data_offset);
 
     m_terrain_model->Render();
 
@@ -376,7 +368,6 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_point_light_shader->setUniform("point_light.position",        m_point_light_properties.position);
     m_terrain_point_light_shader->setUniform("point_light.range",           m_point_light_properties.range);
 
-    m_terrain_point_light_shader->setUniform("cam_pos",            m_camera->position());
     m_terrain_point_light_shader->setUniform("specular_intensity", m_specular_intenstiy.y);
     m_terrain_point_light_shader->setUniform("specular_power",     m_specular_power.y);
     m_terrain_point_light_shader->setUniform("gamma",              m_gamma);
@@ -385,9 +376,7 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_point_light_shader->setUniform("slope_rock_threshold",   m_slope_rock_threshold);
     m_terrain_point_light_shader->setUniform("texcoord_tiling_factor", m_texcoord_tiling_factor);
 
-    m_terrain_point_light_shader->setUniform("model",         m_terrain_model_matrix);
-    m_terrain_point_light_shader->setUniform("normal_matrix", terrain_normal_matrix);
-    m_terrain_point_light_shader->setUniform("mvp",           mvp);
+    RGL::UniformBuffers::BindObjectData(terrain_data_offset);
 
     m_terrain_model->Render();
 
@@ -404,7 +393,6 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_spot_light_shader->setUniform("spot_light.direction",             m_spot_light_properties.direction);
     m_terrain_spot_light_shader->setUniform("spot_light.cutoff",                glm::radians(90.0f - m_spot_light_properties.cutoff));
 
-    m_terrain_spot_light_shader->setUniform("cam_pos",            m_camera->position());
     m_terrain_spot_light_shader->setUniform("specular_intensity", m_specular_intenstiy.z);
     m_terrain_spot_light_shader->setUniform("specular_power",     m_specular_power.z);
     m_terrain_spot_light_shader->setUniform("gamma",              m_gamma);
@@ -413,9 +401,7 @@ void Terrain::render_terrain(const glm::mat4& view_projection)
     m_terrain_spot_light_shader->setUniform("slope_rock_threshold",   m_slope_rock_threshold);
     m_terrain_spot_light_shader->setUniform("texcoord_tiling_factor", m_texcoord_tiling_factor);
 
-    m_terrain_spot_light_shader->setUniform("model",         m_terrain_model_matrix);
-    m_terrain_spot_light_shader->setUniform("normal_matrix", terrain_normal_matrix);
-    m_terrain_spot_light_shader->setUniform("mvp",           mvp);
+    RGL::UniformBuffers::BindObjectData(terrain_data_offset);
 
     m_terrain_model->Render();
 }
@@ -78,7 +78,7 @@ public:
     void render_gui()              override;
 
 private:
-    void render_terrain(const glm::mat4 & view_projection);
+    void render_terrain(uint32_t terrain_data_offset);
 
     std::shared_ptr<RGL::Camera> m_camera;
     std::shared_ptr<RGL::Shader> m_ambient_light_shader;
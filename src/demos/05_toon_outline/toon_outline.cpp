@@ -2,6 +2,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 ToonOutline::ToonOutline()
@@ -134,8 +135,7 @@ void ToonOutline::init_app()
     auto texture_spot = std::make_shared<RGL::Texture2D>();
     texture_spot->Load(RGL::FileSystem::getResourcesPath() / "models/spot/spot.png", true);
 
-    auto default_diffuse_texture = std::make_shared<RGL::Texture2D>();
-    default_diffuse_texture->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto default_diffuse_texture = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
 
     m_objects[0].AddTexture(texture_spot);
 
@@ -187,7 +187,7 @@ void ToonOutline::init_app()
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo);
 
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
     glBindTexture(GL_TEXTURE_2D, 0);
 
     /* Create framebuffer for shading rendering */
@@ -205,7 +205,7 @@ void ToonOutline::init_app()
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_shading_tex_buffer, 0 /* level */);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
     glBindTexture(GL_TEXTURE_2D, 0);
 
     /* Create the outline shaders. */
@@ -332,7 +332,7 @@ void ToonOutline::ps_outline()
     render_toon_shaded_objects();
 
     /* Compose outlines and shading */
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     m_outline_ps_shader->bind();
@@ -35,7 +35,7 @@ void main()
     vec4 ambient                        = texture(texture_diffuse1, texcoord) * vec4(vec3(ambient_factor), 1.0);
     vec4 directional_light_contribution = calcDirectionalLight(directional_light, normalize(normal), world_pos);
 
-    float distance_to_cam = distance(world_pos, cam_pos);
+    float distance_to_cam = distance(world_pos, u_frame.cam_pos);
     float fog_factor = fog_equation(distance_to_cam);
           fog_factor = clamp(fog_factor, 0.0, 1.0);
 
@@ -2,6 +2,8 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -61,8 +63,7 @@ void SimpleFog::init_app()
     }
 
     /* Add textures to the objects. */
-    auto default_diffuse_texture = std::make_shared<RGL::Texture2D>();
-    default_diffuse_texture->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto default_diffuse_texture = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
     m_objects[0].AddTexture(default_diffuse_texture);
 
     /* Create shader. */
@@ -126,7 +127,7 @@ void SimpleFog::render()
     /* Put render specific code here. Don't update variables here! */
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
+    RGL::UniformBuffers::PushFrameData(*m_camera);
 
     /* Render directional light(s) */
     m_directional_light_shader->bind();
@@ -135,7 +136,6 @@ void SimpleFog::render()
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
     
-    m_directional_light_shader->setUniform("cam_pos",            m_camera->position());
     m_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power",     m_specular_power.x);
     m_directional_light_shader->setUniform("gamma",              m_gamma);
@@ -163,9 +163,7 @@ void SimpleFog::render()
 
     for (unsigned i = 0; i < m_objects_model_matrices.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model",         m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
         m_directional_light_shader->setUniform("object_color",  m_objects_colors[i]);
 
         m_objects[0].Render();
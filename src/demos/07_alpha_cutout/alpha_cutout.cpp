@@ -2,6 +2,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -137,7 +138,7 @@ void AlphaCutout::render()
     /* Put render specific code here. Don't update variables here! */
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
+    RGL::UniformBuffers::PushFrameData(*m_camera);
 
     /* Render directional light(s) */
     m_directional_light_shader->bind();
@@ -146,7 +147,6 @@ void AlphaCutout::render()
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
     
-    m_directional_light_shader->setUniform("cam_pos",                m_camera->position());
     m_directional_light_shader->setUniform("specular_intensity",     m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power",         m_specular_power.x);
     m_directional_light_shader->setUniform("gamma",                  m_gamma);
@@ -155,17 +155,13 @@ void AlphaCutout::render()
 
     for (unsigned i = 0; i < m_objects_model_matrices.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model",         m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp",           view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
 
         m_pine_tree.Render();
     }
 
     /* Render ground plane */
-    m_directional_light_shader->setUniform("model", m_ground_plane_model);
-    m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_ground_plane_model))));
-    m_directional_light_shader->setUniform("mvp", view_projection * m_ground_plane_model);
+    RGL::UniformBuffers::PushObjectData(m_ground_plane_model);
     
     m_ground_plane.Render();
 }
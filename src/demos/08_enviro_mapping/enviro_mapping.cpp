@@ -2,6 +2,8 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -82,8 +84,7 @@ void EnvironmentMapping::init_app()
     m_color_tints.emplace_back(glm::vec3(1.0));
 
     /* Add textures to the objects. */
-    auto default_diffuse_texture = std::make_shared<RGL::Texture2D>();
-    default_diffuse_texture->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto default_diffuse_texture = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
 
     m_xyzrgb_dragon->AddTexture(default_diffuse_texture);
     m_lucy->AddTexture(default_diffuse_texture);
@@ -234,6 +235,17 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
 {
     auto view_projection = camera_projection * camera_view;
 
+    /* The cube map faces are rendered with their own view and projection matrices. */
+    RGL::FrameData frame_data;
+    frame_data.view            = camera_view;
+    frame_data.projection      = camera_projection;
+    frame_data.view_projection = view_projection;
+    frame_data.cam_pos         = camera_position;
+    frame_data.near_z          = m_camera->NearPlane();
+    frame_data.far_z           = m_camera->FarPlane();
+
+    RGL::UniformBuffers::PushFrameData(frame_data);
+
     /* Render directional light(s) */
     m_directional_light_shader->bind();
 
@@ -241,7 +253,6 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction", m_dir_light_properties.direction);
 
-    m_directional_light_shader->setUniform("cam_pos", camera_position);
     m_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power", m_specular_power.x);
     m_directional_light_shader->setUniform("gamma", m_gamma);
@@ -249,9 +260,7 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
 
     for (unsigned i = 2; i < m_objects_model_matrices.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
         m_directional_light_shader->setUniform("color_tint", m_color_tints[i]);
 
         m_objects[i]->Render();
@@ -259,7 +268,6 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
 
     /* Render reflective / refractive models */
     m_enviro_mapping_shader->bind();
-    m_enviro_mapping_shader->setUniform("cam_pos", camera_position);
 
     if(!m_dynamic_enviro_mapping_toggle) m_skybox->bindSkyboxTexture(1);
 
@@ -269,9 +277,7 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
         if (m_dynamic_enviro_mapping_toggle) m_cubemap_rts[0].bindTexture(1);
 
         m_enviro_mapping_shader->setSubroutine(RGL::Shader::ShaderType::FRAGMENT, "reflection");
-        m_enviro_mapping_shader->setUniform("model", m_objects_model_matrices[0]);
-        m_enviro_mapping_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[0]))));
-        m_enviro_mapping_shader->setUniform("mvp", view_projection * m_objects_model_matrices[0]);
+        RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[0]);
         m_xyzrgb_dragon->Render();
     }
 
@@ -282,9 +288,7 @@ void EnvironmentMapping::render_objects(const glm::mat4& camera_view, const glm:
 
         m_enviro_mapping_shader->setSubroutine(RGL::Shader::ShaderType::FRAGMENT, "refraction");
         m_enviro_mapping_shader->setUniform("ior", m_ior);
-        m_enviro_mapping_shader->setUniform("model", m_objects_model_matrices[1]);
-        m_enviro_mapping_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[1]))));
-        m_enviro_mapping_shader->setUniform("mvp", view_projection * m_objects_model_matrices[1]);
+        RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[1]);
         m_lucy->Render();
     }
 
@@ -414,7 +418,7 @@ EnvironmentMapping::CubeMapRenderTarget EnvironmentMapping::generate_cubemap_rt(
 
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
 
     return rt;
 }
@@ -430,5 +434,5 @@ void EnvironmentMapping::render_to_cubemap_rt(CubeMapRenderTarget & rt, int igno
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             render_objects(rt.m_view_transforms[side], m_enviro_projection, rt.m_position, ignore_obj_id);
         }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
 }
@@ -1,4 +1,5 @@
 #version 450
+#include "../../core/uniform_blocks.h"
 
 out vec4 frag_color;
 
@@ -6,7 +7,6 @@ in vec3 world_pos;
 in vec3 world_normal;
 
 layout(binding = 1) uniform samplerCube skybox;
-uniform vec3 cam_pos;
 uniform float ior;
 
 subroutine vec4 enviroMapping();
@@ -14,7 +14,7 @@ layout(location = 0) subroutine uniform enviroMapping enviro_func;
 
 layout(index = 0) subroutine(enviroMapping) vec4 reflection()
 {
-    vec3 i = normalize(world_pos - cam_pos);
+    vec3 i = normalize(world_pos - u_frame.cam_pos);
     vec3 r = reflect(i, normalize(world_normal));
 
     return vec4(texture(skybox, r).rgb, 1.0);
@@ -23,7 +23,7 @@ layout(index = 0) subroutine(enviroMapping) vec4 reflection()
 layout(index = 1) subroutine(enviroMapping) vec4 refraction()
 {
     vec3 ratio = 1.0 / (vec3(ior) + vec3(0.0, 0.01, 0.02));
-    vec3 i = normalize(world_pos - cam_pos);
+    vec3 i = normalize(world_pos - u_frame.cam_pos);
     
     vec3 refract_dir_r = refract(i, normalize(world_normal), ratio.r);
     vec3 refract_dir_g = refract(i, normalize(world_normal), ratio.g);
@@ -2,6 +2,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "texture_cache.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -71,11 +72,9 @@ void ProjectedTexture::init_app()
     m_objects_model_matrices.emplace_back(glm::translate(glm::mat4(1.0), glm::vec3( 0.0, -1.0, -5)));                                                                         // ground plane
 
     /* Add textures to the objects. */
-    auto texture = std::make_shared<RGL::Texture2D>();
-    texture->Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
+    auto texture = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/bricks.png", true);
 
-    auto default_diffuse_texture = std::make_shared<RGL::Texture2D>();
-    default_diffuse_texture->Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
+    auto default_diffuse_texture = RGL::TextureCache::Load(RGL::FileSystem::getResourcesPath() / "textures/default_diffuse.png", true);
 
     m_objects[5]->AddTexture(texture);
 
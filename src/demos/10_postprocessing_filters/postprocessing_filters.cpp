@@ -2,6 +2,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -142,15 +143,22 @@ void PostprocessingFilters::render()
     m_postprocess_filter->bindFilterFBO();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    RGL::UniformBuffers::PushFrameData(*m_camera);
+
+    std::vector<uint32_t> objects_data_offsets(m_objects.size());
+
+    for (unsigned i = 0; i < m_objects.size(); ++i)
+    {
+        objects_data_offsets[i] = RGL::UniformBuffers::PushObjectData(m_objects_model_matrices[i]);
+    }
+
     m_ambient_light_shader->bind();
     m_ambient_light_shader->setUniform("ambient_factor", m_ambient_factor);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
-
     /* First, render the ambient color only for the opaque objects. */
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_ambient_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i]->Render();
     }
@@ -171,15 +179,12 @@ void PostprocessingFilters::render()
     m_directional_light_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_directional_light_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
     
-    m_directional_light_shader->setUniform("cam_pos",            m_camera->position());
     m_directional_light_shader->setUniform("specular_intensity", m_specular_intenstiy.x);
     m_directional_light_shader->setUniform("specular_power",     m_specular_power.x);
 
     for (unsigned i = 0; i < m_objects.size(); ++i)
     {
-        m_directional_light_shader->setUniform("model", m_objects_model_matrices[i]);
-        m_directional_light_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_objects_model_matrices[i]))));
-        m_directional_light_shader->setUniform("mvp", view_projection * m_objects_model_matrices[i]);
+        RGL::UniformBuffers::BindObjectData(objects_data_offsets[i]);
 
         m_objects[i]->Render();
     }
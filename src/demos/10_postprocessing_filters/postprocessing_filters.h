@@ -4,6 +4,7 @@
 #include "camera.h"
 #include "static_model.h"
 #include "shader.h"
+#include "window.h"
 
 #include <memory>
 #include <vector>
@@ -59,7 +60,7 @@ struct PostprocessFilter
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_tex_id, 0);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rbo_id);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
 
         m_shader = std::make_shared<RGL::Shader>("src/demos/10_postprocessing_filters/FSQ.vert", "src/demos/10_postprocessing_filters/PS_filters.frag");
         m_shader->link();
@@ -103,7 +104,7 @@ struct PostprocessFilter
 
     void render(const std::string filter_name)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         m_shader->bind();
@@ -9,9 +9,10 @@ using namespace RGL;
  * Vlachos Alex, Jorg Peters, Chas Boydand Jason L.Mitchell. "Curved PN Triangles".Proceedings of the 2001 Symposium interactive 3D graphics(2001) : 159 - 66.
  * John McDonald. "Tessellation On Any Budget".Game Developers Conference, 2011.
  */
-int main()
+int main(int argc, char* argv[])
 {
     std::shared_ptr<CoreApp> app = std::make_shared<TessellationLoD>();
+    app->parse_command_line(argc, argv);
     app->init(WINDOW_WIDTH, WINDOW_HEIGHT, "PN Triangles Tessellation with Level of Detail Demo" /*title*/, 60.0 /*framerate*/);
     app->start();
 
@@ -3,6 +3,7 @@
 #include "filesystem.h"
 #include "input.h"
 #include "util.h"
+#include "uniform_buffers.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/random.hpp>
@@ -117,17 +118,14 @@ void TessellationLoD::render()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
+    RGL::UniformBuffers::PushFrameData(*m_camera);
 
     /* Draw curve */
     m_pn_tessellation_shader->bind();
-    m_pn_tessellation_shader->setUniform("cam_pos",                          m_camera->position());
-    m_pn_tessellation_shader->setUniform("view_projection",                  view_projection);
     m_pn_tessellation_shader->setUniform("min_tess_level",                   m_min_tess_level);
     m_pn_tessellation_shader->setUniform("max_tess_level",                   m_max_tess_level);
     m_pn_tessellation_shader->setUniform("min_depth",                        m_min_depth);
     m_pn_tessellation_shader->setUniform("max_depth",                        m_max_depth);
-    m_pn_tessellation_shader->setUniform("view_matrix",                      m_camera->m_view);
     m_pn_tessellation_shader->setUniform("directional_light.base.color",     m_dir_light_properties.color);
     m_pn_tessellation_shader->setUniform("directional_light.base.intensity", m_dir_light_properties.intensity);
     m_pn_tessellation_shader->setUniform("directional_light.direction",      m_dir_light_properties.direction);
@@ -137,8 +135,7 @@ void TessellationLoD::render()
 
     for (auto& world_matrix : m_world_matrices)
     {
-        m_pn_tessellation_shader->setUniform("model", world_matrix);
-        m_pn_tessellation_shader->setUniform("normal_matrix", glm::mat3(glm::transpose(glm::inverse(world_matrix))));
+        RGL::UniformBuffers::PushObjectData(world_matrix);
         m_model->Render();
     }
 }
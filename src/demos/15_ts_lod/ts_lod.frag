@@ -1,4 +1,5 @@
 #version 460 core
+#include "../../core/uniform_blocks.h"
 
 layout(location = 0) out vec4 frag_color;
 
@@ -6,7 +7,6 @@ in vec3 world_pos_FS_in;
 in vec3 world_normal_FS_in;
 in vec2 texcoord_FS_in;
 
-uniform vec3 cam_pos;
 uniform vec3 ambient;
 
 uniform float specular_intensity;
@@ -28,7 +28,7 @@ vec4 blinnPhong(BaseLight base, vec3 direction, vec3 normal, vec3 world_pos)
 {
     float diffuse = max(dot(normal, -direction), 0.0);
 
-    vec3 dir_to_eye  = normalize(cam_pos - world_pos);
+    vec3 dir_to_eye  = normalize(u_frame.cam_pos - world_pos);
     vec3 half_vector = normalize(dir_to_eye - direction);
     float specular   = pow(max(dot(half_vector, normal), 0.0), specular_power);
 
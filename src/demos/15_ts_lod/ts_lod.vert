@@ -1,18 +1,16 @@
 #version 460 core
+#include "../../core/uniform_blocks.h"
 layout (location = 0) in vec3 in_pos;
 layout (location = 1) in vec2 in_texcoord;
 layout (location = 2) in vec3 in_normal;
 
-uniform mat4 model;
-uniform mat3 normal_matrix;
-
 out vec3 world_pos_TCS_in;
 out vec3 world_normal_TCS_in;
 out vec2 texcoord_TCS_in;
 
 void main()
 {
-	world_pos_TCS_in    = vec3(model * vec4(in_pos, 1.0));
-	world_normal_TCS_in = normalize(normal_matrix * in_normal);
+	world_pos_TCS_in    = vec3(u_object.model * vec4(in_pos, 1.0));
+	world_normal_TCS_in = normalize(mat3(u_object.normal_matrix) * in_normal);
 	texcoord_TCS_in     = in_texcoord;
 }
\ No newline at end of file
@@ -6,16 +6,32 @@
 #include "gui/gui.h"
 #include <timer.h>
 
+#include <algorithm>
+
+#include <glm/gtc/constants.hpp>
+
 MeshSkinning::MeshSkinning()
-    : m_skinning_method        (SkinningMethod::LBS),
-      m_current_animation_index(0),
-      m_animation_speed        (1.0f),
-      m_gamma                  (0.2f)
+    : m_instance_transforms_ssbo(0),
+      m_instances_count         (1),
+      m_skinning_method         (SkinningMethod::LBS),
+      m_pre_skinning            (false),
+      m_animation_lod_enabled   (false),
+      m_max_bone_evaluations    (0),
+      m_current_animation_index (0),
+      m_overlay_animation_index (0),
+      m_overlay_mask_node       (0),
+      m_overlay_weight          (0.0f),
+      m_cross_fade_duration     (0.3f),
+      m_animation_speed         (1.0f),
+      m_gamma                   (0.2f),
+      m_bone_update_time        (0.0f),
+      m_instances_per_ms        (0.0f)
 {
 }
 
 MeshSkinning::~MeshSkinning()
 {
+    glDeleteBuffers(1, &m_instance_transforms_ssbo);
 }
 
 void MeshSkinning::init_app()
@@ -37,12 +53,80 @@ void MeshSkinning::init_app()
 
     m_animated_model.Load(RGL::FileSystem::getResourcesPath() / "models/fox.glb");
     m_animations_names = m_animated_model.GetAnimationsNames();
-    m_animated_model.SetAnimationSpeed(m_animation_speed);
 
     /* Set model matrices for each model. */
     auto scale_factor = m_animated_model.GetUnitScaleFactor();
     m_object_model_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(scale_factor));
 
+    /* Place the crowd on a grid, sorted by the square ring around the origin, so that the first instances stay in the middle. */
+    const int   grid_size = int(std::ceil(std::sqrt(float(MAX_INSTANCES))));
+    const int   grid_half = grid_size / 2;
+    const float spacing   = 1.5f;
+
+    std::vector<glm::ivec2> grid_cells;
+    grid_cells.reserve(grid_size * grid_size);
+
+    for (int z = -grid_half; z < grid_size - grid_half; ++z)
+    {
+        for (int x = -grid_half; x < grid_size - grid_half; ++x)
+        {
+            grid_cells.emplace_back(x, z);
+        }
+    }
+
+    std::stable_sort(grid_cells.begin(), grid_cells.end(), [](const glm::ivec2& a, const glm::ivec2& b)
+    {
+        return std::max(std::abs(a.x), std::abs(a.y)) < std::max(std::abs(b.x), std::abs(b.y));
+    });
+
+    std::vector<glm::mat4> instance_transforms(MAX_INSTANCES);
+    m_instance_positions.resize(MAX_INSTANCES);
+
+    for (uint32_t i = 0; i < MAX_INSTANCES; ++i)
+    {
+        const glm::vec3 position = glm::vec3(grid_cells[i].x, 0.0f, grid_cells[i].y) * spacing;
+        const float     angle    = i == 0 ? 0.0f : float(RGL::Util::RandomDouble(0.0, glm::two_pi<double>()));
+
+        m_instance_positions[i] = position;
+        instance_transforms[i]  = glm::translate(glm::mat4(1.0f), position) * glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * m_object_model_matrix;
+    }
+
+    glCreateBuffers     (1, &m_instance_transforms_ssbo);
+    glNamedBufferStorage(m_instance_transforms_ssbo, instance_transforms.size() * sizeof(glm::mat4), instance_transforms.data(), 0);
+
+    /* Each instance plays the animation from a different time and at a slightly different speed. */
+    m_animation_layers.resize(MAX_INSTANCES * LAYERS_PER_INSTANCE);
+
+    for (uint32_t i = 1; i < MAX_INSTANCES; ++i)
+    {
+        const float time  = float(RGL::Util::RandomDouble(0.0, 10.0));
+        const float speed = float(RGL::Util::RandomDouble(0.8, 1.2));
+
+        for (uint32_t l = 0; l < LAYERS_PER_INSTANCE; ++l)
+        {
+            m_animation_layers[i * LAYERS_PER_INSTANCE + l].state.time  = time;
+            m_animation_layers[i * LAYERS_PER_INSTANCE + l].state.speed = speed;
+        }
+    }
+
+    /* The overlay is disabled until its weight is raised, it's applied from the neck up if the skeleton has such node. */
+    const auto& skeleton = m_animated_model.GetSkeleton();
+    m_bone_masks.assign(skeleton.GetNodesCount(), RGL::AnimationLayer::NO_BONE_MASK);
+
+    for (uint32_t i = 0; i < skeleton.GetNodesCount(); ++i)
+    {
+        if (skeleton.GetNodeName(i).find("Neck") != std::string::npos)
+        {
+            m_overlay_mask_node = i;
+            break;
+        }
+    }
+
+    set_overlay();
+
+    m_bone_palettes.Create(MAX_INSTANCES, m_animated_model.GetBonesCount());
+    m_animated_model.CreatePreSkinningBuffers(MAX_PRE_SKINNED_INSTANCES);
+
     /* Create shader. */
     std::string dir = "src/demos/20_mesh_skinning/";
 
@@ -54,6 +138,16 @@ void MeshSkinning::init_app()
     m_dqs_skinning_shader = std::make_shared<RGL::Shader>(dir + "skinning_dqs.vert", dir + "skinning.frag");
     m_dqs_skinning_shader->link();
 
+    /* Pre-skinning compute shaders and the shader that draws their output. */
+    m_lbs_pre_skinning_shader = std::make_shared<RGL::Shader>(dir + "pre_skinning_lbs.comp");
+    m_lbs_pre_skinning_shader->link();
+
+    m_dqs_pre_skinning_shader = std::make_shared<RGL::Shader>(dir + "pre_skinning_dqs.comp");
+    m_dqs_pre_skinning_shader->link();
+
+    m_pre_skinned_shader = std::make_shared<RGL::Shader>(dir + "pre_skinned.vert", dir + "skinning.frag");
+    m_pre_skinned_shader->link();
+
     dir = "src/demos/02_simple_3d/";
     m_simple_shader = std::make_shared<RGL::Shader>(dir + "simple_3d.vert", dir + "simple_3d.frag");
     m_simple_shader->link();
@@ -106,16 +200,69 @@ void MeshSkinning::update(double delta_time)
     /* Update variables here. */
     m_camera->update(delta_time);
 
-    switch(m_skinning_method)
+    /* The palettes are written directly to the mapped region that the next render() call draws from. */
+    m_bone_palettes.BeginFrame();
+
+    auto                      layers = std::span(m_animation_layers).first(m_instances_count * LAYERS_PER_INSTANCE);
+    RGL::AnimationUpdateStats stats;
+
+    if (m_animation_lod_enabled)
     {
-        case SkinningMethod::LBS:
-            m_bone_transforms.clear();
-            m_animated_model.BoneTransform(delta_time, m_bone_transforms);
-            break;
-        case SkinningMethod::DQS:
-            m_bone_transforms_dq.clear();
-            m_animated_model.BoneTransform(delta_time, m_bone_transforms_dq);
-            break;
+        m_animation_lod.m_settings.max_bone_evaluations = uint32_t(m_max_bone_evaluations);
+        m_animation_lod.Resize(m_instances_count);
+        m_animation_lod.SelectLods(std::span(m_instance_positions).first(m_instances_count), INSTANCE_BOUNDING_RADIUS, m_camera->position(), m_camera->m_projection[1][1]);
+
+        switch(m_skinning_method)
+        {
+            case SkinningMethod::LBS:
+                m_animation_lod_stats = m_animation_lod.Update(m_animated_model, delta_time * m_animation_speed, layers, LAYERS_PER_INSTANCE, m_bone_palettes.GetPalettes(m_instances_count));
+                break;
+            case SkinningMethod::DQS:
+                m_animation_lod_stats = m_animation_lod.Update(m_animated_model, delta_time * m_animation_speed, layers, LAYERS_PER_INSTANCE, m_bone_palettes.GetPalettesDQ(m_instances_count));
+                break;
+        }
+
+        stats.instances_count = m_animation_lod_stats.evaluated_instances_count;
+        stats.update_time     = m_animation_lod_stats.update_time;
+    }
+    else
+    {
+        switch(m_skinning_method)
+        {
+            case SkinningMethod::LBS:
+                stats = m_animated_model.UpdateInstances(delta_time * m_animation_speed, layers, LAYERS_PER_INSTANCE, m_bone_palettes.GetPalettes(m_instances_count));
+                break;
+            case SkinningMethod::DQS:
+                stats = m_animated_model.UpdateInstances(delta_time * m_animation_speed, layers, LAYERS_PER_INSTANCE, m_bone_palettes.GetPalettesDQ(m_instances_count));
+                break;
+        }
+
+        m_animation_lod_stats = {};
+        m_animation_lod_stats.lod_instances_count[0] = stats.instances_count;
+        m_animation_lod_stats.evaluated_instances_count = stats.instances_count;
+        m_animation_lod_stats.bone_evaluations_count    = stats.instances_count * m_animated_model.GetSkeleton().GetNodesCount();
+    }
+
+    float bone_update_time = float(stats.update_time * 1000.0);
+    float instances_per_ms = float(stats.GetInstancesPerMillisecond());
+
+    m_bone_update_time = m_bone_update_time == 0.0f ? bone_update_time : glm::mix(m_bone_update_time, bone_update_time, 0.05f);
+    m_instances_per_ms = m_instances_per_ms == 0.0f ? instances_per_ms : glm::mix(m_instances_per_ms, instances_per_ms, 0.05f);
+}
+
+void MeshSkinning::set_overlay()
+{
+    if (m_bone_masks[m_overlay_mask_node] == RGL::AnimationLayer::NO_BONE_MASK)
+    {
+        m_bone_masks[m_overlay_mask_node] = m_animated_model.CreateBoneMask(m_animated_model.GetSkeleton().GetNodeName(m_overlay_mask_node));
+    }
+
+    for (uint32_t i = 0; i < MAX_INSTANCES; ++i)
+    {
+        auto& overlay = m_animation_layers[i * LAYERS_PER_INSTANCE + 1];
+
+        overlay.weight    = m_overlay_weight;
+        overlay.bone_mask = m_bone_masks[m_overlay_mask_node];
     }
 }
 
@@ -133,26 +280,45 @@ void MeshSkinning::render()
     m_simple_shader->setUniform("mix_factor", 1.0f);
     m_grid_model.Render();
 
-    /* Draw the animated model. */
-    if (m_skinning_method == SkinningMethod::LBS)
+    m_bone_palettes.Bind(BONE_PALETTES_SSBO_BINDING_INDEX);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_TRANSFORMS_SSBO_BINDING_INDEX, m_instance_transforms_ssbo);
+
+    if (m_pre_skinning)
     {
-        m_lbs_skinning_shader->bind();
-        m_lbs_skinning_shader->setUniform("mvp",   view_projection * m_object_model_matrix);
-        m_lbs_skinning_shader->setUniform("model", m_object_model_matrix);
-        m_lbs_skinning_shader->setUniform("bones", m_bone_transforms.data(), m_bone_transforms.size());
-        m_lbs_skinning_shader->setUniform("gamma", m_gamma);
-    }
+        /* Skin the vertices of all instances once, any number of passes can draw them afterwards with a plain vertex fetch. */
+        const uint32_t instances_count = std::min(uint32_t(m_instances_count), m_animated_model.GetPreSkinningMaxInstancesCount());
+        const uint32_t vertices_count  = m_animated_model.BindPreSkinningBuffers(SKINNING_POSITIONS_SSBO_BINDING_INDEX);
+
+        auto& pre_skinning_shader = m_skinning_method == SkinningMethod::LBS ? m_lbs_pre_skinning_shader : m_dqs_pre_skinning_shader;
 
-    if (m_skinning_method == SkinningMethod::DQS)
+        pre_skinning_shader->bind();
+        pre_skinning_shader->setUniform("vertices_count",  GLuint(vertices_count));
+        pre_skinning_shader->setUniform("instances_count", GLuint(instances_count));
+        pre_skinning_shader->setUniform("bones_count",     GLuint(m_animated_model.GetBonesCount()));
+
+        glDispatchCompute((vertices_count * instances_count + PRE_SKINNING_GROUP_SIZE - 1) / PRE_SKINNING_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+        m_pre_skinned_shader->bind();
+        m_pre_skinned_shader->setUniform("view_projection", view_projection);
+        m_pre_skinned_shader->setUniform("gamma",           m_gamma);
+
+        m_animated_model.RenderPreSkinned(instances_count);
+    }
+    else
     {
-        m_dqs_skinning_shader->bind();
-        m_dqs_skinning_shader->setUniform("mvp",   view_projection * m_object_model_matrix);
-        m_dqs_skinning_shader->setUniform("model", m_object_model_matrix);
-        m_dqs_skinning_shader->setUniform("bones", m_bone_transforms_dq.data(), m_bone_transforms_dq.size());
-        m_dqs_skinning_shader->setUniform("gamma", m_gamma);
+        /* Draw the whole crowd with a single instanced draw call per mesh part. */
+        auto& skinning_shader = m_skinning_method == SkinningMethod::LBS ? m_lbs_skinning_shader : m_dqs_skinning_shader;
+
+        skinning_shader->bind();
+        skinning_shader->setUniform("view_projection", view_projection);
+        skinning_shader->setUniform("bones_count",     GLuint(m_animated_model.GetBonesCount()));
+        skinning_shader->setUniform("gamma",           m_gamma);
+
+        m_animated_model.Render(m_instances_count);
     }
 
-    m_animated_model.Render();
+    m_bone_palettes.EndFrame();
 }
 
 void MeshSkinning::render_gui()
@@ -188,11 +354,16 @@ void MeshSkinning::render_gui()
 
         ImGui::SliderFloat("Gamma", &m_gamma, 0.0, 2.5 , "%.1f");
 
-        if (ImGui::SliderFloat("Animation speed", &m_animation_speed, 0.0, 500.0, "%.1f"))
+        ImGui::SliderFloat("Animation speed", &m_animation_speed, 0.0, 500.0, "%.1f");
+        ImGui::SliderInt  ("Instances",       &m_instances_count, 1,   m_pre_skinning ? MAX_PRE_SKINNED_INSTANCES : MAX_INSTANCES);
+
+        if (ImGui::Checkbox("Pre-skinning (compute shader)", &m_pre_skinning) && m_pre_skinning)
         {
-            m_animated_model.SetAnimationSpeed(m_animation_speed);
+            m_instances_count = std::min(m_instances_count, int(MAX_PRE_SKINNED_INSTANCES));
         }
 
+        ImGui::SliderFloat("Cross-fade duration", &m_cross_fade_duration, 0.0, 2.0, "%.2f s");
+
         if (ImGui::BeginCombo("Animation", m_animations_names[m_current_animation_index].c_str()))
         {
             for (int i = 0; i < m_animations_names.size(); ++i)
@@ -201,7 +372,34 @@ void MeshSkinning::render_gui()
                 if (ImGui::Selectable(m_animations_names[i].c_str(), is_selected))
                 {
                     m_current_animation_index = i;
-                    m_animated_model.SetAnimation(i);
+
+                    for (uint32_t j = 0; j < MAX_INSTANCES; ++j)
+                    {
+                        m_animation_layers[j * LAYERS_PER_INSTANCE].state.CrossFade(i, m_cross_fade_duration);
+                    }
+                }
+
+                if (is_selected)
+                {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        if (ImGui::BeginCombo("Overlay animation", m_animations_names[m_overlay_animation_index].c_str()))
+        {
+            for (int i = 0; i < m_animations_names.size(); ++i)
+            {
+                bool is_selected = (m_overlay_animation_index == i);
+                if (ImGui::Selectable(m_animations_names[i].c_str(), is_selected))
+                {
+                    m_overlay_animation_index = i;
+
+                    for (uint32_t j = 0; j < MAX_INSTANCES; ++j)
+                    {
+                        m_animation_layers[j * LAYERS_PER_INSTANCE + 1].state.CrossFade(i, m_cross_fade_duration);
+                    }
                 }
 
                 if (is_selected)
@@ -212,6 +410,32 @@ void MeshSkinning::render_gui()
             ImGui::EndCombo();
         }
 
+        const auto& skeleton = m_animated_model.GetSkeleton();
+
+        if (ImGui::BeginCombo("Overlay mask", skeleton.GetNodeName(m_overlay_mask_node).c_str()))
+        {
+            for (uint32_t i = 0; i < skeleton.GetNodesCount(); ++i)
+            {
+                bool is_selected = (m_overlay_mask_node == i);
+                if (ImGui::Selectable(skeleton.GetNodeName(i).c_str(), is_selected))
+                {
+                    m_overlay_mask_node = i;
+                    set_overlay();
+                }
+
+                if (is_selected)
+                {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        if (ImGui::SliderFloat("Overlay weight", &m_overlay_weight, 0.0, 1.0, "%.2f"))
+        {
+            set_overlay();
+        }
+
         if (ImGui::BeginCombo("Skinning method", m_skinning_methods_names[int(m_skinning_method)].c_str()))
         {
             for (int i = 0; i < std::size(m_skinning_methods_names); ++i)
@@ -230,6 +454,37 @@ void MeshSkinning::render_gui()
             ImGui::EndCombo();
         }
 
+        ImGui::Text("Bone update: %.2f us (%u bones, %d instances)", m_bone_update_time, m_animated_model.GetBonesCount(), m_instances_count);
+        ImGui::Text("Throughput:  %.1f instances/ms", m_instances_per_ms);
+
+        ImGui::Spacing();
+
+        if (ImGui::Checkbox("Animation LOD", &m_animation_lod_enabled) && m_animation_lod_enabled)
+        {
+            /* The cached palettes are stale after updating without the LOD. */
+            m_animation_lod.Invalidate();
+        }
+
+        if (m_animation_lod_enabled)
+        {
+            auto& settings = m_animation_lod.m_settings;
+
+            static constexpr uint32_t min_interval = 1, max_lod1_interval = 8, max_lod2_interval = 16;
+
+            ImGui::SliderFloat ("LOD 1 screen size", &settings.lod_screen_sizes[0], settings.lod_screen_sizes[1], 1.0f, "%.3f");
+            ImGui::SliderFloat ("LOD 2 screen size", &settings.lod_screen_sizes[1], 0.0f, settings.lod_screen_sizes[0], "%.3f");
+            ImGui::SliderScalar("LOD 1 update interval", ImGuiDataType_U32, &settings.update_intervals[1], &min_interval, &max_lod1_interval);
+            ImGui::SliderScalar("LOD 2 update interval", ImGuiDataType_U32, &settings.update_intervals[2], &min_interval, &max_lod2_interval);
+            ImGui::SliderInt   ("Bone evaluations budget", &m_max_bone_evaluations, 0, 200000);
+        }
+
+        const auto& lod_stats = m_animation_lod_stats;
+
+        ImGui::Text("LOD instances: %u / %u / %u", lod_stats.lod_instances_count[0], lod_stats.lod_instances_count[1], lod_stats.lod_instances_count[2]);
+        ImGui::Text("Evaluated: %u, deferred: %u", lod_stats.evaluated_instances_count, lod_stats.deferred_instances_count);
+        ImGui::Text("Bone evaluations: %u (reduced skeleton: %u of %u nodes)", lod_stats.bone_evaluations_count,
+                    m_animated_model.GetSkeleton().GetReducedNodesCount(), m_animated_model.GetSkeleton().GetNodesCount());
+
         ImGui::PopItemWidth();
     }
     ImGui::End();
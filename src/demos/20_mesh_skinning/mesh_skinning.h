@@ -3,7 +3,10 @@
 
 #include "camera.h"
 #include "animated_model.h"
+#include "animation_lod.h"
+#include "bone_palette_buffer.h"
 #include "shader.h"
+#include "shared.h"
 
 #include <memory>
 #include <vector>
@@ -21,22 +24,47 @@ public:
     void render_gui()              override;
 
 private:
+    /* Applies the overlay's weight and bone mask to the overlay layers of all instances. */
+    void set_overlay();
+
+    static constexpr uint32_t MAX_INSTANCES             = 4096;
+    static constexpr uint32_t MAX_PRE_SKINNED_INSTANCES = 1024; /* The skinned vertices of every instance take a copy of the mesh. */
+    static constexpr uint32_t LAYERS_PER_INSTANCE       = 2;    /* The base layer and the masked overlay. */
+    static constexpr float    INSTANCE_BOUNDING_RADIUS  = 0.5f; /* Of the unit scaled model, used to select the animation LOD. */
+
     enum class SkinningMethod { LBS, DQS };
     const std::string m_skinning_methods_names[2] = { "Linear Blend Skinning", "Dual Quaternion Blend Skinning" };
 
     std::shared_ptr<RGL::Camera> m_camera;
     std::shared_ptr<RGL::Shader> m_lbs_skinning_shader, m_dqs_skinning_shader, m_simple_shader;
+    std::shared_ptr<RGL::Shader> m_lbs_pre_skinning_shader, m_dqs_pre_skinning_shader, m_pre_skinned_shader;
 
     RGL::StaticModel m_grid_model;
     RGL::AnimatedModel m_animated_model;
     std::vector<std::string> m_animations_names;
     glm::mat4 m_object_model_matrix;;
 
-    std::vector<glm::mat4> m_bone_transforms;
-    std::vector<glm::mat2x4> m_bone_transforms_dq;
+    /* The crowd, instance i is drawn with the i-th palette and transform. */
+    RGL::BonePaletteBuffer           m_bone_palettes;
+    std::vector<RGL::AnimationLayer> m_animation_layers;
+    GLuint                           m_instance_transforms_ssbo;
+    std::vector<glm::vec3>           m_instance_positions;
+    RGL::AnimationLodSystem          m_animation_lod;
+    RGL::AnimationLodStats           m_animation_lod_stats;
+    int                              m_instances_count;
 
     SkinningMethod m_skinning_method;
+    bool m_pre_skinning; /* Skin the vertices in a compute shader once per frame. */
+    bool m_animation_lod_enabled;
+    int  m_max_bone_evaluations; /* Per update, 0 for unlimited. */
     uint32_t m_current_animation_index;
+    uint32_t m_overlay_animation_index;
+    uint32_t m_overlay_mask_node; /* The overlay is applied to this node and its descendants. */
+    std::vector<uint32_t> m_bone_masks; /* Mask of each node, AnimationLayer::NO_BONE_MASK until it's used. */
+    float m_overlay_weight;
+    float m_cross_fade_duration;
     float m_animation_speed;
     float m_gamma;
+    float m_bone_update_time; /* Average CPU time [us] of AnimatedModel::UpdateInstances(). */
+    float m_instances_per_ms; /* Average throughput of AnimatedModel::UpdateInstances(). */
 };
\ No newline at end of file
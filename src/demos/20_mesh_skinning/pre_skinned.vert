@@ -0,0 +1,27 @@
+#version 460 core
+#include "shared.h"
+
+/* Plain static mesh attributes, the vertices have been skinned by pre_skinning_*.comp. */
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_texcoord;
+layout(location = 2) in vec3 in_normal;
+
+layout(location = 0) out vec2 v_texcoord;
+layout(location = 1) out vec3 v_normal;
+
+layout(std430, binding = INSTANCE_TRANSFORMS_SSBO_BINDING_INDEX) readonly buffer InstanceTransforms
+{
+    mat4 instance_models[];
+};
+
+uniform mat4 view_projection;
+
+void main()
+{
+    /* AnimatedModel::RenderPreSkinned() passes the instance's index as the base instance. */
+    mat4 model = instance_models[gl_BaseInstance + gl_InstanceID];
+
+    v_texcoord  = in_texcoord;
+    v_normal    = (model * vec4(in_normal, 0.0)).xyz;
+    gl_Position = view_projection * model * vec4(in_position, 1.0);
+}
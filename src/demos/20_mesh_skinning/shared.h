@@ -0,0 +1,15 @@
+#ifdef __cplusplus
+#pragma once
+#endif
+
+#define BONE_PALETTES_SSBO_BINDING_INDEX       0
+#define INSTANCE_TRANSFORMS_SSBO_BINDING_INDEX 1
+#define SKINNING_POSITIONS_SSBO_BINDING_INDEX  2 // AnimatedModel::BindPreSkinningBuffers() binds 7 consecutive buffers starting here
+#define SKINNING_TEXCOORDS_SSBO_BINDING_INDEX  3
+#define SKINNING_NORMALS_SSBO_BINDING_INDEX    4
+#define SKINNING_TANGENTS_SSBO_BINDING_INDEX   5
+#define SKINNING_WEIGHTS_SSBO_BINDING_INDEX    6
+#define SKINNING_BONE_IDS_SSBO_BINDING_INDEX   7
+#define SKINNED_VERTICES_SSBO_BINDING_INDEX    8
+
+#define PRE_SKINNING_GROUP_SIZE 64
@@ -1,4 +1,5 @@
 #version 460 core
+#include "shared.h"
 
 layout(location = 0) in vec3  in_position;
 layout(location = 1) in vec2  in_texcoord;
@@ -9,18 +10,29 @@ layout(location = 5) in ivec4 in_bone_ids;
 layout(location = 0) out vec2 v_texcoord;
 layout(location = 1) out vec3 v_normal;
 
-const int MAX_BONES = 100;
+/* The palettes of all instances, bones_count dual quaternions per instance. */
+layout(std430, binding = BONE_PALETTES_SSBO_BINDING_INDEX) readonly buffer BonePalettes
+{
+	mat2x4 bones[];
+};
+
+layout(std430, binding = INSTANCE_TRANSFORMS_SSBO_BINDING_INDEX) readonly buffer InstanceTransforms
+{
+	mat4 instance_models[];
+};
 
-uniform mat4 mvp;
-uniform mat4 model;
-uniform mat2x4 bones[MAX_BONES];
+uniform mat4 view_projection;
+uniform uint bones_count;
 
 void main()
 {
-	mat2x4 dq0 = bones[in_bone_ids[0]];
-	mat2x4 dq1 = bones[in_bone_ids[1]];
-	mat2x4 dq2 = bones[in_bone_ids[2]];
-	mat2x4 dq3 = bones[in_bone_ids[3]];
+	uint first_bone = uint(gl_InstanceID) * bones_count;
+	mat4 model      = instance_models[gl_InstanceID];
+
+	mat2x4 dq0 = bones[first_bone + in_bone_ids[0]];
+	mat2x4 dq1 = bones[first_bone + in_bone_ids[1]];
+	mat2x4 dq2 = bones[first_bone + in_bone_ids[2]];
+	mat2x4 dq3 = bones[first_bone + in_bone_ids[3]];
 
 	/* Antipodality correction. */
 	if(dot(dq0[0], dq1[0]) < 0.0) dq1 *= -1.0;
@@ -39,7 +51,7 @@ void main()
 	vec3 trans          = 2.0*(blended_dq[0].x*blended_dq[1].yzw - blended_dq[1].x*blended_dq[0].yzw + cross(blended_dq[0].yzw, blended_dq[1].yzw));
 	
 	local_position += trans;
-	gl_Position     = mvp * vec4(local_position, 1.0);
+	gl_Position     = view_projection * model * vec4(local_position, 1.0);
 
 	vec3 local_normal = in_normal + 2.0*cross(blended_dq[0].yzw, cross(blended_dq[0].yzw, in_normal) + blended_dq[0].x*in_normal);
 	v_normal          = (model * vec4(local_normal, 0.0)).xyz;
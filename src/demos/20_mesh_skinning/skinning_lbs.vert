@@ -1,4 +1,5 @@
 #version 460 core
+#include "shared.h"
 
 layout(location = 0) in vec3  in_position;
 layout(location = 1) in vec2  in_texcoord;
@@ -9,18 +10,29 @@ layout(location = 5) in ivec4 in_bone_ids;
 layout(location = 0) out vec2 v_texcoord;
 layout(location = 1) out vec3 v_normal;
 
-const int MAX_BONES = 100;
+/* The palettes of all instances, bones_count matrices per instance. */
+layout(std430, binding = BONE_PALETTES_SSBO_BINDING_INDEX) readonly buffer BonePalettes
+{
+    mat4 bones[];
+};
 
-uniform mat4 mvp;
-uniform mat4 model;
-uniform mat4 bones[MAX_BONES];
+layout(std430, binding = INSTANCE_TRANSFORMS_SSBO_BINDING_INDEX) readonly buffer InstanceTransforms
+{
+    mat4 instance_models[];
+};
+
+uniform mat4 view_projection;
+uniform uint bones_count;
 
 void main()
 {       
-    mat4 bone_transform  = bones[in_bone_ids[0]] * in_weights[0];
-         bone_transform += bones[in_bone_ids[1]] * in_weights[1];
-         bone_transform += bones[in_bone_ids[2]] * in_weights[2];
-         bone_transform += bones[in_bone_ids[3]] * in_weights[3];
+    uint first_bone = uint(gl_InstanceID) * bones_count;
+    mat4 model      = instance_models[gl_InstanceID];
+
+    mat4 bone_transform  = bones[first_bone + in_bone_ids[0]] * in_weights[0];
+         bone_transform += bones[first_bone + in_bone_ids[1]] * in_weights[1];
+         bone_transform += bones[first_bone + in_bone_ids[2]] * in_weights[2];
+         bone_transform += bones[first_bone + in_bone_ids[3]] * in_weights[3];
 
     v_texcoord = in_texcoord;
 
@@ -28,5 +40,5 @@ void main()
     v_normal          = (model * local_normal).xyz;
 
     vec4 local_position = bone_transform * vec4(in_position, 1.0);
-    gl_Position         = mvp * local_position;
+    gl_Position         = view_projection * model * local_position;
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
 #version 460 core
 #include "../22_pbr/pbr-lighting.glh"
 
+// Compile-time settings of the permutations, see Shader::getPermutation(). The sample counts must have a Poisson table below.
+#ifndef BLOCKER_SEARCH_SAMPLES
+#define BLOCKER_SEARCH_SAMPLES 128
+#endif
+
+#ifndef PCF_SAMPLES
+#define PCF_SAMPLES 128
+#endif
+
 layout (location = 3) in vec4 in_pos_light_clip_space;
 layout (location = 4) in vec4 in_pos_light_view_space;
 
@@ -13,11 +22,9 @@ layout (binding = 11)  uniform sampler3D       s_random_angles;
 uniform vec3 u_offset_tex_size;
 uniform float u_radius;
 
-uniform int   u_blocker_search_samples;
 uniform float u_light_radius_uv;
 uniform float u_light_near;
 uniform float u_light_far;
-uniform int   u_pcf_samples;
 
 float correction_factor = 1.0;
 
@@ -380,6 +387,30 @@ const vec2 Poisson128[128] = vec2[](
     vec2(0.9608918, -0.03495717),
     vec2(0.972032, 0.2271516));
 
+#if BLOCKER_SEARCH_SAMPLES == 25
+#define BLOCKER_SEARCH_POISSON Poisson25
+#elif BLOCKER_SEARCH_SAMPLES == 32
+#define BLOCKER_SEARCH_POISSON Poisson32
+#elif BLOCKER_SEARCH_SAMPLES == 64
+#define BLOCKER_SEARCH_POISSON Poisson64
+#elif BLOCKER_SEARCH_SAMPLES == 100
+#define BLOCKER_SEARCH_POISSON Poisson100
+#else
+#define BLOCKER_SEARCH_POISSON Poisson128
+#endif
+
+#if PCF_SAMPLES == 25
+#define PCF_POISSON Poisson25
+#elif PCF_SAMPLES == 32
+#define PCF_POISSON Poisson32
+#elif PCF_SAMPLES == 64
+#define PCF_POISSON Poisson64
+#elif PCF_SAMPLES == 100
+#define PCF_POISSON Poisson100
+#else
+#define PCF_POISSON Poisson128
+#endif
+
 // Using similar triangles from the surface point to the area light
 float searchRegionRadiusUV(float z_world)
 {
@@ -426,20 +457,9 @@ void findBlocker(out float accum_blocker_depth,
     num_blockers        = 0.0;
     float biased_depth  = z0 - bias;
 
-    for (int i = 0; i < u_blocker_search_samples; ++i)
+    for (int i = 0; i < BLOCKER_SEARCH_SAMPLES; ++i)
     {
-        vec2 offset;
-
-        if (u_blocker_search_samples == 25)
-            offset = Poisson25[i];
-        else if (u_blocker_search_samples == 32)
-            offset = Poisson32[i];
-        else if (u_blocker_search_samples == 64)
-            offset = Poisson64[i];
-        else if (u_blocker_search_samples == 100)
-            offset = Poisson100[i];
-        else if (u_blocker_search_samples == 128)
-            offset = Poisson128[i];
+        vec2 offset = BLOCKER_SEARCH_POISSON[i];
 
         // Add random rotation to the offset 
         offset = vec2(random_rotation.x * offset.x - random_rotation.y * offset.y,
@@ -466,20 +486,9 @@ float shadowPCF(vec2 uv, float z0, float bias, float filter_radius_uv)
 
     float sum = 0.0;
 
-    for (int i = 0; i < u_pcf_samples; ++i)
+    for (int i = 0; i < PCF_SAMPLES; ++i)
     {
-        vec2 offset;
-
-        if (u_pcf_samples == 25)
-            offset = Poisson25[i];
-        else if (u_pcf_samples == 32)
-            offset = Poisson32[i];
-        else if (u_pcf_samples == 64)
-            offset = Poisson64[i];
-        else if (u_pcf_samples == 100)
-            offset = Poisson100[i];
-        else if (u_pcf_samples == 128)
-            offset = Poisson128[i];
+        vec2 offset = PCF_POISSON[i];
 
         // Add random rotation to the offset 
         offset = vec2(random_rotation.x * offset.x - random_rotation.y * offset.y,
@@ -489,7 +498,7 @@ float shadowPCF(vec2 uv, float z0, float bias, float filter_radius_uv)
         sum += texture(s_shadow_map_pcf, vec3(uv + offset, z0 - bias));
     }
 
-    return sum / float(u_pcf_samples);
+    return sum / float(PCF_SAMPLES);
 }
 
 // ------------------------------------------------------------------
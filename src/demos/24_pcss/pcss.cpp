@@ -11,7 +11,7 @@ PCSS::PCSS()
         m_spot_light_angles        (90.0f, -25.0f),
         m_exposure                 (0.3f),
         m_gamma                    (3.6f),
-        m_background_lod_level     (1.2),
+        m_background_lod_level     (0.2),
         m_skybox_vao               (0),
         m_skybox_vbo               (0),
         m_dir_shadow_map           (0),
@@ -151,18 +151,6 @@ void PCSS::init_app()
     m_ambient_light_shader = std::make_shared<RGL::Shader>(dir + "pbr-lighting.vert", dir + "pbr-ambient.frag");
     m_ambient_light_shader->link();
 
-    m_equirectangular_to_cubemap_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "equirectangular_to_cubemap.frag");
-    m_equirectangular_to_cubemap_shader->link();
-
-    m_irradiance_convolution_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "irradiance_convolution.frag");
-    m_irradiance_convolution_shader->link();
-
-    m_prefilter_env_map_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "prefilter_cubemap.frag");
-    m_prefilter_env_map_shader->link();
-
-    m_precompute_brdf = std::make_shared<RGL::Shader>("src/demos/10_postprocessing_filters/FSQ.vert", dir + "precompute_brdf.frag");
-    m_precompute_brdf->link();
-
     m_background_shader = std::make_shared<RGL::Shader>(dir + "background.vert", dir + "background.frag");
     m_background_shader->link();
 
@@ -171,23 +159,7 @@ void PCSS::init_app()
     // IBL precomputations
     GenSkyboxGeometry();
 
-    m_env_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_env_cubemap_rt->set_position(glm::vec3(0.0));
-    m_env_cubemap_rt->generate_rt(2048, 2048, true);
-
-    m_irradiance_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_irradiance_cubemap_rt->set_position(glm::vec3(0.0));
-    m_irradiance_cubemap_rt->generate_rt(32, 32);
-
-    m_prefiltered_env_map_rt = std::make_shared<CubeMapRenderTarget>();
-    m_prefiltered_env_map_rt->set_position(glm::vec3(0.0));
-    m_prefiltered_env_map_rt->generate_rt(512, 512, true);
-
-    m_brdf_lut_rt = std::make_shared<Texture2DRenderTarget>();
-    m_brdf_lut_rt->generate_rt(512, 512);
-
-    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
-    PrecomputeBRDF(m_brdf_lut_rt);
+    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
 
     // Shadows
     m_dir_light_shadow_map_res = glm::uvec2(1024);
@@ -210,8 +182,9 @@ void PCSS::init_app()
     m_generate_shadow_map_shader = std::make_shared<RGL::Shader>(dir + "generate_shadow_map.vert", dir + "generate_shadow_map.frag");
     m_generate_shadow_map_shader->link();
 
+    /* Built per permutation of the PCSS settings, see RenderTexturedModels(). */
     m_directional_light_shader = std::make_shared<RGL::Shader>(dir + "pbr-lighting-shadow.vert", dir + "pbr-directional-shadow.frag");
-    m_directional_light_shader->link();
+    UpdateDirectionalLightPermutation();
 
     glEnable(GL_CULL_FACE);  
 }
@@ -272,120 +245,6 @@ void PCSS::update(double delta_time)
     m_camera->update(delta_time);
 }
 
-void PCSS::HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt, const std::shared_ptr<RGL::Texture2D>& m_equirectangular_map)
-{
-    /* Update all faces per frame */
-    m_equirectangular_to_cubemap_shader->bind();
-    m_equirectangular_to_cubemap_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_equirectangular_map->Bind(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_equirectangular_to_cubemap_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void PCSS::IrradianceConvolution(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    /* Update all faces per frame */
-    m_irradiance_convolution_shader->bind();
-    m_irradiance_convolution_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_env_cubemap_rt->bindTexture(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_irradiance_convolution_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void PCSS::PrefilterCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    m_prefilter_env_map_shader->bind();
-    m_prefilter_env_map_shader->setUniform("u_projection", cubemap_rt->m_projection);
-    
-    m_env_cubemap_rt->bindTexture(1);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-
-    uint8_t max_mip_levels = glm::log2(float(cubemap_rt->m_width));
-    for (uint8_t mip = 0; mip < max_mip_levels; ++mip)
-    {
-        // resize the framebuffer according to mip-level size.
-        uint32_t mip_width  = cubemap_rt->m_width  * std::pow(0.5, mip);
-        uint32_t mip_height = cubemap_rt->m_height * std::pow(0.5, mip);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, cubemap_rt->m_rbo_id);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mip_width, mip_height);
-        glViewport(0, 0, mip_width, mip_height);
-
-        float roughness = float(mip) / float(max_mip_levels - 1);
-        m_prefilter_env_map_shader->setUniform("u_roughness", roughness);
-
-        for (uint8_t side = 0; side < 6; ++side)
-        {
-            m_prefilter_env_map_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, mip);
-
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glBindVertexArray(m_skybox_vao);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void PCSS::PrecomputeIndirectLight(const std::filesystem::path& hdri_map_filepath)
-{
-    auto envmap_hdr = std::make_shared<RGL::Texture2D>();
-    envmap_hdr->LoadHdr(hdri_map_filepath);
-    auto envmap_metadata = envmap_hdr->GetMetadata();
-
-    HdrEquirectangularToCubemap(m_env_cubemap_rt, envmap_hdr);
-
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap_rt->m_cubemap_texture_id);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    IrradianceConvolution(m_irradiance_cubemap_rt);
-    PrefilterCubemap(m_prefiltered_env_map_rt);
-}
-
-void PCSS::PrecomputeBRDF(const std::shared_ptr<Texture2DRenderTarget>& rt)
-{
-    GLuint m_dummy_vao_id;
-    glCreateVertexArrays(1, &m_dummy_vao_id);
-
-    rt->bindRenderTarget();
-    m_precompute_brdf->bind();
-
-    glBindVertexArray(m_dummy_vao_id);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    glDeleteVertexArrays(1, &m_dummy_vao_id);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
 void PCSS::GenSkyboxGeometry()
 {
     m_skybox_vao = 0;
@@ -544,6 +403,12 @@ void PCSS::UpdateLightMatrix()
     m_dir_shadow_frustum_planes = glm::vec2(min_extents.z, max_extents.z);
 }
 
+void PCSS::UpdateDirectionalLightPermutation()
+{
+    m_directional_light_permutation = &m_directional_light_shader->getPermutation({ { "BLOCKER_SEARCH_SAMPLES", std::to_string(m_blocker_search_samples) },
+                                                                                     { "PCF_SAMPLES",            std::to_string(m_pcf_filter_samples)     } });
+}
+
 void PCSS::RenderTexturedModels()
 {
     m_ambient_light_shader->bind();
@@ -558,9 +423,7 @@ void PCSS::RenderTexturedModels()
     auto view_projection = m_camera->m_projection * m_camera->m_view;
 
     /* First, render the ambient color only for the opaque objects. */
-    m_irradiance_cubemap_rt->bindTexture(6);
-    m_prefiltered_env_map_rt->bindTexture(7);
-    m_brdf_lut_rt->bindTexture(8);
+    m_ibl.Bind();
 
     for (uint32_t i = 0; i < std::size(m_textured_models_model_matrices); ++i)
     {
@@ -580,25 +443,25 @@ void PCSS::RenderTexturedModels()
     glDepthMask(GL_FALSE);
     glDepthFunc(GL_EQUAL);
 
-    /* Render directional light(s) */
-    m_directional_light_shader->bind();
-    m_directional_light_shader->setUniform("u_cam_pos",           m_camera->position());
-    m_directional_light_shader->setUniform("u_has_albedo_map",    true);
-    m_directional_light_shader->setUniform("u_has_normal_map",    true);
-    m_directional_light_shader->setUniform("u_has_metallic_map",  true);
-    m_directional_light_shader->setUniform("u_has_roughness_map", true);
-
-    m_directional_light_shader->setUniform("u_directional_light.base.color",     m_dir_light_properties.color);
-    m_directional_light_shader->setUniform("u_directional_light.base.intensity", m_dir_light_properties.intensity);
-    m_directional_light_shader->setUniform("u_directional_light.direction",      m_dir_light_properties.direction);
-    m_directional_light_shader->setUniform("u_light_view_projection",            m_dir_light_view_projection);
-    m_directional_light_shader->setUniform("u_light_view",                       m_dir_light_view);
-
-    m_directional_light_shader->setUniform("u_blocker_search_samples", m_blocker_search_samples);
-    m_directional_light_shader->setUniform("u_pcf_samples",            m_pcf_filter_samples);
-    m_directional_light_shader->setUniform("u_light_radius_uv",        m_light_radius_uv / (m_dir_shadow_frustum_size * 2.0f));
-    m_directional_light_shader->setUniform("u_light_near",             m_dir_shadow_frustum_planes.x);
-    m_directional_light_shader->setUniform("u_light_far",              m_dir_shadow_frustum_planes.y);
+    /* Render directional light(s), the sample counts are compiled into the shader. */
+    auto & directional_light_shader = *m_directional_light_permutation;
+    directional_light_shader.bind();
+
+    directional_light_shader.setUniform("u_cam_pos",           m_camera->position());
+    directional_light_shader.setUniform("u_has_albedo_map",    true);
+    directional_light_shader.setUniform("u_has_normal_map",    true);
+    directional_light_shader.setUniform("u_has_metallic_map",  true);
+    directional_light_shader.setUniform("u_has_roughness_map", true);
+
+    directional_light_shader.setUniform("u_directional_light.base.color",     m_dir_light_properties.color);
+    directional_light_shader.setUniform("u_directional_light.base.intensity", m_dir_light_properties.intensity);
+    directional_light_shader.setUniform("u_directional_light.direction",      m_dir_light_properties.direction);
+    directional_light_shader.setUniform("u_light_view_projection",            m_dir_light_view_projection);
+    directional_light_shader.setUniform("u_light_view",                       m_dir_light_view);
+
+    directional_light_shader.setUniform("u_light_radius_uv",        m_light_radius_uv / (m_dir_shadow_frustum_size * 2.0f));
+    directional_light_shader.setUniform("u_light_near",             m_dir_shadow_frustum_planes.x);
+    directional_light_shader.setUniform("u_light_far",              m_dir_shadow_frustum_planes.y);
 
     m_shadow_map_pcf_sampler.Bind(10);
 
@@ -608,9 +471,9 @@ void PCSS::RenderTexturedModels()
    
     for (unsigned i = 0; i < std::size(m_textured_models_model_matrices); ++i)
     {
-        m_directional_light_shader->setUniform("u_model",         m_textured_models_model_matrices[i]);
-        m_directional_light_shader->setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_textured_models_model_matrices[i]))));
-        m_directional_light_shader->setUniform("u_mvp",           view_projection * m_textured_models_model_matrices[i]);
+        directional_light_shader.setUniform("u_model",         m_textured_models_model_matrices[i]);
+        directional_light_shader.setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_textured_models_model_matrices[i]))));
+        directional_light_shader.setUniform("u_mvp",           view_projection * m_textured_models_model_matrices[i]);
 
         m_textured_models[i].Render();
     }
@@ -636,7 +499,7 @@ void PCSS::render()
     m_background_shader->setUniform("u_projection", m_camera->m_projection);
     m_background_shader->setUniform("u_view", glm::mat4(glm::mat3(m_camera->m_view)));
     m_background_shader->setUniform("u_lod_level", m_background_lod_level);
-    m_env_cubemap_rt->bindTexture();
+    m_ibl.BindEnvironmentMap();
     
     glCullFace(GL_FRONT);
     glBindVertexArray(m_skybox_vao);
@@ -681,7 +544,7 @@ void PCSS::render_gui()
         ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
         ImGui::SliderFloat("Exposure",             &m_exposure,             0.0, 10.0, "%.1f");
         ImGui::SliderFloat("Gamma",                &m_gamma,                0.0, 10.0, "%.1f");
-        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_env_cubemap_rt->m_width)), "%.1f");
+        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_ibl.GetEnvironmentSize())), "%.1f");
 
         if (ImGui::BeginCombo("HDR map", m_hdr_maps_names[m_current_hdr_map_idx].c_str()))
         {
@@ -692,7 +555,7 @@ void PCSS::render_gui()
                 {
                     glDisable(GL_CULL_FACE);
                     m_current_hdr_map_idx = i;
-                    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL/" / m_hdr_maps_names[m_current_hdr_map_idx]);
+                    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL/" / m_hdr_maps_names[m_current_hdr_map_idx]);
                     glEnable(GL_CULL_FACE);
                 }
 
@@ -715,11 +578,13 @@ void PCSS::render_gui()
             if (ImGui::Combo("Blocker search samples", &m_blocker_search_samples_idx, listbox_items, std::size(listbox_items)))
             {
                 m_blocker_search_samples = sample_counts[m_blocker_search_samples_idx];
+                UpdateDirectionalLightPermutation();
             }
 
             if (ImGui::Combo("PCF filter samples", &m_pcf_filter_samples_idx, listbox_items, std::size(listbox_items)))
             {
                 m_pcf_filter_samples = sample_counts[m_pcf_filter_samples_idx];
+                UpdateDirectionalLightPermutation();
             }
 
             ImGui::SliderFloat("Light radius", &m_light_radius_uv, 0.0, 1.0, "%.2f");
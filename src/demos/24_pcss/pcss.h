@@ -2,8 +2,10 @@
 #include "core_app.h"
 
 #include "camera.h"
+#include "ibl.h"
 #include "static_model.h"
 #include "shader.h"
+#include "window.h"
 
 #include <memory>
 #include <vector>
@@ -97,7 +99,7 @@ struct PostprocessFilter
 
     void render(float exposure, float gamma)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         m_shader->bind();
@@ -129,184 +131,21 @@ public:
     void render_gui()              override;
 
 private:
-    struct Texture2DRenderTarget
-    {
-        GLuint m_texture_id = 0;
-        GLuint m_fbo_id = 0;
-        GLuint m_rbo_id = 0;
-        GLuint m_width = 0, m_height = 0;
-
-        ~Texture2DRenderTarget() { cleanup(); }
-
-        void bindTexture(GLuint unit = 0)
-        {
-            glBindTextureUnit(unit, m_texture_id);
-        }
-
-        void bindRenderTarget()
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_id);
-            glViewport(0, 0, m_width, m_height);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        }
-
-        void cleanup()
-        {
-            if (m_texture_id != 0)
-            {
-                glDeleteTextures(1, &m_texture_id);
-            }
-
-            if (m_fbo_id != 0)
-            {
-                glDeleteFramebuffers(1, &m_fbo_id);
-            }
-
-            if (m_rbo_id != 0)
-            {
-                glDeleteRenderbuffers(1, &m_rbo_id);
-            }
-        }
-
-        void generate_rt(uint32_t width, uint32_t height)
-        {
-            m_width = width;
-            m_height = height;
-
-            glGenTextures(1, &m_texture_id);
-            glBindTexture(GL_TEXTURE_2D, m_texture_id);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, m_width, m_height, 0, GL_RG, GL_FLOAT, 0);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            glGenFramebuffers(1, &m_fbo_id);
-            glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_id);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture_id, 0);
-
-            glGenRenderbuffers(1, &m_rbo_id);
-            glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_id);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo_id);
-
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-    };
-
-    struct CubeMapRenderTarget
-    {
-        glm::mat4 m_view_transforms[6];
-        glm::mat4 m_projection;
-
-        GLuint    m_cubemap_texture_id = 0;
-        GLuint    m_fbo_id             = 0;
-        GLuint    m_rbo_id             = 0;
-        glm::vec3 m_position           = glm::vec3(0.0f);
-        GLuint m_width, m_height;
-
-        ~CubeMapRenderTarget() { cleanup(); }
-
-        void set_position(const glm::vec3 pos)
-        {
-            m_position = pos;
-            m_view_transforms[0] = glm::lookAt(pos, pos + glm::vec3( 1,  0,  0), glm::vec3(0, -1,  0));
-            m_view_transforms[1] = glm::lookAt(pos, pos + glm::vec3(-1,  0,  0), glm::vec3(0, -1,  0));
-            m_view_transforms[2] = glm::lookAt(pos, pos + glm::vec3( 0,  1,  0), glm::vec3(0,  0,  1));
-            m_view_transforms[3] = glm::lookAt(pos, pos + glm::vec3( 0, -1,  0), glm::vec3(0,  0, -1));
-            m_view_transforms[4] = glm::lookAt(pos, pos + glm::vec3( 0,  0,  1), glm::vec3(0, -1,  0));
-            m_view_transforms[5] = glm::lookAt(pos, pos + glm::vec3( 0,  0, -1), glm::vec3(0, -1,  0));
-
-            m_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-        }
-
-        void bindTexture(GLuint unit = 0)
-        {
-            glBindTextureUnit(unit, m_cubemap_texture_id);
-        }
-
-        void cleanup()
-        {
-            if (m_cubemap_texture_id != 0)
-            {
-                glDeleteTextures(1, &m_cubemap_texture_id);
-            }
-
-            if (m_fbo_id != 0)
-            {
-                glDeleteFramebuffers(1, &m_fbo_id);
-            }
-
-            if (m_rbo_id != 0)
-            {
-                glDeleteRenderbuffers(1, &m_rbo_id);
-            }
-        }
-
-        void generate_rt(uint32_t width, uint32_t height, bool gen_mip_levels = false)
-        {
-            m_width  = width;
-            m_height = height;
-
-            glGenTextures(1, &m_cubemap_texture_id);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture_id);
-
-            for (uint8_t i = 0; i < 6; ++i)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, 0);
-            }
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, gen_mip_levels ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-            if (gen_mip_levels) glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-            glGenFramebuffers(1, &m_fbo_id);
-            glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_id);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_cubemap_texture_id, 0);
-
-            glGenRenderbuffers(1, &m_rbo_id);
-            glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_id);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo_id);
-
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-    }; 
-
-    void HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget> & cubemap_rt, const std::shared_ptr<RGL::Texture2D> & m_equirectangular_map);
-    void IrradianceConvolution      (const std::shared_ptr<CubeMapRenderTarget> & cubemap_rt);
-    void PrefilterCubemap           (const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt);
-    void PrecomputeIndirectLight    (const std::filesystem::path & hdri_map_filepath);
-    void PrecomputeBRDF             (const std::shared_ptr<Texture2DRenderTarget>& rt);
     void GenSkyboxGeometry();
 
     void RenderTexturedModels();
 
-    std::shared_ptr<CubeMapRenderTarget> m_env_cubemap_rt;
-    std::shared_ptr<CubeMapRenderTarget> m_irradiance_cubemap_rt;
-    std::shared_ptr<CubeMapRenderTarget> m_prefiltered_env_map_rt;
-    std::shared_ptr<Texture2DRenderTarget> m_brdf_lut_rt;
+    /* Resolves the permutation of the directional light shader, when its settings change. */
+    void UpdateDirectionalLightPermutation();
+
+    RGL::IBL m_ibl;
 
-    std::shared_ptr<RGL::Shader> m_equirectangular_to_cubemap_shader;
-    std::shared_ptr<RGL::Shader> m_irradiance_convolution_shader;
-    std::shared_ptr<RGL::Shader> m_prefilter_env_map_shader;
-    std::shared_ptr<RGL::Shader> m_precompute_brdf;
     std::shared_ptr<RGL::Shader> m_background_shader;
 
     std::shared_ptr<RGL::Camera> m_camera;
     std::shared_ptr<RGL::Shader> m_ambient_light_shader;
     std::shared_ptr<RGL::Shader> m_directional_light_shader;
+    RGL::Shader*                 m_directional_light_permutation = nullptr; /* Owned by m_directional_light_shader. */
 
     RGL::StaticModel m_textured_models[5];
     glm::mat4 m_textured_models_model_matrices[5];
@@ -12,7 +12,7 @@ CascadedPCSS::CascadedPCSS()
         m_spot_light_angles        (90.0f, -25.0f),
         m_exposure                 (0.3f),
         m_gamma                    (3.6f),
-        m_background_lod_level     (1.2),
+        m_background_lod_level     (0.2),
         m_skybox_vao               (0),
         m_skybox_vbo               (0),
         m_shadow_fbo               (0),
@@ -126,18 +126,6 @@ void CascadedPCSS::init_app()
     m_ambient_light_shader = std::make_shared<RGL::Shader>(dir + "pbr-lighting.vert", dir + "pbr-ambient.frag");
     m_ambient_light_shader->link();
 
-    m_equirectangular_to_cubemap_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "equirectangular_to_cubemap.frag");
-    m_equirectangular_to_cubemap_shader->link();
-
-    m_irradiance_convolution_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "irradiance_convolution.frag");
-    m_irradiance_convolution_shader->link();
-
-    m_prefilter_env_map_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "prefilter_cubemap.frag");
-    m_prefilter_env_map_shader->link();
-
-    m_precompute_brdf = std::make_shared<RGL::Shader>("src/demos/10_postprocessing_filters/FSQ.vert", dir + "precompute_brdf.frag");
-    m_precompute_brdf->link();
-
     m_background_shader = std::make_shared<RGL::Shader>(dir + "background.vert", dir + "background.frag");
     m_background_shader->link();
 
@@ -146,31 +134,16 @@ void CascadedPCSS::init_app()
     // IBL precomputations
     GenSkyboxGeometry();
 
-    m_env_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_env_cubemap_rt->set_position(glm::vec3(0.0));
-    m_env_cubemap_rt->generate_rt(2048, 2048, true);
-
-    m_irradiance_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_irradiance_cubemap_rt->set_position(glm::vec3(0.0));
-    m_irradiance_cubemap_rt->generate_rt(32, 32);
-
-    m_prefiltered_env_map_rt = std::make_shared<CubeMapRenderTarget>();
-    m_prefiltered_env_map_rt->set_position(glm::vec3(0.0));
-    m_prefiltered_env_map_rt->generate_rt(512, 512, true);
-
-    m_brdf_lut_rt = std::make_shared<Texture2DRenderTarget>();
-    m_brdf_lut_rt->generate_rt(512, 512);
-
-    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
-    PrecomputeBRDF(m_brdf_lut_rt);
+    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
 
     // Shadows
     dir = "src/demos/25_cascaded_pcss/";
     m_generate_shadow_map_shader = std::make_shared<RGL::Shader>(dir + "generate_csm.vert", dir + "generate_csm.frag", dir + "generate_csm.geom");
     m_generate_shadow_map_shader->link();
 
+    /* Built per permutation of the PCSS settings, see RenderTexturedModels(). */
     m_directional_light_shader = std::make_shared<RGL::Shader>(dir + "pbr-lighting-shadow.vert", dir + "pbr-directional-shadow.frag");
-    m_directional_light_shader->link();
+    UpdateDirectionalLightPermutation();
 
     m_visualize_shadow_map_shader = std::make_shared<RGL::Shader>("src/demos/10_postprocessing_filters/FSQ.vert", dir + "visualize_csm_depth.frag");
     m_visualize_shadow_map_shader->link();
@@ -262,120 +235,6 @@ void CascadedPCSS::update(double delta_time)
     m_camera->update(delta_time);
 }
 
-void CascadedPCSS::HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt, const std::shared_ptr<RGL::Texture2D>& m_equirectangular_map)
-{
-    /* Update all faces per frame */
-    m_equirectangular_to_cubemap_shader->bind();
-    m_equirectangular_to_cubemap_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_equirectangular_map->Bind(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_equirectangular_to_cubemap_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void CascadedPCSS::IrradianceConvolution(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    /* Update all faces per frame */
-    m_irradiance_convolution_shader->bind();
-    m_irradiance_convolution_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_env_cubemap_rt->bindTexture(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_irradiance_convolution_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void CascadedPCSS::PrefilterCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    m_prefilter_env_map_shader->bind();
-    m_prefilter_env_map_shader->setUniform("u_projection", cubemap_rt->m_projection);
-    
-    m_env_cubemap_rt->bindTexture(1);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-
-    uint8_t max_mip_levels = glm::log2(float(cubemap_rt->m_width));
-    for (uint8_t mip = 0; mip < max_mip_levels; ++mip)
-    {
-        // resize the framebuffer according to mip-level size.
-        uint32_t mip_width  = cubemap_rt->m_width  * std::pow(0.5, mip);
-        uint32_t mip_height = cubemap_rt->m_height * std::pow(0.5, mip);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, cubemap_rt->m_rbo_id);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mip_width, mip_height);
-        glViewport(0, 0, mip_width, mip_height);
-
-        float roughness = float(mip) / float(max_mip_levels - 1);
-        m_prefilter_env_map_shader->setUniform("u_roughness", roughness);
-
-        for (uint8_t side = 0; side < 6; ++side)
-        {
-            m_prefilter_env_map_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, mip);
-
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glBindVertexArray(m_skybox_vao);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void CascadedPCSS::PrecomputeIndirectLight(const std::filesystem::path& hdri_map_filepath)
-{
-    auto envmap_hdr = std::make_shared<RGL::Texture2D>();
-    envmap_hdr->LoadHdr(hdri_map_filepath);
-    auto envmap_metadata = envmap_hdr->GetMetadata();
-
-    HdrEquirectangularToCubemap(m_env_cubemap_rt, envmap_hdr);
-
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap_rt->m_cubemap_texture_id);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    IrradianceConvolution(m_irradiance_cubemap_rt);
-    PrefilterCubemap(m_prefiltered_env_map_rt);
-}
-
-void CascadedPCSS::PrecomputeBRDF(const std::shared_ptr<Texture2DRenderTarget>& rt)
-{
-    GLuint m_dummy_vao_id;
-    glCreateVertexArrays(1, &m_dummy_vao_id);
-
-    rt->bindRenderTarget();
-    m_precompute_brdf->bind();
-
-    glBindVertexArray(m_dummy_vao_id);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    glDeleteVertexArrays(1, &m_dummy_vao_id);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
 void CascadedPCSS::GenSkyboxGeometry()
 {
     m_skybox_vao = 0;
@@ -482,10 +341,18 @@ void CascadedPCSS::GenerateShadowMap(uint32_t width, uint32_t height)
 
     m_generate_shadow_map_shader->setUniform("u_light_view_projections", m_dir_light_view_projection_matrices.data(), m_dir_light_view_projection_matrices.size());
 
+    /* Each model is rendered to all of the cascades at once, so a mesh part is culled only if it's outside of every cascade's frustum. */
+    std::vector<glm::mat4> light_model_view_projections(m_dir_light_view_projection_matrices.size());
+
     for (uint32_t i = 0; i < m_models_with_model_matrices.size(); ++i)
     {
+        for (uint32_t c = 0; c < m_dir_light_view_projection_matrices.size(); ++c)
+        {
+            light_model_view_projections[c] = m_dir_light_view_projection_matrices[c] * m_models_with_model_matrices[i].second;
+        }
+
         m_generate_shadow_map_shader->setUniform("u_model", m_models_with_model_matrices[i].second);
-        m_models_with_model_matrices[i].first->Render();
+        m_models_with_model_matrices[i].first->Render(light_model_view_projections);
     }
     glCullFace(GL_BACK);
 }
@@ -632,7 +499,7 @@ void CascadedPCSS::update_csm_frusta()
         glm::mat4 light_ortho_matrix = glm::ortho(min_extents.x, max_extents.x, min_extents.y, max_extents.y, 0.0f, max_extents.z - min_extents.z);
 
         float split_depth = (m_camera->NearPlane() + split_dist * clip_range) * -1.0f;
-        m_directional_light_shader->setUniform("u_cascade_splits[" + std::to_string(i) + "]", split_depth);
+        m_cascade_split_depths[i] = split_depth;
 
         avg_frustum_size = glm::max(avg_frustum_size, max_extents.x - min_extents.x);
 
@@ -661,7 +528,18 @@ void CascadedPCSS::update_csm_frusta()
         last_split_dist = split_dist;
     }
 
-    m_directional_light_shader->setUniform("u_light_radius_uv", m_light_radius_uv / avg_frustum_size);
+    m_light_radius_uv_scaled = m_light_radius_uv / avg_frustum_size;
+}
+
+void CascadedPCSS::UpdateDirectionalLightPermutation()
+{
+    RGL::ShaderDefines defines = { { "BLOCKER_SEARCH_SAMPLES", std::to_string(m_blocker_search_samples) },
+                                   { "PCF_SAMPLES",            std::to_string(m_pcf_filter_samples)     } };
+
+    if (m_hard_shadows)  defines["HARD_SHADOWS"]  = "";
+    if (m_show_cascades) defines["SHOW_CASCADES"] = "";
+
+    m_directional_light_permutation = &m_directional_light_shader->getPermutation(defines);
 }
 
 void CascadedPCSS::RenderTexturedModels()
@@ -678,9 +556,7 @@ void CascadedPCSS::RenderTexturedModels()
     auto view_projection = m_camera->m_projection * m_camera->m_view;
 
     /* First, render the ambient color only for the opaque objects. */
-    m_irradiance_cubemap_rt->bindTexture(6);
-    m_prefiltered_env_map_rt->bindTexture(7);
-    m_brdf_lut_rt->bindTexture(8);
+    m_ibl.Bind();
 
     for (uint32_t i = 0; i < m_models_with_model_matrices.size(); ++i)
     {
@@ -688,7 +564,7 @@ void CascadedPCSS::RenderTexturedModels()
         m_ambient_light_shader->setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_models_with_model_matrices[i].second))));
         m_ambient_light_shader->setUniform("u_mvp",           view_projection * m_models_with_model_matrices[i].second);
 
-        m_models_with_model_matrices[i].first->Render();
+        m_models_with_model_matrices[i].first->Render(view_projection * m_models_with_model_matrices[i].second);
     }
 
     m_ambient_light_shader->setUniform("u_has_albedo_map",    false);
@@ -708,25 +584,25 @@ void CascadedPCSS::RenderTexturedModels()
     glDepthMask(GL_FALSE);
     glDepthFunc(GL_EQUAL);
 
-    /* Render directional light(s) */
-    m_directional_light_shader->bind();
-    m_directional_light_shader->setUniform("u_cam_pos",           m_camera->position());
-    m_directional_light_shader->setUniform("u_has_albedo_map",    true);
-    m_directional_light_shader->setUniform("u_has_normal_map",    true);
-    m_directional_light_shader->setUniform("u_has_metallic_map",  true);
-    m_directional_light_shader->setUniform("u_has_roughness_map", true);
-
-    m_directional_light_shader->setUniform("u_directional_light.base.color",     m_dir_light_properties.color);
-    m_directional_light_shader->setUniform("u_directional_light.base.intensity", m_dir_light_properties.intensity);
-    m_directional_light_shader->setUniform("u_directional_light.direction",      m_dir_light_properties.direction);
-    m_directional_light_shader->setUniform("u_light_view_projections",           m_dir_light_view_projection_matrices.data(), m_dir_light_view_projection_matrices.size());
-    m_directional_light_shader->setUniform("u_light_views",                      m_dir_light_view_matrices.data(), m_dir_light_view_matrices.size());
+    /* Render directional light(s), the sample counts and the debug switches are compiled into the shader. */
+    auto & directional_light_shader = *m_directional_light_permutation;
+    directional_light_shader.bind();
+
+    directional_light_shader.setUniform("u_cam_pos",           m_camera->position());
+    directional_light_shader.setUniform("u_has_albedo_map",    true);
+    directional_light_shader.setUniform("u_has_normal_map",    true);
+    directional_light_shader.setUniform("u_has_metallic_map",  true);
+    directional_light_shader.setUniform("u_has_roughness_map", true);
+
+    directional_light_shader.setUniform("u_directional_light.base.color",     m_dir_light_properties.color);
+    directional_light_shader.setUniform("u_directional_light.base.intensity", m_dir_light_properties.intensity);
+    directional_light_shader.setUniform("u_directional_light.direction",      m_dir_light_properties.direction);
+    directional_light_shader.setUniform("u_light_view_projections",           m_dir_light_view_projection_matrices.data(), m_dir_light_view_projection_matrices.size());
+    directional_light_shader.setUniform("u_light_views",                      m_dir_light_view_matrices.data(), m_dir_light_view_matrices.size());
     
-    m_directional_light_shader->setUniform("u_blocker_search_samples", m_blocker_search_samples);
-    m_directional_light_shader->setUniform("u_pcf_samples",            m_pcf_filter_samples);
-    m_directional_light_shader->setUniform("u_light_frustum_planes",   &m_dir_shadow_frustum_planes[0], std::size(m_dir_shadow_frustum_planes));
-    m_directional_light_shader->setUniform("u_show_cascades",          m_show_cascades);
-    m_directional_light_shader->setUniform("u_hard_shadows",           m_hard_shadows);
+    directional_light_shader.setUniform("u_light_frustum_planes",   &m_dir_shadow_frustum_planes[0], std::size(m_dir_shadow_frustum_planes));
+    directional_light_shader.setUniform("u_cascade_splits",         m_cascade_split_depths, std::size(m_cascade_split_depths));
+    directional_light_shader.setUniform("u_light_radius_uv",        m_light_radius_uv_scaled);
 
     glBindTextureUnit(9, m_dir_shadow_maps);
     glBindTextureUnit(10, m_dir_shadow_maps);
@@ -736,18 +612,18 @@ void CascadedPCSS::RenderTexturedModels()
 
     for (uint32_t i = 0; i < m_models_with_model_matrices.size(); ++i)
     {
-        m_directional_light_shader->setUniform("u_model",         m_models_with_model_matrices[i].second);
-        m_directional_light_shader->setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_models_with_model_matrices[i].second))));
-        m_directional_light_shader->setUniform("u_mvp",           view_projection * m_models_with_model_matrices[i].second);
-        m_directional_light_shader->setUniform("u_mv",            m_camera->m_view * m_models_with_model_matrices[i].second);
+        directional_light_shader.setUniform("u_model",         m_models_with_model_matrices[i].second);
+        directional_light_shader.setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_models_with_model_matrices[i].second))));
+        directional_light_shader.setUniform("u_mvp",           view_projection * m_models_with_model_matrices[i].second);
+        directional_light_shader.setUniform("u_mv",            m_camera->m_view * m_models_with_model_matrices[i].second);
 
-        m_models_with_model_matrices[i].first->Render();
+        m_models_with_model_matrices[i].first->Render(view_projection * m_models_with_model_matrices[i].second);
     }
 
-    m_directional_light_shader->setUniform("u_has_metallic_map",  false);
-    m_directional_light_shader->setUniform("u_has_roughness_map", false);
-    m_directional_light_shader->setUniform("u_metallic",          0.0f);
-    m_directional_light_shader->setUniform("u_roughness",         1.0f);
+    directional_light_shader.setUniform("u_has_metallic_map",  false);
+    directional_light_shader.setUniform("u_has_roughness_map", false);
+    directional_light_shader.setUniform("u_metallic",          0.0f);
+    directional_light_shader.setUniform("u_roughness",         1.0f);
 
     /* Enable writing to the depth buffer. */
     glDepthMask(GL_TRUE);
@@ -770,7 +646,7 @@ void CascadedPCSS::render()
     m_background_shader->setUniform("u_projection", m_camera->m_projection);
     m_background_shader->setUniform("u_view", glm::mat4(glm::mat3(m_camera->m_view)));
     m_background_shader->setUniform("u_lod_level", m_background_lod_level);
-    m_env_cubemap_rt->bindTexture();
+    m_ibl.BindEnvironmentMap();
     
     glCullFace(GL_FRONT);
     glBindVertexArray(m_skybox_vao);
@@ -825,7 +701,7 @@ void CascadedPCSS::render_gui()
         ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
         ImGui::SliderFloat("Exposure",             &m_exposure,             0.0, 10.0, "%.1f");
         ImGui::SliderFloat("Gamma",                &m_gamma,                0.0, 10.0, "%.1f");
-        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_env_cubemap_rt->m_width)), "%.1f");
+        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_ibl.GetEnvironmentSize())), "%.1f");
 
         if (ImGui::BeginCombo("HDR map", m_hdr_maps_names[m_current_hdr_map_idx].c_str()))
         {
@@ -836,7 +712,7 @@ void CascadedPCSS::render_gui()
                 {
                     glDisable(GL_CULL_FACE);
                     m_current_hdr_map_idx = i;
-                    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
+                    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
                     glEnable(GL_CULL_FACE);
                 }
 
@@ -866,9 +742,17 @@ void CascadedPCSS::render_gui()
         }
 
         ImGui::Checkbox("Show shadow maps", &m_draw_debug_visualize_shadow_maps);
-        ImGui::Checkbox("Show cascades",    &m_show_cascades);
-        ImGui::Checkbox("Stable CSM",       &m_stable_csm);
-        ImGui::Checkbox("Hard shadows",     &m_hard_shadows);
+        if (ImGui::Checkbox("Show cascades", &m_show_cascades))
+        {
+            UpdateDirectionalLightPermutation();
+        }
+
+        ImGui::Checkbox("Stable CSM", &m_stable_csm);
+
+        if (ImGui::Checkbox("Hard shadows", &m_hard_shadows))
+        {
+            UpdateDirectionalLightPermutation();
+        }
 
         ImGui::Spacing();
         ImGui::Spacing();
@@ -880,11 +764,13 @@ void CascadedPCSS::render_gui()
             if (ImGui::Combo("Blocker search samples", &m_blocker_search_samples_idx, listbox_items, std::size(listbox_items)))
             {
                 m_blocker_search_samples = sample_counts[m_blocker_search_samples_idx];
+                UpdateDirectionalLightPermutation();
             }
 
             if (ImGui::Combo("PCF filter samples", &m_pcf_filter_samples_idx, listbox_items, std::size(listbox_items)))
             {
                 m_pcf_filter_samples = sample_counts[m_pcf_filter_samples_idx];
+                UpdateDirectionalLightPermutation();
             }
 
             ImGui::SliderFloat("Light radius", &m_light_radius_uv, 0.0, 1.0, "%.2f");
@@ -5,9 +5,10 @@
 
 using namespace RGL;
 
-int main()
+int main(int argc, char* argv[])
 {
     std::shared_ptr<CoreApp> app = std::make_shared<CascadedPCSS>();
+    app->parse_command_line(argc, argv);
     app->init(WINDOW_WIDTH, WINDOW_HEIGHT, "Cascaded Shadow Mapping with Percentage Closer Soft Shadows Demo" /*title*/, 60.0 /*framerate*/);
     app->start();
 
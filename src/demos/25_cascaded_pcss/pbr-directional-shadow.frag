@@ -1,6 +1,17 @@
 #version 460 core
 #include "../22_pbr/pbr-lighting.glh"
 
+// Compile-time settings of the permutations, see Shader::getPermutation(). The sample counts must have a Poisson table below.
+#ifndef BLOCKER_SEARCH_SAMPLES
+#define BLOCKER_SEARCH_SAMPLES 128
+#endif
+
+#ifndef PCF_SAMPLES
+#define PCF_SAMPLES 128
+#endif
+
+// HARD_SHADOWS skips the PCSS, SHOW_CASCADES tints the cascades.
+
 const int NUM_CASCADES = 3;
 
 layout (location = 3) in vec3 in_view_pos;
@@ -13,15 +24,11 @@ layout (binding = 9)  uniform sampler2DArray       s_shadow_map;
 layout (binding = 10) uniform sampler2DArrayShadow s_shadow_map_pcf;
 layout (binding = 11) uniform sampler3D            s_random_angles;
 
-uniform int   u_blocker_search_samples;
 uniform float u_light_radius_uv;
-uniform int   u_pcf_samples;
 uniform vec2  u_light_frustum_planes[NUM_CASCADES];
 uniform float u_cascade_splits[NUM_CASCADES];
 uniform vec2  u_split_scale[NUM_CASCADES];
 uniform vec2  u_split_translate[NUM_CASCADES];
-uniform bool  u_show_cascades;
-uniform bool  u_hard_shadows;
 
 float light_near_plane;
 float light_far_plane;
@@ -391,6 +398,30 @@ const vec2 Poisson128[128] = vec2[](
     vec2( 0.9608918,   -0.03495717),
     vec2( 0.972032,     0.2271516));
 
+#if BLOCKER_SEARCH_SAMPLES == 25
+#define BLOCKER_SEARCH_POISSON Poisson25
+#elif BLOCKER_SEARCH_SAMPLES == 32
+#define BLOCKER_SEARCH_POISSON Poisson32
+#elif BLOCKER_SEARCH_SAMPLES == 64
+#define BLOCKER_SEARCH_POISSON Poisson64
+#elif BLOCKER_SEARCH_SAMPLES == 100
+#define BLOCKER_SEARCH_POISSON Poisson100
+#else
+#define BLOCKER_SEARCH_POISSON Poisson128
+#endif
+
+#if PCF_SAMPLES == 25
+#define PCF_POISSON Poisson25
+#elif PCF_SAMPLES == 32
+#define PCF_POISSON Poisson32
+#elif PCF_SAMPLES == 64
+#define PCF_POISSON Poisson64
+#elif PCF_SAMPLES == 100
+#define PCF_POISSON Poisson100
+#else
+#define PCF_POISSON Poisson128
+#endif
+
 // Using similar triangles from the surface point to the area light
 float searchRegionRadiusUV(float z_world)
 {
@@ -438,20 +469,9 @@ void findBlocker(out float accum_blocker_depth,
     num_blockers        = 0.0;
     float biased_depth  = z0 - bias;
 
-    for (int i = 0; i < u_blocker_search_samples; ++i)
+    for (int i = 0; i < BLOCKER_SEARCH_SAMPLES; ++i)
     {
-        vec2 offset;
-
-        if (u_blocker_search_samples == 25)
-            offset = Poisson25[i];
-        else if (u_blocker_search_samples == 32)
-            offset = Poisson32[i];
-        else if (u_blocker_search_samples == 64)
-            offset = Poisson64[i];
-        else if (u_blocker_search_samples == 100)
-            offset = Poisson100[i];
-        else if (u_blocker_search_samples == 128)
-            offset = Poisson128[i];
+        vec2 offset = BLOCKER_SEARCH_POISSON[i];
 
         // Add random rotation to the offset 
         offset = vec2(random_rotation.x * offset.x - random_rotation.y * offset.y,
@@ -477,20 +497,9 @@ float shadowPCF(vec2 uv, float z0, float bias, float filter_radius_uv, uint casc
 
     float sum = 0.0;
 
-    for (int i = 0; i < u_pcf_samples; ++i)
+    for (int i = 0; i < PCF_SAMPLES; ++i)
     {
-        vec2 offset;
-
-        if (u_pcf_samples == 25)
-            offset = Poisson25[i];
-        else if (u_pcf_samples == 32)
-            offset = Poisson32[i];
-        else if (u_pcf_samples == 64)
-            offset = Poisson64[i];
-        else if (u_pcf_samples == 100)
-            offset = Poisson100[i];
-        else if (u_pcf_samples == 128)
-            offset = Poisson128[i];
+        vec2 offset = PCF_POISSON[i];
 
         // Add random rotation to the offset 
         offset *= filter_radius_uv;
@@ -500,7 +509,7 @@ float shadowPCF(vec2 uv, float z0, float bias, float filter_radius_uv, uint casc
         sum += texture(s_shadow_map_pcf, vec4(uv + offset, cascade_index, z0 - bias));
     }
 
-    return sum / float(u_pcf_samples);
+    return sum / float(PCF_SAMPLES);
 }
 
 // ------------------------------------------------------------------
@@ -589,17 +598,15 @@ void main()
         }
     }
 
-    float shadow_factor = 0.0;
-    if (u_hard_shadows)
-    {
-         shadow_factor = shadowOcclusionHard(cascade_index);
-    }
-    else
-    {
-         shadow_factor = shadowOcclusionSoft(cascade_index);
-    }
+#ifdef HARD_SHADOWS
+    float shadow_factor = shadowOcclusionHard(cascade_index);
+#else
+    float shadow_factor = shadowOcclusionSoft(cascade_index);
+#endif
 
-    if (u_show_cascades) cascade_debug_indicator = cascade_debug_colors[cascade_index];
+#ifdef SHOW_CASCADES
+    cascade_debug_indicator = cascade_debug_colors[cascade_index];
+#endif
 
     frag_color = vec4(cascade_debug_indicator + shadow_factor * calcDirectionalLight(u_directional_light, normalize(in_normal), in_world_pos), 1.0);
 } 
\ No newline at end of file
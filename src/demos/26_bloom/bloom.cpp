@@ -11,7 +11,7 @@
 Bloom::Bloom()
       : m_exposure            (1.0f),
         m_gamma               (3.6f),
-        m_background_lod_level(1.2),
+        m_background_lod_level(0.2),
         m_skybox_vao          (0),
         m_skybox_vbo          (0),
         m_threshold           (1.5),
@@ -194,18 +194,6 @@ void Bloom::init_app()
     m_point_light_shader = std::make_shared<RGL::Shader>(dir + "pbr-lighting.vert", dir + "pbr-point.frag");
     m_point_light_shader->link();
 
-    m_equirectangular_to_cubemap_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "equirectangular_to_cubemap.frag");
-    m_equirectangular_to_cubemap_shader->link();
-
-    m_irradiance_convolution_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "irradiance_convolution.frag");
-    m_irradiance_convolution_shader->link();
-
-    m_prefilter_env_map_shader = std::make_shared<RGL::Shader>(dir + "cubemap.vert", dir + "prefilter_cubemap.frag");
-    m_prefilter_env_map_shader->link();
-
-    m_precompute_brdf = std::make_shared<RGL::Shader>("src/demos/10_postprocessing_filters/FSQ.vert", dir + "precompute_brdf.frag");
-    m_precompute_brdf->link();
-
     m_background_shader = std::make_shared<RGL::Shader>(dir + "background.vert", dir + "background.frag");
     m_background_shader->link();
 
@@ -225,23 +213,7 @@ void Bloom::init_app()
     /* IBL precomputations. */
     GenSkyboxGeometry();
 
-    m_env_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_env_cubemap_rt->set_position(glm::vec3(0.0));
-    m_env_cubemap_rt->generate_rt(2048, 2048, true);
-
-    m_irradiance_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_irradiance_cubemap_rt->set_position(glm::vec3(0.0));
-    m_irradiance_cubemap_rt->generate_rt(32, 32);
-
-    m_prefiltered_env_map_rt = std::make_shared<CubeMapRenderTarget>();
-    m_prefiltered_env_map_rt->set_position(glm::vec3(0.0));
-    m_prefiltered_env_map_rt->generate_rt(512, 512, true);
-
-    m_brdf_lut_rt = std::make_shared<Texture2DRenderTarget>();
-    m_brdf_lut_rt->create(512, 512, GL_RG16F);
-
-    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
-    PrecomputeBRDF(m_brdf_lut_rt);
+    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
 }
 
 void Bloom::input()
@@ -300,120 +272,6 @@ void Bloom::update(double delta_time)
     m_camera->update(delta_time);
 }
 
-void Bloom::HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt, const std::shared_ptr<RGL::Texture2D>& m_equirectangular_map)
-{
-    /* Update all faces per frame */
-    m_equirectangular_to_cubemap_shader->bind();
-    m_equirectangular_to_cubemap_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_equirectangular_map->Bind(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_equirectangular_to_cubemap_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void Bloom::IrradianceConvolution(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    /* Update all faces per frame */
-    m_irradiance_convolution_shader->bind();
-    m_irradiance_convolution_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_env_cubemap_rt->bindTexture(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_irradiance_convolution_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void Bloom::PrefilterCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    m_prefilter_env_map_shader->bind();
-    m_prefilter_env_map_shader->setUniform("u_projection", cubemap_rt->m_projection);
-    
-    m_env_cubemap_rt->bindTexture(1);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-
-    uint8_t max_mip_levels = glm::log2(float(cubemap_rt->m_width));
-    for (uint8_t mip = 0; mip < max_mip_levels; ++mip)
-    {
-        // resize the framebuffer according to mip-level size.
-        uint32_t mip_width  = cubemap_rt->m_width  * std::pow(0.5, mip);
-        uint32_t mip_height = cubemap_rt->m_height * std::pow(0.5, mip);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, cubemap_rt->m_rbo_id);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mip_width, mip_height);
-        glViewport(0, 0, mip_width, mip_height);
-
-        float roughness = float(mip) / float(max_mip_levels - 1);
-        m_prefilter_env_map_shader->setUniform("u_roughness", roughness);
-
-        for (uint8_t side = 0; side < 6; ++side)
-        {
-            m_prefilter_env_map_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, mip);
-
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glBindVertexArray(m_skybox_vao);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
-void Bloom::PrecomputeIndirectLight(const std::filesystem::path& hdri_map_filepath)
-{
-    auto envmap_hdr = std::make_shared<RGL::Texture2D>();
-    envmap_hdr->LoadHdr(hdri_map_filepath);
-    auto envmap_metadata = envmap_hdr->GetMetadata();
-
-    HdrEquirectangularToCubemap(m_env_cubemap_rt, envmap_hdr);
-
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap_rt->m_cubemap_texture_id);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    IrradianceConvolution(m_irradiance_cubemap_rt);
-    PrefilterCubemap(m_prefiltered_env_map_rt);
-}
-
-void Bloom::PrecomputeBRDF(const std::shared_ptr<Texture2DRenderTarget>& rt)
-{
-    GLuint m_dummy_vao_id;
-    glCreateVertexArrays(1, &m_dummy_vao_id);
-
-    rt->bindRenderTarget();
-    m_precompute_brdf->bind();
-
-    glBindVertexArray(m_dummy_vao_id);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    glDeleteVertexArrays(1, &m_dummy_vao_id);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, RGL::Window::getWidth(), RGL::Window::getHeight());
-}
-
 void Bloom::GenSkyboxGeometry()
 {
     m_skybox_vao = 0;
@@ -487,9 +345,7 @@ void Bloom::RenderScene()
     m_ambient_light_shader->setUniform("u_cam_pos", m_camera->position());
 
     /* First, render the ambient color only for the opaque objects. */
-    m_irradiance_cubemap_rt->bindTexture(6);
-    m_prefiltered_env_map_rt->bindTexture(7);
-    m_brdf_lut_rt->bindTexture(8);
+    m_ibl.Bind();
 
     for (uint32_t i = 0; i < m_static_objects.size(); ++i)
     {
@@ -570,7 +426,7 @@ void Bloom::render()
     m_background_shader->setUniform("u_projection", m_camera->m_projection);
     m_background_shader->setUniform("u_view", glm::mat4(glm::mat3(m_camera->m_view)));
     m_background_shader->setUniform("u_lod_level", m_background_lod_level);
-    m_env_cubemap_rt->bindTexture();
+    m_ibl.BindEnvironmentMap();
 
     glBindVertexArray(m_skybox_vao);
     glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -658,7 +514,7 @@ void Bloom::render_gui()
         ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
         ImGui::SliderFloat("Exposure",             &m_exposure,             0.0, 10.0, "%.1f");
         ImGui::SliderFloat("Gamma",                &m_gamma,                0.0, 10.0, "%.1f");
-        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_env_cubemap_rt->m_width)), "%.1f");
+        ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_ibl.GetEnvironmentSize())), "%.1f");
 
         if (ImGui::BeginCombo("HDR map", m_hdr_maps_names[m_current_hdr_map_idx].c_str()))
         {
@@ -668,7 +524,7 @@ void Bloom::render_gui()
                 if (ImGui::Selectable(m_hdr_maps_names[i].c_str(), is_selected))
                 {
                     m_current_hdr_map_idx = i;
-                    PrecomputeIndirectLight(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
+                    m_ibl.Load(RGL::FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
                 }
 
                 if (is_selected)
@@ -1,7 +1,10 @@
 #include "clustered_shading.h"
 #include "filesystem.h"
 #include "input.h"
+#include "profiler.h"
+#include "timer.h"
 #include "util.h"
+#include "uniform_buffers.h"
 #include "gui/gui.h"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -14,7 +17,7 @@ using namespace RGL;
 ClusteredShading::ClusteredShading()
       : m_exposure            (0.4f),
         m_gamma               (2.2f),
-        m_background_lod_level(1.2),
+        m_background_lod_level(0.2),
         m_skybox_vao          (0),
         m_skybox_vbo          (0),
         m_threshold           (1.5),
@@ -56,6 +59,7 @@ ClusteredShading::~ClusteredShading()
     glDeleteBuffers(1, &m_unique_active_clusters_ssbo);
 
     glDeleteTextures(1, &m_depth_tex2D_id);
+    glDeleteTextures(1, &m_hiz_tex2D_id);
     glDeleteFramebuffers(1, &m_depth_pass_fbo_id);
 }
 
@@ -100,6 +104,66 @@ void ClusteredShading::init_app()
     GenerateSpotLights();
     GenerateAreaLights();
 
+    /// Create shaders. They are compiled in the background while Sponza and the textures are loaded.
+    RGL::ShaderBatch shader_batch;
+
+    std::string dir = "src/demos/27_clustered_shading/";
+    m_depth_prepass_shader = std::make_shared<Shader>(dir + "depth_pass.vert", dir + "depth_pass.frag");
+    shader_batch.add(m_depth_prepass_shader);
+
+    /* The multi-draw indirect path reads the material textures through bindless handles. The GPU culling draws with it,
+     * so its shaders are only needed then too. */
+    if (Texture::IsBindlessSupported())
+    {
+        m_depth_prepass_mdi_shader = std::make_shared<Shader>(dir + "depth_pass_mdi.vert", dir + "depth_pass_mdi.frag");
+        shader_batch.add(m_depth_prepass_mdi_shader);
+
+        m_clustered_pbr_mdi_shader = std::make_shared<Shader>(dir + "pbr_lighting_mdi.vert", dir + "pbr_clustered_mdi.frag");
+        shader_batch.add(m_clustered_pbr_mdi_shader);
+
+        m_build_hiz_shader = std::make_shared<Shader>(dir + "build_hiz.comp");
+        shader_batch.add(m_build_hiz_shader);
+
+        m_cull_mesh_parts_shader = std::make_shared<Shader>(dir + "cull_mesh_parts.comp");
+        shader_batch.add(m_cull_mesh_parts_shader);
+    }
+
+    m_generate_clusters_shader = std::make_shared<Shader>(dir + "generate_clusters.comp");
+    shader_batch.add(m_generate_clusters_shader);
+
+    m_find_visible_clusters_shader = std::make_shared<Shader>(dir + "find_visible_clusters.comp");
+    shader_batch.add(m_find_visible_clusters_shader);
+
+    m_find_unique_clusters_shader = std::make_shared<Shader>(dir + "find_unique_clusters.comp");
+    shader_batch.add(m_find_unique_clusters_shader);
+
+    m_update_cull_lights_indirect_args_shader = std::make_shared<Shader>(dir + "update_cull_lights_indirect_args.comp");
+    shader_batch.add(m_update_cull_lights_indirect_args_shader);
+
+    m_cull_lights_shader = std::make_shared<Shader>(dir + "cull_lights.comp");
+    shader_batch.add(m_cull_lights_shader);
+
+    m_clustered_pbr_shader = std::make_shared<Shader>(dir + "pbr_lighting.vert", dir + "pbr_clustered.frag");
+    shader_batch.add(m_clustered_pbr_shader);
+
+    m_update_lights_shader = std::make_shared<Shader>(dir + "update_lights.comp");
+    shader_batch.add(m_update_lights_shader);
+
+    m_draw_area_lights_geometry_shader = std::make_shared<Shader>(dir + "area_light_geom.vert", dir + "area_light_geom.frag");
+    shader_batch.add(m_draw_area_lights_geometry_shader);
+
+    dir = "src/demos/22_pbr/";
+    m_background_shader = std::make_shared<Shader>(dir + "background.vert", dir + "background.frag");
+    shader_batch.add(m_background_shader);
+
+    // Bloom shaders.
+    dir = "src/demos/26_bloom/";
+    m_downscale_shader = std::make_shared<Shader>(dir + "downscale.comp");
+    shader_batch.add(m_downscale_shader);
+
+    m_upscale_shader = std::make_shared<Shader>(dir + "upscale.comp");
+    shader_batch.add(m_upscale_shader);
+
     /// Create Sponza static object
     auto sponza_model = std::make_shared<StaticModel>();
     sponza_model->Load(RGL::FileSystem::getResourcesPath() / "models/sponza/Sponza.gltf");
@@ -198,6 +262,17 @@ void ClusteredShading::init_app()
     GLenum draw_buffers[] = { GL_NONE };
     glNamedFramebufferDrawBuffers(m_depth_pass_fbo_id, 1, draw_buffers);
 
+    // Create Hi-Z texture with the full mip chain of the depth pre-pass texture
+    m_hiz_levels_count = 1 + uint32_t(glm::floor(glm::log2(float(glm::max(RGL::Window::getWidth(), RGL::Window::getHeight())))));
+
+    glCreateTextures  (GL_TEXTURE_2D, 1, &m_hiz_tex2D_id);
+    glTextureStorage2D(m_hiz_tex2D_id, m_hiz_levels_count, GL_R32F, RGL::Window::getWidth(), RGL::Window::getHeight());
+
+    glTextureParameteri(m_hiz_tex2D_id, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_hiz_tex2D_id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_hiz_tex2D_id, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_hiz_tex2D_id, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+
     /// Load LTC look-up-tables for area lights rendering
     auto ltc_lut_path     = FileSystem::getResourcesPath() / "lut";
     auto ltc_lut_mat_path = ltc_lut_path / "ltc_mat.dds";
@@ -229,84 +304,17 @@ void ClusteredShading::init_app()
         fprintf(stderr, "Error: could not load texture %s\n", ltc_lut_amp_path.string().c_str());
     }
 
-    /// Create shaders.
-    std::string dir = "src/demos/27_clustered_shading/";
-    m_depth_prepass_shader = std::make_shared<Shader>(dir + "depth_pass.vert", dir + "depth_pass.frag");
-    m_depth_prepass_shader->link();
-
-    m_generate_clusters_shader = std::make_shared<Shader>(dir + "generate_clusters.comp");
-    m_generate_clusters_shader->link();
-
-    m_find_visible_clusters_shader = std::make_shared<Shader>(dir + "find_visible_clusters.comp");
-    m_find_visible_clusters_shader->link();
-
-    m_find_unique_clusters_shader = std::make_shared<Shader>(dir + "find_unique_clusters.comp");
-    m_find_unique_clusters_shader->link();
-
-    m_update_cull_lights_indirect_args_shader = std::make_shared<Shader>(dir + "update_cull_lights_indirect_args.comp");
-    m_update_cull_lights_indirect_args_shader->link();
-
-    m_cull_lights_shader = std::make_shared<Shader>(dir + "cull_lights.comp");
-    m_cull_lights_shader->link();
-
-    m_clustered_pbr_shader = std::make_shared<Shader>(dir + "pbr_lighting.vert", dir + "pbr_clustered.frag");
-    m_clustered_pbr_shader->link();
-
-    m_update_lights_shader = std::make_shared<Shader>(dir + "update_lights.comp");
-    m_update_lights_shader->link();
-
-    m_draw_area_lights_geometry_shader = std::make_shared<Shader>(dir + "area_light_geom.vert", dir + "area_light_geom.frag");
-    m_draw_area_lights_geometry_shader->link();
-
-    dir = "src/demos/22_pbr/";
-    m_equirectangular_to_cubemap_shader = std::make_shared<Shader>(dir + "cubemap.vert", dir + "equirectangular_to_cubemap.frag");
-    m_equirectangular_to_cubemap_shader->link();
-
-    m_irradiance_convolution_shader = std::make_shared<Shader>(dir + "cubemap.vert", dir + "irradiance_convolution.frag");
-    m_irradiance_convolution_shader->link();
-    
-    m_prefilter_env_map_shader = std::make_shared<Shader>(dir + "cubemap.vert", dir + "prefilter_cubemap.frag");
-    m_prefilter_env_map_shader->link();
-
-    m_precompute_brdf = std::make_shared<Shader>("src/demos/10_postprocessing_filters/FSQ.vert", dir + "precompute_brdf.frag");
-    m_precompute_brdf->link();
-
-    m_background_shader = std::make_shared<Shader>(dir + "background.vert", dir + "background.frag");
-    m_background_shader->link();
-
     m_tmo_ps = std::make_shared<PostprocessFilter>(Window::getWidth(), Window::getHeight());
 
-    // Bloom shaders.
-    dir = "src/demos/26_bloom/";
-    m_downscale_shader = std::make_shared<Shader>(dir + "downscale.comp");
-    m_downscale_shader->link();
-
-    m_upscale_shader = std::make_shared<Shader>(dir + "upscale.comp");
-    m_upscale_shader->link();
-
     m_bloom_dirt_texture = std::make_shared<Texture2D>(); 
     m_bloom_dirt_texture->Load(FileSystem::getResourcesPath() / "textures/bloom_dirt_mask.png");
 
+    shader_batch.finish();
+
     // IBL precomputations.
     GenSkyboxGeometry();
 
-    m_env_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_env_cubemap_rt->set_position(glm::vec3(0.0));
-    m_env_cubemap_rt->generate_rt(2048, 2048, true);
-
-    m_irradiance_cubemap_rt = std::make_shared<CubeMapRenderTarget>();
-    m_irradiance_cubemap_rt->set_position(glm::vec3(0.0));
-    m_irradiance_cubemap_rt->generate_rt(32, 32);
-
-    m_prefiltered_env_map_rt = std::make_shared<CubeMapRenderTarget>();
-    m_prefiltered_env_map_rt->set_position(glm::vec3(0.0));
-    m_prefiltered_env_map_rt->generate_rt(512, 512, true);
-
-    m_brdf_lut_rt = std::make_shared<Texture2DRenderTarget>();
-    m_brdf_lut_rt->create(512, 512, GL_RG16F);
-
-    PrecomputeIndirectLight(FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
-    PrecomputeBRDF(m_brdf_lut_rt);
+    m_ibl.Load(FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
 
     auto proj = m_camera->m_projection;
     auto inv_proj = glm::inverse(proj);
@@ -530,119 +538,6 @@ void ClusteredShading::UpdateLightsSSBOs()
     glNamedBufferData(m_spot_lights_ellipses_radii_ssbo,  sizeof(m_spot_lights_ellipses_radii[0])  * m_spot_lights_ellipses_radii.size(),  m_spot_lights_ellipses_radii.data(),  GL_DYNAMIC_DRAW);
 }
 
-void ClusteredShading::HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt, const std::shared_ptr<Texture2D>& m_equirectangular_map)
-{
-    /* Update all faces per frame */
-    m_equirectangular_to_cubemap_shader->bind();
-    m_equirectangular_to_cubemap_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_equirectangular_map->Bind(1);
-
-    glBindVertexArray(m_skybox_vao);
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_equirectangular_to_cubemap_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, Window::getWidth(), Window::getHeight());
-}
-
-void ClusteredShading::IrradianceConvolution(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    /* Update all faces per frame */
-    m_irradiance_convolution_shader->bind();
-    m_irradiance_convolution_shader->setUniform("u_projection", cubemap_rt->m_projection);
-
-    glViewport(0, 0, cubemap_rt->m_width, cubemap_rt->m_height);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-    m_env_cubemap_rt->bindTexture(1);
-
-    for (uint8_t side = 0; side < 6; ++side)
-    {
-        m_irradiance_convolution_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        glBindVertexArray(m_skybox_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-    glViewport(0, 0, Window::getWidth(), Window::getHeight());
-}
-
-void ClusteredShading::PrefilterCubemap(const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt)
-{
-    m_prefilter_env_map_shader->bind();
-    m_prefilter_env_map_shader->setUniform("u_projection", cubemap_rt->m_projection);
-    
-    m_env_cubemap_rt->bindTexture(1);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemap_rt->m_fbo_id);
-
-    uint8_t max_mip_levels = glm::log2(float(cubemap_rt->m_width));
-    for (uint8_t mip = 0; mip < max_mip_levels; ++mip)
-    {
-        // resize the framebuffer according to mip-level size.
-        uint32_t mip_width  = cubemap_rt->m_width  * std::pow(0.5, mip);
-        uint32_t mip_height = cubemap_rt->m_height * std::pow(0.5, mip);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, cubemap_rt->m_rbo_id);
-        //glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mip_width, mip_height);
-        glViewport(0, 0, mip_width, mip_height);
-
-        float roughness = float(mip) / float(max_mip_levels - 1);
-        m_prefilter_env_map_shader->setUniform("u_roughness", roughness);
-
-        for (uint8_t side = 0; side < 6; ++side)
-        {
-            m_prefilter_env_map_shader->setUniform("u_view", cubemap_rt->m_view_transforms[side]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, cubemap_rt->m_cubemap_texture_id, mip);
-
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glBindVertexArray(m_skybox_vao);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, Window::getWidth(), Window::getHeight());
-}
-
-void ClusteredShading::PrecomputeIndirectLight(const std::filesystem::path& hdri_map_filepath)
-{
-    auto envmap_hdr = std::make_shared<Texture2D>();
-    envmap_hdr->LoadHdr(hdri_map_filepath);
-
-    HdrEquirectangularToCubemap(m_env_cubemap_rt, envmap_hdr);
-
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap_rt->m_cubemap_texture_id);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    IrradianceConvolution(m_irradiance_cubemap_rt);
-    PrefilterCubemap(m_prefiltered_env_map_rt);
-}
-
-void ClusteredShading::PrecomputeBRDF(const std::shared_ptr<Texture2DRenderTarget>& rt)
-{
-    GLuint m_dummy_vao_id;
-    glCreateVertexArrays(1, &m_dummy_vao_id);
-
-    rt->bindRenderTarget();
-    m_precompute_brdf->bind();
-
-    glBindVertexArray(m_dummy_vao_id);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-    glDeleteVertexArrays(1, &m_dummy_vao_id);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, Window::getWidth(), Window::getHeight());
-}
-
 void ClusteredShading::GenSkyboxGeometry()
 {
     m_skybox_vao = 0;
@@ -710,8 +605,21 @@ void ClusteredShading::GenSkyboxGeometry()
 
 void ClusteredShading::render()
 {
+    /* Camera and Sponza's transformations are shared by the depth, lighting and area lights passes. */
+    RGL::UniformBuffers::PushFrameData(*m_camera);
+    RGL::UniformBuffers::PushObjectData(m_sponza_static_object.m_transform);
+
     // 1. Depth(Z) pre-pass
-    renderDepthPass();
+    {
+        RGL::ProfileScope scope("Depth pre-pass");
+        renderDepthPass();
+    }
+
+    // 1.1. Hi-Z pyramid for the occlusion culling of the lighting pass
+    if (m_gpu_culling && m_gpu_occlusion_culling)
+    {
+        buildHiZ();
+    }
 
     // 2. Blit depth info to tmo_ps framebuffer
     glBlitNamedFramebuffer(m_depth_pass_fbo_id, m_tmo_ps->rt->m_fbo_id, 
@@ -721,66 +629,86 @@ void ClusteredShading::render()
     static const uint32_t clear_val = 0;
     
     // 3. Find visible clusters
-    glClearNamedBufferData(m_clusters_flags_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-
-    m_find_visible_clusters_shader->bind();
-    m_find_visible_clusters_shader->setUniform("u_near_z",          m_camera->NearPlane());
-    m_find_visible_clusters_shader->setUniform("u_far_z",           m_camera->FarPlane());
-    m_find_visible_clusters_shader->setUniform("u_log_grid_dim_y",  m_log_grid_dim_y);
-    m_find_visible_clusters_shader->setUniform("u_cluster_size_ss", glm::uvec2(m_cluster_grid_block_size));
-    m_find_visible_clusters_shader->setUniform("u_grid_dim",        m_cluster_grid_dim);
+    {
+        RGL::ProfileScope scope("Find visible clusters");
+
+        glClearNamedBufferData(m_clusters_flags_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+
+        m_find_visible_clusters_shader->bind();
+        m_find_visible_clusters_shader->setUniform("u_near_z",          m_camera->NearPlane());
+        m_find_visible_clusters_shader->setUniform("u_far_z",           m_camera->FarPlane());
+        m_find_visible_clusters_shader->setUniform("u_log_grid_dim_y",  m_log_grid_dim_y);
+        m_find_visible_clusters_shader->setUniform("u_cluster_size_ss", glm::uvec2(m_cluster_grid_block_size));
+        m_find_visible_clusters_shader->setUniform("u_grid_dim",        m_cluster_grid_dim);
     
-    glBindTextureUnit(0, m_depth_tex2D_id);
-    glDispatchCompute(glm::ceil(RGL::Window::getWidth() / 32.0f), glm::ceil(RGL::Window::getHeight() / 32.0f), 1);
-    glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindTextureUnit(0, m_depth_tex2D_id);
+        glDispatchCompute(glm::ceil(RGL::Window::getWidth() / 32.0f), glm::ceil(RGL::Window::getHeight() / 32.0f), 1);
+        glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
     // 4. Find unique clusters and update the indirect dispatch arguments buffer
-    glClearNamedBufferData(m_unique_active_clusters_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+    {
+        RGL::ProfileScope scope("Find unique clusters");
 
-    m_find_unique_clusters_shader->bind();
-    glDispatchCompute(glm::ceil(m_clusters_count / 1024.0f), 1, 1);
-    glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+        glClearNamedBufferData(m_unique_active_clusters_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
 
-    m_update_cull_lights_indirect_args_shader->bind();
-    glDispatchCompute(1, 1, 1);
-    glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+        m_find_unique_clusters_shader->bind();
+        glDispatchCompute(glm::ceil(m_clusters_count / 1024.0f), 1, 1);
+        glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+
+        m_update_cull_lights_indirect_args_shader->bind();
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
     // 5. Assign lights to clusters (cull lights)
-    glClearNamedBufferData(m_point_light_grid_ssbo,       GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-    glClearNamedBufferData(m_point_light_index_list_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-    glClearNamedBufferData(m_spot_light_grid_ssbo,        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-    glClearNamedBufferData(m_spot_light_index_list_ssbo,  GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-    glClearNamedBufferData(m_area_light_grid_ssbo,        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
-    glClearNamedBufferData(m_area_light_index_list_ssbo,  GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+    {
+        RGL::ProfileScope scope("Cull lights");
+
+        glClearNamedBufferData(m_point_light_grid_ssbo,       GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+        glClearNamedBufferData(m_point_light_index_list_ssbo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+        glClearNamedBufferData(m_spot_light_grid_ssbo,        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+        glClearNamedBufferData(m_spot_light_index_list_ssbo,  GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+        glClearNamedBufferData(m_area_light_grid_ssbo,        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
+        glClearNamedBufferData(m_area_light_index_list_ssbo,  GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &clear_val);
 
-    m_cull_lights_shader->bind();
-    m_cull_lights_shader->setUniform("u_view_matrix", m_camera->m_view);
+        m_cull_lights_shader->bind();
+        m_cull_lights_shader->setUniform("u_view_matrix", m_camera->m_view);
 
-    glBindBuffer             (GL_DISPATCH_INDIRECT_BUFFER, m_cull_lights_dispatch_args_ssbo);
-    glDispatchComputeIndirect(0);
-    glMemoryBarrier          (GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindBuffer             (GL_DISPATCH_INDIRECT_BUFFER, m_cull_lights_dispatch_args_ssbo);
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier          (GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
     // 6. Render lighting
-    renderLighting();
+    {
+        RGL::ProfileScope scope("Lighting");
+        renderLighting();
+    }
 
     // 7. Render area lights geometry
-    m_draw_area_lights_geometry_shader->bind();
-    m_draw_area_lights_geometry_shader->setUniform("u_view_projection", m_camera->m_projection * m_camera->m_view);
-    glDrawArrays(GL_TRIANGLES, 0, 6 * m_area_lights.size());
+    {
+        RGL::ProfileScope scope("Area lights and skybox");
 
-    // 8. Render skybox
-    m_background_shader->bind();
-    m_background_shader->setUniform("u_projection", m_camera->m_projection);
-    m_background_shader->setUniform("u_view",       glm::mat4(glm::mat3(m_camera->m_view)));
-    m_background_shader->setUniform("u_lod_level",  m_background_lod_level);
-    m_env_cubemap_rt->bindTexture();
+        m_draw_area_lights_geometry_shader->bind();
+        glDrawArrays(GL_TRIANGLES, 0, 6 * m_area_lights.size());
 
-    glBindVertexArray(m_skybox_vao);
-    glDrawArrays     (GL_TRIANGLES, 0, 36);
+        // 8. Render skybox
+        m_background_shader->bind();
+        m_background_shader->setUniform("u_projection", m_camera->m_projection);
+        m_background_shader->setUniform("u_view",       glm::mat4(glm::mat3(m_camera->m_view)));
+        m_background_shader->setUniform("u_lod_level",  m_background_lod_level);
+        m_ibl.BindEnvironmentMap();
+
+        glBindVertexArray(m_skybox_vao);
+        glDrawArrays     (GL_TRIANGLES, 0, 36);
+    }
 
     // 9. Bloom: downscale
     if (m_bloom_enabled)
     {
+        RGL::ProfileScope scope("Bloom");
+
         m_downscale_shader->bind();
         m_downscale_shader->setUniform("u_threshold", glm::vec4(m_threshold, m_threshold - m_knee, 2.0f * m_knee, 0.25f * m_knee));
         m_tmo_ps->rt->bindTexture();
@@ -826,7 +754,10 @@ void ClusteredShading::render()
     }
 
     // 10. Apply tone mapping
-    m_tmo_ps->render(m_exposure, m_gamma);
+    {
+        RGL::ProfileScope scope("Tone mapping");
+        m_tmo_ps->render(m_exposure, m_gamma);
+    }
 }
 
 void ClusteredShading::renderDepthPass()
@@ -838,9 +769,37 @@ void ClusteredShading::renderDepthPass()
     glColorMask(0, 0, 0, 0);
     glDepthFunc(GL_LESS);
 
-    m_depth_prepass_shader->bind();
-    m_depth_prepass_shader->setUniform("mvp", m_camera->m_projection * m_camera->m_view * m_sponza_static_object.m_transform);
-    m_sponza_static_object.m_model->Render();
+    auto& depth_prepass_shader = m_multi_draw_indirect ? m_depth_prepass_mdi_shader : m_depth_prepass_shader;
+
+    auto mvp = m_camera->m_projection * m_camera->m_view * m_sponza_static_object.m_transform;
+
+    /* Nothing has been drawn yet, so only the frustum culling can be done. */
+    if (m_gpu_culling)
+    {
+        RGL::ProfileScope scope("Depth culling");
+        cullMeshParts(mvp, false);
+    }
+
+    RGL::ProfileScope scope("Depth draws");
+
+    const double submit_start_time = Timer::getTime();
+
+    depth_prepass_shader->bind();
+
+    if (m_gpu_culling)
+    {
+        m_sponza_static_object.m_model->RenderIndirectCount(MATERIALS_SSBO_BINDING_INDEX, DRAW_MATERIALS_SSBO_BINDING_INDEX);
+    }
+    else if (m_multi_draw_indirect)
+    {
+        m_sponza_static_object.m_model->RenderIndirect(MATERIALS_SSBO_BINDING_INDEX, DRAW_MATERIALS_SSBO_BINDING_INDEX);
+    }
+    else
+    {
+        m_sponza_static_object.m_model->Render(mvp);
+    }
+
+    m_submit_time_accum = (Timer::getTime() - submit_start_time) * 1000.0;
 }
 
 void ClusteredShading::renderLighting()
@@ -851,36 +810,100 @@ void ClusteredShading::renderLighting()
 
     m_tmo_ps->bindFilterFBO(GL_COLOR_BUFFER_BIT);
 
-    auto view_projection = m_camera->m_projection * m_camera->m_view;
-
-    m_clustered_pbr_shader->bind();
-    m_clustered_pbr_shader->setUniform("u_cam_pos",                               m_camera->position());
-    m_clustered_pbr_shader->setUniform("u_near_z",                                m_camera->NearPlane());
-    m_clustered_pbr_shader->setUniform("u_grid_dim",                              m_cluster_grid_dim);
-    m_clustered_pbr_shader->setUniform("u_cluster_size_ss",                       glm::uvec2(m_cluster_grid_block_size));
-    m_clustered_pbr_shader->setUniform("u_log_grid_dim_y",                        m_log_grid_dim_y);
-    m_clustered_pbr_shader->setUniform("u_debug_slices",                          m_debug_slices);
-    m_clustered_pbr_shader->setUniform("u_debug_clusters_occupancy",              m_debug_clusters_occupancy);
-    m_clustered_pbr_shader->setUniform("u_debug_clusters_occupancy_blend_factor", m_debug_clusters_occupancy_blend_factor);
-
-    m_clustered_pbr_shader->setUniform("u_model",         m_sponza_static_object.m_transform);
-    m_clustered_pbr_shader->setUniform("u_view",          m_camera->m_view);
-    m_clustered_pbr_shader->setUniform("u_normal_matrix", glm::mat3(glm::transpose(glm::inverse(m_sponza_static_object.m_transform))));
-    m_clustered_pbr_shader->setUniform("u_mvp",           view_projection * m_sponza_static_object.m_transform);
-
-    m_irradiance_cubemap_rt->bindTexture(6);
-    m_prefiltered_env_map_rt->bindTexture(7);
-    m_brdf_lut_rt->bindTexture(8);
+    auto mvp = m_camera->m_projection * m_camera->m_view * m_sponza_static_object.m_transform;
+
+    auto& clustered_pbr_shader = m_multi_draw_indirect ? m_clustered_pbr_mdi_shader : m_clustered_pbr_shader;
+
+    clustered_pbr_shader->bind();
+    clustered_pbr_shader->setUniform("u_grid_dim",                              m_cluster_grid_dim);
+    clustered_pbr_shader->setUniform("u_cluster_size_ss",                       glm::uvec2(m_cluster_grid_block_size));
+    clustered_pbr_shader->setUniform("u_log_grid_dim_y",                        m_log_grid_dim_y);
+    clustered_pbr_shader->setUniform("u_debug_slices",                          m_debug_slices);
+    clustered_pbr_shader->setUniform("u_debug_clusters_occupancy",              m_debug_clusters_occupancy);
+    clustered_pbr_shader->setUniform("u_debug_clusters_occupancy_blend_factor", m_debug_clusters_occupancy_blend_factor);
+
+    m_ibl.Bind();
     m_ltc_mat_lut->Bind(9);
     m_ltc_amp_lut->Bind(10);
 
-    m_sponza_static_object.m_model->Render(m_clustered_pbr_shader);
+    /* The parts hidden behind the depth pre-pass wouldn't pass the GL_EQUAL depth test anyway. */
+    if (m_gpu_culling)
+    {
+        RGL::ProfileScope scope("Lighting culling");
+        cullMeshParts(mvp, m_gpu_occlusion_culling);
+
+        clustered_pbr_shader->bind();
+    }
+
+    {
+        RGL::ProfileScope scope("Lighting draws");
+
+        const double submit_start_time = Timer::getTime();
+
+        if (m_gpu_culling)
+        {
+            m_sponza_static_object.m_model->RenderIndirectCount(MATERIALS_SSBO_BINDING_INDEX, DRAW_MATERIALS_SSBO_BINDING_INDEX);
+        }
+        else if (m_multi_draw_indirect)
+        {
+            m_sponza_static_object.m_model->RenderIndirect(MATERIALS_SSBO_BINDING_INDEX, DRAW_MATERIALS_SSBO_BINDING_INDEX);
+        }
+        else
+        {
+            m_sponza_static_object.m_model->Render(mvp, m_clustered_pbr_shader);
+        }
+
+        m_submit_time_accum += (Timer::getTime() - submit_start_time) * 1000.0;
+    }
 
     /* Enable writing to the depth buffer. */
     glDepthMask(1);
     glDepthFunc(GL_LEQUAL);
 }
 
+void ClusteredShading::buildHiZ()
+{
+    RGL::ProfileScope scope("Hi-Z build");
+
+    m_build_hiz_shader->bind();
+
+    glBindTextureUnit(0, m_depth_tex2D_id);
+
+    glm::uvec2 level_size = glm::uvec2(RGL::Window::getWidth(), RGL::Window::getHeight());
+
+    for (uint32_t level = 0; level < m_hiz_levels_count; ++level)
+    {
+        m_build_hiz_shader->setUniform("u_copy_depth", level == 0);
+
+        if (level > 0)
+        {
+            glBindImageTexture(0, m_hiz_tex2D_id, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(1, m_hiz_tex2D_id, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute(glm::ceil(level_size.x / 8.0f), glm::ceil(level_size.y / 8.0f), 1);
+        glMemoryBarrier  (GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        level_size = glm::max(level_size / 2u, glm::uvec2(1));
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void ClusteredShading::cullMeshParts(const glm::mat4& mvp, bool occlusion_culling)
+{
+    uint32_t draws_count = m_sponza_static_object.m_model->BindIndirectCullingBuffers(DRAW_INFOS_SSBO_BINDING_INDEX);
+
+    m_cull_mesh_parts_shader->bind();
+    m_cull_mesh_parts_shader->setUniform("u_mvp",               mvp);
+    m_cull_mesh_parts_shader->setUniform("u_draws_count",       draws_count);
+    m_cull_mesh_parts_shader->setUniform("u_occlusion_culling", occlusion_culling);
+
+    glBindTextureUnit(0, m_hiz_tex2D_id);
+    glDispatchCompute(glm::ceil(draws_count / 64.0f), 1, 1);
+    glMemoryBarrier  (GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
 void ClusteredShading::render_gui()
 {
     /* This method is responsible for rendering GUI using ImGUI. */
@@ -1061,7 +1084,7 @@ void ClusteredShading::render_gui()
             ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
             ImGui::SliderFloat("Exposure",             &m_exposure,             0.0, 10.0, "%.1f");
             ImGui::SliderFloat("Gamma",                &m_gamma,                0.0, 10.0, "%.1f");
-            ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_env_cubemap_rt->m_width)), "%.1f");
+            ImGui::SliderFloat("Background LOD level", &m_background_lod_level, 0.0, glm::log2(float(m_ibl.GetEnvironmentSize())), "%.1f");
 
             if (ImGui::BeginCombo("HDR map", m_hdr_maps_names[m_current_hdr_map_idx].c_str()))
             {
@@ -1071,7 +1094,7 @@ void ClusteredShading::render_gui()
                     if (ImGui::Selectable(m_hdr_maps_names[i].c_str(), is_selected))
                     {
                         m_current_hdr_map_idx = i;
-                        PrecomputeIndirectLight(FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
+                        m_ibl.Load(FileSystem::getResourcesPath() / "textures/skyboxes/IBL" / m_hdr_maps_names[m_current_hdr_map_idx]);
                     }
 
                     if (is_selected)
@@ -1093,6 +1116,76 @@ void ClusteredShading::render_gui()
             ImGui::SliderFloat("Bloom dirt intensity", &m_bloom_dirt_intensity, 0.0f, 10.0f, "%.1f");
         }
 
+        if (ImGui::CollapsingHeader("Geometry"))
+        {
+            static const char* vertex_formats_names[] = { "Separate", "Interleaved", "Compact" };
+
+            auto& model                 = m_sponza_static_object.m_model;
+            int   current_vertex_format = int(model->GetVertexFormat());
+
+            /* Rolling average of the frame time for the active vertex format. */
+            auto& frame_time = m_vertex_format_frame_times[current_vertex_format];
+            frame_time = frame_time == 0.0f ? 1000.0f / ImGui::GetIO().Framerate : glm::mix(frame_time, 1000.0f / ImGui::GetIO().Framerate, 0.05f);
+
+            ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+            if (ImGui::Combo("Vertex format", &current_vertex_format, vertex_formats_names, IM_ARRAYSIZE(vertex_formats_names)))
+            {
+                model->SetVertexFormat(VertexFormat(current_vertex_format));
+                model->Load(FileSystem::getResourcesPath() / "models/sponza/Sponza.gltf");
+            }
+            ImGui::PopItemWidth();
+
+            for (int i = 0; i < IM_ARRAYSIZE(vertex_formats_names); ++i)
+            {
+                ImGui::Text("%-12s %2u bytes per vertex, %.3f ms/frame", vertex_formats_names[i], StaticModel::GetBytesPerVertex(VertexFormat(i)), m_vertex_format_frame_times[i]);
+            }
+
+            /* Rolling average of the CPU time spent on submitting the depth pre-pass and the lighting pass draws. */
+            auto& submit_time = m_submit_times[m_multi_draw_indirect];
+            submit_time = submit_time == 0.0f ? float(m_submit_time_accum) : glm::mix(submit_time, float(m_submit_time_accum), 0.05f);
+
+            if (m_clustered_pbr_mdi_shader)
+            {
+                /* The GPU culling draws with the multi-draw indirect shaders. */
+                if (ImGui::Checkbox("Multi-draw indirect", &m_multi_draw_indirect) && !m_multi_draw_indirect)
+                {
+                    m_gpu_culling = false;
+                }
+            }
+            else
+            {
+                ImGui::Text("Multi-draw indirect requires GL_ARB_bindless_texture");
+            }
+
+            ImGui::Text("%-12s %.3f ms CPU submit/frame", "Per part", m_submit_times[0]);
+            ImGui::Text("%-12s %.3f ms CPU submit/frame", "Indirect", m_submit_times[1]);
+
+            ImGui::Separator();
+
+            if (m_clustered_pbr_mdi_shader)
+            {
+                if (ImGui::Checkbox("GPU culling", &m_gpu_culling) && m_gpu_culling)
+                {
+                    m_multi_draw_indirect = true;
+                }
+
+                if (m_gpu_culling)
+                {
+                    ImGui::Checkbox("Hi-Z occlusion culling", &m_gpu_occlusion_culling);
+                }
+            }
+
+            /* Rolling averages of the profiler, the whole frame is in the Profiler window. */
+            ImGui::Text("GPU time/frame:");
+            for (const char* pass : { "Depth culling", "Depth draws", "Hi-Z build", "Lighting culling", "Lighting draws" })
+            {
+                if (auto stats = RGL::Profiler::FindStats(pass))
+                {
+                    ImGui::Text("%-16s %.3f ms (p95 %.3f ms)", pass, stats->gpu_average, RGL::Profiler::GetPercentile(*stats, 0.95f, true));
+                }
+            }
+        }
+
     }
     ImGui::End();
 }
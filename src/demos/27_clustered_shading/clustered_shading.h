@@ -2,8 +2,10 @@
 #include "core_app.h"
 
 #include "camera.h"
+#include "ibl.h"
 #include "static_model.h"
 #include "shader.h"
+#include "window.h"
 #include "shared.h"
 
 #include <memory>
@@ -239,7 +241,7 @@ private:
 
         void render(float exposure, float gamma)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, RGL::Window::getDefaultFramebuffer());
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             m_shader->bind();
@@ -252,134 +254,44 @@ private:
         }
     };
 
-    struct CubeMapRenderTarget
-    {
-        glm::mat4 m_view_transforms[6];
-        glm::mat4 m_projection;
-
-        GLuint    m_cubemap_texture_id = 0;
-        GLuint    m_fbo_id             = 0;
-        GLuint    m_rbo_id             = 0;
-        glm::vec3 m_position           = glm::vec3(0.0f);
-        GLuint m_width, m_height;
-
-        ~CubeMapRenderTarget() { cleanup(); }
-
-        void set_position(const glm::vec3 pos)
-        {
-            m_position = pos;
-            m_view_transforms[0] = glm::lookAt(pos, pos + glm::vec3( 1,  0,  0), glm::vec3(0, -1,  0));
-            m_view_transforms[1] = glm::lookAt(pos, pos + glm::vec3(-1,  0,  0), glm::vec3(0, -1,  0));
-            m_view_transforms[2] = glm::lookAt(pos, pos + glm::vec3( 0,  1,  0), glm::vec3(0,  0,  1));
-            m_view_transforms[3] = glm::lookAt(pos, pos + glm::vec3( 0, -1,  0), glm::vec3(0,  0, -1));
-            m_view_transforms[4] = glm::lookAt(pos, pos + glm::vec3( 0,  0,  1), glm::vec3(0, -1,  0));
-            m_view_transforms[5] = glm::lookAt(pos, pos + glm::vec3( 0,  0, -1), glm::vec3(0, -1,  0));
-
-            m_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-        }
-
-        void bindTexture(GLuint unit = 0)
-        {
-            glBindTextureUnit(unit, m_cubemap_texture_id);
-        }
-
-        void cleanup()
-        {
-            if (m_cubemap_texture_id != 0)
-            {
-                glDeleteTextures(1, &m_cubemap_texture_id);
-            }
-
-            if (m_fbo_id != 0)
-            {
-                glDeleteFramebuffers(1, &m_fbo_id);
-            }
-
-            if (m_rbo_id != 0)
-            {
-                glDeleteRenderbuffers(1, &m_rbo_id);
-            }
-        }
-
-        void generate_rt(uint32_t width, uint32_t height, bool gen_mip_levels = false)
-        {
-            m_width  = width;
-            m_height = height;
-
-            glGenTextures(1, &m_cubemap_texture_id);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture_id);
-
-            for (uint8_t i = 0; i < 6; ++i)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, 0);
-            }
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, gen_mip_levels ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-            if (gen_mip_levels) glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-            glGenFramebuffers(1, &m_fbo_id);
-            glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_id);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_cubemap_texture_id, 0);
-
-            glGenRenderbuffers(1, &m_rbo_id);
-            glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_id);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo_id);
-
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-    }; 
-
     void GenerateAreaLights();
     void GeneratePointLights();
     void GenerateSpotLights();
     void UpdateLightsSSBOs();
 
-    void HdrEquirectangularToCubemap(const std::shared_ptr<CubeMapRenderTarget> & cubemap_rt, const std::shared_ptr<RGL::Texture2D> & m_equirectangular_map);
-    void IrradianceConvolution      (const std::shared_ptr<CubeMapRenderTarget> & cubemap_rt);
-    void PrefilterCubemap           (const std::shared_ptr<CubeMapRenderTarget>& cubemap_rt);
-    void PrecomputeIndirectLight    (const std::filesystem::path & hdri_map_filepath);
-    void PrecomputeBRDF             (const std::shared_ptr<Texture2DRenderTarget>& rt);
     void GenSkyboxGeometry();
 
     void renderDepthPass();
     void renderLighting();
+    void buildHiZ();
+    void cullMeshParts(const glm::mat4& mvp, bool occlusion_culling);
 
     std::shared_ptr<RGL::Camera> m_camera;
 
-    std::shared_ptr<CubeMapRenderTarget>   m_env_cubemap_rt;
-    std::shared_ptr<CubeMapRenderTarget>   m_irradiance_cubemap_rt;
-    std::shared_ptr<CubeMapRenderTarget>   m_prefiltered_env_map_rt;
-    std::shared_ptr<Texture2DRenderTarget> m_brdf_lut_rt;
+    RGL::IBL m_ibl;
 
-    std::shared_ptr<RGL::Shader> m_equirectangular_to_cubemap_shader;
-    std::shared_ptr<RGL::Shader> m_irradiance_convolution_shader;
-    std::shared_ptr<RGL::Shader> m_prefilter_env_map_shader;
-    std::shared_ptr<RGL::Shader> m_precompute_brdf;
     std::shared_ptr<RGL::Shader> m_background_shader;
 
     /// Clustered shading variables.
     std::shared_ptr<RGL::Shader> m_depth_prepass_shader;
+    std::shared_ptr<RGL::Shader> m_depth_prepass_mdi_shader;
     std::shared_ptr<RGL::Shader> m_generate_clusters_shader;
     std::shared_ptr<RGL::Shader> m_find_visible_clusters_shader;
     std::shared_ptr<RGL::Shader> m_find_unique_clusters_shader;
     std::shared_ptr<RGL::Shader> m_update_cull_lights_indirect_args_shader;
     std::shared_ptr<RGL::Shader> m_cull_lights_shader;
     std::shared_ptr<RGL::Shader> m_clustered_pbr_shader;
+    std::shared_ptr<RGL::Shader> m_clustered_pbr_mdi_shader;
     std::shared_ptr<RGL::Shader> m_update_lights_shader;
+    std::shared_ptr<RGL::Shader> m_build_hiz_shader;
+    std::shared_ptr<RGL::Shader> m_cull_mesh_parts_shader;
 
     std::shared_ptr<RGL::Shader> m_draw_area_lights_geometry_shader;
 
     GLuint m_depth_tex2D_id;
     GLuint m_depth_pass_fbo_id;
+    GLuint m_hiz_tex2D_id;          // Farthest depth pyramid of the depth pre-pass, used by the GPU occlusion culling.
+    GLuint m_hiz_levels_count;
 
     GLuint m_clusters_ssbo;
     GLuint m_cull_lights_dispatch_args_ssbo;
@@ -435,6 +347,12 @@ private:
     std::vector<glm::vec4>        m_spot_lights_ellipses_radii;  // [x, y, z] => [ellipse a radius, ellipse b radius, light move speed]
 
     StaticObject m_sponza_static_object;
+    float        m_vertex_format_frame_times[3] = { 0.0f }; // Average frame time [ms] measured for each of the vertex formats.
+    bool         m_multi_draw_indirect          = false;
+    double       m_submit_time_accum            = 0.0;      // CPU time [ms] spent on submitting Sponza's draws in the current frame.
+    float        m_submit_times[2]              = { 0.0f }; // Average CPU submit time [ms] per frame, [0] - per mesh part draws, [1] - multi-draw indirect.
+    bool         m_gpu_culling                  = false;    // Frustum and Hi-Z occlusion culling in a compute shader, requires multi-draw indirect.
+    bool         m_gpu_occlusion_culling        = true;
 
     GLuint m_directional_lights_ssbo;
     GLuint m_point_lights_ssbo;
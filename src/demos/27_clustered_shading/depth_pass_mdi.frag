@@ -0,0 +1,19 @@
+#version 460
+#extension GL_ARB_bindless_texture : require
+#include "shared.h"
+#include "materials_mdi.glh"
+
+layout(location = 0) in vec2 texcoord;
+layout(location = 1) flat in uint in_draw_id;
+
+void main()
+{
+	uvec2 albedo_handle = MATERIAL.texture_handles[0];
+
+	if (albedo_handle != uvec2(0))
+	{
+		float alpha = texture(sampler2D(albedo_handle), texcoord).a;
+
+		if (alpha < 0.5) discard;
+	}
+}
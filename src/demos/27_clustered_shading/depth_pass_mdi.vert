@@ -0,0 +1,14 @@
+#version 460
+#include "../../core/uniform_blocks.h"
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec2 in_texcoord;
+
+layout(location = 0) out vec2 texcoord;
+layout(location = 1) flat out uint out_draw_id;
+
+void main()
+{
+	texcoord    = in_texcoord;
+	out_draw_id = gl_DrawID;
+	gl_Position = u_object.mvp * vec4(in_pos, 1.0);
+}
@@ -5,9 +5,10 @@
 
 using namespace RGL;
 
-int main()
+int main(int argc, char* argv[])
 {
     std::shared_ptr<CoreApp> app = std::make_shared<ClusteredShading>();
+    app->parse_command_line(argc, argv);
     app->init(1920, 1080, "Clustered Shading Demo" /*title*/, 6000.0 /*framerate*/);
     app->start();
 
@@ -0,0 +1,5 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+
+#define MULTI_DRAW_INDIRECT
+#include "pbr_clustered.glh"
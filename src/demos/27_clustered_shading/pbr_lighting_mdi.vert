@@ -0,0 +1,3 @@
+#version 460 core
+#define MULTI_DRAW_INDIRECT
+#include "pbr_lighting_vs.glh"
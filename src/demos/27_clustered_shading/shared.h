@@ -22,6 +22,13 @@
 #define AREA_LIGHTS_SSBO_BINDING_INDEX                 13
 #define AREA_LIGHT_INDEX_LIST_SSBO_BINDING_INDEX       14
 #define AREA_LIGHT_GRID_SSBO_BINDING_INDEX             15
+#define MATERIALS_SSBO_BINDING_INDEX                   16
+#define DRAW_MATERIALS_SSBO_BINDING_INDEX              17
+#define DRAW_INFOS_SSBO_BINDING_INDEX                  18 // StaticModel::BindIndirectCullingBuffers() binds 5 consecutive buffers starting here
+#define DRAW_COMMANDS_SSBO_BINDING_INDEX               19
+#define CULLED_DRAW_COMMANDS_SSBO_BINDING_INDEX        20
+#define CULLED_DRAW_MATERIALS_SSBO_BINDING_INDEX       21
+#define DRAW_COUNTS_SSBO_BINDING_INDEX                 22
 
 struct BaseLight
 {
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <vector>
+
+#include "animated_model.h"
+#include "animation_lod.h"
+#include "filesystem.h"
+#include "window.h"
+
+/* Checks that the steady state animation update doesn't allocate: loads the skinned model of the mesh skinning demo, warms up
+ * the per thread buffers and counts the heap allocations of the following updates. Returns EXIT_FAILURE if any update allocated.
+ * It's a separate executable, since it replaces the global operator new of the whole process. */
+
+static std::atomic<uint64_t> g_allocations_count = 0;
+
+void* operator new(std::size_t size)
+{
+    g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size > 0 ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace RGL;
+
+static constexpr uint32_t MAX_INSTANCES       = 1024; /* Enough for ParallelFor() to use all of the workers. */
+static constexpr uint32_t LAYERS_PER_INSTANCE = 2;
+static constexpr uint32_t WARMUP_UPDATES      = 16;
+static constexpr uint32_t MEASURED_UPDATES    = 64;
+static constexpr float    DELTA_TIME          = 1.0f / 60.0f;
+
+/* Returns the number of allocations done by MEASURED_UPDATES calls of update, after WARMUP_UPDATES calls. */
+template<typename Update>
+static uint64_t CountAllocations(const char* name, const Update& update)
+{
+    for (uint32_t i = 0; i < WARMUP_UPDATES; ++i)
+    {
+        update();
+    }
+
+    const uint64_t allocations_count = g_allocations_count;
+
+    for (uint32_t i = 0; i < MEASURED_UPDATES; ++i)
+    {
+        update();
+    }
+
+    const uint64_t update_allocations_count = g_allocations_count - allocations_count;
+
+    printf("%-40s %s (%llu allocations in %u updates)\n", name, update_allocations_count == 0 ? "passed" : "FAILED", (unsigned long long)update_allocations_count, MEASURED_UPDATES);
+
+    return update_allocations_count;
+}
+
+int main()
+{
+    Window::createHeadless(1, 1, "Animation allocations");
+
+    AnimatedModel model;
+
+    if (!model.Load(FileSystem::getResourcesPath() / "models/fox.glb") || model.GetAnimationsCount() == 0)
+    {
+        fprintf(stderr, "Could not load an animated model.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* The overlay layer uses a bone mask, so that the masked blend is covered too. */
+    const uint32_t bone_mask = model.CreateBoneMask(model.GetSkeleton().GetNodeName(model.GetSkeleton().GetNodesCount() / 2));
+
+    std::vector<AnimationLayer> layers(MAX_INSTANCES * LAYERS_PER_INSTANCE);
+
+    for (uint32_t i = 0; i < MAX_INSTANCES; ++i)
+    {
+        layers[i * LAYERS_PER_INSTANCE + 0].state.time = float(i) * 0.01f;
+        layers[i * LAYERS_PER_INSTANCE + 1].weight     = 0.5f;
+        layers[i * LAYERS_PER_INSTANCE + 1].bone_mask  = bone_mask;
+
+        /* Some of the instances cross-fade all the time. */
+        if (i % 2 == 0)
+        {
+            layers[i * LAYERS_PER_INSTANCE + 0].state.CrossFade((i / 2) % model.GetAnimationsCount(), 1000.0f);
+        }
+    }
+
+    std::vector<glm::mat4>   palettes   (MAX_INSTANCES * model.GetBonesCount());
+    std::vector<glm::mat2x4> palettes_dq(MAX_INSTANCES * model.GetBonesCount());
+    std::vector<glm::vec3>   positions  (MAX_INSTANCES);
+
+    for (uint32_t i = 0; i < MAX_INSTANCES; ++i)
+    {
+        positions[i] = glm::vec3(float(i % 32), 0.0f, float(i / 32)) * 1.5f;
+    }
+
+    AnimationLodSystem lod_system;
+    lod_system.Resize(MAX_INSTANCES);
+    lod_system.SelectLods(positions, 0.5f, glm::vec3(0.0f, 1.0f, -2.0f), 1.7f);
+
+    uint64_t allocations_count = 0;
+
+    for (uint32_t instances_count : { 1u, MAX_INSTANCES })
+    {
+        auto instances_layers   = std::span(layers).first(instances_count * LAYERS_PER_INSTANCE);
+        auto instances_palettes = std::span(palettes);
+        auto instances_dq       = std::span(palettes_dq);
+        char name[64];
+
+        snprintf(name, sizeof(name), "UpdateInstances, LBS, %u instances", instances_count);
+        allocations_count += CountAllocations(name, [&] { model.UpdateInstances(DELTA_TIME, instances_layers, LAYERS_PER_INSTANCE, instances_palettes); });
+
+        snprintf(name, sizeof(name), "UpdateInstances, DQS, %u instances", instances_count);
+        allocations_count += CountAllocations(name, [&] { model.UpdateInstances(DELTA_TIME, instances_layers, LAYERS_PER_INSTANCE, instances_dq); });
+    }
+
+    lod_system.m_settings.max_bone_evaluations = MAX_INSTANCES * model.GetSkeleton().GetNodesCount() / 4;
+
+    allocations_count += CountAllocations("AnimationLodSystem::Update, LBS", [&] { lod_system.Update(model, DELTA_TIME, layers, LAYERS_PER_INSTANCE, std::span(palettes)); });
+
+    lod_system.Invalidate();
+    allocations_count += CountAllocations("AnimationLodSystem::Update, DQS", [&] { lod_system.Update(model, DELTA_TIME, layers, LAYERS_PER_INSTANCE, std::span(palettes_dq)); });
+
+    return allocations_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}